@@ -0,0 +1,124 @@
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+#include "AllocCounter.h"
+
+namespace {
+	// Counters are atomic because the replacement operators can be called from any thread.
+	std::atomic<unsigned long long> allocCount{ 0 };
+	std::atomic<unsigned long long> allocBytes{ 0 };
+
+	struct Phase {
+		const char* name;
+		unsigned long long allocations;
+		unsigned long long bytes;
+	};
+
+	Phase phases[AllocCounter::MAX_PHASES];
+	int phaseCount = 0;
+	bool phaseOpen = false;
+
+	unsigned long long steadyAllocs = 0;
+	unsigned long long steadyBytes = 0;
+}
+
+#ifdef LISP_ALLOC_COUNTER
+
+// Replacement of the global allocation functions: every allocation is counted and forwarded to malloc.
+// The array and nothrow forms provided by the standard library call these ones, so they are counted too.
+
+void* operator new(std::size_t size) {
+	allocCount.fetch_add(1, std::memory_order_relaxed);
+	allocBytes.fetch_add(size, std::memory_order_relaxed);
+	if (void* p = std::malloc(size ? size : 1)) {
+		return p;
+	}
+	throw std::bad_alloc();
+}
+
+void* operator new(std::size_t size, std::align_val_t al) {
+	allocCount.fetch_add(1, std::memory_order_relaxed);
+	allocBytes.fetch_add(size, std::memory_order_relaxed);
+	std::size_t alignment = static_cast<std::size_t>(al);
+	// aligned_alloc requires the size to be a multiple of the alignment
+	std::size_t rounded = (size + alignment - 1) / alignment * alignment;
+	if (void* p = std::aligned_alloc(alignment, rounded ? rounded : alignment)) {
+		return p;
+	}
+	throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept {
+	std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept {
+	std::free(p);
+}
+
+void operator delete(void* p, std::align_val_t) noexcept {
+	std::free(p);
+}
+
+void operator delete(void* p, std::size_t, std::align_val_t) noexcept {
+	std::free(p);
+}
+
+#endif
+
+bool AllocCounter::isCompiledIn() {
+#ifdef LISP_ALLOC_COUNTER
+	return true;
+#else
+	return false;
+#endif
+}
+
+unsigned long long AllocCounter::allocations() {
+	return allocCount.load(std::memory_order_relaxed);
+}
+
+unsigned long long AllocCounter::bytes() {
+	return allocBytes.load(std::memory_order_relaxed);
+}
+
+void AllocCounter::beginPhase(const char* name) {
+	endPhase();
+	if (phaseCount == MAX_PHASES) {
+		return;
+	}
+	// The phase stores the counters at its beginning; endPhase turns them into differences.
+	phases[phaseCount] = Phase{ name, allocations(), bytes() };
+	phaseOpen = true;
+}
+
+void AllocCounter::endPhase() {
+	if (!phaseOpen) {
+		return;
+	}
+	Phase& p = phases[phaseCount++];
+	p.allocations = allocations() - p.allocations;
+	p.bytes = bytes() - p.bytes;
+	phaseOpen = false;
+}
+
+void AllocCounter::addSteadyStateLoop(unsigned long long allocs, unsigned long long allocBytesCount) {
+	steadyAllocs += allocs;
+	steadyBytes += allocBytesCount;
+}
+
+void AllocCounter::report(std::ostream& os) {
+	if (!isCompiledIn()) {
+		os << "Allocation counter not compiled in (build with -DLISP_ALLOC_COUNTER)" << std::endl;
+		return;
+	}
+	endPhase();
+	os << "Allocations per phase:" << std::endl;
+	for (int i = 0; i < phaseCount; ++i) {
+		os << "  " << phases[i].name << ": " << phases[i].allocations << " allocations, "
+			<< phases[i].bytes << " bytes" << std::endl;
+	}
+	os << "  loop iterations after the first: " << steadyAllocs << " allocations, "
+		<< steadyBytes << " bytes" << std::endl;
+}
@@ -0,0 +1,36 @@
+#ifndef ALLOCCOUNTER_H
+#define ALLOCCOUNTER_H
+
+#include <ostream>
+
+// The allocation counter replaces the global operator new/delete when the program is compiled with
+// -DLISP_ALLOC_COUNTER. Without that flag the replacement is not compiled in, the counters stay at zero
+// and the interpreter keeps using the standard allocator.
+// It is used to check that the evaluation of a loop does not allocate once it reaches a steady state.
+class AllocCounter
+{
+public:
+	// Maximum number of phases that can be recorded (a fixed array, so recording a phase never allocates).
+	static constexpr int MAX_PHASES = 16;
+
+	// True when the replacement operators are compiled in.
+	static bool isCompiledIn();
+
+	// Total number of allocations and allocated bytes since the start of the program.
+	static unsigned long long allocations();
+	static unsigned long long bytes();
+
+	// A phase records the allocations performed between beginPhase and endPhase.
+	// Phases are not nested: beginning a phase ends the previous one.
+	static void beginPhase(const char* name);
+	static void endPhase();
+
+	// Loop iterations after the first one of every WHILE are expected to be allocation free.
+	// The evaluator reports what they allocated here (only when the counter is compiled in).
+	static void addSteadyStateLoop(unsigned long long allocs, unsigned long long allocBytes);
+
+	// Writes the recorded phases in human-readable form.
+	static void report(std::ostream& os);
+};
+
+#endif
@@ -0,0 +1,326 @@
+#include <sstream>
+
+#include "AssignmentAnalysis.h"
+
+std::vector<AssignmentAnalysis::Warning> AssignmentAnalysis::operator()(Program* progNode) {
+	slots.clear();
+	names.clear();
+	must.clear();
+	may.clear();
+	uses.clear();
+	mustTrail.clear();
+	mayTrail.clear();
+	warnings.clear();
+	collecting = false;
+	current = nullptr;
+	accesses.clear();
+	parallelDepth = 0;
+	parallelStatements = 0;
+	readsInput = false;
+	progNode->accept(this);
+	progNode->setSlotNames(names);
+	progNode->setParallelStatements(parallelStatements);
+	progNode->setReadsInput(readsInput);
+	return std::move(warnings);
+}
+
+int AssignmentAnalysis::slotOf(const std::string& name) {
+	auto found = slots.find(name);
+	if (found != slots.end()) {
+		return found->second;
+	}
+	int slot = static_cast<int>(names.size());
+	slots.emplace(name, slot);
+	names.push_back(name);
+	must.push_back(false);
+	may.push_back(false);
+	uses.push_back(UNUSED);
+	return slot;
+}
+
+void AssignmentAnalysis::use(int slot, Use u, const Statement* stmt) {
+	if (uses[slot] == UNUSED) {
+		uses[slot] = u;
+	}
+	else if (uses[slot] != u) {
+		std::stringstream tmp{};
+		tmp << "Variable " << names[slot] << " used both as a number and as an array (line " << stmt->getLine()
+			<< ", column " << stmt->getColumn() << ")";
+		throw SemanticError(tmp.str());
+	}
+}
+
+void AssignmentAnalysis::read(Variable* varNode) {
+	int slot = slotOf(varNode->getVarId());
+	if (parallelDepth != 0) {
+		accesses.emplace_back(slot, false);
+	}
+	if (must[slot]) {
+		varNode->resolve(slot, Variable::ASSIGNED);
+	}
+	else if (may[slot]) {
+		varNode->resolve(slot, Variable::MAYBE_ASSIGNED);
+	}
+	else {
+		varNode->resolve(slot, Variable::NEVER_ASSIGNED);
+		warnings.push_back(Warning{ varNode->getVarId(), current->getLine(), current->getColumn() });
+	}
+}
+
+void AssignmentAnalysis::assign(int slot) {
+	if (parallelDepth != 0) {
+		accesses.emplace_back(slot, true);
+	}
+	if (!collecting && !must[slot]) {
+		must[slot] = true;
+		mustTrail.push_back(slot);
+	}
+	if (!may[slot]) {
+		may[slot] = true;
+		mayTrail.push_back(slot);
+	}
+}
+
+void AssignmentAnalysis::undoMust(size_t mark) {
+	while (mustTrail.size() > mark) {
+		must[mustTrail.back()] = false;
+		mustTrail.pop_back();
+	}
+}
+
+void AssignmentAnalysis::visitProgram(Program* progNode) {
+	progNode->getBlock()->accept(this);
+}
+
+void AssignmentAnalysis::visitBlock(Block* blockNode) {
+	for (auto i : blockNode->getVector()) {
+		i->accept(this);
+	}
+}
+
+void AssignmentAnalysis::visitPrintStmt(PrintStmt* printStmtNode) {
+	if (collecting) {
+		return;
+	}
+	current = printStmtNode;
+	printStmtNode->getPrinter()->accept(this);
+}
+
+void AssignmentAnalysis::visitSetStmt(SetStmt* setStmtNode) {
+	Variable* var = setStmtNode->getVar();
+	if (!collecting) {
+		// The value is computed before the variable is assigned
+		current = setStmtNode;
+		setStmtNode->getSetter()->accept(this);
+	}
+	int slot = slotOf(var->getVarId());
+	use(slot, NUMBER, setStmtNode);
+	// The target of an assignment is never read, it only needs its slot
+	var->resolve(slot, Variable::ASSIGNED);
+	assign(slot);
+}
+
+void AssignmentAnalysis::visitInputStmt(InputStmt* inputStmtNode) {
+	if (parallelDepth != 0) {
+		std::stringstream tmp{};
+		tmp << "INPUT in a PARALLEL statement (line " << inputStmtNode->getLine() << ", column " << inputStmtNode->getColumn() << ")";
+		throw SemanticError(tmp.str());
+	}
+	readsInput = true;
+	Variable* var = inputStmtNode->getVar();
+	int slot = slotOf(var->getVarId());
+	use(slot, NUMBER, inputStmtNode);
+	var->resolve(slot, Variable::ASSIGNED);
+	assign(slot);
+}
+
+void AssignmentAnalysis::visitWhileStmt(WhileStmt* whileStmtNode) {
+	Block* body = whileStmtNode->getReppeter();
+	if (collecting) {
+		body->accept(this);
+		return;
+	}
+	// The condition and the body also run after any number of iterations:
+	// what the body may assign is added to may before analysing them
+	collecting = true;
+	body->accept(this);
+	collecting = false;
+	current = whileStmtNode;
+	whileStmtNode->getCondition()->accept(this);
+	// The body may run zero times, so what it assigns is not added to must
+	size_t mark = mustTrail.size();
+	body->accept(this);
+	undoMust(mark);
+}
+
+void AssignmentAnalysis::visitIfStmt(IfStmt* ifStmtNode) {
+	if (collecting) {
+		ifStmtNode->getIfBlock()->accept(this);
+		ifStmtNode->getElseBlock()->accept(this);
+		return;
+	}
+	current = ifStmtNode;
+	ifStmtNode->getCondition()->accept(this);
+
+	// The if branch, then its additions are removed from both sets so that the else branch starts from the same state
+	size_t mustMark = mustTrail.size(), mayMark = mayTrail.size();
+	ifStmtNode->getIfBlock()->accept(this);
+	std::vector<int> ifMust(mustTrail.begin() + mustMark, mustTrail.end());
+	std::vector<int> ifMay(mayTrail.begin() + mayMark, mayTrail.end());
+	undoMust(mustMark);
+	while (mayTrail.size() > mayMark) {
+		may[mayTrail.back()] = false;
+		mayTrail.pop_back();
+	}
+
+	ifStmtNode->getElseBlock()->accept(this);
+
+	// must: only the variables assigned by both branches are kept.
+	// The else additions are marked with 2 and those also assigned by the if branch raised to 3.
+	for (size_t i = mustMark; i < mustTrail.size(); ++i) {
+		must[mustTrail[i]] = 2;
+	}
+	for (int slot : ifMust) {
+		if (must[slot] == 2) {
+			must[slot] = 3;
+		}
+	}
+	size_t kept = mustMark;
+	for (size_t i = mustMark; i < mustTrail.size(); ++i) {
+		int slot = mustTrail[i];
+		if (must[slot] == 3) {
+			must[slot] = true;
+			mustTrail[kept++] = slot;
+		}
+		else {
+			must[slot] = false;
+		}
+	}
+	mustTrail.resize(kept);
+	// may: the variables assigned by either branch
+	for (int slot : ifMay) {
+		if (!may[slot]) {
+			may[slot] = true;
+			mayTrail.push_back(slot);
+		}
+	}
+}
+
+void AssignmentAnalysis::visitParallelStmt(ParallelStmt* parallelStmtNode) {
+	const std::vector<Block*>& children = parallelStmtNode->getChildren();
+	if (collecting) {
+		for (auto i : children) {
+			i->accept(this);
+		}
+		return;
+	}
+	// The children are analysed in order, recording what each of them uses (a nested PARALLEL records in its child)
+	std::vector<size_t> marks;
+	++parallelDepth;
+	for (auto i : children) {
+		marks.push_back(accesses.size());
+		i->accept(this);
+	}
+	marks.push_back(accesses.size());
+	--parallelDepth;
+
+	// For every variable: the first child using it, whether other children use it too, and whether it is assigned
+	std::vector<int> user(names.size(), -1);
+	std::vector<char> shared(names.size(), false), assigned(names.size(), false);
+	for (size_t c = 0; c < children.size(); ++c) {
+		for (size_t a = marks[c]; a < marks[c + 1]; ++a) {
+			int slot = accesses[a].first;
+			if (user[slot] < 0) {
+				user[slot] = static_cast<int>(c);
+			}
+			else if (user[slot] != static_cast<int>(c)) {
+				shared[slot] = true;
+			}
+			assigned[slot] = assigned[slot] || accesses[a].second;
+		}
+	}
+	for (size_t a = marks.front(); a < marks.back(); ++a) {
+		int slot = accesses[a].first;
+		if (shared[slot] && assigned[slot]) {
+			std::stringstream tmp{};
+			tmp << "Variable " << names[slot] << " assigned by a block of the PARALLEL statement and used by another one (line "
+				<< parallelStmtNode->getLine() << ", column " << parallelStmtNode->getColumn() << ")";
+			throw SemanticError(tmp.str());
+		}
+	}
+	if (parallelDepth == 0) {
+		accesses.clear();
+	}
+	parallelStmtNode->setChecked(true);
+	++parallelStatements;
+}
+
+void AssignmentAnalysis::visitArrayStmt(ArrayStmt* arrayStmtNode) {
+	Variable* array = arrayStmtNode->getArray();
+	if (!collecting) {
+		// The operands are used before the array is changed or replaced
+		current = arrayStmtNode;
+		if (arrayStmtNode->isElementWise()) {
+			for (Variable* operand : { arrayStmtNode->getLeft(), arrayStmtNode->getRight() }) {
+				use(slotOf(operand->getVarId()), ARRAY, arrayStmtNode);
+				read(operand);
+			}
+		}
+		else {
+			arrayStmtNode->getOperand()->accept(this);
+			if (arrayStmtNode->getElement()) {
+				arrayStmtNode->getElement()->accept(this);
+			}
+		}
+	}
+	int slot = slotOf(array->getVarId());
+	use(slot, ARRAY, arrayStmtNode);
+	if (arrayStmtNode->getKind() != ArrayStmt::PUT) {
+		array->resolve(slot, Variable::ASSIGNED);
+		assign(slot);
+	}
+	else if (!collecting) {
+		// PUT changes an array that must exist: a read, and an assignment for the PARALLEL checks only
+		read(array);
+		if (parallelDepth != 0) {
+			accesses.emplace_back(slot, true);
+		}
+	}
+}
+
+void AssignmentAnalysis::visitOperator(Operator* opNode) {
+	opNode->getLeft()->accept(this);
+	opNode->getRight()->accept(this);
+}
+
+void AssignmentAnalysis::visitNumber(Number*) {
+}
+
+void AssignmentAnalysis::visitVariable(Variable* varNode) {
+	use(slotOf(varNode->getVarId()), NUMBER, current);
+	read(varNode);
+}
+
+void AssignmentAnalysis::visitArrayExpr(ArrayExpr* arrayExprNode) {
+	Variable* array = arrayExprNode->getArray();
+	use(slotOf(array->getVarId()), ARRAY, current);
+	read(array);
+	if (arrayExprNode->getIndex()) {
+		arrayExprNode->getIndex()->accept(this);
+	}
+}
+
+void AssignmentAnalysis::visitRelOp(RelOp* relOpNode) {
+	relOpNode->getLeft()->accept(this);
+	relOpNode->getRight()->accept(this);
+}
+
+void AssignmentAnalysis::visitBoolConst(BoolConst*) {
+}
+
+void AssignmentAnalysis::visitBoolOp(BoolOp* boolOpNode) {
+	boolOpNode->getLeft()->accept(this);
+	if (boolOpNode->getBoolOpCode() != BoolOp::NOT) {
+		boolOpNode->getRight()->accept(this);
+	}
+}
@@ -0,0 +1,91 @@
+#ifndef ASSIGNMENTANALYSIS_H
+#define ASSIGNMENTANALYSIS_H
+
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "Visitor.h"
+
+// The AssignmentAnalysis is a definite assignment analysis run on the syntax tree before the evaluation.
+// It gives every variable of the program a slot (its position in the SymbolTable, so the evaluator never looks a
+// variable up by name) and classifies every read of a variable:
+// - ASSIGNED: the variable is assigned on every path reaching the read, which is evaluated without checks;
+// - MAYBE_ASSIGNED: it depends on the path, the evaluator keeps the "Variable does not exist" check;
+// - NEVER_ASSIGNED: no path assigns it first, the read fails whenever it is reached and is reported as a warning.
+// The state of the analysis is the set of variables assigned on every path (must) and on some path (may).
+// Variables are only ever added to them, so an IF is the intersection (must) and the union (may) of its branches,
+// and a WHILE adds to "may" what its body assigns, as its condition and body also run after previous iterations.
+// It also checks the PARALLEL statements, whose children may run in any order: a variable assigned by one of them
+// cannot be used by another one, and they cannot read the input, so that running them one after the other gives
+// the same result. The children are then analysed as the statements of a block. A violation raises SemanticError.
+// Arrays have slots too: ARRAY and the element-wise operations assign their array, the other uses read it, and PUT
+// also counts as an assignment for the PARALLEL checks. A name used both as a number and as an array raises
+// SemanticError.
+class AssignmentAnalysis : public Visitor {
+public:
+	// A read of a variable that is never assigned before it, at the position of its statement.
+	struct Warning {
+		std::string variable;
+		int line;
+		int column;
+	};
+
+	// Resolves and classifies all the variables of the program, stores the names of its slots in the program
+	// and returns the reads of never assigned variables.
+	std::vector<Warning> operator()(Program* progNode);
+
+	void visitProgram(Program* progNode) override;
+	void visitBlock(Block* blockNode) override;
+
+	void visitPrintStmt(PrintStmt* printStmtNode) override;
+	void visitSetStmt(SetStmt* setStmtNode) override;
+	void visitInputStmt(InputStmt* inputStmtNode) override;
+	void visitWhileStmt(WhileStmt* whileStmtNode) override;
+	void visitIfStmt(IfStmt* ifStmtNode) override;
+	void visitParallelStmt(ParallelStmt* parallelStmtNode) override;
+	void visitArrayStmt(ArrayStmt* arrayStmtNode) override;
+
+	void visitOperator(Operator* opNode) override;
+	void visitNumber(Number* numNode) override;
+	void visitVariable(Variable* varNode) override;
+	void visitArrayExpr(ArrayExpr* arrayExprNode) override;
+
+	void visitRelOp(RelOp* relOpNode) override;
+	void visitBoolConst(BoolConst* boolConstNode) override;
+	void visitBoolOp(BoolOp* boolOpNode) override;
+
+private:
+	// What a slot is used for, by its first use.
+	enum Use : char { UNUSED, NUMBER, ARRAY };
+
+	// Slot of a variable, created on its first occurrence.
+	int slotOf(const std::string& name);
+	// Records the use of the slot in the statement, which must be the use of its previous occurrences.
+	void use(int slot, Use u, const Statement* stmt);
+	// Resolves and classifies a read of the variable (or array) in the current statement.
+	void read(Variable* varNode);
+	// The statement assigns the variable: it is added to must and may (recording the additions to undo them).
+	void assign(int slot);
+	// Removes from must the additions recorded after the given mark.
+	void undoMust(size_t mark);
+
+	std::unordered_map<std::string, int> slots;
+	std::vector<std::string> names;
+	std::vector<char> must, may;
+	std::vector<Use> uses;
+	// Variables added to must and may, in order, so that a branch can be undone without copying the sets.
+	std::vector<int> mustTrail, mayTrail;
+	// While collecting, only the assignments are recorded in may (the body of a WHILE, before analysing its condition).
+	bool collecting = false;
+	const Statement* current = nullptr;
+	std::vector<Warning> warnings;
+	// Inside the children of PARALLEL statements: the slots read (false) and assigned (true), in order.
+	std::vector<std::pair<int, bool>> accesses;
+	size_t parallelDepth = 0;
+	size_t parallelStatements = 0;
+	bool readsInput = false;
+};
+
+#endif
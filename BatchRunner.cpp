@@ -0,0 +1,105 @@
+#include <condition_variable>
+#include <fstream>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+
+#include "BatchRunner.h"
+#include "ThreadPool.h"
+
+std::vector<BatchRunner::Entry> BatchRunner::readManifest(const std::string& fileName) {
+	std::ifstream manifest{ fileName };
+	if (!manifest) {
+		throw std::runtime_error("Cannot open the manifest " + fileName);
+	}
+	std::vector<Entry> entries;
+	std::string line;
+	while (std::getline(manifest, line)) {
+		std::istringstream words{ line };
+		Entry e;
+		if (!(words >> e.program) || e.program[0] == '#') {
+			continue;
+		}
+		words >> e.input;
+		entries.push_back(std::move(e));
+	}
+	return entries;
+}
+
+Session::Result BatchRunner::runEntry(const Session& session, const Entry& entry) {
+	std::ifstream source{ entry.program };
+	if (!source) {
+		Session::Result r;
+		r.status = Session::OTHER_ERROR;
+		r.message = "Cannot open " + entry.program;
+		return r;
+	}
+	ProgramHandle program;
+	Session::Result r = session.compile(source, program);
+	if (!r.ok()) {
+		return r;
+	}
+	StringOutputSink out;
+	std::unique_ptr<InputSource> in;
+	try {
+		if (entry.input.empty()) {
+			in.reset(new StringInputSource(""));
+		}
+		else {
+			in = BufferedInputSource::openFile(entry.input);
+		}
+	}
+	catch (std::exception& exc) {
+		r.status = Session::OTHER_ERROR;
+		r.message = exc.what();
+		return r;
+	}
+	r = session.run(program, out, *in);
+	r.output = out.str();
+	return r;
+}
+
+size_t BatchRunner::run(const std::vector<Entry>& entries, std::ostream& out) const {
+	Session session{ limits };
+	std::vector<Session::Result> results(entries.size());
+	std::vector<char> done(entries.size(), false);
+	std::mutex doneMutex;
+	std::condition_variable finished;
+
+	ThreadPool pool{ jobs };
+	for (size_t i = 0; i < entries.size(); ++i) {
+		pool.submit([&, i] {
+			Session::Result r;
+			try {
+				r = runEntry(session, entries[i]);
+			}
+			catch (std::exception& exc) {
+				// For instance running out of memory: the other runs go on
+				r.status = Session::OTHER_ERROR;
+				r.message = exc.what();
+			}
+			std::lock_guard<std::mutex> lock{ doneMutex };
+			results[i] = std::move(r);
+			done[i] = true;
+			finished.notify_all();
+		});
+	}
+
+	size_t failed = 0;
+	for (size_t i = 0; i < entries.size(); ++i) {
+		Session::Result r;
+		{
+			std::unique_lock<std::mutex> lock{ doneMutex };
+			finished.wait(lock, [&] { return done[i] != 0; });
+			r = std::move(results[i]);
+		}
+		out << "=== " << entries[i].program << " " << Session::statusName(r.status);
+		if (!r.ok()) {
+			out << ": " << r.message;
+			++failed;
+		}
+		out << "\n" << r.output;
+	}
+	out.flush();
+	return failed;
+}
@@ -0,0 +1,40 @@
+#ifndef BATCHRUNNER_H
+#define BATCHRUNNER_H
+
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "Session.h"
+
+// Runs many programs concurrently on a ThreadPool (--batch mode).
+// Every run is independent: its own compiled program, SymbolTable and captured input and output.
+// The results are written in manifest order, each one as soon as it and all the previous ones are done.
+class BatchRunner
+{
+public:
+	struct Entry {
+		std::string program;	// Program file
+		std::string input;	// File with the INPUT values, empty for no input
+	};
+
+	// Reads a manifest: one run per line, made of the program file optionally followed by the input file.
+	// Empty lines and lines starting with '#' are skipped. Throws std::runtime_error if the manifest cannot be read.
+	static std::vector<Entry> readManifest(const std::string& fileName);
+
+	// Zero jobs means one per core; every run is subject to the limits.
+	explicit BatchRunner(unsigned jobs = 0, const ExecutionLimits& l = ExecutionLimits()) : jobs{ jobs }, limits{ l } {}
+
+	// Runs the entries and writes for each one a header line "=== <program> <status>" followed by its output
+	// (what it printed before the error, if it failed). Returns the number of failed runs.
+	size_t run(const std::vector<Entry>& entries, std::ostream& out) const;
+
+	// Compiles and runs a single entry.
+	static Session::Result runEntry(const Session& session, const Entry& entry);
+
+private:
+	unsigned jobs;
+	ExecutionLimits limits;
+};
+
+#endif
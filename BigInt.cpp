@@ -0,0 +1,302 @@
+#include <algorithm>
+#include <climits>
+
+#include "BigInt.h"
+
+namespace {
+	// 10^9 is the largest power of ten fitting in a limb: decimal conversions work on groups of nine digits.
+	constexpr uint32_t DECIMAL_BASE = 1000000000;
+	constexpr int DECIMAL_DIGITS = 9;
+
+	// mag = mag * m + a
+	void mulAddSmall(std::vector<uint32_t>& mag, uint32_t m, uint32_t a) {
+		uint64_t carry = a;
+		for (uint32_t& limb : mag) {
+			uint64_t t = static_cast<uint64_t>(limb) * m + carry;
+			limb = static_cast<uint32_t>(t);
+			carry = t >> 32;
+		}
+		if (carry) {
+			mag.push_back(static_cast<uint32_t>(carry));
+		}
+	}
+}
+
+BigInt::BigInt(long int v) : negative{ v < 0 } {
+	// The magnitude is computed in unsigned arithmetic so that LONG_MIN does not overflow
+	uint64_t m = v < 0 ? 0 - static_cast<uint64_t>(v) : static_cast<uint64_t>(v);
+	while (m) {
+		mag.push_back(static_cast<uint32_t>(m));
+		m >>= 32;
+	}
+}
+
+BigInt BigInt::fromString(const char* begin, const char* end) {
+	BigInt r;
+	bool neg = false;
+	if (begin != end && *begin == '-') {
+		neg = true;
+		++begin;
+	}
+	// The first group takes the digits exceeding a multiple of nine, every following group has nine digits
+	size_t length = end - begin;
+	size_t group = length % DECIMAL_DIGITS ? length % DECIMAL_DIGITS : DECIMAL_DIGITS;
+	while (begin != end) {
+		uint32_t chunk = 0;
+		uint32_t scale = 1;
+		for (size_t i = 0; i < group; ++i) {
+			chunk = chunk * 10 + (*begin++ - '0');
+			scale *= 10;
+		}
+		mulAddSmall(r.mag, scale, chunk);
+		group = DECIMAL_DIGITS;
+	}
+	r.trim();
+	r.negative = neg && !r.isZero();
+	return r;
+}
+
+BigInt BigInt::add(const BigInt& a, const BigInt& b) {
+	return combine(a, b, b.negative);
+}
+
+BigInt BigInt::sub(const BigInt& a, const BigInt& b) {
+	return combine(a, b, !b.negative);
+}
+
+BigInt BigInt::combine(const BigInt& a, const BigInt& b, bool bNegative) {
+	BigInt r;
+	if (a.negative == bNegative) {
+		addMag(a.mag, b.mag, r.mag);
+		r.negative = a.negative;
+	}
+	else if (compareMag(a.mag, b.mag) >= 0) {
+		subMag(a.mag, b.mag, r.mag);
+		r.negative = a.negative;
+	}
+	else {
+		subMag(b.mag, a.mag, r.mag);
+		r.negative = bNegative;
+	}
+	r.trim();
+	return r;
+}
+
+BigInt BigInt::mul(const BigInt& a, const BigInt& b) {
+	BigInt r;
+	mulMag(a.mag, b.mag, r.mag);
+	r.trim();
+	r.negative = !r.isZero() && a.negative != b.negative;
+	return r;
+}
+
+BigInt BigInt::div(const BigInt& a, const BigInt& b) {
+	BigInt r;
+	if (compareMag(a.mag, b.mag) < 0) {
+		// |a| < |b|: the quotient truncated towards zero is zero
+		return r;
+	}
+	if (b.mag.size() == 1) {
+		divMagSmall(a.mag, b.mag[0], r.mag);
+	}
+	else {
+		divMag(a.mag, b.mag, r.mag);
+	}
+	r.trim();
+	r.negative = !r.isZero() && a.negative != b.negative;
+	return r;
+}
+
+int BigInt::compare(const BigInt& a, const BigInt& b) {
+	if (a.negative != b.negative) {
+		return a.negative ? -1 : 1;
+	}
+	int c = compareMag(a.mag, b.mag);
+	return a.negative ? -c : c;
+}
+
+bool BigInt::fitsLong() const {
+	if (mag.size() > 2) {
+		return false;
+	}
+	uint64_t m = 0;
+	for (size_t i = mag.size(); i-- > 0; ) {
+		m = (m << 32) | mag[i];
+	}
+	// The negative range has one more value than the positive one
+	return negative ? m <= static_cast<uint64_t>(LONG_MAX) + 1 : m <= static_cast<uint64_t>(LONG_MAX);
+}
+
+long int BigInt::toLong() const {
+	uint64_t m = 0;
+	for (size_t i = mag.size(); i-- > 0; ) {
+		m = (m << 32) | mag[i];
+	}
+	return static_cast<long int>(negative ? 0 - m : m);
+}
+
+std::string BigInt::toString() const {
+	if (isZero()) {
+		return "0";
+	}
+	// Collect groups of nine digits, least significant first
+	std::vector<uint32_t> groups;
+	Magnitude q = mag;
+	while (!q.empty()) {
+		Magnitude next;
+		groups.push_back(divMagSmall(q, DECIMAL_BASE, next));
+		while (!next.empty() && next.back() == 0) {
+			next.pop_back();
+		}
+		q.swap(next);
+	}
+	std::string s = negative ? "-" : "";
+	s += std::to_string(groups.back());
+	for (size_t i = groups.size() - 1; i-- > 0; ) {
+		std::string digits = std::to_string(groups[i]);
+		s.append(DECIMAL_DIGITS - digits.size(), '0');
+		s += digits;
+	}
+	return s;
+}
+
+int BigInt::compareMag(const Magnitude& a, const Magnitude& b) {
+	if (a.size() != b.size()) {
+		return a.size() < b.size() ? -1 : 1;
+	}
+	for (size_t i = a.size(); i-- > 0; ) {
+		if (a[i] != b[i]) {
+			return a[i] < b[i] ? -1 : 1;
+		}
+	}
+	return 0;
+}
+
+void BigInt::addMag(const Magnitude& a, const Magnitude& b, Magnitude& r) {
+	const Magnitude& longer = a.size() >= b.size() ? a : b;
+	const Magnitude& shorter = a.size() >= b.size() ? b : a;
+	r.resize(longer.size() + 1);
+	uint64_t carry = 0;
+	for (size_t i = 0; i < longer.size(); ++i) {
+		uint64_t t = static_cast<uint64_t>(longer[i]) + (i < shorter.size() ? shorter[i] : 0) + carry;
+		r[i] = static_cast<uint32_t>(t);
+		carry = t >> 32;
+	}
+	r[longer.size()] = static_cast<uint32_t>(carry);
+}
+
+void BigInt::subMag(const Magnitude& a, const Magnitude& b, Magnitude& r) {
+	r.resize(a.size());
+	int64_t borrow = 0;
+	for (size_t i = 0; i < a.size(); ++i) {
+		int64_t t = static_cast<int64_t>(a[i]) - (i < b.size() ? b[i] : 0) - borrow;
+		borrow = t < 0;
+		r[i] = static_cast<uint32_t>(t + (borrow << 32));
+	}
+}
+
+void BigInt::mulMag(const Magnitude& a, const Magnitude& b, Magnitude& r) {
+	if (a.empty() || b.empty()) {
+		r.clear();
+		return;
+	}
+	r.assign(a.size() + b.size(), 0);
+	// Fast path: one of the operands is a single limb
+	if (b.size() == 1 || a.size() == 1) {
+		const Magnitude& longer = a.size() == 1 ? b : a;
+		uint64_t m = a.size() == 1 ? a[0] : b[0];
+		uint64_t carry = 0;
+		for (size_t i = 0; i < longer.size(); ++i) {
+			uint64_t t = longer[i] * m + carry;
+			r[i] = static_cast<uint32_t>(t);
+			carry = t >> 32;
+		}
+		r[longer.size()] = static_cast<uint32_t>(carry);
+		return;
+	}
+	for (size_t i = 0; i < a.size(); ++i) {
+		uint64_t carry = 0;
+		for (size_t j = 0; j < b.size(); ++j) {
+			uint64_t t = static_cast<uint64_t>(a[i]) * b[j] + r[i + j] + carry;
+			r[i + j] = static_cast<uint32_t>(t);
+			carry = t >> 32;
+		}
+		r[i + b.size()] = static_cast<uint32_t>(carry);
+	}
+}
+
+uint32_t BigInt::divMagSmall(const Magnitude& a, uint32_t b, Magnitude& q) {
+	q.resize(a.size());
+	uint64_t rem = 0;
+	for (size_t i = a.size(); i-- > 0; ) {
+		uint64_t cur = (rem << 32) | a[i];
+		q[i] = static_cast<uint32_t>(cur / b);
+		rem = cur % b;
+	}
+	return static_cast<uint32_t>(rem);
+}
+
+void BigInt::divMag(const Magnitude& u, const Magnitude& v, Magnitude& q) {
+	size_t m = u.size();
+	size_t n = v.size();
+	// Normalize: shift both operands so that the most significant limb of the divisor has its top bit set
+	int s = __builtin_clz(v[n - 1]);
+	Magnitude vn(n), un(m + 1);
+	for (size_t i = n - 1; i > 0; --i) {
+		vn[i] = (v[i] << s) | static_cast<uint32_t>(static_cast<uint64_t>(v[i - 1]) >> (32 - s));
+	}
+	vn[0] = v[0] << s;
+	un[m] = static_cast<uint32_t>(static_cast<uint64_t>(u[m - 1]) >> (32 - s));
+	for (size_t i = m - 1; i > 0; --i) {
+		un[i] = (u[i] << s) | static_cast<uint32_t>(static_cast<uint64_t>(u[i - 1]) >> (32 - s));
+	}
+	un[0] = u[0] << s;
+
+	q.assign(m - n + 1, 0);
+	const uint64_t base = 1ull << 32;
+	for (size_t j = m - n + 1; j-- > 0; ) {
+		// Estimate the quotient digit from the two top limbs, then correct it (at most twice)
+		uint64_t num = (static_cast<uint64_t>(un[j + n]) << 32) | un[j + n - 1];
+		uint64_t qhat = num / vn[n - 1];
+		uint64_t rhat = num % vn[n - 1];
+		while (qhat >= base || qhat * vn[n - 2] > ((rhat << 32) | un[j + n - 2])) {
+			--qhat;
+			rhat += vn[n - 1];
+			if (rhat >= base) {
+				break;
+			}
+		}
+		// Multiply and subtract
+		int64_t borrow = 0;
+		int64_t t;
+		for (size_t i = 0; i < n; ++i) {
+			uint64_t p = qhat * vn[i];
+			t = static_cast<int64_t>(un[i + j]) - borrow - static_cast<int64_t>(p & 0xFFFFFFFF);
+			un[i + j] = static_cast<uint32_t>(t);
+			borrow = static_cast<int64_t>(p >> 32) - (t >> 32);
+		}
+		t = static_cast<int64_t>(un[j + n]) - borrow;
+		un[j + n] = static_cast<uint32_t>(t);
+		q[j] = static_cast<uint32_t>(qhat);
+		if (t < 0) {
+			// The estimate was one too large: add the divisor back
+			--q[j];
+			uint64_t carry = 0;
+			for (size_t i = 0; i < n; ++i) {
+				uint64_t sum = static_cast<uint64_t>(un[i + j]) + vn[i] + carry;
+				un[i + j] = static_cast<uint32_t>(sum);
+				carry = sum >> 32;
+			}
+			un[j + n] += static_cast<uint32_t>(carry);
+		}
+	}
+}
+
+void BigInt::trim() {
+	while (!mag.empty() && mag.back() == 0) {
+		mag.pop_back();
+	}
+	if (mag.empty()) {
+		negative = false;
+	}
+}
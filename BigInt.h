@@ -0,0 +1,73 @@
+#ifndef BIGINT_H
+#define BIGINT_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Arbitrary precision integer, used by Value when a result does not fit in a long int.
+// The number is stored as a sign and a magnitude made of 32 bits limbs, least significant limb first.
+// The magnitude never has leading zero limbs and zero is never negative.
+class BigInt
+{
+public:
+	BigInt() : negative{ false } {}
+	BigInt(long int v);
+
+	// Converts a decimal number made of an optional '-' followed by digits (already validated by the caller).
+	static BigInt fromString(const char* begin, const char* end);
+
+	// Arithmetic with the semantics of the C++ operators on integers: the division truncates towards zero.
+	// The divisor of div must not be zero.
+	static BigInt add(const BigInt& a, const BigInt& b);
+	static BigInt sub(const BigInt& a, const BigInt& b);
+	static BigInt mul(const BigInt& a, const BigInt& b);
+	static BigInt div(const BigInt& a, const BigInt& b);
+
+	// Returns a negative number, zero or a positive number if a is less, equal or greater than b.
+	static int compare(const BigInt& a, const BigInt& b);
+
+	bool isZero() const {
+		return mag.empty();
+	}
+
+	bool isNegative() const {
+		return negative;
+	}
+
+	// True if the number can be represented by a long int.
+	bool fitsLong() const;
+	// Conversion to long int, valid only if fitsLong() is true.
+	long int toLong() const;
+
+	std::string toString() const;
+
+	// Bytes used by the limbs, for memory accounting.
+	size_t bytesHeld() const {
+		return mag.capacity() * sizeof(uint32_t);
+	}
+
+private:
+	typedef std::vector<uint32_t> Magnitude;
+
+	// Adds a and b, using the sign bNegative for b (so that sub is an add of the opposite).
+	static BigInt combine(const BigInt& a, const BigInt& b, bool bNegative);
+
+	// Operations on magnitudes only.
+	static int compareMag(const Magnitude& a, const Magnitude& b);
+	static void addMag(const Magnitude& a, const Magnitude& b, Magnitude& r);
+	// Requires a >= b.
+	static void subMag(const Magnitude& a, const Magnitude& b, Magnitude& r);
+	static void mulMag(const Magnitude& a, const Magnitude& b, Magnitude& r);
+	// Divides by a single limb, returns the remainder.
+	static uint32_t divMagSmall(const Magnitude& a, uint32_t b, Magnitude& q);
+	// Long division (Knuth, algorithm D), b must have at least two limbs.
+	static void divMag(const Magnitude& a, const Magnitude& b, Magnitude& q);
+
+	void trim();
+
+	bool negative;
+	Magnitude mag;
+};
+
+#endif
@@ -22,7 +22,9 @@ public:
 
 	void accept(Visitor* v);
 
-	std::vector<Statement*> getVector() const {
+	// Returned by reference: visitors walk the statement list on every execution of the block,
+	// so handing out a copy would cost one heap allocation per visit.
+	const std::vector<Statement*>& getVector() const {
 		return stmt_list;
 	}
 	
@@ -0,0 +1,44 @@
+#include <algorithm>
+
+#include "Budget.h"
+#include "Exceptions.h"
+
+unsigned long long BudgetMeter::start() {
+	used = 0;
+	work = 0;
+	deadline = std::chrono::steady_clock::now() + limits.timeLimit;
+	return grant();
+}
+
+unsigned long long BudgetMeter::refill() {
+	used += granted;
+	if (limits.maxSteps != 0 && used > limits.maxSteps) {
+		throw BudgetExceeded("STEP LIMIT EXCEEDED");
+	}
+	checkTime();
+	return grant();
+}
+
+void BudgetMeter::chargeValue(size_t bytes) {
+	if (limits.maxValueBytes != 0 && bytes > limits.maxValueBytes) {
+		throw BudgetExceeded("VALUE LIMIT EXCEEDED");
+	}
+	unsigned long long words = bytes / sizeof(long);
+	charge(words * words);
+}
+
+void BudgetMeter::checkTime() {
+	work = 0;
+	if (limits.timeLimit.count() != 0 && std::chrono::steady_clock::now() >= deadline) {
+		throw BudgetExceeded("TIME LIMIT EXCEEDED");
+	}
+}
+
+unsigned long long BudgetMeter::grant() {
+	granted = CHECK_INTERVAL;
+	if (limits.maxSteps != 0) {
+		// The step after the last allowed one is the one that calls refill and fails
+		granted = std::min(granted, limits.maxSteps + 1 - used);
+	}
+	return granted;
+}
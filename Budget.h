@@ -0,0 +1,69 @@
+#ifndef BUDGET_H
+#define BUDGET_H
+
+#include <chrono>
+#include <cstddef>
+
+// Limits of a run of a program; zero means no limit.
+// Steps are the entries into a block, which include the iterations of the WHILE loops (their body is a block):
+// any program that does not end takes infinitely many of them, while the statements between two steps always end.
+// They may still take long, on big integers (a product takes time in the square of the size of its operands) or on
+// whole arrays: maxValueBytes bounds the size of the integers an operation may compute, and so its time.
+struct ExecutionLimits {
+	unsigned long long maxSteps = 0;
+	std::chrono::milliseconds timeLimit{ 0 };
+	size_t maxOutputBytes = 0;
+	size_t maxValueBytes = 0;
+
+	// True if the evaluator has to count its steps (the output is limited by the sink).
+	bool metered() const {
+		return maxSteps != 0 || timeLimit.count() != 0 || maxValueBytes != 0;
+	}
+};
+
+// The BudgetMeter enforces the step and time limits of a run.
+// The evaluator counts down the steps it was granted and calls refill only when they are used up,
+// so the fast path is a decrement and the clock is read once every CHECK_INTERVAL steps at most.
+// The work of a step that does not have a bounded cost, an operation computing a big integer or an operation on a
+// whole array, is charged apart (see charge): the clock is also read once every CHECK_WORK words of such work.
+// A limit that is exceeded raises BudgetExceeded.
+class BudgetMeter
+{
+public:
+	static constexpr unsigned long long CHECK_INTERVAL = 4096;
+	static constexpr unsigned long long CHECK_WORK = 1 << 16;
+
+	explicit BudgetMeter(const ExecutionLimits& l) : limits{ l } {}
+
+	// Starts the clock of the time limit; returns the steps that can be taken before the first call to refill.
+	unsigned long long start();
+
+	// Called by the step that uses the last granted step. Throws BudgetExceeded if a limit is exceeded,
+	// otherwise returns the steps granted until the next call.
+	unsigned long long refill();
+
+	// An operation went through "words" words of data.
+	void charge(unsigned long long words) {
+		work += words;
+		if (work >= CHECK_WORK) {
+			checkTime();
+		}
+	}
+
+	// An operation computed a big integer of the given size: throws BudgetExceeded if it is over the limit,
+	// otherwise charges its cost, up to the square of its size in words (for a product or a quotient).
+	void chargeValue(size_t bytes);
+
+private:
+	void checkTime();
+
+	unsigned long long grant();
+
+	ExecutionLimits limits;
+	unsigned long long used = 0;	// Steps taken up to the last refill
+	unsigned long long granted = 0;
+	unsigned long long work = 0;	// Words charged since the clock was last read
+	std::chrono::steady_clock::time_point deadline;
+};
+
+#endif
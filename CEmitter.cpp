@@ -0,0 +1,504 @@
+#include <climits>
+
+#include "CEmitter.h"
+
+namespace {
+	// Runtime of the generated programs: buffered output, chunked input and checked arithmetic.
+	// The messages are the ones of the interpreter; the helpers are inline so that the unused ones raise no warning.
+	const char* const runtime = R"(#include <errno.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+static char lisp_out[1 << 18];
+static size_t lisp_out_used;
+static char lisp_in[1 << 16];
+static size_t lisp_in_pos, lisp_in_end;
+static int lisp_in_eof;
+
+static inline void lisp_flush(void) {
+	size_t written = 0;
+	while (written < lisp_out_used) {
+		ssize_t n = write(1, lisp_out + written, lisp_out_used - written);
+		if (n < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			lisp_out_used = 0;
+			fprintf(stderr, "Error\nCannot write the output: %s\n", strerror(errno));
+			exit(EXIT_FAILURE);
+		}
+		written += (size_t)n;
+	}
+	lisp_out_used = 0;
+}
+
+static inline void lisp_fail(const char* message) {
+	lisp_flush();
+	fprintf(stderr, "Error in semantic analysis\n%s\n", message);
+	exit(EXIT_FAILURE);
+}
+
+static inline long lisp_undefined(void) {
+	lisp_fail("Variable does not exist");
+	return 0;
+}
+
+static inline long lisp_overflow(void) {
+	lisp_fail("INTEGER OVERFLOW");
+	return 0;
+}
+
+static inline long lisp_add(long a, long b) {
+	long r;
+	return __builtin_add_overflow(a, b, &r) ? lisp_overflow() : r;
+}
+
+static inline long lisp_sub(long a, long b) {
+	long r;
+	return __builtin_sub_overflow(a, b, &r) ? lisp_overflow() : r;
+}
+
+static inline long lisp_mul(long a, long b) {
+	long r;
+	return __builtin_mul_overflow(a, b, &r) ? lisp_overflow() : r;
+}
+
+static inline long lisp_div(long a, long b) {
+	if (b == 0) {
+		lisp_fail("ZERO DIVISION");
+	}
+	return a == LONG_MIN && b == -1 ? lisp_overflow() : a / b;
+}
+
+static inline void lisp_print(long v) {
+	char digits[24];
+	int n = 0;
+	unsigned long u = v < 0 ? 0UL - (unsigned long)v : (unsigned long)v;
+	if (lisp_out_used + 22 > sizeof(lisp_out)) {
+		lisp_flush();
+	}
+	do {
+		digits[n++] = (char)('0' + u % 10);
+		u /= 10;
+	} while (u);
+	if (v < 0) {
+		lisp_out[lisp_out_used++] = '-';
+	}
+	while (n) {
+		lisp_out[lisp_out_used++] = digits[--n];
+	}
+	lisp_out[lisp_out_used++] = '\n';
+}
+
+static inline int lisp_space(char c) {
+	return c == ' ' || (c >= '\t' && c <= '\r');
+}
+
+/* Returns the next character of the standard input, or -1 at its end. */
+static inline int lisp_getc(void) {
+	if (lisp_in_pos == lisp_in_end) {
+		ssize_t n;
+		if (lisp_in_eof) {
+			return -1;
+		}
+		do {
+			n = read(0, lisp_in, sizeof(lisp_in));
+		} while (n < 0 && errno == EINTR);
+		if (n < 0) {
+			lisp_flush();
+			fprintf(stderr, "Error\nCannot read the input: %s\n", strerror(errno));
+			exit(EXIT_FAILURE);
+		}
+		if (n == 0) {
+			lisp_in_eof = 1;
+			return -1;
+		}
+		lisp_in_pos = 0;
+		lisp_in_end = (size_t)n;
+	}
+	return (unsigned char)lisp_in[lisp_in_pos++];
+}
+
+/* Reads the next whitespace separated word: an optional '-' followed by digits. */
+static inline long lisp_input(void) {
+	int c;
+	int negative = 0, digits = 0, valid = 1;
+	unsigned long limit, u = 0;
+	/* What was printed before is visible before the program waits for its input */
+	lisp_flush();
+	do {
+		c = lisp_getc();
+	} while (c >= 0 && lisp_space((char)c));
+	if (c < 0) {
+		lisp_fail("END OF INPUT");
+	}
+	if (c == '-') {
+		negative = 1;
+		c = lisp_getc();
+	}
+	limit = negative ? 0UL - (unsigned long)LONG_MIN : (unsigned long)LONG_MAX;
+	for (; c >= 0 && !lisp_space((char)c); c = lisp_getc()) {
+		if (c < '0' || c > '9') {
+			valid = 0;
+		}
+		else if (valid) {
+			if (u > (limit - (unsigned long)(c - '0')) / 10) {
+				lisp_overflow();
+			}
+			u = u * 10 + (unsigned long)(c - '0');
+			++digits;
+		}
+	}
+	if (!valid || digits == 0) {
+		lisp_fail("NOT A ACCETABLE NUMBER ");
+	}
+	return negative ? (long)(0UL - u) : (long)u;
+}
+)";
+
+	// Arrays, after the definition of LISP_ARRAY_MAX: the storage is aligned and padded with zeros to whole lines.
+	const char* const arrayRuntime = R"(
+typedef struct {
+	long* data;
+	long size;
+	int exists;
+} lisp_array;
+
+static inline long* lisp_array_storage(long size) {
+	size_t padded = ((size_t)size + 7) / 8 * 8;
+	long* data = aligned_alloc(64, (padded ? padded : 8) * sizeof(long));
+	if (!data) {
+		lisp_flush();
+		fprintf(stderr, "Error\nCannot allocate an array\n");
+		exit(EXIT_FAILURE);
+	}
+	memset(data, 0, (padded ? padded : 8) * sizeof(long));
+	return data;
+}
+
+static inline lisp_array* lisp_array_check(lisp_array* a) {
+	if (!a->exists) {
+		lisp_fail("Array does not exist");
+	}
+	return a;
+}
+
+static inline void lisp_array_new(lisp_array* a, long size) {
+	long* data;
+	if (size < 0 || size > LISP_ARRAY_MAX) {
+		lisp_fail("INVALID ARRAY SIZE");
+	}
+	data = lisp_array_storage(size);
+	free(a->data);
+	a->data = data;
+	a->size = size;
+	a->exists = 1;
+}
+
+static inline long lisp_array_index(lisp_array* a, long i) {
+	if (i < 0 || i >= lisp_array_check(a)->size) {
+		lisp_fail("INDEX OUT OF BOUNDS");
+	}
+	return i;
+}
+
+static inline long lisp_array_sum(lisp_array* a) {
+	__int128 s = 0;
+	long i;
+	for (i = 0; i < lisp_array_check(a)->size; ++i) {
+		s += a->data[i];
+	}
+	return s < LONG_MIN || s > LONG_MAX ? lisp_overflow() : (long)s;
+}
+
+/* Element-wise operation: 0 ADD, 1 SUB, 2 MUL, 3 LT, 4 GT, 5 EQ; the destination may be an operand */
+static inline void lisp_array_op(lisp_array* d, lisp_array* a, lisp_array* b, int op) {
+	long* r;
+	long i, n = lisp_array_check(a)->size;
+	unsigned long overflow = 0;
+	if (lisp_array_check(b)->size != n) {
+		lisp_fail("ARRAY SIZE MISMATCH");
+	}
+	r = lisp_array_storage(n);
+	for (i = 0; i < n; ++i) {
+		long x = a->data[i], y = b->data[i];
+		switch (op) {
+		case 0: overflow |= __builtin_add_overflow(x, y, &r[i]); break;
+		case 1: overflow |= __builtin_sub_overflow(x, y, &r[i]); break;
+		case 2: overflow |= __builtin_mul_overflow(x, y, &r[i]); break;
+		case 3: r[i] = x < y; break;
+		case 4: r[i] = x > y; break;
+		default: r[i] = x == y; break;
+		}
+	}
+	if (overflow) {
+		free(r);
+		lisp_fail("ARRAY ELEMENT OVERFLOW");
+	}
+	free(d->data);
+	d->data = r;
+	d->size = n;
+	d->exists = 1;
+}
+)";
+}
+
+void CEmitterVisitor::emit(Program* progNode, std::ostream& os) {
+	body.str("");
+	variables.clear();
+	arrays.clear();
+	indent = 1;
+	temps = 0;
+	progNode->accept(this);
+	os << runtime;
+	if (!arrays.empty()) {
+		os << "\n#define LISP_ARRAY_MAX " << IntArray::MAX_SIZE << "L\n" << arrayRuntime;
+	}
+	os << "\nint main(void) {\n";
+	for (const std::string& v : variables) {
+		// Unused when the variable is only assigned
+		os << "\tlong " << valueName(v) << " __attribute__((unused)) = 0;\n\tint " << flagName(v) << " __attribute__((unused)) = 0;\n";
+	}
+	for (const std::string& a : arrays) {
+		os << "\tlisp_array a_" << a << " = { 0, 0, 0 };\n";
+	}
+	os << body.str() << "\tlisp_flush();\n\treturn 0;\n}\n";
+}
+
+std::ostream& CEmitterVisitor::line() {
+	body << std::string(indent, '\t');
+	return body;
+}
+
+std::string CEmitterVisitor::newTemp(const char* prefix) {
+	return prefix + std::to_string(temps++);
+}
+
+void CEmitterVisitor::visitProgram(Program* progNode) {
+	progNode->getBlock()->accept(this);
+}
+
+void CEmitterVisitor::visitBlock(Block* blockNode) {
+	for (auto i : blockNode->getVector()) {
+		// Every statement in its own scope, so its temporaries do not pile up in the function
+		line() << "{\n";
+		++indent;
+		i->accept(this);
+		--indent;
+		line() << "}\n";
+	}
+}
+
+void CEmitterVisitor::visitPrintStmt(PrintStmt* printStmtNode) {
+	printStmtNode->getPrinter()->accept(this);
+	line() << "lisp_print(" << result << ");\n";
+}
+
+void CEmitterVisitor::visitSetStmt(SetStmt* setStmtNode) {
+	const std::string& var = setStmtNode->getVar()->getVarId();
+	variables.insert(var);
+	setStmtNode->getSetter()->accept(this);
+	line() << valueName(var) << " = " << result << ";\n";
+	line() << flagName(var) << " = 1;\n";
+}
+
+void CEmitterVisitor::visitInputStmt(InputStmt* inputStmtNode) {
+	const std::string& var = inputStmtNode->getVar()->getVarId();
+	variables.insert(var);
+	line() << valueName(var) << " = lisp_input();\n";
+	line() << flagName(var) << " = 1;\n";
+}
+
+void CEmitterVisitor::visitWhileStmt(WhileStmt* whileStmtNode) {
+	line() << "for (;;) {\n";
+	++indent;
+	whileStmtNode->getCondition()->accept(this);
+	line() << "if (!" << result << ") {\n";
+	line() << "\tbreak;\n";
+	line() << "}\n";
+	whileStmtNode->getReppeter()->accept(this);
+	--indent;
+	line() << "}\n";
+}
+
+void CEmitterVisitor::visitIfStmt(IfStmt* ifStmtNode) {
+	ifStmtNode->getCondition()->accept(this);
+	line() << "if (" << result << ") {\n";
+	++indent;
+	ifStmtNode->getIfBlock()->accept(this);
+	--indent;
+	line() << "}\n";
+	line() << "else {\n";
+	++indent;
+	ifStmtNode->getElseBlock()->accept(this);
+	--indent;
+	line() << "}\n";
+}
+
+void CEmitterVisitor::visitParallelStmt(ParallelStmt* parallelStmtNode) {
+	// The children are independent, so the C code runs them one after the other
+	for (auto i : parallelStmtNode->getChildren()) {
+		i->accept(this);
+	}
+}
+
+void CEmitterVisitor::visitArrayStmt(ArrayStmt* arrayStmtNode) {
+	std::string array = arrayAddress(arrayStmtNode->getArray());
+	switch (arrayStmtNode->getKind())
+	{
+	case ArrayStmt::ALLOCATE:
+		arrayStmtNode->getOperand()->accept(this);
+		line() << "lisp_array_new(" << array << ", " << result << ");\n";
+		return;
+	case ArrayStmt::PUT: {
+		arrayStmtNode->getOperand()->accept(this);
+		std::string index = result;
+		arrayStmtNode->getElement()->accept(this);
+		line() << "(" << array << ")->data[lisp_array_index(" << array << ", " << index << ")] = " << result << ";\n";
+		return;
+	}
+	default:
+		line() << "lisp_array_op(" << array << ", " << arrayAddress(arrayStmtNode->getLeft()) << ", "
+			<< arrayAddress(arrayStmtNode->getRight()) << ", " << arrayStmtNode->getKind() - ArrayStmt::ADD << ");\n";
+		return;
+	}
+}
+
+void CEmitterVisitor::visitOperator(Operator* opNode) {
+	opNode->getLeft()->accept(this);
+	std::string left = result;
+	opNode->getRight()->accept(this);
+	std::string right = result;
+	result = newTemp("t");
+	if (opNode->getArithmetic() != Operator::CHECKED) {
+		// Proven in range by the RangeAnalysis: plain C arithmetic, on 32 bits where everything fits
+		static const char* const symbols[] = { " + ", " - ", " * ", " / " };
+		const char* symbol = symbols[opNode->getOpCode()];
+		if (opNode->getArithmetic() == Operator::INT32) {
+			line() << "long " << result << " = (int)" << left << symbol << "(int)" << right << ";\n";
+		}
+		else {
+			line() << "long " << result << " = " << left << symbol << right << ";\n";
+		}
+		return;
+	}
+	const char* function;
+	switch (opNode->getOpCode())
+	{
+	case Operator::ADD:
+		function = "lisp_add"; break;
+	case Operator::SUB:
+		function = "lisp_sub"; break;
+	case Operator::MUL:
+		function = "lisp_mul"; break;
+	case Operator::DIV:
+		function = "lisp_div"; break;
+	default:
+		throw SemanticError("INVALID operation");
+	}
+	line() << "long " << result << " = " << function << "(" << left << ", " << right << ");\n";
+}
+
+void CEmitterVisitor::visitNumber(Number* numNode) {
+	const Value& v = numNode->getValue();
+	if (!v.isSmall()) {
+		// The literal itself does not fit: the program stops when it reaches it
+		result = "lisp_overflow()";
+	}
+	else if (v.getSmall() == LONG_MIN) {
+		// -9223372036854775808 is not a valid C literal (the minus applies to a number that does not fit)
+		result = "LONG_MIN";
+	}
+	else {
+		result = std::to_string(v.getSmall()) + "L";
+	}
+}
+
+void CEmitterVisitor::visitVariable(Variable* varNode) {
+	const std::string& var = varNode->getVarId();
+	variables.insert(var);
+	result = newTemp("t");
+	if (varNode->getAssignment() == Variable::ASSIGNED) {
+		// Proven assigned by the AssignmentAnalysis
+		line() << "long " << result << " = " << valueName(var) << ";\n";
+	}
+	else {
+		line() << "long " << result << " = " << flagName(var) << " ? " << valueName(var) << " : lisp_undefined();\n";
+	}
+}
+
+void CEmitterVisitor::visitArrayExpr(ArrayExpr* arrayExprNode) {
+	std::string array = arrayAddress(arrayExprNode->getArray());
+	std::string index;
+	if (arrayExprNode->getIndex()) {
+		arrayExprNode->getIndex()->accept(this);
+		index = result;
+	}
+	result = newTemp("t");
+	switch (arrayExprNode->getKind())
+	{
+	case ArrayExpr::GET:
+		line() << "long " << result << " = (" << array << ")->data[lisp_array_index(" << array << ", " << index << ")];\n";
+		break;
+	case ArrayExpr::SUM:
+		line() << "long " << result << " = lisp_array_sum(" << array << ");\n";
+		break;
+	default:
+		line() << "long " << result << " = lisp_array_check(" << array << ")->size;\n";
+		break;
+	}
+}
+
+void CEmitterVisitor::visitRelOp(RelOp* relOpNode) {
+	relOpNode->getLeft()->accept(this);
+	std::string left = result;
+	relOpNode->getRight()->accept(this);
+	std::string right = result;
+	const char* op;
+	switch (relOpNode->getRelOpCode())
+	{
+	case RelOp::EQ:
+		op = " == "; break;
+	case RelOp::LT:
+		op = " < "; break;
+	case RelOp::GT:
+		op = " > "; break;
+	default:
+		throw SemanticError("INVALID realtional operator");
+	}
+	result = newTemp("b");
+	line() << "int " << result << " = " << left << op << right << ";\n";
+}
+
+void CEmitterVisitor::visitBoolConst(BoolConst* boolConstNode) {
+	result = boolConstNode->getValue() ? "1" : "0";
+}
+
+void CEmitterVisitor::visitBoolOp(BoolOp* boolOpNode) {
+	boolOpNode->getLeft()->accept(this);
+	std::string left = result;
+	std::string b = newTemp("b");
+	switch (boolOpNode->getBoolOpCode())
+	{
+	case BoolOp::NOT:
+		line() << "int " << b << " = !" << left << ";\n";
+		break;
+	case BoolOp::AND:
+	case BoolOp::OR:
+		// Short circuit: the right operand is evaluated only if the left one does not decide
+		line() << "int " << b << " = " << left << ";\n";
+		line() << "if (" << (boolOpNode->getBoolOpCode() == BoolOp::AND ? "" : "!") << b << ") {\n";
+		++indent;
+		boolOpNode->getRight()->accept(this);
+		line() << b << " = " << result << ";\n";
+		--indent;
+		line() << "}\n";
+		break;
+	default:
+		throw SemanticError("INVALID boolean operator");
+	}
+	result = b;
+}
@@ -0,0 +1,76 @@
+#ifndef CEMITTER_H
+#define CEMITTER_H
+
+#include <ostream>
+#include <set>
+#include <sstream>
+#include <string>
+
+#include "Visitor.h"
+
+// The CEmitterVisitor translates a program into a self-contained C translation unit (--emit-c),
+// to be compiled with the system C compiler into a native program behaving like the interpreter:
+// same output, same error messages on the standard error and same exit status.
+// Variables become local long variables with a flag telling whether they were assigned, WHILE and IF become native
+// loops and branches, PRINT and INPUT use buffered I/O helpers.
+// Expressions are flattened into temporaries evaluated left to right, so that when an expression contains
+// several errors the reported one is the one the evaluator would meet first.
+// The compiled program uses 64 bits integers only: where the interpreter would promote a value to a big integer,
+// it stops with the error "INTEGER OVERFLOW".
+// The operations proven in range by the RangeAnalysis are plain C arithmetic, on int where they fit in 32 bits.
+// Arrays become lisp_array structures, with helpers (emitted only for programs using arrays) keeping the checks
+// and the messages of IntArray; the sum of an array that does not fit in a long int stops with "INTEGER OVERFLOW".
+class CEmitterVisitor : public Visitor {
+public:
+	// Writes the whole translation unit for the program.
+	void emit(Program* progNode, std::ostream& os);
+
+	void visitProgram(Program* progNode) override;
+	void visitBlock(Block* blockNode) override;
+
+	void visitPrintStmt(PrintStmt* printStmtNode) override;
+	void visitSetStmt(SetStmt* setStmtNode) override;
+	void visitInputStmt(InputStmt* inputStmtNode) override;
+	void visitWhileStmt(WhileStmt* whileStmtNode) override;
+	void visitIfStmt(IfStmt* ifStmtNode) override;
+	void visitParallelStmt(ParallelStmt* parallelStmtNode) override;
+	void visitArrayStmt(ArrayStmt* arrayStmtNode) override;
+
+	// The expression visits write the code computing the expression and leave in "result"
+	// the C expression (a temporary or a constant) holding its value.
+	void visitOperator(Operator* opNode) override;
+	void visitNumber(Number* numNode) override;
+	void visitVariable(Variable* varNode) override;
+	void visitArrayExpr(ArrayExpr* arrayExprNode) override;
+
+	void visitRelOp(RelOp* relOpNode) override;
+	void visitBoolConst(BoolConst* boolConstNode) override;
+	void visitBoolOp(BoolOp* boolOpNode) override;
+
+private:
+	// Starts a new line of code at the current indentation.
+	std::ostream& line();
+	std::string newTemp(const char* prefix);
+
+	// C names of a variable and of its "assigned" flag (variable names are made of letters only).
+	static std::string valueName(const std::string& var) {
+		return "v_" + var;
+	}
+	static std::string flagName(const std::string& var) {
+		return "d_" + var;
+	}
+	// Address of the structure of an array.
+	std::string arrayAddress(const Variable* array) {
+		arrays.insert(array->getVarId());
+		return "&a_" + array->getVarId();
+	}
+
+	std::ostringstream body;
+	std::set<std::string> variables;
+	std::set<std::string> arrays;
+	std::string result;
+	int indent = 1;
+	int temps = 0;
+};
+
+#endif
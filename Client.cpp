@@ -0,0 +1,60 @@
+#include <cerrno>
+#include <cstring>
+#include <sstream>
+#include <stdexcept>
+#include <unistd.h>
+#include <vector>
+
+#include "Client.h"
+
+Client::Response Client::run(const std::string& source, const std::string& input) {
+	connection.writeAll("RUN " + std::to_string(source.size()) + " " + std::to_string(input.size()) + "\n" + source + input);
+	return readResponse();
+}
+
+Client::Response Client::runHash(const std::string& hash, const std::string& input) {
+	connection.writeAll("HASH " + hash + " " + std::to_string(input.size()) + "\n" + input);
+	return readResponse();
+}
+
+Client::Response Client::stream(const std::string& source, int inputFd) {
+	connection.writeAll("STREAM " + std::to_string(source.size()) + "\n" + source);
+	std::vector<char> chunk(1 << 16);
+	for (;;) {
+		ssize_t n = ::read(inputFd, chunk.data(), chunk.size());
+		if (n < 0 && errno == EINTR) {
+			continue;
+		}
+		if (n < 0) {
+			throw std::runtime_error(std::string("Cannot read the input: ") + std::strerror(errno));
+		}
+		if (n == 0) {
+			break;
+		}
+		try {
+			connection.writeAll(std::string(chunk.data(), n));
+		}
+		catch (std::runtime_error&) {
+			// The program ended before its input: the response is there
+			break;
+		}
+	}
+	connection.shutdownWrite();
+	return readResponse();
+}
+
+Client::Response Client::readResponse() {
+	std::string header;
+	if (!connection.readLine(header)) {
+		throw std::runtime_error("The server closed the connection");
+	}
+	std::istringstream fields{ header };
+	Response r;
+	size_t outputLength, messageLength;
+	if (!(fields >> r.code >> r.hash >> outputLength >> messageLength)) {
+		throw std::runtime_error("Malformed response: " + header);
+	}
+	connection.readExact(outputLength, r.output);
+	connection.readExact(messageLength, r.message);
+	return r;
+}
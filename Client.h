@@ -0,0 +1,38 @@
+#ifndef CLIENT_H
+#define CLIENT_H
+
+#include <string>
+
+#include "Connection.h"
+
+// Client of the server mode (see Server.h for the protocol).
+class Client
+{
+public:
+	struct Response {
+		int code;	// Server::OK, Server::FAILED or Server::UNKNOWN_PROGRAM
+		std::string hash;	// Hash of the program, to send it again with runHash
+		std::string output;
+		std::string message;
+	};
+
+	// Throws std::runtime_error if the server cannot be reached.
+	explicit Client(const std::string& socketPath) : connection{ Connection::connectTo(socketPath) } {}
+
+	// Sends the source of a program and the values of its INPUT statements.
+	Response run(const std::string& source, const std::string& input);
+
+	// Runs a program already sent, by its hash.
+	Response runHash(const std::string& hash, const std::string& input);
+
+	// Sends the source of a program, then its input as it is read from the descriptor until its end, and ends the
+	// connection: the program runs while the input arrives.
+	Response stream(const std::string& source, int inputFd);
+
+private:
+	Response readResponse();
+
+	Connection connection;
+};
+
+#endif
@@ -0,0 +1,131 @@
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "Connection.h"
+
+namespace {
+	constexpr size_t BUFFER_SIZE = 1 << 16;
+
+	std::runtime_error socketError(const char* what) {
+		return std::runtime_error(std::string(what) + ": " + std::strerror(errno));
+	}
+}
+
+Connection Connection::connectTo(const std::string& path) {
+	sockaddr_un address{};
+	if (path.size() >= sizeof(address.sun_path)) {
+		throw std::runtime_error("Socket path too long: " + path);
+	}
+	address.sun_family = AF_UNIX;
+	std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+	int s = ::socket(AF_UNIX, SOCK_STREAM, 0);
+	if (s < 0) {
+		throw socketError("Cannot create the socket");
+	}
+	if (::connect(s, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0) {
+		std::runtime_error error = socketError(("Cannot connect to " + path).c_str());
+		::close(s);
+		throw error;
+	}
+	return Connection(s);
+}
+
+Connection::Connection(Connection&& other) noexcept
+	: fd{ other.fd }, buffer{ std::move(other.buffer) }, begin{ other.begin }, end{ other.end } {
+	other.fd = -1;
+}
+
+Connection::~Connection() {
+	if (fd >= 0) {
+		::close(fd);
+	}
+}
+
+bool Connection::fill() {
+	if (begin == end) {
+		begin = end = 0;
+	}
+	if (buffer.size() < BUFFER_SIZE) {
+		buffer.resize(BUFFER_SIZE);
+	}
+	if (end == buffer.size()) {
+		// Keep the unread bytes and make room after them
+		std::memmove(buffer.data(), buffer.data() + begin, end - begin);
+		end -= begin;
+		begin = 0;
+	}
+	ssize_t n;
+	do {
+		n = ::read(fd, buffer.data() + end, buffer.size() - end);
+	} while (n < 0 && errno == EINTR);
+	if (n < 0) {
+		throw socketError("Cannot read from the socket");
+	}
+	end += n;
+	return n > 0;
+}
+
+bool Connection::readLine(std::string& line, size_t maxLength) {
+	line.clear();
+	for (;;) {
+		for (; begin < end; ++begin) {
+			if (buffer[begin] == '\n') {
+				++begin;
+				return true;
+			}
+			if (line.size() == maxLength) {
+				throw std::runtime_error("Line too long");
+			}
+			line.push_back(buffer[begin]);
+		}
+		if (!fill()) {
+			if (line.empty()) {
+				return false;
+			}
+			throw std::runtime_error("Connection closed in the middle of a line");
+		}
+	}
+}
+
+void Connection::readExact(size_t n, std::string& data) {
+	while (n) {
+		if (begin == end && !fill()) {
+			throw std::runtime_error("Connection closed in the middle of a message");
+		}
+		size_t chunk = std::min(n, end - begin);
+		data.append(buffer.data() + begin, chunk);
+		begin += chunk;
+		n -= chunk;
+	}
+}
+
+void Connection::readBuffered(std::string& data) {
+	data.append(buffer.data() + begin, end - begin);
+	begin = end;
+}
+
+void Connection::shutdownWrite() {
+	if (::shutdown(fd, SHUT_WR) < 0) {
+		throw socketError("Cannot shut down the socket");
+	}
+}
+
+void Connection::writeAll(const std::string& data) {
+	size_t written = 0;
+	while (written < data.size()) {
+		// MSG_NOSIGNAL: a client that went away is an error of this connection, not a SIGPIPE for the whole server
+		ssize_t n = ::send(fd, data.data() + written, data.size() - written, MSG_NOSIGNAL);
+		if (n < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			throw socketError("Cannot write to the socket");
+		}
+		written += n;
+	}
+}
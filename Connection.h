@@ -0,0 +1,54 @@
+#ifndef CONNECTION_H
+#define CONNECTION_H
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// A connected Unix domain socket, with buffered reads, used by the server mode and its client.
+// Errors of the socket raise std::runtime_error.
+class Connection
+{
+public:
+	// Takes ownership of a connected socket.
+	explicit Connection(int fd) : fd{ fd } {}
+
+	// Connects to the server listening on the given socket path.
+	static Connection connectTo(const std::string& path);
+
+	Connection(Connection&& other) noexcept;
+	Connection(const Connection&) = delete;
+	Connection& operator=(const Connection&) = delete;
+	~Connection();
+
+	// Reads a line without its '\n'. Returns false if the peer closed the connection before sending anything;
+	// a line longer than maxLength raises an error.
+	bool readLine(std::string& line, size_t maxLength = 256);
+
+	// Reads exactly n bytes, appending them to data.
+	void readExact(size_t n, std::string& data);
+
+	void writeAll(const std::string& data);
+
+	// Whether bytes were received and not read yet.
+	bool buffered() const {
+		return begin < end;
+	}
+
+	// Appends the bytes received and not read yet to data.
+	void readBuffered(std::string& data);
+
+	// Tells the peer that nothing more will be written.
+	void shutdownWrite();
+
+private:
+	// Reads what is available into the buffer; returns false at the end of the stream.
+	bool fill();
+
+	int fd;
+	std::vector<char> buffer;
+	size_t begin = 0;
+	size_t end = 0;
+};
+
+#endif
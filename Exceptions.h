@@ -4,7 +4,7 @@
 #include <stdexcept>
 #include <string>
 
-// Extending the "std::runtime_error" class in four different contexts to help pinpoint the stage of the program where the issue occurred.
+// Extending the "std::runtime_error" class in different contexts to help pinpoint the stage of the program where the issue occurred.
 
 struct LexicalError : std::runtime_error {
 	LexicalError(const char* msg) : std::runtime_error(msg) { }
@@ -23,5 +23,10 @@ struct SemanticError : std::runtime_error{
 	SemanticError(const char* msg) : std::runtime_error(msg) { }
 	SemanticError(std::string msg) : std::runtime_error(msg.c_str()) { }
 };
+// The program was stopped because it exceeded a limit of its ExecutionLimits (steps, time or output).
+struct BudgetExceeded : std::runtime_error {
+	BudgetExceeded(const char* msg) : std::runtime_error(msg) { }
+	BudgetExceeded(std::string msg) : std::runtime_error(msg.c_str()) { }
+};
 
 #endif
\ No newline at end of file
@@ -0,0 +1,218 @@
+#include <cerrno>
+#include <charconv>
+#include <cstring>
+#include <stdexcept>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "InputSource.h"
+#include "Exceptions.h"
+
+namespace {
+	// Same characters as std::isspace in the "C" locale, which is what std::cin uses to split the words.
+	inline bool isSpace(char c) {
+		return c == ' ' || (c >= '\t' && c <= '\r');
+	}
+}
+
+BufferedInputSource::BufferedInputSource(int f)
+	: fd{ f }, ownsFd{ false }, endOfFile{ false }, pos{ nullptr }, end{ nullptr }, mapped{ nullptr }, mappedSize{ 0 },
+	  chunk(CHUNK_SIZE), readyPos{ 0 }, pendingError{ NONE } {
+	pos = end = chunk.data();
+	ready.reserve(MAX_READY);
+}
+
+BufferedInputSource::BufferedInputSource(const char* begin, const char* e)
+	: fd{ -1 }, ownsFd{ false }, endOfFile{ true }, pos{ begin }, end{ e }, mapped{ nullptr }, mappedSize{ 0 },
+	  readyPos{ 0 }, pendingError{ NONE } {
+	ready.reserve(MAX_READY);
+}
+
+BufferedInputSource::~BufferedInputSource() {
+	if (mapped) {
+		munmap(mapped, mappedSize);
+	}
+	if (ownsFd) {
+		::close(fd);
+	}
+}
+
+std::unique_ptr<BufferedInputSource> BufferedInputSource::openFile(const std::string& fileName) {
+	int f = ::open(fileName.c_str(), O_RDONLY);
+	if (f < 0) {
+		throw std::runtime_error("Cannot open input file " + fileName + ": " + std::strerror(errno));
+	}
+	struct stat info;
+	if (fstat(f, &info) == 0 && S_ISREG(info.st_mode)) {
+		if (info.st_size == 0) {
+			::close(f);
+			return std::unique_ptr<BufferedInputSource>(new BufferedInputSource(nullptr, nullptr));
+		}
+		void* m = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, f, 0);
+		if (m != MAP_FAILED) {
+			// The mapping stays valid after the descriptor is closed
+			::close(f);
+			madvise(m, info.st_size, MADV_SEQUENTIAL);
+			const char* begin = static_cast<const char*>(m);
+			std::unique_ptr<BufferedInputSource> source(new BufferedInputSource(begin, begin + info.st_size));
+			source->mapped = m;
+			source->mappedSize = info.st_size;
+			return source;
+		}
+	}
+	// Not a regular file or not mappable: read it in chunks like the standard input
+	std::unique_ptr<BufferedInputSource> source(new BufferedInputSource(f));
+	source->ownsFd = true;
+	return source;
+}
+
+void BufferedInputSource::setMemory(const char* begin, const char* e) {
+	pos = begin;
+	end = e;
+	ready.clear();
+	readyPos = 0;
+	pendingError = NONE;
+}
+
+Value BufferedInputSource::next() {
+	if (readyPos == ready.size() && !refill()) {
+		// The messages are the ones the evaluator gave when it validated the words read with std::cin
+		switch (pendingError) {
+		case NOT_A_NUMBER:
+			throw SemanticError("NOT A ACCETABLE NUMBER ");
+		default:
+			throw SemanticError("END OF INPUT");
+		}
+	}
+	return std::move(ready[readyPos++]);
+}
+
+bool BufferedInputSource::refill() {
+	ready.clear();
+	readyPos = 0;
+	while (pendingError == NONE) {
+		// Convert what is already in memory first, then read a new chunk only if nothing was ready
+		convert(endOfFile);
+		if (!ready.empty()) {
+			return true;
+		}
+		if (pendingError != NONE) {
+			break;
+		}
+		if (endOfFile) {
+			pendingError = END_OF_INPUT;
+			break;
+		}
+		readChunk();
+	}
+	return false;
+}
+
+void BufferedInputSource::convert(bool final) {
+	while (pos < end && ready.size() < MAX_READY) {
+		while (pos < end && isSpace(*pos)) {
+			++pos;
+		}
+		if (pos == end) {
+			return;
+		}
+		const char* wordEnd = pos;
+		while (wordEnd < end && !isSpace(*wordEnd)) {
+			++wordEnd;
+		}
+		if (wordEnd == end && !final) {
+			// The word may continue in the next chunk
+			return;
+		}
+		long int value = 0;
+		std::from_chars_result r = std::from_chars(pos, wordEnd, value);
+		if (r.ptr != wordEnd) {
+			pendingError = NOT_A_NUMBER;
+			return;
+		}
+		if (r.ec == std::errc::result_out_of_range) {
+			// Only digits, but too many for a long int: the word becomes a big value
+			Value b;
+			Value::fromChars(pos, wordEnd, b);
+			ready.push_back(b);
+		}
+		else {
+			ready.push_back(value);
+		}
+		pos = wordEnd;
+	}
+}
+
+void BufferedInputSource::readChunk() {
+	// Move the unconverted part of the previous chunk to the front, then append the new bytes
+	size_t leftover = end - pos;
+	size_t offset = pos - chunk.data();
+	if (chunk.size() < leftover + CHUNK_SIZE) {
+		chunk.resize(leftover + CHUNK_SIZE);
+	}
+	std::memmove(chunk.data(), chunk.data() + offset, leftover);
+	ssize_t n;
+	do {
+		n = ::read(fd, chunk.data() + leftover, CHUNK_SIZE);
+	} while (n < 0 && errno == EINTR);
+	if (n < 0) {
+		throw std::runtime_error(std::string("Cannot read the input: ") + std::strerror(errno));
+	}
+	if (n == 0) {
+		endOfFile = true;
+	}
+	pos = chunk.data();
+	end = pos + leftover + n;
+}
+
+StringInputSource::StringInputSource(std::string t)
+	: BufferedInputSource(nullptr, nullptr), text{ std::move(t) } {
+	setMemory(text.data(), text.data() + text.size());
+}
+
+void FeedInputSource::feed(const char* data, size_t n) {
+	// The words already read are dropped when they are most of the text, so the text stays as large as the unread data
+	if (pos > text.size() / 2) {
+		text.erase(0, pos);
+		wordEnd -= pos;
+		pos = 0;
+	}
+	text.append(data, n);
+}
+
+bool FeedInputSource::findWord() {
+	while (pos < text.size() && isSpace(text[pos])) {
+		++pos;
+	}
+	wordEnd = pos;
+	while (wordEnd < text.size() && !isSpace(text[wordEnd])) {
+		++wordEnd;
+	}
+	return wordEnd < text.size() || closed;
+}
+
+bool FeedInputSource::ready() {
+	return findWord();
+}
+
+Value FeedInputSource::next() {
+	if (!findWord() || pos == wordEnd) {
+		throw SemanticError("END OF INPUT");
+	}
+	Value v;
+	if (!Value::fromChars(text.data() + pos, text.data() + wordEnd, v)) {
+		throw SemanticError("NOT A ACCETABLE NUMBER ");
+	}
+	pos = wordEnd;
+	return v;
+}
+
+Value CallbackInputSource::next() {
+	Value v;
+	if (!callback(v)) {
+		throw SemanticError("END OF INPUT");
+	}
+	return v;
+}
@@ -0,0 +1,153 @@
+#ifndef INPUTSOURCE_H
+#define INPUTSOURCE_H
+
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "Value.h"
+
+// The InputSource provides the values read by the INPUT statements.
+// Like the OutputSink, it is passed to the evaluator so the origin of the input can be chosen by whoever runs the program.
+class InputSource
+{
+public:
+	virtual ~InputSource() {};
+
+	// Returns the next integer of the input (numbers too large for a long int become big values).
+	// Throws SemanticError if the next word is not a number or if the input is over.
+	virtual Value next() = 0;
+
+	// True if next() can return (or fail) without waiting for data. The sources whose next() simply blocks
+	// are always ready; a source fed by the host is not while the next word is incomplete, so the StackEvaluator
+	// can suspend the program instead of blocking its thread.
+	virtual bool ready() {
+		return true;
+	}
+};
+
+// Input source reading whitespace separated integers in large chunks.
+// The data comes from a file descriptor (read in chunks), from a memory mapped file or from memory.
+// Words are converted with std::from_chars into a queue of ready values, so a call to next() usually
+// only pops a value from the queue.
+class BufferedInputSource : public InputSource
+{
+public:
+	static constexpr size_t CHUNK_SIZE = 1 << 16;
+
+	// Reads the file descriptor in chunks of CHUNK_SIZE bytes. The descriptor is not closed by the source.
+	explicit BufferedInputSource(int fd);
+
+	// The source owns mapped memory or a descriptor opened by openFile: no copies.
+	BufferedInputSource(const BufferedInputSource&) = delete;
+	BufferedInputSource& operator=(const BufferedInputSource&) = delete;
+
+	~BufferedInputSource() override;
+
+	// Opens a file as input: it is memory mapped when possible, read in chunks otherwise (pipes, special files).
+	// Throws std::runtime_error if the file cannot be opened.
+	static std::unique_ptr<BufferedInputSource> openFile(const std::string& fileName);
+
+	Value next() override;
+
+protected:
+	// The source reads the whole [begin, end) memory range, which must stay valid while the source is used.
+	BufferedInputSource(const char* begin, const char* end);
+
+	// Replaces the memory range read by the source (used by derived classes owning the memory).
+	void setMemory(const char* begin, const char* end);
+
+private:
+	// Kind of error found while converting the words, reported when the queue reaches the wrong word.
+	enum PendingError { NONE, NOT_A_NUMBER, END_OF_INPUT };
+
+	// Converts the next words into ready values. Returns false when nothing more could be converted,
+	// in which case pendingError tells why.
+	bool refill();
+	// Converts the complete words of [pos, end) into ready values, stopping at the first wrong one.
+	// When "final" is false the last word may continue in the next chunk, so it is left unconverted.
+	void convert(bool final);
+	// Reads the next chunk from the file descriptor into "chunk".
+	void readChunk();
+
+	// Maximum number of values converted at once from memory, to keep the queue small.
+	static constexpr size_t MAX_READY = 4096;
+
+	int fd;
+	bool ownsFd;
+	bool endOfFile;
+
+	// Memory range currently being converted.
+	const char* pos;
+	const char* end;
+
+	// Mapped memory (when the file is memory mapped).
+	void* mapped;
+	size_t mappedSize;
+
+	// Buffer for chunked reads: leftover word of the previous chunk followed by the new bytes.
+	std::vector<char> chunk;
+
+	std::vector<Value> ready;
+	size_t readyPos;
+	PendingError pendingError;
+};
+
+// Input source reading the integers from a string, for tests and embedders.
+class StringInputSource : public BufferedInputSource
+{
+public:
+	explicit StringInputSource(std::string t);
+
+private:
+	std::string text;
+};
+
+// Input source whose data is supplied by the host as it arrives, for programs run by a Scheduler.
+// The next word is ready once a blank follows it or the input is closed.
+class FeedInputSource : public InputSource
+{
+public:
+	// Appends data to the input.
+	void feed(const char* data, size_t n);
+
+	// No more data will come: the last word is complete, and reading past it raises END OF INPUT.
+	void close() {
+		closed = true;
+	}
+
+	bool isClosed() const {
+		return closed;
+	}
+
+	bool ready() override;
+
+	// Called when the source is not ready, raises END OF INPUT like a source that is over.
+	Value next() override;
+
+private:
+	// Finds the next word, setting [pos, wordEnd); returns false if it is not complete yet.
+	bool findWord();
+
+	std::string text;
+	size_t pos = 0;
+	size_t wordEnd = 0;
+	bool closed = false;
+};
+
+// Input source asking a function for every value, for embedders.
+// The function stores the value and returns true, or returns false when there are no more values.
+class CallbackInputSource : public InputSource
+{
+public:
+	explicit CallbackInputSource(std::function<bool(Value&)> f) : callback{ std::move(f) } {}
+
+	Value next() override;
+
+private:
+	std::function<bool(Value&)> callback;
+};
+
+#endif
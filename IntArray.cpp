@@ -0,0 +1,214 @@
+#include <algorithm>
+#include <new>
+#include <stdexcept>
+
+#include "IntArray.h"
+#include "Exceptions.h"
+#include "Statement.h"
+#include "SymbolTable.h"
+
+namespace {
+	typedef unsigned long U;
+
+	// Elements as GCC vectors of 16 bytes, the SIMD registers every x86-64 (SSE2) and ARMv8 (NEON) processor has:
+	// the operations on them are SIMD instructions at any optimization level, without relying on the
+	// auto-vectorizer (which a plain -O2 does not run on these loops). A line holds a whole number of vectors.
+	typedef long Vec __attribute__((vector_size(16)));
+	typedef U UVec __attribute__((vector_size(16)));
+	constexpr size_t WIDTH = sizeof(Vec) / sizeof(long);
+
+	// Runs an element-wise operation over the whole padded storage, vector by vector, so the loop has no remainder.
+	// The element function computes a vector of results and returns a vector of flags, which are or'ed together
+	// to be checked once after the loop.
+	template<typename Element>
+	U kernel(long* r, const long* a, const long* b, size_t padded, Element element) {
+		UVec flags = {};
+		for (size_t i = 0; i < padded; i += WIDTH) {
+			flags |= element(*reinterpret_cast<Vec*>(r + i), *reinterpret_cast<const Vec*>(a + i),
+				*reinterpret_cast<const Vec*>(b + i));
+		}
+		U f = 0;
+		for (size_t j = 0; j < WIDTH; ++j) {
+			f |= flags[j];
+		}
+		return f;
+	}
+
+	// Overflow of a sum or a difference: the sign bit of the flags (as in the LaneEvaluator).
+	UVec addElement(Vec& r, Vec x, Vec y) {
+		r = reinterpret_cast<Vec>(reinterpret_cast<UVec>(x) + reinterpret_cast<UVec>(y));
+		return reinterpret_cast<UVec>((x ^ r) & (y ^ r));
+	}
+
+	UVec subElement(Vec& r, Vec x, Vec y) {
+		r = reinterpret_cast<Vec>(reinterpret_cast<UVec>(x) - reinterpret_cast<UVec>(y));
+		return reinterpret_cast<UVec>((x ^ y) & (x ^ r));
+	}
+
+	// The product of two 32 bits integers cannot overflow: the flags have a bit above the 32 low bits set
+	// if an operand does not fit in 32 bits, and only then are the products checked one by one.
+	UVec mulElement(Vec& r, Vec x, Vec y) {
+		UVec ux = reinterpret_cast<UVec>(x), uy = reinterpret_cast<UVec>(y);
+		r = reinterpret_cast<Vec>(ux * uy);
+		return (ux + 0x80000000UL) | (uy + 0x80000000UL);
+	}
+
+	// The comparisons of 64 bits integers are SSE4 instructions: they are made of SSE2 ones.
+	// x < y: the sign of x - y, inverted if the difference overflows.
+	UVec ltElement(Vec& r, Vec x, Vec y) {
+		UVec ux = reinterpret_cast<UVec>(x), uy = reinterpret_cast<UVec>(y), d = ux - uy;
+		r = reinterpret_cast<Vec>((d ^ ((ux ^ uy) & (d ^ ux))) >> 63);
+		return UVec{};
+	}
+
+	UVec gtElement(Vec& r, Vec x, Vec y) {
+		return ltElement(r, y, x);
+	}
+
+	// x == y: x ^ y is zero, the only value whose sign is that of its negation.
+	UVec eqElement(Vec& r, Vec x, Vec y) {
+		UVec z = reinterpret_cast<UVec>(x ^ y);
+		r = reinterpret_cast<Vec>(((z | -z) >> 63) ^ 1);
+		return UVec{};
+	}
+}
+
+IntArray::IntArray(size_t n) : IntArray(n, Uninitialized{}) {
+	std::fill(elements, elements + count, 0L);
+}
+
+IntArray::IntArray(size_t n, Uninitialized) : count{ n }, padded{ (n + LINE - 1) / LINE * LINE },
+	elements{ static_cast<long*>(::operator new(padded * sizeof(long), std::align_val_t{ ALIGNMENT })) } {
+	std::fill(elements + count, elements + padded, 0L);
+}
+
+IntArray::~IntArray() {
+	::operator delete(elements, std::align_val_t{ ALIGNMENT });
+}
+
+size_t IntArray::checkedSize(const Value& n) {
+	if (!n.isSmall() || n.getSmall() < 0 || static_cast<U>(n.getSmall()) > MAX_SIZE) {
+		throw SemanticError("INVALID ARRAY SIZE");
+	}
+	return static_cast<size_t>(n.getSmall());
+}
+
+size_t IntArray::checkedIndex(const Value& index) const {
+	if (!index.isSmall() || index.getSmall() < 0 || static_cast<U>(index.getSmall()) >= count) {
+		throw SemanticError("INDEX OUT OF BOUNDS");
+	}
+	return static_cast<size_t>(index.getSmall());
+}
+
+void IntArray::set(const Value& index, const Value& element) {
+	size_t i = checkedIndex(index);
+	if (!element.isSmall()) {
+		throw SemanticError("ARRAY ELEMENT OVERFLOW");
+	}
+	elements[i] = element.getSmall();
+}
+
+std::unique_ptr<IntArray> IntArray::apply(Operation op, const IntArray& a, const IntArray& b) {
+	if (a.count != b.count) {
+		throw SemanticError("ARRAY SIZE MISMATCH");
+	}
+	std::unique_ptr<IntArray> result{ new IntArray(a.count, Uninitialized{}) };
+	long* r = result->elements;
+	bool overflow = false;
+	switch (op)
+	{
+	case ADD:
+		overflow = kernel(r, a.elements, b.elements, a.padded, addElement) >> 63;
+		break;
+	case SUB:
+		overflow = kernel(r, a.elements, b.elements, a.padded, subElement) >> 63;
+		break;
+	case MUL:
+		if (kernel(r, a.elements, b.elements, a.padded, mulElement) >> 32) {
+			for (size_t i = 0; i < a.count && !overflow; ++i) {
+				overflow = __builtin_mul_overflow(a.elements[i], b.elements[i], &r[i]);
+			}
+		}
+		break;
+	case LT:
+		kernel(r, a.elements, b.elements, a.padded, ltElement);
+		break;
+	case GT:
+		kernel(r, a.elements, b.elements, a.padded, gtElement);
+		break;
+	case EQ:
+		kernel(r, a.elements, b.elements, a.padded, eqElement);
+		break;
+	default:
+		throw SemanticError("INVALID operation");
+	}
+	if (overflow) {
+		throw SemanticError("ARRAY ELEMENT OVERFLOW");
+	}
+	// The padding compares equal
+	std::fill(r + result->count, r + result->padded, 0L);
+	return result;
+}
+
+Value IntArray::sum() const {
+	// The elements are split into their high halves, signed, and their low halves, unsigned:
+	// with at most MAX_SIZE elements neither sum can overflow, so the lines are added without any check.
+	Vec highs = {};
+	UVec lows = {};
+	for (size_t i = 0; i < padded; i += WIDTH) {
+		Vec e = *reinterpret_cast<const Vec*>(elements + i);
+		highs += e >> 32;
+		lows += reinterpret_cast<UVec>(e) & 0xFFFFFFFFUL;
+	}
+	long high = 0;
+	U low = 0;
+	for (size_t j = 0; j < WIDTH; ++j) {
+		high += highs[j];
+		low += lows[j];
+	}
+	// high * 2^32 + low, with the carry of low moved into high so that every operand is a long int
+	high += static_cast<long>(low >> 32);
+	return Value::add(Value::mul(Value(high), Value(1L << 32)), Value(static_cast<long>(low & 0xFFFFFFFFUL)));
+}
+
+int IntArray::slotOf(const Variable* array) {
+	if (array->getSlot() < 0) {
+		throw std::logic_error("Array without slot: the program was not analysed");
+	}
+	return array->getSlot();
+}
+
+void IntArray::execute(SymbolTable& ST, const ArrayStmt* arrayStmtNode, const Value& operand, const Value& element) {
+	int slot = slotOf(arrayStmtNode->getArray());
+	switch (arrayStmtNode->getKind())
+	{
+	case ArrayStmt::ALLOCATE:
+		ST.setArray(slot, std::unique_ptr<IntArray>(new IntArray(checkedSize(operand))));
+		return;
+	case ArrayStmt::PUT:
+		ST.getArray(slot).set(operand, element);
+		return;
+	default: {
+		Operation op = static_cast<Operation>(arrayStmtNode->getKind() - ArrayStmt::ADD);
+		const IntArray& a = ST.getArray(slotOf(arrayStmtNode->getLeft()));
+		const IntArray& b = ST.getArray(slotOf(arrayStmtNode->getRight()));
+		ST.setArray(slot, apply(op, a, b));
+		return;
+	}
+	}
+}
+
+Value IntArray::evaluate(const SymbolTable& ST, const ArrayExpr* arrayExprNode, const Value& index) {
+	const IntArray& a = ST.getArray(slotOf(arrayExprNode->getArray()));
+	switch (arrayExprNode->getKind())
+	{
+	case ArrayExpr::GET:
+		return Value(a.get(index));
+	case ArrayExpr::SUM:
+		return a.sum();
+	case ArrayExpr::LEN:
+		return Value(static_cast<long>(a.count));
+	default:
+		throw SemanticError("INVALID array operation");
+	}
+}
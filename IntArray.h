@@ -0,0 +1,84 @@
+#ifndef INTARRAY_H
+#define INTARRAY_H
+
+#include <cstddef>
+#include <memory>
+
+#include "Value.h"
+
+class SymbolTable;
+class ArrayStmt;
+class ArrayExpr;
+class Variable;
+
+// Integer array of the ARRAY statements: the elements are long ints stored contiguously, in storage aligned on a
+// cache line and padded with zeros up to a whole number of lines. The element-wise kernels run over whole lines,
+// with SIMD instructions and without a remainder loop; the padding never changes
+// a result, as zeros add, subtract, multiply and compare without overflowing (and is cleared after a kernel).
+// The errors are SemanticErrors: a size beyond MAX_SIZE, an index out of bounds, an element that is not a long int,
+// operands of different sizes and an element-wise operation that overflows.
+class IntArray
+{
+public:
+	static constexpr size_t ALIGNMENT = 64;
+	static constexpr size_t LINE = ALIGNMENT / sizeof(long);
+	static constexpr size_t MAX_SIZE = static_cast<size_t>(1) << 24;
+
+	// Element-wise operations, in the order of the element-wise kinds of ArrayStmt.
+	enum Operation { ADD, SUB, MUL, LT, GT, EQ };
+
+	// An array of n zeros, n being at most MAX_SIZE.
+	explicit IntArray(size_t n);
+	~IntArray();
+
+	IntArray(const IntArray&) = delete;
+	IntArray& operator=(const IntArray&) = delete;
+
+	size_t size() const {
+		return count;
+	}
+
+	const long* data() const {
+		return elements;
+	}
+
+	// The size of an ARRAY statement: between 0 and MAX_SIZE.
+	static size_t checkedSize(const Value& n);
+
+	long get(const Value& index) const {
+		return elements[checkedIndex(index)];
+	}
+
+	void set(const Value& index, const Value& element);
+
+	// Element-wise operation on two arrays of the same size, into a new array (so the destination may be an operand).
+	static std::unique_ptr<IntArray> apply(Operation op, const IntArray& a, const IntArray& b);
+
+	// Exact sum of the elements: a big integer if it does not fit in a long int.
+	Value sum() const;
+
+	// Bytes of the storage, for memory accounting.
+	size_t bytesHeld() const {
+		return sizeof(IntArray) + padded * sizeof(long);
+	}
+
+	// The array statements and reads of the evaluators, on the arrays of a SymbolTable. Their numeric operands
+	// (the size of ARRAY, the index and the element of PUT, the index of GET) are evaluated by the caller.
+	// The arrays are accessed by slot: the program must have been analysed by the AssignmentAnalysis.
+	static void execute(SymbolTable& ST, const ArrayStmt* arrayStmtNode, const Value& operand, const Value& element);
+	static Value evaluate(const SymbolTable& ST, const ArrayExpr* arrayExprNode, const Value& index);
+
+private:
+	// Storage for n elements: the padding is cleared, the elements are left to the caller.
+	struct Uninitialized {};
+	IntArray(size_t n, Uninitialized);
+
+	size_t checkedIndex(const Value& index) const;
+	static int slotOf(const Variable* array);
+
+	size_t count;
+	size_t padded;
+	long* elements;
+};
+
+#endif
@@ -0,0 +1,417 @@
+#include <algorithm>
+#include <climits>
+#include <fstream>
+#include <stdexcept>
+
+#include "Lanes.h"
+#include "Exceptions.h"
+
+LaneEvaluator::LaneEvaluator(const ProgramHandle& p, const std::vector<std::string>& in, const ExecutionLimits& l)
+	: program{ p }, width{ in.size() }, limits{ l }, meter{ l }, outputs(in.size()), alive(in.size(), true),
+	numbers{ in.size() }, conditions{ in.size() }, masks{ in.size() }, failed(in.size()) {
+	inputs.reserve(width);
+	for (const std::string& text : in) {
+		inputs.emplace_back(new StringInputSource(text));
+	}
+	size_t slots = program->getProgram()->getSlotNames().size();
+	values.assign(slots * width, 0);
+	assigned.assign(slots * width, false);
+}
+
+void LaneEvaluator::run() {
+	char* all = masks.push();
+	std::fill(all, all + width, true);
+	try {
+		if (limits.metered()) {
+			fuel = meter.start();
+		}
+		program->getProgram()->accept(this);
+	}
+	catch (BudgetExceeded&) {
+		// The lanes run at most as many steps as the whole group and start at the same time:
+		// the ones still running are run again alone, to stop at the exact step
+		for (size_t lane = 0; lane < width; ++lane) {
+			retire(lane);
+		}
+	}
+	masks.pop();
+}
+
+bool LaneEvaluator::any(const char* m) const {
+	char set = 0;
+	for (size_t lane = 0; lane < width; ++lane) {
+		set |= m[lane];
+	}
+	return set != 0;
+}
+
+bool LaneEvaluator::pushMask(const char* cond, bool set) {
+	const char* parent = masks.peek();
+	char* m = masks.push();
+	char flip = !set;
+	for (size_t lane = 0; lane < width; ++lane) {
+		m[lane] = parent[lane] & (cond[lane] ^ flip);
+	}
+	return any(m);
+}
+
+void LaneEvaluator::retire(size_t lane) {
+	if (alive[lane]) {
+		alive[lane] = false;
+		masks.clearLane(lane);
+	}
+}
+
+void LaneEvaluator::retireFailed(const char* f) {
+	for (size_t lane = 0; lane < width; ++lane) {
+		if (f[lane]) {
+			retire(lane);
+		}
+	}
+}
+
+void LaneEvaluator::visitProgram(Program* progNode) {
+	progNode->getBlock()->accept(this);
+}
+
+void LaneEvaluator::visitBlock(Block* blockNode) {
+	// A step of the whole group, as in the EvaluatorVisitor
+	if (limits.metered() && --fuel == 0) {
+		fuel = meter.refill();
+	}
+	for (auto i : blockNode->getVector()) {
+		if (!any(mask())) {
+			return;
+		}
+		i->accept(this);
+	}
+}
+
+void LaneEvaluator::visitPrintStmt(PrintStmt* printStmtNode) {
+	printStmtNode->getPrinter()->accept(this);
+	const long* v = numbers.peek();
+	const char* m = mask();
+	for (size_t lane = 0; lane < width; ++lane) {
+		if (m[lane]) {
+			outputs[lane].writeValue(Value(v[lane]));
+			if (limits.maxOutputBytes && outputs[lane].str().size() > limits.maxOutputBytes) {
+				retire(lane);
+			}
+		}
+	}
+	numbers.pop();
+}
+
+void LaneEvaluator::visitSetStmt(SetStmt* setStmtNode) {
+	setStmtNode->getSetter()->accept(this);
+	int slot = setStmtNode->getVar()->getSlot();
+	if (slot < 0) {
+		throw std::logic_error("Variable without slot: the program was not analysed");
+	}
+	const long* v = numbers.peek();
+	const char* m = mask();
+	long* x = &values[slot * width];
+	char* a = &assigned[slot * width];
+	for (size_t lane = 0; lane < width; ++lane) {
+		x[lane] = m[lane] ? v[lane] : x[lane];
+		a[lane] |= m[lane];
+	}
+	numbers.pop();
+}
+
+void LaneEvaluator::visitInputStmt(InputStmt* inputStmtNode) {
+	int slot = inputStmtNode->getVar()->getSlot();
+	if (slot < 0) {
+		throw std::logic_error("Variable without slot: the program was not analysed");
+	}
+	const char* m = mask();
+	for (size_t lane = 0; lane < width; ++lane) {
+		if (!m[lane]) {
+			continue;
+		}
+		try {
+			Value v = inputs[lane]->next();
+			if (v.isSmall()) {
+				values[slot * width + lane] = v.getSmall();
+				assigned[slot * width + lane] = true;
+			}
+			else {
+				retire(lane);
+			}
+		}
+		catch (SemanticError&) {
+			retire(lane);
+		}
+	}
+}
+
+void LaneEvaluator::visitWhileStmt(WhileStmt* whileStmtNode) {
+	// The lanes still iterating: the condition is evaluated for them, the body runs for those where it is true
+	pushMask(mask(), true);
+	while (true) {
+		whileStmtNode->getCondition()->accept(this);
+		const char* c = conditions.peek();
+		char* loop = masks.peek();
+		char more = 0;
+		for (size_t lane = 0; lane < width; ++lane) {
+			loop[lane] &= c[lane];
+			more |= loop[lane];
+		}
+		conditions.pop();
+		if (!more) {
+			break;
+		}
+		whileStmtNode->getReppeter()->accept(this);
+	}
+	masks.pop();
+}
+
+void LaneEvaluator::visitIfStmt(IfStmt* ifStmtNode) {
+	ifStmtNode->getCondition()->accept(this);
+	const char* c = conditions.peek();
+	if (pushMask(c, true)) {
+		ifStmtNode->getIfBlock()->accept(this);
+	}
+	masks.pop();
+	if (pushMask(c, false)) {
+		ifStmtNode->getElseBlock()->accept(this);
+	}
+	masks.pop();
+	conditions.pop();
+}
+
+void LaneEvaluator::visitParallelStmt(ParallelStmt* parallelStmtNode) {
+	// The children run one after the other for all the lanes, as the EvaluatorVisitor runs them without a pool
+	for (auto i : parallelStmtNode->getChildren()) {
+		i->accept(this);
+	}
+}
+
+void LaneEvaluator::visitArrayStmt(ArrayStmt*) {
+	retireFailed(mask());
+}
+
+void LaneEvaluator::visitOperator(Operator* opNode) {
+	opNode->getLeft()->accept(this);
+	opNode->getRight()->accept(this);
+	long* a = numbers.peek(1);
+	const long* b = numbers.peek();
+	const char* m = mask();
+	char* f = failed.data();
+	// The lanes outside the mask compute on whatever they hold, so the arithmetic wraps instead of overflowing
+	// and never divides by zero; only the lanes of the mask are checked.
+	// The checks of the operations proven by the RangeAnalysis are left out.
+	typedef unsigned long U;
+	char anyFailed = 0;
+	switch (opNode->getEvaluation())
+	{
+	case Operator::ADD_UNCHECKED:
+		for (size_t lane = 0; lane < width; ++lane) {
+			a[lane] = static_cast<long>(static_cast<U>(a[lane]) + static_cast<U>(b[lane]));
+		}
+		break;
+	case Operator::SUB_UNCHECKED:
+		for (size_t lane = 0; lane < width; ++lane) {
+			a[lane] = static_cast<long>(static_cast<U>(a[lane]) - static_cast<U>(b[lane]));
+		}
+		break;
+	case Operator::MUL_UNCHECKED:
+		for (size_t lane = 0; lane < width; ++lane) {
+			a[lane] = static_cast<long>(static_cast<U>(a[lane]) * static_cast<U>(b[lane]));
+		}
+		break;
+	case Operator::ADD:
+		for (size_t lane = 0; lane < width; ++lane) {
+			long r = static_cast<long>(static_cast<U>(a[lane]) + static_cast<U>(b[lane]));
+			// Overflow: both operands have the sign the result does not have
+			f[lane] = static_cast<char>(static_cast<U>((a[lane] ^ r) & (b[lane] ^ r)) >> 63) & m[lane];
+			anyFailed |= f[lane];
+			a[lane] = r;
+		}
+		break;
+	case Operator::SUB:
+		for (size_t lane = 0; lane < width; ++lane) {
+			long r = static_cast<long>(static_cast<U>(a[lane]) - static_cast<U>(b[lane]));
+			f[lane] = static_cast<char>(static_cast<U>((a[lane] ^ b[lane]) & (a[lane] ^ r)) >> 63) & m[lane];
+			anyFailed |= f[lane];
+			a[lane] = r;
+		}
+		break;
+	case Operator::MUL:
+		for (size_t lane = 0; lane < width; ++lane) {
+			long r;
+			f[lane] = __builtin_mul_overflow(a[lane], b[lane], &r) & m[lane];
+			anyFailed |= f[lane];
+			a[lane] = r;
+		}
+		break;
+	case Operator::DIV:
+	case Operator::DIV_UNCHECKED:
+		for (size_t lane = 0; lane < width; ++lane) {
+			// Dividing by zero fails, LONG_MIN / -1 is promoted to a big integer
+			bool bad = b[lane] == 0 || (a[lane] == LONG_MIN && b[lane] == -1);
+			f[lane] = bad & m[lane];
+			anyFailed |= f[lane];
+			a[lane] = bad ? 0 : a[lane] / b[lane];
+		}
+		break;
+	default:
+		throw SemanticError("INVALID operation");
+	}
+	if (anyFailed) {
+		retireFailed(f);
+	}
+	numbers.pop();
+}
+
+void LaneEvaluator::visitNumber(Number* numNode) {
+	long* v = numbers.push();
+	const Value& n = numNode->getValue();
+	if (n.isSmall()) {
+		std::fill(v, v + width, n.getSmall());
+		return;
+	}
+	// A literal too large for the lanes
+	std::fill(v, v + width, 0);
+	retireFailed(mask());
+}
+
+void LaneEvaluator::visitVariable(Variable* varNode) {
+	int slot = varNode->getSlot();
+	if (slot < 0) {
+		throw std::logic_error("Variable without slot: the program was not analysed");
+	}
+	long* v = numbers.push();
+	std::copy(&values[slot * width], &values[slot * width] + width, v);
+	if (varNode->getAssignment() == Variable::ASSIGNED) {
+		return;
+	}
+	// The lanes reading the variable before assigning it fail
+	const char* m = mask();
+	const char* a = &assigned[slot * width];
+	char* f = failed.data();
+	char anyFailed = 0;
+	for (size_t lane = 0; lane < width; ++lane) {
+		f[lane] = m[lane] & !a[lane];
+		anyFailed |= f[lane];
+	}
+	if (anyFailed) {
+		retireFailed(f);
+	}
+}
+
+void LaneEvaluator::visitArrayExpr(ArrayExpr*) {
+	long* v = numbers.push();
+	std::fill(v, v + width, 0);
+	retireFailed(mask());
+}
+
+void LaneEvaluator::visitRelOp(RelOp* relOpNode) {
+	relOpNode->getLeft()->accept(this);
+	relOpNode->getRight()->accept(this);
+	const long* a = numbers.peek(1);
+	const long* b = numbers.peek();
+	char* c = conditions.push();
+	switch (relOpNode->getRelOpCode())
+	{
+	case RelOp::EQ:
+		for (size_t lane = 0; lane < width; ++lane) {
+			c[lane] = a[lane] == b[lane];
+		}
+		break;
+	case RelOp::LT:
+		for (size_t lane = 0; lane < width; ++lane) {
+			c[lane] = a[lane] < b[lane];
+		}
+		break;
+	case RelOp::GT:
+		for (size_t lane = 0; lane < width; ++lane) {
+			c[lane] = a[lane] > b[lane];
+		}
+		break;
+	default:
+		throw SemanticError("INVALID realtional operator");
+	}
+	numbers.pop();
+	numbers.pop();
+}
+
+void LaneEvaluator::visitBoolConst(BoolConst* boolConstNode) {
+	char* c = conditions.push();
+	std::fill(c, c + width, boolConstNode->getValue());
+}
+
+void LaneEvaluator::visitBoolOp(BoolOp* boolOpNode) {
+	boolOpNode->getLeft()->accept(this);
+	char* l = conditions.peek();
+	BoolOp::BoolOpCode code = boolOpNode->getBoolOpCode();
+	if (code == BoolOp::NOT) {
+		for (size_t lane = 0; lane < width; ++lane) {
+			l[lane] = !l[lane];
+		}
+		return;
+	}
+	// The right operand is evaluated only by the lanes the left one does not decide:
+	// those where it is true for AND, false for OR
+	bool isAnd = code == BoolOp::AND;
+	if (pushMask(l, isAnd)) {
+		boolOpNode->getRight()->accept(this);
+		const char* r = conditions.peek();
+		for (size_t lane = 0; lane < width; ++lane) {
+			l[lane] = isAnd ? l[lane] & r[lane] : l[lane] | r[lane];
+		}
+		conditions.pop();
+	}
+	masks.pop();
+}
+
+std::vector<std::string> LaneRunner::readInputSets(const std::string& fileName) {
+	std::ifstream file{ fileName };
+	if (!file) {
+		throw std::runtime_error("Cannot open the input sets " + fileName);
+	}
+	std::vector<std::string> inputs;
+	std::string line;
+	while (std::getline(file, line)) {
+		inputs.push_back(std::move(line));
+	}
+	return inputs;
+}
+
+std::vector<Session::Result> LaneRunner::run(const ProgramHandle& program, const std::vector<std::string>& inputs) {
+	Session session{ limits };
+	std::vector<Session::Result> results(inputs.size());
+	retiredRuns = 0;
+	for (size_t first = 0; first < inputs.size(); first += width) {
+		size_t count = std::min(width, inputs.size() - first);
+		std::vector<std::string> group(inputs.begin() + first, inputs.begin() + first + count);
+		LaneEvaluator lanes{ program, group, limits };
+		lanes.run();
+		for (size_t lane = 0; lane < count; ++lane) {
+			if (lanes.retired(lane)) {
+				results[first + lane] = session.run(program, group[lane]);
+				retiredRuns++;
+			}
+			else {
+				results[first + lane].output = lanes.output(lane);
+			}
+		}
+	}
+	return results;
+}
+
+size_t LaneRunner::run(const ProgramHandle& program, const std::vector<std::string>& inputs, std::ostream& out) {
+	std::vector<Session::Result> results = run(program, inputs);
+	size_t failed = 0;
+	for (size_t i = 0; i < results.size(); ++i) {
+		const Session::Result& r = results[i];
+		out << "=== " << i + 1 << " " << Session::statusName(r.status);
+		if (!r.ok()) {
+			out << ": " << r.message;
+			++failed;
+		}
+		out << "\n" << r.output;
+	}
+	out.flush();
+	return failed;
+}
@@ -0,0 +1,162 @@
+#ifndef LANES_H
+#define LANES_H
+
+#include <cstddef>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "Visitor.h"
+#include "Session.h"
+#include "Budget.h"
+
+// The LaneEvaluator runs one program over many input sets at once (SPMD): every variable holds one value per input set,
+// a lane, and every node of the tree is evaluated once for all the lanes with loops the compiler vectorizes.
+// Control flow is handled with masks: an IF runs each branch for the lanes taking it, a WHILE runs its body for the
+// lanes whose condition is still true until none is, and AND/OR evaluate their right operand only for the lanes
+// that need it, so a lane never evaluates something its scalar run would not.
+// Lanes hold long ints only. A lane that would do anything else (promote a value to a big integer, fail with an error,
+// exceed a limit) is retired: it stops taking part in the run and the LaneRunner runs it again alone with the scalar
+// evaluator, which gives its exact output and error. The lanes reaching an array statement or expression are retired
+// as well: the arrays are left to the scalar evaluator.
+class LaneEvaluator : public Visitor {
+public:
+	// Lane i reads its INPUT values from inputs[i]; the program must have been compiled by a Session.
+	LaneEvaluator(const ProgramHandle& program, const std::vector<std::string>& inputs, const ExecutionLimits& limits);
+
+	// Runs the program over all the lanes.
+	void run();
+
+	// After the run: the lanes that must be run again alone, and the output of every lane that was not retired.
+	bool retired(size_t lane) const {
+		return !alive[lane];
+	}
+
+	const std::string& output(size_t lane) const {
+		return outputs[lane].str();
+	}
+
+	void visitProgram(Program* progNode) override;
+	void visitBlock(Block* blockNode) override;
+
+	void visitPrintStmt(PrintStmt* printStmtNode) override;
+	void visitSetStmt(SetStmt* setStmtNode) override;
+	void visitInputStmt(InputStmt* inputStmtNode) override;
+	void visitWhileStmt(WhileStmt* whileStmtNode) override;
+	void visitIfStmt(IfStmt* ifStmtNode) override;
+	void visitParallelStmt(ParallelStmt* parallelStmtNode) override;
+	void visitArrayStmt(ArrayStmt* arrayStmtNode) override;
+
+	// The numeric expressions push their lanes on the numeric accumulator, the boolean ones on the boolean accumulator.
+	void visitOperator(Operator* opNode) override;
+	void visitNumber(Number* numNode) override;
+	void visitVariable(Variable* varNode) override;
+	void visitArrayExpr(ArrayExpr* arrayExprNode) override;
+
+	void visitRelOp(RelOp* relOpNode) override;
+	void visitBoolConst(BoolConst* boolConstNode) override;
+	void visitBoolOp(BoolOp* boolOpNode) override;
+
+private:
+	// Stack of lane vectors whose storage is reused: pushing never allocates once the stack reached its depth.
+	template<typename T>
+	class LaneStack {
+	public:
+		explicit LaneStack(size_t w) : width{ w } {}
+
+		T* push() {
+			if (top == storage.size()) {
+				storage.emplace_back(width);
+			}
+			return storage[top++].data();
+		}
+
+		T* peek(size_t fromTop = 0) {
+			return storage[top - 1 - fromTop].data();
+		}
+
+		void pop() {
+			--top;
+		}
+
+		// Clears the lane in every vector of the stack.
+		void clearLane(size_t lane) {
+			for (size_t k = 0; k < top; ++k) {
+				storage[k][lane] = 0;
+			}
+		}
+
+		size_t size() const {
+			return top;
+		}
+
+	private:
+		size_t width;
+		size_t top = 0;
+		std::vector<std::vector<T>> storage;
+	};
+
+	// Lanes executing the current statement: the top of the mask stack.
+	const char* mask() {
+		return masks.peek();
+	}
+
+	// True if some lane of the current mask is set.
+	bool any(const char* m) const;
+	// Pushes the current mask restricted to the lanes set (or not set, if "set" is false) in "cond".
+	bool pushMask(const char* cond, bool set);
+	// Removes the lane from the run, and from all the masks.
+	void retire(size_t lane);
+	// Retires the lanes of the current mask that are set in "failed".
+	void retireFailed(const char* failed);
+
+	ProgramHandle program;
+	size_t width;
+	ExecutionLimits limits;
+	BudgetMeter meter;
+	unsigned long long fuel = 0;
+	std::vector<std::unique_ptr<StringInputSource>> inputs;
+	std::vector<StringOutputSink> outputs;
+	std::vector<char> alive;
+	// Values and assigned flags of the variables, by slot and then by lane.
+	std::vector<long> values;
+	std::vector<char> assigned;
+	LaneStack<long> numbers;
+	LaneStack<char> conditions;
+	LaneStack<char> masks;
+	std::vector<char> failed;	// Scratch vector of the lanes failing a check
+};
+
+// Runs a program over many input sets (--lanes mode): groups of up to "width" input sets are run by a LaneEvaluator,
+// the lanes it retires by the scalar evaluator of a Session. Every result is the one Session::run would give.
+class LaneRunner
+{
+public:
+	static constexpr size_t DEFAULT_WIDTH = 64;
+
+	// Reads the input sets: every line of the file holds the whitespace separated INPUT values of one run.
+	// Throws std::runtime_error if the file cannot be read.
+	static std::vector<std::string> readInputSets(const std::string& fileName);
+
+	explicit LaneRunner(size_t width = DEFAULT_WIDTH, const ExecutionLimits& l = ExecutionLimits()) : width{ width ? width : DEFAULT_WIDTH }, limits{ l } {}
+
+	// Runs the program over every input set, the outputs are returned in the results.
+	std::vector<Session::Result> run(const ProgramHandle& program, const std::vector<std::string>& inputs);
+
+	// Runs the program over every input set and writes for each one a header line "=== <input set> <status>",
+	// numbered from 1, followed by its output. Returns the number of failed runs.
+	size_t run(const ProgramHandle& program, const std::vector<std::string>& inputs, std::ostream& out);
+
+	// Lanes that had to be run again alone in the last run.
+	size_t getRetired() const {
+		return retiredRuns;
+	}
+
+private:
+	size_t width;
+	ExecutionLimits limits;
+	size_t retiredRuns = 0;
+};
+
+#endif
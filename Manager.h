@@ -27,6 +27,21 @@ public:
 	// Template function to clear memory of a vector of objects.
 	template <typename T>
 	void clearMemory(std::vector<T>& vec);
+
+	// Number of nodes allocated by the manager.
+	virtual size_t nodeCount() const = 0;
+
+	// Bytes held by the allocated nodes (including what they allocate themselves) and by the manager, for memory accounting.
+	virtual size_t bytesHeld() const = 0;
+
+protected:
+	// Heap bytes of a string, zero when it fits in the string itself.
+	static size_t stringBytes(const std::string& s) {
+		return s.capacity() > std::string().capacity() ? s.capacity() + 1 : 0;
+	}
+
+	// Bytes of the nodes that never change after their creation, counted by the make functions.
+	size_t nodeBytes = 0;
 };
 
 // Managers are used to keep track of all allocated objects.
@@ -40,21 +55,38 @@ public:
 	NumExpr* makeOperator(Operator::OpCode op, NumExpr* l, NumExpr* r) {
 		NumExpr* created = new Operator(op, l, r);
 		NEallocated.push_back(created);
+		nodeBytes += sizeof(Operator);
 		return created;
 	} 
 	// Create a numerical constant.
-	NumExpr* makeNumber(int value) {
-		NumExpr* created = new Number(value);
+	NumExpr* makeNumber(const Value& value) {
+		Number* created = new Number(value);
+		NEallocated.push_back(created);
+		nodeBytes += sizeof(Number) + created->getValue().bytesHeld();
+		return created;
+	}
+	// Create an array read; the index is only given for GET.
+	NumExpr* makeArrayExpr(ArrayExpr::Kind k, Variable* a, NumExpr* i = nullptr) {
+		NumExpr* created = new ArrayExpr(k, a, i);
 		NEallocated.push_back(created);
+		nodeBytes += sizeof(ArrayExpr);
 		return created;
 	}
 	// Create a variable_id.
-	NumExpr* makeVariable(std::string name) {
-		NumExpr* created = new Variable(name);
+	NumExpr* makeVariable(const std::string& name) {
+		Variable* created = new Variable(name);
 		NEallocated.push_back(created);
+		nodeBytes += sizeof(Variable) + stringBytes(created->getVarId());
 		return created;
 	}
 
+	size_t nodeCount() const override {
+		return NEallocated.size();
+	}
+	size_t bytesHeld() const override {
+		return nodeBytes + NEallocated.capacity() * sizeof(NumExpr*);
+	}
+
 	// Destructor to free allocated memory.
 	 ~NumExprManager() override;
 private: 
@@ -70,8 +102,21 @@ public:
 	Block* makeBlock() {
 		Block* created = new Block();
 		Ballocated.push_back(created);
+		nodeBytes += sizeof(Block);
 		return created;
 	}
+
+	size_t nodeCount() const override {
+		return Ballocated.size();
+	}
+	// The statement lists grow after the creation of the blocks, so they are measured now.
+	size_t bytesHeld() const override {
+		size_t bytes = nodeBytes + Ballocated.capacity() * sizeof(Block*);
+		for (auto b : Ballocated) {
+			bytes += b->getVector().capacity() * sizeof(Statement*);
+		}
+		return bytes;
+	}
 	// Destructor to free allocated memory.
 	 ~BlockManager() override;
 private:
@@ -85,26 +130,37 @@ public:
 	BoolExpr* makeBoolConst(bool b) {
 		BoolExpr* created = new BoolConst(b);
 		BEallocated.push_back(created);
+		nodeBytes += sizeof(BoolConst);
 		return created;
 	}
 	// Create a relational operator boolean expression.
 	BoolExpr* makeRelOp(RelOp::RelOpCode o, NumExpr* lop, NumExpr* rop) {
 		BoolExpr* created = new RelOp(o,lop,rop);
 		BEallocated.push_back(created);
+		nodeBytes += sizeof(RelOp);
 		return created;
 	}
 	// Create a boolean operator boolean expression with two operands.
 	BoolExpr* makeBoolOp(BoolOp::BoolOpCode o, BoolExpr* lop, BoolExpr* rop) {
 		BoolExpr* created = new BoolOp(o,lop,rop);
 		BEallocated.push_back(created);
+		nodeBytes += sizeof(BoolOp);
 		return created;
 	}
 	// Create and manage a boolean operator boolean expression with one operand.(NOT)
 	BoolExpr* makeBoolOp(BoolOp::BoolOpCode o, BoolExpr* lop) {
 		BoolExpr* created = new BoolOp(o, lop);
 		BEallocated.push_back(created);
+		nodeBytes += sizeof(BoolOp);
 		return created;
 	}
+	size_t nodeCount() const override {
+		return BEallocated.size();
+	}
+	size_t bytesHeld() const override {
+		return nodeBytes + BEallocated.capacity() * sizeof(BoolExpr*);
+	}
+
 	// Destructor to free allocated memory.
 	~BoolExprManager() override;
 private:
@@ -118,32 +174,65 @@ public:
 	Statement* makeIfStmt(BoolExpr* c, Block* bi, Block* be) {
 		Statement* created = new IfStmt(c,bi,be);
 		Sallocated.push_back(created);
+		nodeBytes += sizeof(IfStmt);
 		return created;
 	}
 	// Create a while statement
 	Statement* makeWhileStmt(BoolExpr* b, Block* bb) {
 		Statement* created = new WhileStmt(b,bb);
 		Sallocated.push_back(created);
+		nodeBytes += sizeof(WhileStmt);
+		return created;
+	}
+	// Create a parallel statement
+	Statement* makeParallelStmt(const std::vector<Block*>& c) {
+		Statement* created = new ParallelStmt(c);
+		Sallocated.push_back(created);
+		nodeBytes += sizeof(ParallelStmt) + c.size() * sizeof(Block*);
+		return created;
+	}
+	// Create an array statement: ARRAY or PUT
+	Statement* makeArrayStmt(ArrayStmt::Kind k, Variable* a, NumExpr* o, NumExpr* e = nullptr) {
+		Statement* created = new ArrayStmt(k, a, o, e);
+		Sallocated.push_back(created);
+		nodeBytes += sizeof(ArrayStmt);
+		return created;
+	}
+	// Create an element-wise array statement
+	Statement* makeArrayStmt(ArrayStmt::Kind k, Variable* d, Variable* l, Variable* r) {
+		Statement* created = new ArrayStmt(k, d, l, r);
+		Sallocated.push_back(created);
+		nodeBytes += sizeof(ArrayStmt);
 		return created;
 	}
 	// Create an input statement
 	Statement* makeInputStmt(Variable* v) {
 		Statement* created = new InputStmt(v);
 		Sallocated.push_back(created);
+		nodeBytes += sizeof(InputStmt);
 		return created;
 	}
 	// Create a print statement
 	Statement* makePrintStmt(NumExpr* n) {
 		Statement* created = new PrintStmt(n);
 		Sallocated.push_back(created);
+		nodeBytes += sizeof(PrintStmt);
 		return created;
 	}
 	// Create a set statement
 	Statement* makeSetStmt(Variable* v, NumExpr* n) {
 		Statement* created = new SetStmt(v,n);
 		Sallocated.push_back(created);
+		nodeBytes += sizeof(SetStmt);
 		return created;
 	}
+	size_t nodeCount() const override {
+		return Sallocated.size();
+	}
+	size_t bytesHeld() const override {
+		return nodeBytes + Sallocated.capacity() * sizeof(Statement*);
+	}
+
 	// Destructor to free allocated memory.
 	~StatementManager() override;
 private:
@@ -157,8 +246,16 @@ public:
 	Program* makeProgram(Block* bb) {
 		Program* created = new Program(bb);
 		Pallocated.push_back(created);
+		nodeBytes += sizeof(Program);
 		return created;
 	}
+
+	size_t nodeCount() const override {
+		return Pallocated.size();
+	}
+	size_t bytesHeld() const override {
+		return nodeBytes + Pallocated.capacity() * sizeof(Program*);
+	}
 	// Destructor to free allocated memory.
 	~ProgramManager() override;
 private:
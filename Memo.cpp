@@ -0,0 +1,176 @@
+#include <algorithm>
+#include <iterator>
+
+#include "Memo.h"
+
+ExpressionMemo::ExpressionMemo(Program* progNode, size_t threshold) : minCost{ threshold } {
+	progNode->accept(this);
+}
+
+unsigned long long ExpressionMemo::hits() const {
+	unsigned long long total = 0;
+	for (const Entry& e : entries) {
+		total += e.hits;
+	}
+	return total;
+}
+
+unsigned long long ExpressionMemo::misses() const {
+	unsigned long long total = 0;
+	for (const Entry& e : entries) {
+		total += e.misses;
+	}
+	return total;
+}
+
+void ExpressionMemo::writeText(std::ostream& os) const {
+	size_t disabled = std::count_if(entries.begin(), entries.end(), [](const Entry& e) { return !e.enabled; });
+	os << "Expression memo: " << entries.size() << " cached subtrees (" << disabled << " switched off), "
+		<< hits() << " hits, " << misses() << " misses" << std::endl;
+	for (const Entry& e : entries) {
+		if (e.hits + e.misses == 0) {
+			continue;
+		}
+		os << "  line " << e.line << " column " << e.column << ": " << e.cost << " nodes, " << e.slots.size()
+			<< " variables, " << e.hits << " hits, " << e.misses << " misses" << (e.enabled ? "" : " (switched off)") << std::endl;
+	}
+}
+
+template<typename Node>
+void ExpressionMemo::combine(Node* node, Subtree left, const Subtree* right) {
+	if (right) {
+		left.cost += right->cost;
+		left.cacheable = left.cacheable && right->cacheable;
+		if (left.cacheable) {
+			std::vector<int> slots;
+			std::set_union(left.slots.begin(), left.slots.end(), right->slots.begin(), right->slots.end(), std::back_inserter(slots));
+			left.slots = std::move(slots);
+		}
+	}
+	left.cost++;
+	if (left.slots.size() > MAX_FREE_VARIABLES) {
+		left.cacheable = false;
+	}
+	if (!left.cacheable) {
+		left.slots.clear();
+	}
+	else if (left.cost >= minCost) {
+		index.emplace(node, static_cast<int>(entries.size()));
+		entries.emplace_back();
+		Entry& e = entries.back();
+		e.cost = left.cost;
+		e.line = current ? current->getLine() : 0;
+		e.column = current ? current->getColumn() : 0;
+		e.slots = left.slots;
+		e.versions.resize(e.slots.size());
+	}
+	last = std::move(left);
+}
+
+void ExpressionMemo::visitProgram(Program* progNode) {
+	progNode->getBlock()->accept(this);
+}
+
+void ExpressionMemo::visitBlock(Block* blockNode) {
+	for (auto i : blockNode->getVector()) {
+		i->accept(this);
+	}
+}
+
+void ExpressionMemo::visitPrintStmt(PrintStmt* printStmtNode) {
+	current = printStmtNode;
+	printStmtNode->getPrinter()->accept(this);
+}
+
+void ExpressionMemo::visitSetStmt(SetStmt* setStmtNode) {
+	current = setStmtNode;
+	setStmtNode->getSetter()->accept(this);
+}
+
+void ExpressionMemo::visitInputStmt(InputStmt*) {
+}
+
+void ExpressionMemo::visitWhileStmt(WhileStmt* whileStmtNode) {
+	current = whileStmtNode;
+	whileStmtNode->getCondition()->accept(this);
+	whileStmtNode->getReppeter()->accept(this);
+}
+
+void ExpressionMemo::visitIfStmt(IfStmt* ifStmtNode) {
+	current = ifStmtNode;
+	ifStmtNode->getCondition()->accept(this);
+	ifStmtNode->getIfBlock()->accept(this);
+	ifStmtNode->getElseBlock()->accept(this);
+}
+
+void ExpressionMemo::visitParallelStmt(ParallelStmt* parallelStmtNode) {
+	for (auto i : parallelStmtNode->getChildren()) {
+		i->accept(this);
+	}
+}
+
+void ExpressionMemo::visitArrayStmt(ArrayStmt* arrayStmtNode) {
+	current = arrayStmtNode;
+	if (arrayStmtNode->getOperand()) {
+		arrayStmtNode->getOperand()->accept(this);
+	}
+	if (arrayStmtNode->getElement()) {
+		arrayStmtNode->getElement()->accept(this);
+	}
+}
+
+void ExpressionMemo::visitOperator(Operator* opNode) {
+	opNode->getLeft()->accept(this);
+	Subtree left = std::move(last);
+	opNode->getRight()->accept(this);
+	Subtree right = std::move(last);
+	combine(opNode, std::move(left), &right);
+}
+
+void ExpressionMemo::visitNumber(Number*) {
+	last = Subtree{ 1, {}, true };
+}
+
+void ExpressionMemo::visitVariable(Variable* varNode) {
+	// A variable without a slot cannot be versioned
+	if (varNode->getSlot() < 0) {
+		last = Subtree{ 1, {}, false };
+	}
+	else {
+		last = Subtree{ 1, { varNode->getSlot() }, true };
+	}
+}
+
+void ExpressionMemo::visitArrayExpr(ArrayExpr* arrayExprNode) {
+	// The index may be cached, not the read
+	size_t cost = 1;
+	if (arrayExprNode->getIndex()) {
+		arrayExprNode->getIndex()->accept(this);
+		cost += last.cost;
+	}
+	last = Subtree{ cost, {}, false };
+}
+
+void ExpressionMemo::visitRelOp(RelOp* relOpNode) {
+	relOpNode->getLeft()->accept(this);
+	Subtree left = std::move(last);
+	relOpNode->getRight()->accept(this);
+	Subtree right = std::move(last);
+	combine(relOpNode, std::move(left), &right);
+}
+
+void ExpressionMemo::visitBoolConst(BoolConst*) {
+	last = Subtree{ 1, {}, true };
+}
+
+void ExpressionMemo::visitBoolOp(BoolOp* boolOpNode) {
+	boolOpNode->getLeft()->accept(this);
+	Subtree left = std::move(last);
+	if (boolOpNode->getBoolOpCode() == BoolOp::NOT) {
+		combine(boolOpNode, std::move(left), nullptr);
+		return;
+	}
+	boolOpNode->getRight()->accept(this);
+	Subtree right = std::move(last);
+	combine(boolOpNode, std::move(left), &right);
+}
@@ -0,0 +1,189 @@
+#ifndef MEMO_H
+#define MEMO_H
+
+#include <ostream>
+#include <unordered_map>
+#include <vector>
+
+#include "Visitor.h"
+
+// The ExpressionMemo caches the results of expensive expression subtrees between their evaluations.
+// A subtree is pure: its result depends only on its free variables, so a cached result is reused as long as
+// the write versions of those variables in the SymbolTable (see getVersion) are the ones it was computed with.
+// The memo is planned once for a program: every Operator, RelOp or BoolOp subtree of at least "threshold" nodes,
+// with at most MAX_FREE_VARIABLES free variables all resolved to slots by the AssignmentAnalysis, gets an entry.
+// A subtree reading an array gets none: PUT changes an array without changing the version of its slot.
+// The entries of the nodes are kept in the memo, which leaves the program untouched: it can be shared by threads
+// running it with memos of their own. The cached results belong to a single run (a single SymbolTable).
+// An entry whose inputs change almost every time (a subtree depending on the loop counter, for example) would only
+// cost a check per evaluation: after PROBATION lookups, an entry hitting less than one time in five is switched off.
+class ExpressionMemo : public Visitor {
+public:
+	static constexpr size_t DEFAULT_THRESHOLD = 16;
+	static constexpr size_t MAX_FREE_VARIABLES = 8;
+	static constexpr unsigned long long PROBATION = 64;
+
+	struct Entry {
+		size_t cost = 0;	// Nodes of the subtree
+		int line = 0, column = 0;	// Position of the statement containing the subtree
+		std::vector<int> slots;	// Free variables
+		std::vector<unsigned long long> versions;	// Their versions when the result was computed
+		bool valid = false;
+		bool enabled = true;
+		Value number;	// The result, for a numeric subtree
+		bool condition = false;	// The result, for a boolean subtree
+		unsigned long long hits = 0, misses = 0;
+	};
+
+	explicit ExpressionMemo(Program* progNode, size_t threshold = DEFAULT_THRESHOLD);
+
+	// The entry of the subtree rooted at the node, nullptr if it is not cached.
+	Entry* entry(const void* node) {
+		auto i = index.find(node);
+		return i == index.end() ? nullptr : &entries[i->second];
+	}
+
+	// Returns true if the cached result of the entry is valid for the current versions of its free variables,
+	// counting the hit or the miss. A switched off entry always returns false.
+	bool lookup(Entry& e, const SymbolTable& ST) {
+		if (!e.enabled) {
+			return false;
+		}
+		if (e.valid) {
+			size_t i = 0;
+			while (i < e.slots.size() && ST.getVersion(e.slots[i]) == e.versions[i]) {
+				++i;
+			}
+			if (i == e.slots.size()) {
+				e.hits++;
+				return true;
+			}
+		}
+		miss(e);
+		return false;
+	}
+
+	// The result has just been computed: records the versions it depends on (the caller stores the result).
+	void store(Entry& e, const SymbolTable& ST) {
+		if (!e.enabled) {
+			return;
+		}
+		for (size_t i = 0; i < e.slots.size(); ++i) {
+			e.versions[i] = ST.getVersion(e.slots[i]);
+		}
+		e.valid = true;
+	}
+
+	size_t size() const {
+		return entries.size();
+	}
+
+	unsigned long long hits() const;
+	unsigned long long misses() const;
+
+	// Totals, then every entry that was looked up.
+	void writeText(std::ostream& os) const;
+
+	// Planning
+	void visitProgram(Program* progNode) override;
+	void visitBlock(Block* blockNode) override;
+
+	void visitPrintStmt(PrintStmt* printStmtNode) override;
+	void visitSetStmt(SetStmt* setStmtNode) override;
+	void visitInputStmt(InputStmt* inputStmtNode) override;
+	void visitWhileStmt(WhileStmt* whileStmtNode) override;
+	void visitIfStmt(IfStmt* ifStmtNode) override;
+	void visitParallelStmt(ParallelStmt* parallelStmtNode) override;
+	void visitArrayStmt(ArrayStmt* arrayStmtNode) override;
+
+	void visitOperator(Operator* opNode) override;
+	void visitNumber(Number* numNode) override;
+	void visitVariable(Variable* varNode) override;
+	void visitArrayExpr(ArrayExpr* arrayExprNode) override;
+
+	void visitRelOp(RelOp* relOpNode) override;
+	void visitBoolConst(BoolConst* boolConstNode) override;
+	void visitBoolOp(BoolOp* boolOpNode) override;
+
+private:
+	// Summary of the subtree just planned.
+	struct Subtree {
+		size_t cost;
+		std::vector<int> slots;	// Sorted
+		bool cacheable;	// All variables resolved and not too many of them
+	};
+
+	void miss(Entry& e) {
+		e.misses++;
+		if (e.hits + e.misses >= PROBATION && e.hits * 4 < e.misses) {
+			e.enabled = false;
+		}
+	}
+
+	// Combines the summaries of the operands into "last" and creates an entry for the subtree if it is worth it.
+	template<typename Node>
+	void combine(Node* node, Subtree left, const Subtree* right);
+
+	std::vector<Entry> entries;
+	std::unordered_map<const void*, int> index;	// Node to entry
+	size_t minCost;
+	Subtree last;
+	const Statement* current = nullptr;
+};
+
+// Evaluator using an ExpressionMemo for the subtrees that have an entry.
+class MemoVisitor : public EvaluatorVisitor {
+public:
+	MemoVisitor(SymbolTable& S, OutputSink& O, InputSource& I, ExpressionMemo& M) : EvaluatorVisitor{ S, O, I }, ST{ S }, Memo{ M } {}
+
+	void visitOperator(Operator* opNode) override {
+		ExpressionMemo::Entry* m = Memo.entry(opNode);
+		if (!m) {
+			EvaluatorVisitor::visitOperator(opNode);
+			return;
+		}
+		ExpressionMemo::Entry& e = *m;
+		if (Memo.lookup(e, ST)) {
+			pushNumber(e.number);
+			return;
+		}
+		EvaluatorVisitor::visitOperator(opNode);
+		if (e.enabled) {
+			e.number = topNumber();
+			Memo.store(e, ST);
+		}
+	}
+
+	void visitRelOp(RelOp* relOpNode) override {
+		memoCondition(relOpNode, [&] { EvaluatorVisitor::visitRelOp(relOpNode); });
+	}
+
+	void visitBoolOp(BoolOp* boolOpNode) override {
+		memoCondition(boolOpNode, [&] { EvaluatorVisitor::visitBoolOp(boolOpNode); });
+	}
+
+private:
+	template<typename Evaluate>
+	void memoCondition(BoolExpr* node, Evaluate evaluate) {
+		ExpressionMemo::Entry* m = Memo.entry(node);
+		if (!m) {
+			evaluate();
+			return;
+		}
+		ExpressionMemo::Entry& e = *m;
+		if (Memo.lookup(e, ST)) {
+			pushCondition(e.condition);
+			return;
+		}
+		evaluate();
+		if (e.enabled) {
+			e.condition = topCondition();
+			Memo.store(e, ST);
+		}
+	}
+
+	const SymbolTable& ST;
+	ExpressionMemo& Memo;
+};
+
+#endif
@@ -17,3 +17,8 @@ void Variable::accept(Visitor* v)
 {
 	v->visitVariable(this);
 }
+
+void ArrayExpr::accept(Visitor* v)
+{
+	v->visitArrayExpr(this);
+}
@@ -3,6 +3,8 @@
 
 #include <string> 
 
+#include "Value.h"
+
 // Forward declaration of the Visitor class
 // To avoid infinite inclusion
 class Visitor;
@@ -24,6 +26,15 @@ public:
 	// It must be defined immutably during node creation.
 	enum OpCode { ADD, SUB, MUL, DIV };
 
+	// Result of the RangeAnalysis for the operation.
+	// UNCHECKED: operands and result always fit in a long int and a divisor is never zero, so nothing is checked;
+	// INT32: as UNCHECKED, and everything also fits in 32 bits.
+	enum Arithmetic { CHECKED, UNCHECKED, INT32 };
+
+	// The operation and its checking, in a single switch of the evaluators: the OpCode when checked, otherwise
+	// one of the following.
+	enum Evaluation { ADD_UNCHECKED = DIV + 1, SUB_UNCHECKED, MUL_UNCHECKED, DIV_UNCHECKED };
+
 	Operator(OpCode o, NumExpr* le, NumExpr* ri) : Cod {o}, Left{le}, Right{ri} { }
 
 	// Destructor is defaulted as the deallocation isn't the node's responsibility.
@@ -44,42 +55,107 @@ public:
 		return Right;
 	}
 
+	// Set by the RangeAnalysis, before the program is evaluated.
+	void setArithmetic(Arithmetic a) {
+		arithmetic = a;
+	}
+
+	Arithmetic getArithmetic() const{
+		return arithmetic;
+	}
+
+	int getEvaluation() const{
+		return arithmetic == CHECKED ? Cod : static_cast<int>(Cod) + ADD_UNCHECKED;
+	}
+
 private:
 	OpCode Cod;
 	NumExpr* Left; 
 	NumExpr* Right;
+	Arithmetic arithmetic = CHECKED;
 };
 
 class Number : public NumExpr {
 public:
-	Number(long int v) : intValue{ v } { }
+	Number(const Value& v) : intValue{ v } { }
 
 	~Number() = default;
 
 	void accept(Visitor* v) override;
 
-	long int getValue() const{
+	const Value& getValue() const{
 		return intValue;
 	}
 
 private:
-	long int intValue;
+	Value intValue;
 };
 
 class Variable : public NumExpr {
 public:
+	// Result of the AssignmentAnalysis for a read of the variable.
+	// Until the analysis runs the variable has no slot and is looked up by name.
+	enum Assignment { NOT_ANALYSED, ASSIGNED, MAYBE_ASSIGNED, NEVER_ASSIGNED };
 
-	Variable(std::string v): variable_id {v} {}
+	Variable(const std::string& v): variable_id {v} {}
 
 	~Variable() = default;
 
 	void accept(Visitor* v) override;
 
-	std::string getVarId() const{
+	const std::string& getVarId() const{
 		return variable_id;
 	}
+
+	// Set once by the AssignmentAnalysis, before the program is evaluated.
+	void resolve(int s, Assignment a) {
+		slot = s;
+		assignment = a;
+	}
+
+	int getSlot() const{
+		return slot;
+	}
+
+	Assignment getAssignment() const{
+		return assignment;
+	}
 private:
 	std::string variable_id;
+	int slot = -1;
+	Assignment assignment = NOT_ANALYSED;
+};
+
+// Read of an integer array (see IntArray): (GET a i) is the element at index i, (SUM a) the exact sum of the elements
+// and (LEN a) the number of elements.
+class ArrayExpr : public NumExpr {
+public:
+	// In the order of the tokens GET, SUM and LEN.
+	enum Kind { GET, SUM, LEN };
+
+	// The index is only given for GET.
+	ArrayExpr(Kind k, Variable* a, NumExpr* i = nullptr) : kind{ k }, Array{ a }, Index{ i } {}
+
+	~ArrayExpr() = default;
+
+	void accept(Visitor* v) override;
+
+	Kind getKind() const{
+		return kind;
+	}
+
+	Variable* getArray() const{
+		return Array;
+	}
+
+	NumExpr* getIndex() const{
+		return Index;
+	}
+
+private:
+	Kind kind;
+	Variable* Array;
+	NumExpr* Index;
 };
 
 #endif 
@@ -0,0 +1,138 @@
+#include <cerrno>
+#include <charconv>
+#include <cstring>
+#include <sstream>
+#include <stdexcept>
+#include <unistd.h>
+
+#include "OutputSink.h"
+#include "Exceptions.h"
+
+namespace {
+	// Longest decimal representation of a long int ("-9223372036854775808") plus the newline.
+	constexpr size_t MAX_TEXT_VALUE = 21;
+}
+
+BufferedOutputSink::BufferedOutputSink(int f, size_t capacity, int policy, Format format)
+	: fd{ f }, flushPolicy{ policy }, outFormat{ format }, used{ 0 }, buffer(capacity < MAX_TEXT_VALUE ? MAX_TEXT_VALUE : capacity) { }
+
+BufferedOutputSink::~BufferedOutputSink() {
+	// A destructor must not throw: if the output cannot be written there is nobody left to report it to.
+	try {
+		flush();
+	}
+	catch (std::exception&) {
+	}
+}
+
+void BufferedOutputSink::writeValue(const Value& value) {
+	if (outFormat == BINARY_INT64) {
+		if (!value.isSmall()) {
+			throw std::out_of_range("Value too large for the binary output: " + value.toString());
+		}
+		long int v = value.getSmall();
+		reserve(sizeof(v));
+		std::memcpy(buffer.data() + used, &v, sizeof(v));
+		used += sizeof(v);
+		return;
+	}
+	if (!value.isSmall()) {
+		std::string text = value.toString();
+		reserve(text.size() + 1);
+		std::memcpy(buffer.data() + used, text.data(), text.size());
+		used += text.size();
+		buffer[used++] = '\n';
+		return;
+	}
+	reserve(MAX_TEXT_VALUE);
+	char* end = std::to_chars(buffer.data() + used, buffer.data() + buffer.size(), value.getSmall()).ptr;
+	*end++ = '\n';
+	used = end - buffer.data();
+}
+
+void BufferedOutputSink::beforeInput() {
+	if (flushPolicy & FLUSH_ON_INPUT) {
+		flush();
+	}
+}
+
+void BufferedOutputSink::flush() {
+	size_t written = 0;
+	while (written < used) {
+		ssize_t n = ::write(fd, buffer.data() + written, used - written);
+		if (n < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			used = 0;
+			throw std::runtime_error(std::string("Cannot write the output: ") + std::strerror(errno));
+		}
+		written += n;
+	}
+	used = 0;
+}
+
+void BufferedOutputSink::reserve(size_t needed) {
+	if (used + needed <= buffer.size()) {
+		return;
+	}
+	if (flushPolicy & FLUSH_ON_SIZE) {
+		flush();
+	}
+	// A big value may not fit even in the empty buffer
+	while (used + needed > buffer.size()) {
+		buffer.resize(buffer.size() * 2);
+	}
+}
+
+int BufferedOutputSink::parsePolicy(const std::string& names) {
+	int policy = FLUSH_ON_EXIT;
+	std::stringstream list{ names };
+	std::string name;
+	while (std::getline(list, name, ',')) {
+		if (name == "exit") {
+			policy |= FLUSH_ON_EXIT;
+		}
+		else if (name == "size") {
+			policy |= FLUSH_ON_SIZE;
+		}
+		else if (name == "input") {
+			policy |= FLUSH_ON_INPUT;
+		}
+		else {
+			throw std::invalid_argument("Unknown flush policy: " + name);
+		}
+	}
+	return policy;
+}
+
+void StringOutputSink::writeValue(const Value& value) {
+	if (!value.isSmall()) {
+		text += value.toString();
+		text += '\n';
+		return;
+	}
+	char tmp[MAX_TEXT_VALUE];
+	char* end = std::to_chars(tmp, tmp + sizeof(tmp), value.getSmall()).ptr;
+	*end++ = '\n';
+	text.append(tmp, end);
+}
+
+void LimitedOutputSink::writeValue(const Value& value) {
+	size_t bytes;
+	if (binaryFormat) {
+		bytes = sizeof(long int);
+	}
+	else if (value.isSmall()) {
+		char tmp[MAX_TEXT_VALUE];
+		bytes = std::to_chars(tmp, tmp + sizeof(tmp), value.getSmall()).ptr - tmp + 1;
+	}
+	else {
+		bytes = value.toString().size() + 1;
+	}
+	if (bytes > remaining) {
+		throw BudgetExceeded("OUTPUT LIMIT EXCEEDED");
+	}
+	remaining -= bytes;
+	target.writeValue(value);
+}
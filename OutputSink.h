@@ -0,0 +1,153 @@
+#ifndef OUTPUTSINK_H
+#define OUTPUTSINK_H
+
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "Value.h"
+
+// The OutputSink receives the values printed by the PRINT statements.
+// It is passed to the evaluator, so the destination of the output can be chosen by whoever runs the program
+// (standard output, a file descriptor, a string for tests and embedders...).
+class OutputSink
+{
+public:
+	virtual ~OutputSink() {};
+
+	// Writes a single printed value.
+	virtual void writeValue(const Value& value) = 0;
+
+	// Called by the evaluator right before an INPUT statement reads its value,
+	// so that interactive prompts printed before the INPUT are visible.
+	virtual void beforeInput() {}
+
+	// Writes out everything that is still buffered.
+	virtual void flush() {}
+};
+
+// Output sink writing to a file descriptor through a large buffer.
+// Integers are formatted with std::to_chars, avoiding iostreams and the flush done by std::endl on every line.
+class BufferedOutputSink : public OutputSink
+{
+public:
+	// Flush policy flags, they can be combined.
+	// FLUSH_ON_SIZE: the buffer is written when it is full (without it, the buffer grows and is written on exit).
+	// FLUSH_ON_INPUT: the buffer is written before each INPUT statement.
+	// The buffer is always written on exit (explicit flush or destruction of the sink).
+	static constexpr int FLUSH_ON_EXIT = 0;
+	static constexpr int FLUSH_ON_SIZE = 1;
+	static constexpr int FLUSH_ON_INPUT = 2;
+
+	// TEXT writes every value as a decimal number followed by a newline.
+	// BINARY_INT64 writes every value as a fixed-width 8 bytes integer in the native byte order
+	// (a value that does not fit in 64 bits cannot be written in this format and raises std::out_of_range).
+	enum Format { TEXT, BINARY_INT64 };
+
+	static constexpr size_t DEFAULT_CAPACITY = 1 << 18;
+
+	BufferedOutputSink(int fd, size_t capacity = DEFAULT_CAPACITY, int policy = FLUSH_ON_SIZE | FLUSH_ON_INPUT, Format format = TEXT);
+
+	// Copying the sink would write the same buffered data twice.
+	BufferedOutputSink(const BufferedOutputSink&) = delete;
+	BufferedOutputSink& operator=(const BufferedOutputSink&) = delete;
+
+	// The destructor writes out what is still buffered.
+	~BufferedOutputSink() override;
+
+	void writeValue(const Value& value) override;
+	void beforeInput() override;
+	void flush() override;
+
+	// Parses a comma separated list of policies ("exit", "size", "input") into flags.
+	// Throws std::invalid_argument if a name is not recognized.
+	static int parsePolicy(const std::string& names);
+
+private:
+	// Makes room for at least "needed" bytes, writing or growing the buffer according to the policy.
+	void reserve(size_t needed);
+
+	int fd;
+	int flushPolicy;
+	Format outFormat;
+	size_t used;
+	std::vector<char> buffer;
+};
+
+// Output sink keeping the printed values as text in memory.
+// It produces exactly what the interpreter would write on the standard output.
+class StringOutputSink : public OutputSink
+{
+public:
+	void writeValue(const Value& value) override;
+
+	const std::string& str() const {
+		return text;
+	}
+
+	void clear() {
+		text.clear();
+	}
+
+private:
+	std::string text;
+};
+
+// Output sink keeping the printed values in memory, to write them later to another sink in the same order.
+class RecordingOutputSink : public OutputSink
+{
+public:
+	void writeValue(const Value& value) override {
+		values.push_back(value);
+	}
+
+	void replay(OutputSink& target) const {
+		for (const Value& v : values) {
+			target.writeValue(v);
+		}
+	}
+
+private:
+	std::vector<Value> values;
+};
+
+// Output sink enforcing the output limit of an ExecutionLimits in front of another sink.
+// The bytes are counted as the target writes them: the text of the value and its newline, or 8 bytes in binary format.
+// The value that would exceed the limit is not written and raises BudgetExceeded.
+class LimitedOutputSink : public OutputSink
+{
+public:
+	LimitedOutputSink(OutputSink& t, size_t maxBytes, bool binary = false) : target{ t }, remaining{ maxBytes }, binaryFormat{ binary } {}
+
+	void writeValue(const Value& value) override;
+
+	void beforeInput() override {
+		target.beforeInput();
+	}
+
+	void flush() override {
+		target.flush();
+	}
+
+private:
+	OutputSink& target;
+	size_t remaining;
+	bool binaryFormat;
+};
+
+// Output sink passing every printed value to a function, for embedders.
+class CallbackOutputSink : public OutputSink
+{
+public:
+	explicit CallbackOutputSink(std::function<void(const Value&)> f) : callback{ std::move(f) } {}
+
+	void writeValue(const Value& value) override {
+		callback(value);
+	}
+
+private:
+	std::function<void(const Value&)> callback;
+};
+
+#endif
@@ -19,6 +19,7 @@ Program* Parser::programParse(std::vector<token>::const_iterator& tokenItr)
 // Parsing for a block
 Block* Parser::blockParse(std::vector<token>::const_iterator& tokenItr)
 {
+	Nesting nesting{ *this };
 
     if (tokenItr->tag == token::LP) {
 		// Create the block that will be returned through the Manager
@@ -36,7 +37,8 @@ Block* Parser::blockParse(std::vector<token>::const_iterator& tokenItr)
 
 			} while (!(tokenItr->tag == token::RP));
 		}
-		else if (tokenItr->tag == token::IF || tokenItr->tag == token::WHILE || tokenItr->tag == token::PRINT || tokenItr->tag == token::SET || tokenItr->tag == token::INPUT) {
+		else if (tokenItr->tag == token::IF || tokenItr->tag == token::WHILE || tokenItr->tag == token::PRINT || tokenItr->tag == token::SET || tokenItr->tag == token::INPUT
+			|| tokenItr->tag == token::PARALLEL || (tokenItr->tag >= token::ARRAY && tokenItr->tag <= token::VEQ)) {
 			// In case the block is a single statement, return to "(" since that will be part of statementParse
 			--tokenItr;
 			ire--;
@@ -45,25 +47,22 @@ Block* Parser::blockParse(std::vector<token>::const_iterator& tokenItr)
 			temp->pushback(part);
 		}
 		else {
-			std::stringstream tmp{};
-			tmp << "ERROR in block definition at word: " << tokenItr->word << " [position: "<< ire << "]";
-			throw ParseError(tmp.str());
-			return nullptr;
+			fail("ERROR in block definition at word: ", tokenItr->word);
 		}
 		// Return a pointer to the Block already allocated by BM
 		return temp;
 	}else
 	{
-		std::stringstream tmp{};
-		tmp << "ERROR: Unexpected initial token for a block at word:  " << tokenItr->word << " [position: " << ire << "]";
-		throw ParseError(tmp.str());
-		return nullptr;
+		fail("ERROR: Unexpected initial token for a block at word:  ", tokenItr->word);
 	}
 }
 // Parsing for a statement
 Statement* Parser::statementParse(std::vector<token>::const_iterator& tokenItr)
 {
+	Nesting nesting{ *this };
 	if (tokenItr->tag == token::LP) {
+		int line = tokenItr->line;
+		int column = tokenItr->column;
 		safe_next(tokenItr);
 		Statement* temp = nullptr;
 		// Parsing different types of statements
@@ -85,9 +84,7 @@ Statement* Parser::statementParse(std::vector<token>::const_iterator& tokenItr)
 			//TODO solve dynamic casting 
 			Variable* vi = (Variable*)ni;
 			if (!vi) {
-				std::stringstream tmp{};
-				tmp << "ERROR: Unrecognized variable at word: " << tokenItr->word << " [position: " << ire << "]";
-				throw ParseError(tmp.str());
+				fail("ERROR: Unrecognized variable at word: ", tokenItr->word);
 			}
 			temp = SM.makeInputStmt(vi);
 		}
@@ -105,9 +102,7 @@ Statement* Parser::statementParse(std::vector<token>::const_iterator& tokenItr)
 			//TODO solve dynamic casting 
 			Variable* vs = (Variable*)ns;
 			if (!vs) {
-				std::stringstream tmp{};
-				tmp << "ERROR: Unrecognized variable at word: " << tokenItr->word << " [position: " << ire << "]";
-				throw ParseError(tmp.str());
+				fail("ERROR: Unrecognized variable at word: ", tokenItr->word);
 			}
 			temp = SM.makeSetStmt(vs, as);
 		}
@@ -119,33 +114,71 @@ Statement* Parser::statementParse(std::vector<token>::const_iterator& tokenItr)
 			safe_next(tokenItr);
 			temp = SM.makeWhileStmt(b, bb);
 		}
+		else if (tokenItr->tag == token::PARALLEL) {
+			// Parsing a parallel statement: blocks until the ")" which ends the statement
+			safe_next(tokenItr);
+			std::vector<Block*> children;
+			do {
+				children.push_back(blockParse(tokenItr));
+				safe_next(tokenItr);
+			} while (!(tokenItr->tag == token::RP));
+			temp = SM.makeParallelStmt(children);
+		}
+		else if (tokenItr->tag >= token::ARRAY && tokenItr->tag <= token::VEQ) {
+			// Parsing an array statement: the array, followed by its size (ARRAY), by the index and the element (PUT)
+			// or by the two operand arrays (element-wise operations)
+			ArrayStmt::Kind kind = static_cast<ArrayStmt::Kind>(tokenItr->tag - token::ARRAY);
+			safe_next(tokenItr);
+			Variable* array = arrayParse(tokenItr);
+			if (kind == ArrayStmt::ALLOCATE) {
+				NumExpr* size = numexprParse(tokenItr);
+				temp = SM.makeArrayStmt(kind, array, size);
+			}
+			else if (kind == ArrayStmt::PUT) {
+				NumExpr* index = numexprParse(tokenItr);
+				NumExpr* element = numexprParse(tokenItr);
+				temp = SM.makeArrayStmt(kind, array, index, element);
+			}
+			else {
+				Variable* left = arrayParse(tokenItr);
+				Variable* right = arrayParse(tokenItr);
+				temp = SM.makeArrayStmt(kind, array, left, right);
+			}
+		}
 		else{
-			std::stringstream tmp{};
-			tmp << "ERROR: Unrecognized variable at word: " << tokenItr->word << " [position: " << ire << "]";
-			throw ParseError(tmp.str());
+			fail("ERROR: Unrecognized variable at word: ", tokenItr->word);
 		}
 		if (tokenItr->tag != token::RP) {
-			std::stringstream tmp{};
-			tmp << "ERROR: Mismatched parenthesis at word: " << tokenItr->word << " [position: " << ire << "]";
-			throw ParseError(tmp.str());
+			fail("ERROR: Mismatched parenthesis at word: ", tokenItr->word);
 		}
+		temp->setLocation(line, column);
 		return temp;
 	}
 	else
 	{
-		std::stringstream tmp{};
-		tmp << "ERROR: Unexpected initial token for a Statement at word:  " << tokenItr->word << " [position: " << ire << "]";
-		throw ParseError(tmp.str());
-		return nullptr;
+		fail("ERROR: Unexpected initial token for a Statement at word:  ", tokenItr->word);
 	}
 }
 
 // Parsing for a numerical expression
 NumExpr* Parser::numexprParse(std::vector<token>::const_iterator& tokenItr)
 {
+	Nesting nesting{ *this };
 	// A correct numerical expression starts with a number, variable_id, or a (
 	if (tokenItr->tag == token::LP) {
 		safe_next(tokenItr);
+		if (tokenItr->tag >= token::GET && tokenItr->tag <= token::LEN) {
+			// A read of an array: the array, followed by the index for GET
+			ArrayExpr::Kind kind = static_cast<ArrayExpr::Kind>(tokenItr->tag - token::GET);
+			safe_next(tokenItr);
+			Variable* array = arrayParse(tokenItr);
+			NumExpr* index = kind == ArrayExpr::GET ? numexprParse(tokenItr) : nullptr;
+			if (tokenItr->tag != token::RP) {
+				fail("ERROR: Mismatched parenthesis at word: ", tokenItr->word);
+			}
+			safe_next(tokenItr);
+			return NEM.makeArrayExpr(kind, array, index);
+		}
 		// Identify the type of operation to perform
 		Operator::OpCode op;
 		switch (tokenItr->tag) {
@@ -154,18 +187,14 @@ NumExpr* Parser::numexprParse(std::vector<token>::const_iterator& tokenItr)
 		case token::MUL: op = Operator::MUL; break;
 		case token::DIV: op = Operator::DIV; break;
 		default:
-			std::stringstream tmp{};
-			tmp << "ERROR: Unrecognized operator at word: " << tokenItr->word << " [position: " << ire << "]";
-			throw ParseError(tmp.str());
+			fail("ERROR: Unrecognized operator at word: ", tokenItr->word);
 		}
 		safe_next(tokenItr);
 		// Parse the left and right operands of the operation
 		NumExpr* left = numexprParse(tokenItr);
 		NumExpr* right = numexprParse(tokenItr);
 		if (tokenItr->tag != token::RP) {
-			std::stringstream tmp{};
-			tmp << "ERROR: Mismatched parenthesis at word: " << tokenItr->word << " [position: " << ire << "]";
-			throw ParseError(tmp.str());
+			fail("ERROR: Mismatched parenthesis at word: ", tokenItr->word);
 		}
 		safe_next(tokenItr);
 		// Create the operation using the pointers and NEM for allocation
@@ -174,39 +203,43 @@ NumExpr* Parser::numexprParse(std::vector<token>::const_iterator& tokenItr)
 	}
 	else if (tokenItr->tag == token::NUMBER) {
 		// Get the value from the token's word
-		// Convert it to a long int
+		// Convert it to a Value (numbers too large for a long int become big values)
 		// Create a node using NEM, using the extracted token value
-		std::stringstream temp{};
-		temp << tokenItr->word;
-		long int value;
-		temp >> value;
+		const std::string& word = tokenItr->word;
+		Value value;
+		if (!Value::fromChars(word.data(), word.data() + word.size(), value)) {
+			fail("ERROR: Invalid number at word: ", word);
+		}
 		NumExpr* expr = NEM.makeNumber(value);
 		safe_next(tokenItr);
 		return expr;
 	}
 	else if (tokenItr->tag == token::VARIABLE_ID) {
-		// Get the value from the token's word
-		// Convert it to a string
-		// Create a node using NEM, using the extracted token text
-		std::stringstream temp{};
-		temp << tokenItr->word;
-		std::string name;
-		temp >> name;
-		NumExpr* expr = NEM.makeVariable(name);
+		// Create a node using NEM, using the token text
+		NumExpr* expr = NEM.makeVariable(tokenItr->word);
 		safe_next(tokenItr);
 		return expr;
 	}
 	else {
-		std::stringstream tmp{};
-		tmp << "ERROR: Unexpected initial token for a Numeric Expression at word:   " << tokenItr->word << " [position: " << ire << "]";
-		throw ParseError(tmp.str());
-		return nullptr;
+		fail("ERROR: Unexpected initial token for a Numeric Expression at word:   ", tokenItr->word);
 	}
 }
 
+// Parsing for the name of an array
+Variable* Parser::arrayParse(std::vector<token>::const_iterator& tokenItr)
+{
+	if (tokenItr->tag != token::VARIABLE_ID) {
+		fail("ERROR: Expected an array name at word: ", tokenItr->word);
+	}
+	Variable* array = static_cast<Variable*>(NEM.makeVariable(tokenItr->word));
+	safe_next(tokenItr);
+	return array;
+}
+
 // Parsing for a boolean expression
 BoolExpr* Parser::boolexprParse(std::vector<token>::const_iterator& tokenItr)
 {	
+	Nesting nesting{ *this };
 	// A correct boolean expression starts with a ( or a boolean constant
 	if (tokenItr->tag == token::LP) {
 		safe_next(tokenItr);
@@ -235,17 +268,11 @@ BoolExpr* Parser::boolexprParse(std::vector<token>::const_iterator& tokenItr)
 			temp = BEM.makeBoolOp(c, notbool);
 		}
 		else{
-			std::stringstream tmp{};
-			tmp << "ERROR: Unrecognized operator in boolean expression at word: " << tokenItr->word << " [position: " << ire << "]";
-			throw ParseError(tmp.str());
-			return nullptr;
+			fail("ERROR: Unrecognized operator in boolean expression at word: ", tokenItr->word);
 		}
 
 		if (tokenItr->tag != token::RP) {
-			std::stringstream tmp{};
-			tmp << "ERROR: Mismatched parenthesis at word: " << tokenItr->word << " [position: " << ire << "]";
-			throw ParseError(tmp.str());
-			return nullptr;
+			fail("ERROR: Mismatched parenthesis at word: ", tokenItr->word);
 		}
 		safe_next(tokenItr);
 		return temp;
@@ -255,5 +282,22 @@ BoolExpr* Parser::boolexprParse(std::vector<token>::const_iterator& tokenItr)
 		safe_next(tokenItr);
 		return bc;
 	}
+	else {
+		fail("ERROR: Unexpected initial token for a Boolean Expression at word:   ", tokenItr->word);
+	}
+}
+
+void Parser::fail(const char* message, const std::string& word)
+{
+	std::stringstream tmp{};
+	tmp << message << word << " [position: " << ire << "]";
+	throw ParseError(tmp.str());
+}
+
+void Parser::tooDeep()
+{
+	std::stringstream tmp{};
+	tmp << "ERROR: Program nested more than " << maxDepth << " levels deep [position: " << ire << "]";
+	throw ParseError(tmp.str());
 }
 
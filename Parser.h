@@ -13,11 +13,20 @@
 #include "NumExpr.h"
 #include "Statement.h"
 
+// The parser, and the analyses and evaluators after it, recurse once per level of nesting of the program:
+// a program nested deeper than maxDepth is rejected with a ParseError, before any of them runs out of stack.
+// DEFAULT_MAX_DEPTH is safe with every pass and evaluator on the 8 MB stack of a process or of a thread. The
+// StackEvaluator keeps its frames on the heap: with --stack-evaluator the interpreter runs on a thread with a stack
+// large enough for the passes on a program nested STACK_EVALUATOR_MAX_DEPTH levels deep.
 class Parser
 {
 public:
+	static constexpr int DEFAULT_MAX_DEPTH = 10000;
+	static constexpr int STACK_EVALUATOR_MAX_DEPTH = 1000000;
+
 	// Constructor: Initializes the parser with various managers for managing objects.
-	Parser(NumExprManager& n, BoolExprManager& be, StatementManager& sm, BlockManager& bm, ProgramManager& pm) : NEM{ n }, BEM{ be }, SM{ sm }, BM{ bm }, PM{ pm } {}
+	Parser(NumExprManager& n, BoolExprManager& be, StatementManager& sm, BlockManager& bm, ProgramManager& pm, int d = DEFAULT_MAX_DEPTH)
+		: NEM{ n }, BEM{ be }, SM{ sm }, BM{ bm }, PM{ pm }, maxDepth{ d } {}
 
 	// Operator() to start parsing from the given input token stream.
 	Program* operator()(const std::vector<token>& inputStream) 
@@ -27,6 +36,7 @@ public:
 		leght = inputStream.size();
 		if(leght == 0) throw ParseError("Empty Program");
 		ire = 1;
+		depth = 0;
 		// Call the parser for the program, as "Program" is the starting symbol of derivation
 		Program* pro = programParse(tokenItr);
 		// If the parsing function above returns but hasn't reached the end of input, raise an error
@@ -45,6 +55,21 @@ private:
 
 	int leght; // Total length of input token stream.
 	int ire;   // Current position in the token stream.
+	int maxDepth;
+	int depth = 0; // Nesting of the parsing functions being run.
+
+	// Counts a level of nesting for the lifetime of a parsing function.
+	struct Nesting {
+		Parser& parser;
+		Nesting(Parser& p) : parser{ p } {
+			if (++parser.depth > parser.maxDepth) {
+				parser.tooDeep();
+			}
+		}
+		~Nesting() {
+			--parser.depth;
+		}
+	};
 
 	// Parsers will be called recursively to create the syntactic tree of the program being parsed.
 	Program* programParse(std::vector<token>::const_iterator& tokenItr);
@@ -52,7 +77,13 @@ private:
 	Statement* statementParse(std::vector<token>::const_iterator& tokenItr);
 	NumExpr* numexprParse(std::vector<token>::const_iterator& tokenItr);
 	BoolExpr* boolexprParse(std::vector<token>::const_iterator& tokenItr);
+	// The name of an array, which has to be a VARIABLE_ID.
+	Variable* arrayParse(std::vector<token>::const_iterator& tokenItr);
+
 
+	// Throws the ParseError of the message, followed by the word and the position.
+	[[noreturn]] __attribute__((noinline, cold)) void fail(const char* message, const std::string& word);
+	[[noreturn]] __attribute__((noinline, cold)) void tooDeep();
 
 	// Helper function to safely move to the next token.
 	void safe_next(std::vector<token>::const_iterator& itr) {
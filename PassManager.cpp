@@ -0,0 +1,172 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <stdexcept>
+
+#include "PassManager.h"
+#include "Rewriter.h"
+#include "Visitor.h"
+
+namespace {
+	// Marks every operator checked again, so that a program in which the range analysis gives up keeps no mark of
+	// an earlier analysis of other code.
+	class ArithmeticReset : public Rewriter {
+	public:
+		using Rewriter::Rewriter;
+
+	protected:
+		NumExpr* rewriteOperator(Operator* opNode, NumExpr* left, NumExpr* right) override {
+			opNode->setArithmetic(Operator::CHECKED);
+			return Rewriter::rewriteOperator(opNode, left, right);
+		}
+	};
+
+	bool contains(const std::vector<std::string>& names, const std::string& name) {
+		return std::find(names.begin(), names.end(), name) != names.end();
+	}
+}
+
+bool RangePass::run(PassContext& context) {
+	ArithmeticReset reset{ context.NEM, context.BEM, context.SM, context.BM, context.PM };
+	reset(context.program);
+	ranges(context.program);
+	return false;
+}
+
+PassManager::PassManager(int l) : level{ l } {
+	add(std::unique_ptr<Pass>(new AssignmentPass()));
+	add(std::unique_ptr<Pass>(new RangePass()));
+	add(std::unique_ptr<Pass>(new RewritePass<ConstantFolding>("fold")));
+	add(std::unique_ptr<Pass>(new RewritePass<AlgebraicSimplification>("simplify")));
+	if (level >= 2) {
+		// Simplifying exposes more constants: (ADD (MUL x 1) 0) folds only once it is x
+		schedule("fold");
+		schedule("simplify");
+		schedule("fold");
+	}
+	required.push_back("assignments");
+	if (level >= 1) {
+		required.push_back("ranges");
+	}
+}
+
+void PassManager::add(std::unique_ptr<Pass> pass) {
+	Entry* e = entry(pass->name());
+	if (e) {
+		e->pass = std::move(pass);
+		e->valid = false;
+		return;
+	}
+	passes.push_back(Entry{ std::move(pass), false });
+}
+
+void PassManager::schedule(const std::string& name) {
+	if (entry(name) == nullptr) {
+		throw std::invalid_argument("Unknown pass: " + name);
+	}
+	pipeline.push_back(name);
+}
+
+void PassManager::dumpAfter(const std::vector<std::string>& names, std::ostream& os) {
+	for (const std::string& name : names) {
+		if (name != "all" && entry(name) == nullptr) {
+			throw std::invalid_argument("Unknown pass: " + name);
+		}
+	}
+	dumped = names;
+	dumpStream = &os;
+}
+
+Pass* PassManager::find(const std::string& name) const {
+	Entry* e = entry(name);
+	return e ? e->pass.get() : nullptr;
+}
+
+PassManager::Entry* PassManager::entry(const std::string& name) const {
+	for (const Entry& e : passes) {
+		if (name == e.pass->name()) {
+			return const_cast<Entry*>(&e);
+		}
+	}
+	return nullptr;
+}
+
+void PassManager::run(PassContext& context) {
+	std::vector<const Entry*> active;
+	for (const std::string& name : pipeline) {
+		runPass(*entry(name), context, active);
+	}
+	for (const std::string& name : required) {
+		ensure(name, context, active);
+	}
+}
+
+void PassManager::ensure(const std::string& name, PassContext& context, std::vector<const Entry*>& active) {
+	Entry* e = entry(name);
+	if (e == nullptr) {
+		throw std::invalid_argument("Unknown pass: " + name);
+	}
+	if (e->pass->kind() != Pass::ANALYSIS) {
+		throw std::logic_error(std::string("A pass cannot depend on the transformation ") + e->pass->name());
+	}
+	if (!e->valid) {
+		runPass(*e, context, active);
+	}
+}
+
+void PassManager::runPass(Entry& e, PassContext& context, std::vector<const Entry*>& active) {
+	if (std::find(active.begin(), active.end(), &e) != active.end()) {
+		throw std::logic_error(std::string("Cyclic dependency of the pass ") + e.pass->name());
+	}
+	active.push_back(&e);
+	for (const std::string& dependency : e.pass->dependencies()) {
+		ensure(dependency, context, active);
+	}
+	active.pop_back();
+
+	auto start = std::chrono::steady_clock::now();
+	bool changed = e.pass->run(context);
+	double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	timings.push_back(Timing{ e.pass->name(), ms, changed });
+
+	if (e.pass->kind() == Pass::ANALYSIS) {
+		e.valid = true;
+	}
+	else if (changed) {
+		std::vector<std::string> kept = e.pass->preserved();
+		for (Entry& other : passes) {
+			if (!contains(kept, other.pass->name())) {
+				other.valid = false;
+			}
+		}
+	}
+	if (dumpStream && (contains(dumped, "all") || contains(dumped, e.pass->name()))) {
+		bool unchanged = e.pass->kind() == Pass::TRANSFORMATION && !changed;
+		*dumpStream << "After " << e.pass->name() << (unchanged ? " (unchanged):" : ":") << "\n";
+		PrintVisitor print{ *dumpStream };
+		context.program->accept(&print);
+	}
+}
+
+void PassManager::writeTimes(std::ostream& os) const {
+	char line[128];
+	os << "Passes (-O" << level << ")\n";
+	std::snprintf(line, sizeof(line), "  %-18s %12s %8s\n", "pass", "wall ms", "changed");
+	os << line;
+	double total = 0;
+	for (const Timing& t : timings) {
+		std::snprintf(line, sizeof(line), "  %-18s %12.3f %8s\n", t.name.c_str(), t.wallMs, t.changed ? "yes" : "no");
+		os << line;
+		total += t.wallMs;
+	}
+	std::snprintf(line, sizeof(line), "  %-18s %12.3f\n", "total", total);
+	os << line;
+}
+
+bool PassManager::parseLevel(const std::string& option, int& l) {
+	if (option.size() != 3 || option.compare(0, 2, "-O") != 0 || option[2] < '0' || option[2] > '0' + MAX_LEVEL) {
+		return false;
+	}
+	l = option[2] - '0';
+	return true;
+}
@@ -0,0 +1,210 @@
+#ifndef PASSMANAGER_H
+#define PASSMANAGER_H
+
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "Manager.h"
+#include "Program.h"
+#include "AssignmentAnalysis.h"
+#include "RangeAnalysis.h"
+
+// What the passes work on: the program, which a transformation replaces with the rewritten one,
+// and the Managers owning the nodes of the program and the nodes the transformations make.
+struct PassContext {
+	NumExprManager& NEM;
+	BoolExprManager& BEM;
+	StatementManager& SM;
+	BlockManager& BM;
+	ProgramManager& PM;
+	Program* program;
+};
+
+// A pass of the PassManager over the syntax tree.
+// An analysis annotates the nodes (slots, checks to skip) and keeps its results; a transformation rewrites the
+// program. Every pass declares the analyses that must be valid before it runs, and a transformation the
+// analyses that stay valid when it changes the program: the others are invalidated and run again when needed.
+class Pass
+{
+public:
+	enum Kind { ANALYSIS, TRANSFORMATION };
+
+	virtual ~Pass() = default;
+
+	virtual const char* name() const = 0;
+	virtual Kind kind() const = 0;
+
+	// Names of the analyses this pass needs.
+	virtual std::vector<std::string> dependencies() const {
+		return {};
+	}
+
+	// Names of the analyses still valid after this transformation changed the program.
+	virtual std::vector<std::string> preserved() const {
+		return {};
+	}
+
+	// Runs the pass; returns true if it changed the program.
+	virtual bool run(PassContext& context) = 0;
+};
+
+// Definite assignment analysis ("assignments"): resolves the variables to slots and checks the PARALLEL statements.
+// It is always the last analysis before the evaluation, as the evaluators need the slots.
+class AssignmentPass : public Pass
+{
+public:
+	const char* name() const override {
+		return "assignments";
+	}
+
+	Kind kind() const override {
+		return ANALYSIS;
+	}
+
+	bool run(PassContext& context) override {
+		warnings = analyse(context.program);
+		return false;
+	}
+
+	// Reads of variables never assigned before, of the last run.
+	const std::vector<AssignmentAnalysis::Warning>& getWarnings() const {
+		return warnings;
+	}
+
+private:
+	AssignmentAnalysis analyse;
+	std::vector<AssignmentAnalysis::Warning> warnings;
+};
+
+// Range analysis ("ranges"): marks the arithmetic that needs no check. Needs the slots of "assignments".
+class RangePass : public Pass
+{
+public:
+	const char* name() const override {
+		return "ranges";
+	}
+
+	Kind kind() const override {
+		return ANALYSIS;
+	}
+
+	std::vector<std::string> dependencies() const override {
+		return { "assignments" };
+	}
+
+	bool run(PassContext& context) override;
+
+	const RangeAnalysis& getRanges() const {
+		return ranges;
+	}
+
+private:
+	RangeAnalysis ranges;
+};
+
+// Transformation running a Rewriter (see Rewriter.h) over the program.
+template<typename R>
+class RewritePass : public Pass
+{
+public:
+	explicit RewritePass(const char* n) : passName{ n } {}
+
+	const char* name() const override {
+		return passName;
+	}
+
+	Kind kind() const override {
+		return TRANSFORMATION;
+	}
+
+	bool run(PassContext& context) override {
+		R rewrite{ context.NEM, context.BEM, context.SM, context.BM, context.PM };
+		Program* rewritten = rewrite(context.program);
+		if (rewritten == context.program) {
+			return false;
+		}
+		context.program = rewritten;
+		return true;
+	}
+
+private:
+	const char* passName;
+};
+
+// The PassManager runs the passes between the Parser and the evaluation.
+// The passes are registered by name, then scheduled in a pipeline; before a pass runs, its dependencies that are not
+// valid run first (and theirs before them), and after a transformation changed the program the analyses it does not
+// preserve are invalid. At the end the analyses the evaluators need ("assignments", and "ranges" from -O1) run
+// again if they are not valid, so they always describe the final program.
+// The optimization levels select the pipeline:
+// -O0: no pass but the assignment analysis, every operation is checked;
+// -O1 (the default): the range analysis removes the checks it can prove useless;
+// -O2: constant folding ("fold") and algebraic simplification ("simplify") first, then folding again on the
+// simplified program, then the analyses.
+// Every run of a pass is timed; the tree can be written after any pass, as source text (see PrintVisitor).
+class PassManager
+{
+public:
+	static constexpr int MAX_LEVEL = 2;
+	static constexpr int DEFAULT_LEVEL = 1;
+
+	// A manager with the standard passes registered and the pipeline of the level scheduled.
+	explicit PassManager(int level = DEFAULT_LEVEL);
+
+	PassManager(const PassManager&) = delete;
+	PassManager& operator=(const PassManager&) = delete;
+
+	// Registers a pass; a pass of the same name is replaced.
+	void add(std::unique_ptr<Pass> pass);
+
+	// Appends a registered pass to the pipeline; throws std::invalid_argument for an unknown name.
+	void schedule(const std::string& name);
+
+	// Writes the program to os after every run of the named passes ("all" for every pass).
+	void dumpAfter(const std::vector<std::string>& names, std::ostream& os);
+
+	// Runs the pipeline on the program of the context, leaving the final program in it.
+	void run(PassContext& context);
+
+	// The registered pass, or null.
+	Pass* find(const std::string& name) const;
+
+	// Writes the time of every run of a pass, in order.
+	void writeTimes(std::ostream& os) const;
+
+	int getLevel() const {
+		return level;
+	}
+
+	// Parses the level of a "-O<n>" option; returns false if it is not one.
+	static bool parseLevel(const std::string& option, int& level);
+
+private:
+	struct Entry {
+		std::unique_ptr<Pass> pass;
+		bool valid = false;	// For an analysis: its results describe the current program
+	};
+
+	struct Timing {
+		std::string name;
+		double wallMs;
+		bool changed;
+	};
+
+	Entry* entry(const std::string& name) const;
+	// Runs the pass after its invalid dependencies; "active" are the passes being run, to report a cycle.
+	void runPass(Entry& e, PassContext& context, std::vector<const Entry*>& active);
+	void ensure(const std::string& name, PassContext& context, std::vector<const Entry*>& active);
+
+	int level;
+	std::vector<Entry> passes;
+	std::vector<std::string> pipeline;
+	std::vector<std::string> required;
+	std::vector<std::string> dumped;
+	std::ostream* dumpStream = nullptr;
+	std::vector<Timing> timings;
+};
+
+#endif
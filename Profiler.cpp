@@ -0,0 +1,89 @@
+#include <algorithm>
+#include <cstdio>
+
+#include "Profiler.h"
+
+void Profiler::start() {
+	// The cheapest of a few measurements of two consecutive readings
+	timerCost = ~0ULL;
+	for (int i = 0; i < 64; ++i) {
+		unsigned long long t0 = ticks();
+		ticks();
+		unsigned long long t2 = ticks();
+		timerCost = std::min(timerCost, t2 - t0);
+	}
+	startTime = std::chrono::steady_clock::now();
+	startTicks = ticks();
+}
+
+void Profiler::stop() {
+	stopTicks = ticks();
+	stopTime = std::chrono::steady_clock::now();
+	totalNs = std::chrono::duration<double, std::nano>(stopTime - startTime).count();
+	double nsPerTick = stopTicks > startTicks ? totalNs / (stopTicks - startTicks) : 1;
+	// The timed executions stand for all of them
+	for (auto& i : entries) {
+		Entry& e = i.second;
+		e.inclusiveNs = e.timed ? e.ticks * nsPerTick * e.count / e.timed : 0;
+		e.exclusiveNs = e.inclusiveNs;
+	}
+	for (auto& i : entries) {
+		if (i.second.parent) {
+			i.second.parent->exclusiveNs -= i.second.inclusiveNs;
+		}
+	}
+	// With sampling the estimate of the nested statements may slightly exceed the one of their parent
+	for (auto& i : entries) {
+		i.second.exclusiveNs = std::max(i.second.exclusiveNs, 0.0);
+	}
+}
+
+std::vector<const Profiler::Entry*> Profiler::sorted() const {
+	std::vector<const Entry*> result;
+	result.reserve(entries.size());
+	for (auto& i : entries) {
+		result.push_back(&i.second);
+	}
+	// Hottest first; equal times keep the source order
+	std::sort(result.begin(), result.end(), [](const Entry* a, const Entry* b) {
+		if (a->exclusiveNs != b->exclusiveNs) {
+			return a->exclusiveNs > b->exclusiveNs;
+		}
+		if (a->stmt->getLine() != b->stmt->getLine()) {
+			return a->stmt->getLine() < b->stmt->getLine();
+		}
+		return a->stmt->getColumn() < b->stmt->getColumn();
+	});
+	return result;
+}
+
+void Profiler::writeText(std::ostream& os) const {
+	char line[160];
+	std::snprintf(line, sizeof(line), "Profile: %.3f ms, statements sorted by exclusive time\n", totalNs / 1e6);
+	os << line;
+	std::snprintf(line, sizeof(line), "%10s  %-8s %12s %12s %14s %14s %7s\n",
+		"line:col", "stmt", "count", "iterations", "inclusive ms", "exclusive ms", "excl %");
+	os << line;
+	for (const Entry* e : sorted()) {
+		char position[32];
+		std::snprintf(position, sizeof(position), "%d:%d", e->stmt->getLine(), e->stmt->getColumn());
+		std::snprintf(line, sizeof(line), "%10s  %-8s %12llu %12llu %14.3f %14.3f %7.2f\n",
+			position, e->kind, e->count, e->iterations, e->inclusiveNs / 1e6, e->exclusiveNs / 1e6,
+			totalNs > 0 ? 100 * e->exclusiveNs / totalNs : 0.0);
+		os << line;
+	}
+}
+
+void Profiler::writeJson(std::ostream& os) const {
+	os << "{\n  \"total_ns\": " << static_cast<unsigned long long>(totalNs) << ",\n";
+	os << "  \"statements\": [";
+	const char* separator = "\n";
+	for (const Entry* e : sorted()) {
+		os << separator << "    {\"line\": " << e->stmt->getLine() << ", \"column\": " << e->stmt->getColumn()
+			<< ", \"kind\": \"" << e->kind << "\", \"count\": " << e->count << ", \"iterations\": " << e->iterations
+			<< ", \"inclusive_ns\": " << static_cast<unsigned long long>(e->inclusiveNs)
+			<< ", \"exclusive_ns\": " << static_cast<unsigned long long>(e->exclusiveNs) << "}";
+		separator = ",\n";
+	}
+	os << "\n  ]\n}\n";
+}
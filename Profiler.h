@@ -0,0 +1,176 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <chrono>
+#include <ostream>
+#include <unordered_map>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#include "token.h"
+#include "Statement.h"
+#include "Visitor.h"
+
+// The Profiler records, for every statement of the program, how many times it was executed,
+// how many iterations it made (WHILE only) and the time spent in it, inclusive and exclusive of the statements it contains.
+// Times are measured with the time stamp counter where available, and converted to nanoseconds at the end of the run
+// by comparing the counter with the steady clock.
+// Reading the counter costs as much as evaluating a small statement, so a statement is timed on its first ALWAYS_TIMED
+// executions and then once every SAMPLE_PERIOD executions; the counts are exact and the times are scaled to the count.
+// The exclusive time of a statement is its inclusive time minus the inclusive time of the statements directly inside it.
+// The cost of the timers of nested statements is measured at start and removed from the time of the enclosing statement.
+class Profiler
+{
+public:
+	static constexpr unsigned long long ALWAYS_TIMED = 1024;
+	static constexpr unsigned long long SAMPLE_PERIOD = 16;
+
+	struct Entry {
+		const Statement* stmt = nullptr;
+		const char* kind = nullptr;	// The statement keyword ("SET", "WHILE"...)
+		Entry* parent = nullptr;	// The statement containing this one
+		unsigned long long count = 0;
+		unsigned long long iterations = 0;
+		unsigned long long timed = 0;	// Executions that were timed
+		unsigned long long ticks = 0;	// Total time of the timed executions
+		double inclusiveNs = 0;	// Estimates computed by stop()
+		double exclusiveNs = 0;
+	};
+
+	// Cheap timer: the time stamp counter on x86, the steady clock in nanoseconds elsewhere.
+	static unsigned long long ticks() {
+#if defined(__x86_64__) || defined(__i386__)
+		return __rdtsc();
+#else
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+	}
+
+	// Start and end of the profiled run; stop converts the ticks to nanoseconds and computes the estimates.
+	void start();
+	void stop();
+
+	// A statement starts executing: returns its entry, which stays valid for the whole run.
+	Entry& enter(const Statement* stmt, const char* kind) {
+		Entry& e = entries[stmt];
+		if (e.count++ == 0) {
+			e.stmt = stmt;
+			e.kind = kind;
+			e.parent = current;
+		}
+		current = &e;
+		return e;
+	}
+
+	// The statement of the entry finished executing.
+	void leave(Entry& e) {
+		current = e.parent;
+	}
+
+	bool shouldTime(const Entry& e) const {
+		return e.count <= ALWAYS_TIMED || e.count % SAMPLE_PERIOD == 0;
+	}
+
+	// Timing of one execution of a statement.
+	struct Timing {
+		unsigned long long regions;
+		unsigned long long begin;
+	};
+
+	Timing startTiming() {
+		return Timing{ timedRegions, ticks() };
+	}
+
+	void stopTiming(Entry& e, const Timing& t) {
+		unsigned long long elapsed = ticks() - t.begin;
+		// A nested timing costs two readings, the reading that ends this one about one
+		unsigned long long overhead = (timedRegions - t.regions) * timerCost + timerCost / 2;
+		e.ticks += elapsed > overhead ? elapsed - overhead : 0;
+		e.timed++;
+		timedRegions++;
+	}
+
+	// Report sorted by exclusive time, in human-readable form and as JSON.
+	void writeText(std::ostream& os) const;
+	void writeJson(std::ostream& os) const;
+
+private:
+	std::vector<const Entry*> sorted() const;
+
+	// Node based map: the entries never move, so they can point to each other.
+	std::unordered_map<const Statement*, Entry> entries;
+	Entry* current = nullptr;
+	unsigned long long timedRegions = 0;	// Timed executions so far
+	unsigned long long timerCost = 0;	// Ticks added to a statement by the timing of a nested one
+	unsigned long long startTicks = 0, stopTicks = 0;
+	std::chrono::steady_clock::time_point startTime, stopTime;
+	double totalNs = 0;
+};
+
+// Evaluator recording every executed statement in a Profiler.
+// The evaluation itself is left to the EvaluatorVisitor, except for the WHILE loop which also counts its iterations.
+class ProfilerVisitor : public EvaluatorVisitor {
+public:
+	ProfilerVisitor(SymbolTable& S, OutputSink& O, InputSource& I, Profiler& P) : EvaluatorVisitor{ S, O, I }, Prof{ P } {}
+
+	void visitPrintStmt(PrintStmt* printStmtNode) override {
+		profile(printStmtNode, token::id2word[token::PRINT], [&](Profiler::Entry&) { EvaluatorVisitor::visitPrintStmt(printStmtNode); });
+	}
+	void visitSetStmt(SetStmt* setStmtNode) override {
+		profile(setStmtNode, token::id2word[token::SET], [&](Profiler::Entry&) { EvaluatorVisitor::visitSetStmt(setStmtNode); });
+	}
+	void visitInputStmt(InputStmt* inputStmtNode) override {
+		profile(inputStmtNode, token::id2word[token::INPUT], [&](Profiler::Entry&) { EvaluatorVisitor::visitInputStmt(inputStmtNode); });
+	}
+	void visitWhileStmt(WhileStmt* whileStmtNode) override {
+		profile(whileStmtNode, token::id2word[token::WHILE], [&](Profiler::Entry& e) {
+			whileStmtNode->getCondition()->accept(this);
+			bool cond = popCondition();
+			while (cond) {
+				e.iterations++;
+				whileStmtNode->getReppeter()->accept(this);
+				whileStmtNode->getCondition()->accept(this);
+				cond = popCondition();
+			}
+		});
+	}
+	void visitIfStmt(IfStmt* ifStmtNode) override {
+		profile(ifStmtNode, token::id2word[token::IF], [&](Profiler::Entry&) { EvaluatorVisitor::visitIfStmt(ifStmtNode); });
+	}
+	void visitParallelStmt(ParallelStmt* parallelStmtNode) override {
+		profile(parallelStmtNode, token::id2word[token::PARALLEL], [&](Profiler::Entry&) { EvaluatorVisitor::visitParallelStmt(parallelStmtNode); });
+	}
+	void visitArrayStmt(ArrayStmt* arrayStmtNode) override {
+		profile(arrayStmtNode, token::id2word[token::ARRAY + arrayStmtNode->getKind()], [&](Profiler::Entry&) { EvaluatorVisitor::visitArrayStmt(arrayStmtNode); });
+	}
+
+private:
+	template<typename Evaluate>
+	void profile(const Statement* stmt, const char* kind, Evaluate evaluate) {
+		Profiler::Entry& e = Prof.enter(stmt, kind);
+		if (Prof.shouldTime(e)) {
+			Profiler::Timing t = Prof.startTiming();
+			try {
+				evaluate(e);
+			}
+			catch (...) {
+				// The statements left by an error or a limit are timed up to it, for the report of the failed run
+				Prof.stopTiming(e, t);
+				Prof.leave(e);
+				throw;
+			}
+			Prof.stopTiming(e, t);
+		}
+		else {
+			evaluate(e);
+		}
+		Prof.leave(e);
+	}
+
+	Profiler& Prof;
+};
+
+#endif
@@ -1,6 +1,9 @@
 #ifndef PROGRAM_H
 #define PROGRAM_H
 
+#include <string>
+#include <vector>
+
 #include "Block.h"
 
 // Forward declaration of the Visitor class
@@ -18,9 +21,39 @@ public:
 		return MainBlock;
 	}
 	
+	// Names of the variables in slot order, set by the AssignmentAnalysis (empty if it did not run).
+	void setSlotNames(const std::vector<std::string>& names) {
+		slotNames = names;
+	}
+
+	const std::vector<std::string>& getSlotNames() const {
+		return slotNames;
+	}
+	
+	// Number of PARALLEL statements, set by the AssignmentAnalysis which checks them.
+	void setParallelStatements(size_t n) {
+		parallelStatements = n;
+	}
+
+	size_t getParallelStatements() const {
+		return parallelStatements;
+	}
+
+	// True if the program has an INPUT statement, set by the AssignmentAnalysis.
+	void setReadsInput(bool r) {
+		readsInput = r;
+	}
+
+	bool getReadsInput() const {
+		return readsInput;
+	}
+
 	void accept(Visitor* v);
 private:
 	// A program has only one possible derivation, which is a block named MainBlock
 	Block* MainBlock;
+	std::vector<std::string> slotNames;
+	size_t parallelStatements = 0;
+	bool readsInput = false;
 };
 #endif
@@ -0,0 +1,59 @@
+#include <cstdint>
+#include <cstdio>
+
+#include "ProgramCache.h"
+
+std::string ProgramCache::hashOf(const std::string& source) {
+	uint64_t h = 14695981039346656037ULL;
+	for (unsigned char c : source) {
+		h ^= c;
+		h *= 1099511628211ULL;
+	}
+	char text[17];
+	std::snprintf(text, sizeof(text), "%016llx", static_cast<unsigned long long>(h));
+	return text;
+}
+
+ProgramHandle ProgramCache::find(const std::string& hash, const std::string* source) {
+	std::lock_guard<std::mutex> lock{ m };
+	auto i = index.find(hash);
+	if (i == index.end() || (source && i->second->source != *source)) {
+		return ProgramHandle();
+	}
+	items.splice(items.begin(), items, i->second);
+	return i->second->program;
+}
+
+void ProgramCache::insert(const std::string& hash, const std::string& source, ProgramHandle program) {
+	size_t bytes = program->bytesHeld() + source.capacity();
+	if (bytes > budget) {
+		return;
+	}
+	std::lock_guard<std::mutex> lock{ m };
+	auto i = index.find(hash);
+	if (i != index.end()) {
+		// Compiled meanwhile by another request, or a collision: the new program replaces the old one
+		used -= i->second->bytes;
+		items.erase(i->second);
+		index.erase(i);
+	}
+	items.push_front(Item{ hash, source, std::move(program), bytes });
+	index[hash] = items.begin();
+	used += bytes;
+	while (used > budget) {
+		Item& last = items.back();
+		used -= last.bytes;
+		index.erase(last.hash);
+		items.pop_back();
+	}
+}
+
+size_t ProgramCache::bytesUsed() const {
+	std::lock_guard<std::mutex> lock{ m };
+	return used;
+}
+
+size_t ProgramCache::size() const {
+	std::lock_guard<std::mutex> lock{ m };
+	return items.size();
+}
@@ -0,0 +1,52 @@
+#ifndef PROGRAMCACHE_H
+#define PROGRAMCACHE_H
+
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include "Session.h"
+
+// Cache of compiled programs keyed by the hash of their source, used by the server mode.
+// The least recently used programs are dropped when the memory held by the cache exceeds its budget.
+// The cache only holds handles: a dropped program that is still running stays alive until its run ends.
+// All the functions can be called by several threads at the same time.
+class ProgramCache
+{
+public:
+	static constexpr size_t DEFAULT_BUDGET = 64 << 20;
+
+	explicit ProgramCache(size_t budget = DEFAULT_BUDGET) : budget{ budget } {}
+
+	// Hash of a source text (64 bits FNV-1a, written as 16 hexadecimal digits).
+	static std::string hashOf(const std::string& source);
+
+	// Returns the program with the given hash, or an empty handle if it is not cached.
+	// When the source is given, it is compared with the cached one, so a hash collision is a miss.
+	ProgramHandle find(const std::string& hash, const std::string* source = nullptr);
+
+	// Adds a program; a program larger than the whole budget is not cached.
+	void insert(const std::string& hash, const std::string& source, ProgramHandle program);
+
+	// Bytes held by the cached programs (syntax trees and sources).
+	size_t bytesUsed() const;
+	size_t size() const;
+
+private:
+	struct Item {
+		std::string hash;
+		std::string source;
+		ProgramHandle program;
+		size_t bytes;
+	};
+
+	// Most recently used first.
+	std::list<Item> items;
+	std::unordered_map<std::string, std::list<Item>::iterator> index;
+	size_t budget;
+	size_t used = 0;
+	mutable std::mutex m;
+};
+
+#endif
@@ -0,0 +1,594 @@
+#include <algorithm>
+#include <climits>
+
+#include "RangeAnalysis.h"
+
+namespace {
+	typedef RangeAnalysis::Interval Interval;
+
+	// Largest exact bound: products of two bounds still fit in an __int128
+	const __int128 LIMIT = static_cast<__int128>(1) << 63;
+	const __int128 INF = static_cast<__int128>(1) << 64;
+	const Interval EMPTY{ 1, 0 };
+	const Interval ANY{ -INF, INF };
+	const Interval LONGS{ LONG_MIN, LONG_MAX };
+	const Interval INDEXES{ 0, IntArray::MAX_SIZE - 1 };
+
+	// A lower bound beyond the limit is either infinite (below) or lowered to the limit (above), which only loosens it
+	__int128 clampLo(__int128 b) {
+		return b < -LIMIT ? -INF : std::min(b, LIMIT);
+	}
+
+	__int128 clampHi(__int128 b) {
+		return b > LIMIT ? INF : std::max(b, -LIMIT);
+	}
+
+	bool infinite(__int128 b) {
+		return b == INF || b == -INF;
+	}
+
+	Interval intersect(const Interval& a, const Interval& b) {
+		return Interval{ std::max(a.lo, b.lo), std::min(a.hi, b.hi) };
+	}
+
+	// Product of two bounds, an infinite bound standing for its limit
+	__int128 product(__int128 a, __int128 b) {
+		if (a == 0 || b == 0) {
+			return 0;
+		}
+		if (infinite(a) || infinite(b)) {
+			return (a < 0) == (b < 0) ? INF : -INF;
+		}
+		return a * b;
+	}
+
+	// Quotients of the corners of a dividend and a divisor that does not contain zero.
+	// For a fixed sign of the divisor the truncated quotient is monotone in both operands, so its extremes are at the corners.
+	void quotients(const Interval& l, const Interval& d, __int128& lo, __int128& hi) {
+		for (__int128 a : { l.lo, l.hi }) {
+			for (__int128 b : { d.lo, d.hi }) {
+				__int128 q[2];
+				int n = 0;
+				if (!infinite(b)) {
+					q[n++] = infinite(a) ? ((a < 0) == (b < 0) ? INF : -INF) : a / b;
+				}
+				else if (!infinite(a)) {
+					q[n++] = 0;
+				}
+				else {
+					// Both unbounded: anything between zero and the infinity of the sign
+					q[n++] = 0;
+					q[n++] = (a < 0) == (b < 0) ? INF : -INF;
+				}
+				for (int i = 0; i < n; ++i) {
+					lo = std::min(lo, q[i]);
+					hi = std::max(hi, q[i]);
+				}
+			}
+		}
+	}
+}
+
+bool RangeAnalysis::operator()(Program* progNode) {
+	names = progNode->getSlotNames();
+	state.vars.assign(names.size(), EMPTY);
+	state.reachable = true;
+	ever.assign(names.size(), EMPTY);
+	operators.clear();
+	recording = true;
+	outcome = true;
+	budget = WORK_LIMIT;
+	abandoned = false;
+	total = unchecked = narrow = 0;
+	try {
+		progNode->accept(this);
+	}
+	catch (const GiveUp&) {
+		abandoned = true;
+		operators.clear();
+		return false;
+	}
+
+	for (auto& entry : operators) {
+		const Seen& s = entry.second;
+		total++;
+		bool fits = s.left.within(LONG_MIN, LONG_MAX) && s.right.within(LONG_MIN, LONG_MAX) && s.result.within(LONG_MIN, LONG_MAX);
+		if (entry.first->getOpCode() == Operator::DIV && s.right.lo <= 0 && s.right.hi >= 0) {
+			fits = false;
+		}
+		if (!fits) {
+			entry.first->setArithmetic(Operator::CHECKED);
+			continue;
+		}
+		unchecked++;
+		if (s.left.within(INT_MIN, INT_MAX) && s.right.within(INT_MIN, INT_MAX) && s.result.within(INT_MIN, INT_MAX)) {
+			entry.first->setArithmetic(Operator::INT32);
+			narrow++;
+		}
+		else {
+			entry.first->setArithmetic(Operator::UNCHECKED);
+		}
+	}
+	return true;
+}
+
+void RangeAnalysis::writeRanges(std::ostream& os) const {
+	if (abandoned) {
+		os << "Ranges: analysis abandoned, every operation is checked" << std::endl;
+		return;
+	}
+	os << "Ranges:" << std::endl;
+	for (size_t slot = 0; slot < names.size(); ++slot) {
+		os << "  " << names[slot] << ": ";
+		if (ever[slot].empty()) {
+			os << "never assigned" << std::endl;
+		}
+		else {
+			os << "[" << boundText(ever[slot].lo) << ", " << boundText(ever[slot].hi) << "]" << std::endl;
+		}
+	}
+	os << "Operations: " << unchecked << " of " << total << " unchecked, " << narrow << " on 32 bits" << std::endl;
+}
+
+std::string RangeAnalysis::boundText(__int128 b) {
+	if (b == INF) {
+		return "+inf";
+	}
+	if (b == -INF) {
+		return "-inf";
+	}
+	bool negative = b < 0;
+	unsigned __int128 u = negative ? -static_cast<unsigned __int128>(b) : static_cast<unsigned __int128>(b);
+	std::string text;
+	do {
+		text.push_back(static_cast<char>('0' + static_cast<int>(u % 10)));
+		u /= 10;
+	} while (u != 0);
+	if (negative) {
+		text.push_back('-');
+	}
+	std::reverse(text.begin(), text.end());
+	return text;
+}
+
+Interval RangeAnalysis::join(const Interval& a, const Interval& b) {
+	if (a.empty()) {
+		return b;
+	}
+	if (b.empty()) {
+		return a;
+	}
+	return Interval{ std::min(a.lo, b.lo), std::max(a.hi, b.hi) };
+}
+
+void RangeAnalysis::join(State& into, const State& other) {
+	if (!other.reachable) {
+		return;
+	}
+	if (!into.reachable) {
+		into = other;
+		return;
+	}
+	for (size_t slot = 0; slot < into.vars.size(); ++slot) {
+		into.vars[slot] = join(into.vars[slot], other.vars[slot]);
+	}
+}
+
+void RangeAnalysis::widen(State& into, const State& next) {
+	if (!into.reachable) {
+		into = next;
+		return;
+	}
+	for (size_t slot = 0; slot < into.vars.size(); ++slot) {
+		Interval& v = into.vars[slot];
+		const Interval& n = next.vars[slot];
+		if (v.empty()) {
+			v = n;
+			continue;
+		}
+		if (n.lo < v.lo) {
+			v.lo = -INF;
+		}
+		if (n.hi > v.hi) {
+			v.hi = INF;
+		}
+	}
+}
+
+bool RangeAnalysis::includes(const State& big, const State& small) {
+	if (!small.reachable) {
+		return true;
+	}
+	if (!big.reachable) {
+		return false;
+	}
+	for (size_t slot = 0; slot < big.vars.size(); ++slot) {
+		const Interval& b = big.vars[slot];
+		const Interval& s = small.vars[slot];
+		if (!s.empty() && (b.empty() || s.lo < b.lo || s.hi > b.hi)) {
+			return false;
+		}
+	}
+	return true;
+}
+
+Interval RangeAnalysis::arithmetic(Operator::OpCode code, const Interval& l, const Interval& r) {
+	if (l.empty() || r.empty()) {
+		return EMPTY;
+	}
+	switch (code)
+	{
+	case Operator::ADD:
+		return Interval{ l.lo == -INF || r.lo == -INF ? -INF : clampLo(l.lo + r.lo),
+			l.hi == INF || r.hi == INF ? INF : clampHi(l.hi + r.hi) };
+	case Operator::SUB:
+		return Interval{ l.lo == -INF || r.hi == INF ? -INF : clampLo(l.lo - r.hi),
+			l.hi == INF || r.lo == -INF ? INF : clampHi(l.hi - r.lo) };
+	case Operator::MUL: {
+		__int128 p[4] = { product(l.lo, r.lo), product(l.lo, r.hi), product(l.hi, r.lo), product(l.hi, r.hi) };
+		return Interval{ clampLo(*std::min_element(p, p + 4)), clampHi(*std::max_element(p, p + 4)) };
+	}
+	case Operator::DIV: {
+		// The divisor without zero, in its negative and positive parts; dividing by zero has no result
+		__int128 lo = INF, hi = -INF;
+		Interval negative = intersect(r, Interval{ -INF, -1 });
+		Interval positive = intersect(r, Interval{ 1, INF });
+		if (!negative.empty()) {
+			quotients(l, negative, lo, hi);
+		}
+		if (!positive.empty()) {
+			quotients(l, positive, lo, hi);
+		}
+		return lo > hi ? EMPTY : Interval{ clampLo(lo), clampHi(hi) };
+	}
+	default:
+		return ANY;
+	}
+}
+
+void RangeAnalysis::work(size_t amount) {
+	if (amount >= budget) {
+		throw GiveUp{};
+	}
+	budget -= amount;
+}
+
+void RangeAnalysis::assign(int slot, const Interval& value) {
+	if (value.empty()) {
+		// Computing the value fails
+		state.reachable = false;
+		return;
+	}
+	if (slot < 0) {
+		return;
+	}
+	state.vars[slot] = value;
+	if (recording) {
+		ever[slot] = join(ever[slot], value);
+	}
+}
+
+void RangeAnalysis::visitProgram(Program* progNode) {
+	progNode->getBlock()->accept(this);
+}
+
+void RangeAnalysis::visitBlock(Block* blockNode) {
+	for (auto i : blockNode->getVector()) {
+		if (!state.reachable) {
+			return;
+		}
+		i->accept(this);
+	}
+}
+
+void RangeAnalysis::visitPrintStmt(PrintStmt* printStmtNode) {
+	printStmtNode->getPrinter()->accept(this);
+	if (result.empty()) {
+		state.reachable = false;
+	}
+}
+
+void RangeAnalysis::visitSetStmt(SetStmt* setStmtNode) {
+	setStmtNode->getSetter()->accept(this);
+	assign(setStmtNode->getVar()->getSlot(), result);
+}
+
+void RangeAnalysis::visitInputStmt(InputStmt* inputStmtNode) {
+	assign(inputStmtNode->getVar()->getSlot(), ANY);
+}
+
+void RangeAnalysis::visitWhileStmt(WhileStmt* whileStmtNode) {
+	// The state at the condition is the state on entry joined with the state after any number of iterations.
+	// It is iterated until the body adds nothing, widening every step, then narrowed by iterating again from it:
+	// each of these iterates includes what the loop can reach, so only the last pass is recorded.
+	// A loop inside a loop that is still iterating is not narrowed: its bounds only matter in the recorded pass,
+	// and narrowing every iteration of every enclosing loop would make nested loops exponential.
+	bool record = recording;
+	recording = false;
+	work(state.vars.size());
+	State entry = state;
+	State head = entry;
+	while (true) {
+		refine(whileStmtNode->getCondition(), true);
+		if (state.reachable) {
+			whileStmtNode->getReppeter()->accept(this);
+		}
+		join(state, entry);
+		if (includes(head, state)) {
+			break;
+		}
+		join(state, head);
+		widen(head, state);
+		state = head;
+		work(state.vars.size());
+	}
+	int passes = record ? NARROWING : 0;
+	for (int pass = 0; pass < passes; ++pass) {
+		recording = pass == passes - 1;
+		state = head;
+		refine(whileStmtNode->getCondition(), true);
+		if (state.reachable) {
+			whileStmtNode->getReppeter()->accept(this);
+		}
+		join(state, entry);
+		head = std::move(state);
+		work(head.vars.size());
+	}
+	recording = record;
+	state = std::move(head);
+	refine(whileStmtNode->getCondition(), false);
+}
+
+void RangeAnalysis::visitIfStmt(IfStmt* ifStmtNode) {
+	work(state.vars.size());
+	State before = state;
+	refine(ifStmtNode->getCondition(), true);
+	if (state.reachable) {
+		ifStmtNode->getIfBlock()->accept(this);
+	}
+	State taken = std::move(state);
+	state = std::move(before);
+	refine(ifStmtNode->getCondition(), false);
+	if (state.reachable) {
+		ifStmtNode->getElseBlock()->accept(this);
+	}
+	join(state, taken);
+}
+
+void RangeAnalysis::visitParallelStmt(ParallelStmt* parallelStmtNode) {
+	// The children are independent (see AssignmentAnalysis): they are bounded as if they ran one after the other
+	for (auto i : parallelStmtNode->getChildren()) {
+		if (!state.reachable) {
+			return;
+		}
+		i->accept(this);
+	}
+}
+
+Interval RangeAnalysis::elements(const Variable* array) const {
+	return array->getSlot() >= 0 ? state.vars[array->getSlot()] : ANY;
+}
+
+void RangeAnalysis::visitArrayStmt(ArrayStmt* arrayStmtNode) {
+	int slot = arrayStmtNode->getArray()->getSlot();
+	if (arrayStmtNode->isElementWise()) {
+		Interval left = elements(arrayStmtNode->getLeft());
+		Interval right = elements(arrayStmtNode->getRight());
+		if (left.empty() || right.empty()) {
+			// An operand does not exist
+			state.reachable = false;
+			return;
+		}
+		ArrayStmt::Kind kind = arrayStmtNode->getKind();
+		if (kind == ArrayStmt::LT || kind == ArrayStmt::GT || kind == ArrayStmt::EQ) {
+			assign(slot, Interval{ 0, 1 });
+			return;
+		}
+		static const Operator::OpCode codes[] = { Operator::ADD, Operator::SUB, Operator::MUL };
+		Interval value = intersect(arithmetic(codes[kind - ArrayStmt::ADD], left, right), LONGS);
+		// Every element overflows: only arrays without elements get past the operation
+		assign(slot, value.empty() ? Interval{ 0, 0 } : value);
+		return;
+	}
+	arrayStmtNode->getOperand()->accept(this);
+	Interval operand = result;
+	if (arrayStmtNode->getKind() == ArrayStmt::ALLOCATE) {
+		// A new array of zeros, if the size is valid
+		if (intersect(operand, Interval{ 0, IntArray::MAX_SIZE }).empty()) {
+			state.reachable = false;
+			return;
+		}
+		assign(slot, Interval{ 0, 0 });
+		return;
+	}
+	arrayStmtNode->getElement()->accept(this);
+	Interval element = intersect(result, LONGS);
+	Interval array = elements(arrayStmtNode->getArray());
+	if (array.empty() || element.empty() || intersect(operand, INDEXES).empty()) {
+		state.reachable = false;
+		return;
+	}
+	assign(slot, join(array, element));
+}
+
+void RangeAnalysis::visitOperator(Operator* opNode) {
+	work(1);
+	opNode->getLeft()->accept(this);
+	Interval left = result;
+	opNode->getRight()->accept(this);
+	Interval right = result;
+	result = arithmetic(opNode->getOpCode(), left, right);
+	resultSlot = -1;
+	if (recording) {
+		auto found = operators.find(opNode);
+		if (found == operators.end()) {
+			operators.emplace(opNode, Seen{ left, right, result });
+		}
+		else {
+			Seen& s = found->second;
+			s.left = join(s.left, left);
+			s.right = join(s.right, right);
+			s.result = join(s.result, result);
+		}
+	}
+}
+
+void RangeAnalysis::visitNumber(Number* numNode) {
+	work(1);
+	const Value& v = numNode->getValue();
+	if (v.isSmall()) {
+		result = Interval{ v.getSmall(), v.getSmall() };
+	}
+	else {
+		// Beyond the exact bounds: only its sign is kept
+		result = Value::compare(v, Value(0)) > 0 ? Interval{ LIMIT, INF } : Interval{ -INF, -LIMIT };
+	}
+	resultSlot = -1;
+}
+
+void RangeAnalysis::visitVariable(Variable* varNode) {
+	work(1);
+	resultSlot = varNode->getSlot();
+	// A variable without a value makes the read fail, so its interval is empty
+	result = resultSlot >= 0 ? state.vars[resultSlot] : ANY;
+}
+
+void RangeAnalysis::visitArrayExpr(ArrayExpr* arrayExprNode) {
+	work(1);
+	Interval index = INDEXES;
+	if (arrayExprNode->getIndex()) {
+		arrayExprNode->getIndex()->accept(this);
+		index = intersect(result, INDEXES);
+	}
+	resultSlot = -1;
+	Interval array = elements(arrayExprNode->getArray());
+	if (array.empty() || index.empty()) {
+		// The array does not exist, or the index is out of bounds
+		result = EMPTY;
+		return;
+	}
+	switch (arrayExprNode->getKind())
+	{
+	case ArrayExpr::GET:
+		result = array;
+		break;
+	case ArrayExpr::SUM:
+		// At most MAX_SIZE elements
+		result = Interval{ clampLo(product(std::min<__int128>(array.lo, 0), IntArray::MAX_SIZE)),
+			clampHi(product(std::max<__int128>(array.hi, 0), IntArray::MAX_SIZE)) };
+		break;
+	default:
+		result = Interval{ 0, IntArray::MAX_SIZE };
+		break;
+	}
+}
+
+void RangeAnalysis::refine(BoolExpr* cond, bool expected) {
+	bool saved = outcome;
+	outcome = expected;
+	cond->accept(this);
+	outcome = saved;
+}
+
+void RangeAnalysis::restrict(int slot, const Interval& value, const Interval& allowed) {
+	Interval narrowed = intersect(value, allowed);
+	if (narrowed.empty()) {
+		state.reachable = false;
+	}
+	else if (slot >= 0) {
+		state.vars[slot] = narrowed;
+	}
+}
+
+void RangeAnalysis::visitRelOp(RelOp* relOpNode) {
+	if (!state.reachable) {
+		return;
+	}
+	relOpNode->getLeft()->accept(this);
+	Interval left = result;
+	int leftSlot = resultSlot;
+	relOpNode->getRight()->accept(this);
+	Interval right = result;
+	int rightSlot = resultSlot;
+	if (left.empty() || right.empty()) {
+		// Evaluating an operand fails
+		state.reachable = false;
+		return;
+	}
+
+	// Reduced to "lower < upper" or "lower >= upper" for LT and GT
+	RelOp::RelOpCode code = relOpNode->getRelOpCode();
+	if (code == RelOp::EQ) {
+		if (outcome) {
+			restrict(leftSlot, left, right);
+			if (state.reachable) {
+				restrict(rightSlot, right, left);
+			}
+		}
+		else {
+			// Only a constant at the edge of the other interval can be removed
+			if (right.lo == right.hi && !infinite(right.lo)) {
+				restrict(leftSlot, left, Interval{ left.lo == right.lo ? left.lo + 1 : left.lo, left.hi == right.lo ? left.hi - 1 : left.hi });
+			}
+			if (state.reachable && left.lo == left.hi && !infinite(left.lo)) {
+				restrict(rightSlot, right, Interval{ right.lo == left.lo ? right.lo + 1 : right.lo, right.hi == left.lo ? right.hi - 1 : right.hi });
+			}
+		}
+		return;
+	}
+	Interval lower = code == RelOp::LT ? left : right;
+	Interval upper = code == RelOp::LT ? right : left;
+	int lowerSlot = code == RelOp::LT ? leftSlot : rightSlot;
+	int upperSlot = code == RelOp::LT ? rightSlot : leftSlot;
+	if (outcome) {
+		restrict(lowerSlot, lower, Interval{ -INF, upper.hi == INF ? INF : clampHi(upper.hi - 1) });
+		if (state.reachable) {
+			restrict(upperSlot, upper, Interval{ lower.lo == -INF ? -INF : clampLo(lower.lo + 1), INF });
+		}
+	}
+	else {
+		restrict(lowerSlot, lower, Interval{ upper.lo, INF });
+		if (state.reachable) {
+			restrict(upperSlot, upper, Interval{ -INF, lower.hi });
+		}
+	}
+}
+
+void RangeAnalysis::visitBoolConst(BoolConst* boolConstNode) {
+	if (boolConstNode->getValue() != outcome) {
+		state.reachable = false;
+	}
+}
+
+void RangeAnalysis::visitBoolOp(BoolOp* boolOpNode) {
+	if (!state.reachable) {
+		return;
+	}
+	BoolOp::BoolOpCode code = boolOpNode->getBoolOpCode();
+	if (code == BoolOp::NOT) {
+		refine(boolOpNode->getLeft(), !outcome);
+		return;
+	}
+	// The right operand is only evaluated when the left one does not decide: true for AND, false for OR
+	bool decides = code == BoolOp::OR;
+	if (outcome == decides) {
+		// Decided by either operand: the join of the two ways
+		work(state.vars.size());
+		State before = state;
+		refine(boolOpNode->getLeft(), decides);
+		State first = std::move(state);
+		state = std::move(before);
+		refine(boolOpNode->getLeft(), !decides);
+		if (state.reachable) {
+			refine(boolOpNode->getRight(), decides);
+		}
+		join(state, first);
+	}
+	else {
+		// Both operands are evaluated and give the outcome
+		refine(boolOpNode->getLeft(), outcome);
+		if (state.reachable) {
+			refine(boolOpNode->getRight(), outcome);
+		}
+	}
+}
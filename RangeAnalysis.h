@@ -0,0 +1,118 @@
+#ifndef RANGEANALYSIS_H
+#define RANGEANALYSIS_H
+
+#include <cstddef>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "Visitor.h"
+
+// The RangeAnalysis is an abstract interpretation of the program computing, for every variable and every
+// arithmetic operation, an interval containing all the values it can take.
+// SET and INPUT give their variable a new interval, the conditions of IF and WHILE narrow the intervals of the
+// values they compare, and a WHILE is iterated with widening (a bound that still moves becomes infinite) until its
+// state is stable, then NARROWING more times to recover the bounds given by the condition.
+// Every Operator whose operands and result provably fit in a long int, and whose divisor is provably not zero,
+// is marked UNCHECKED, so the evaluators and the C backend skip its checks, or INT32 if everything fits in 32 bits.
+// Variables are tracked by their slot, so the AssignmentAnalysis must run first. The interval of an array is the
+// interval of its elements, empty while it does not exist.
+// Nested loops multiply the iterations: past WORK_LIMIT the analysis gives up and every operation stays checked.
+class RangeAnalysis : public Visitor {
+public:
+	static constexpr int NARROWING = 2;
+	static constexpr size_t WORK_LIMIT = 1 << 24;
+
+	// Interval of integers, empty when lo > hi.
+	// The bounds are exact up to 2^63 in absolute value (one past the long ints on the positive side),
+	// beyond that a bound is either clamped to 2^63 (on the side where that only loosens it) or infinite.
+	struct Interval {
+		__int128 lo;
+		__int128 hi;
+
+		bool empty() const {
+			return lo > hi;
+		}
+
+		bool within(__int128 min, __int128 max) const {
+			return !empty() && lo >= min && hi <= max;
+		}
+	};
+
+	// Analyses the program and marks its operators; returns false if the analysis gave up.
+	bool operator()(Program* progNode);
+
+	// Writes the interval of every variable (all the values it is assigned) and how many operations are unchecked.
+	void writeRanges(std::ostream& os) const;
+
+	void visitProgram(Program* progNode) override;
+	void visitBlock(Block* blockNode) override;
+
+	void visitPrintStmt(PrintStmt* printStmtNode) override;
+	void visitSetStmt(SetStmt* setStmtNode) override;
+	void visitInputStmt(InputStmt* inputStmtNode) override;
+	void visitWhileStmt(WhileStmt* whileStmtNode) override;
+	void visitIfStmt(IfStmt* ifStmtNode) override;
+	void visitParallelStmt(ParallelStmt* parallelStmtNode) override;
+	void visitArrayStmt(ArrayStmt* arrayStmtNode) override;
+
+	// The numeric expressions leave their interval in "result".
+	void visitOperator(Operator* opNode) override;
+	void visitNumber(Number* numNode) override;
+	void visitVariable(Variable* varNode) override;
+	void visitArrayExpr(ArrayExpr* arrayExprNode) override;
+
+	// The boolean expressions narrow "state" to the executions in which they evaluate to "outcome".
+	void visitRelOp(RelOp* relOpNode) override;
+	void visitBoolConst(BoolConst* boolConstNode) override;
+	void visitBoolOp(BoolOp* boolOpNode) override;
+
+private:
+	// Intervals of the variables by slot (empty while unassigned); unreachable when no execution gets here.
+	struct State {
+		std::vector<Interval> vars;
+		bool reachable = true;
+	};
+
+	// Operands and result of an operator, joined over the recorded visits.
+	struct Seen {
+		Interval left, right, result;
+	};
+
+	// Thrown when the work limit is reached.
+	struct GiveUp {};
+
+	static Interval join(const Interval& a, const Interval& b);
+	static void join(State& into, const State& other);
+	// Widens the previous iterate with the next one (which includes it): the bounds that moved become infinite.
+	static void widen(State& into, const State& next);
+	static bool includes(const State& big, const State& small);
+	static Interval arithmetic(Operator::OpCode code, const Interval& l, const Interval& r);
+	static std::string boundText(__int128 b);
+
+	// Narrows the state to the executions in which the condition evaluates to the given outcome.
+	void refine(BoolExpr* cond, bool expected);
+	// Narrows an operand of a comparison to the allowed interval: the interval of its variable if it is one,
+	// the whole state if no value is allowed.
+	void restrict(int slot, const Interval& value, const Interval& allowed);
+	void assign(int slot, const Interval& value);
+	// Interval of the elements of an array.
+	Interval elements(const Variable* array) const;
+	void work(size_t amount);
+
+	State state;
+	Interval result{ 1, 0 };
+	int resultSlot = -1;	// Slot of the variable whose value is "result", -1 for other expressions
+	bool outcome = true;
+	// Only the visits made with a stable state are recorded: the iterations of a loop before it is stable are not.
+	bool recording = true;
+	std::vector<std::string> names;
+	std::vector<Interval> ever;
+	std::unordered_map<Operator*, Seen> operators;
+	size_t budget = 0;
+	bool abandoned = false;
+	size_t total = 0, unchecked = 0, narrow = 0;
+};
+
+#endif
@@ -0,0 +1,560 @@
+#include <algorithm>
+#include <array>
+#include <climits>
+
+#include "Reduction.h"
+
+namespace {
+	// Tells the type of a node, without visiting its children.
+	class Probe : public Visitor {
+	public:
+		SetStmt* set = nullptr;
+		Operator* op = nullptr;
+		Number* number = nullptr;
+		Variable* variable = nullptr;
+		RelOp* relOp = nullptr;
+		ArrayExpr* array = nullptr;
+
+		void visitProgram(Program*) override {}
+		void visitBlock(Block*) override {}
+		void visitPrintStmt(PrintStmt*) override {}
+		void visitSetStmt(SetStmt* setStmtNode) override {
+			set = setStmtNode;
+		}
+		void visitInputStmt(InputStmt*) override {}
+		void visitWhileStmt(WhileStmt*) override {}
+		void visitIfStmt(IfStmt*) override {}
+		void visitParallelStmt(ParallelStmt*) override {}
+		void visitArrayStmt(ArrayStmt*) override {}
+		void visitOperator(Operator* opNode) override {
+			op = opNode;
+		}
+		void visitNumber(Number* numNode) override {
+			number = numNode;
+		}
+		void visitVariable(Variable* varNode) override {
+			variable = varNode;
+		}
+		void visitArrayExpr(ArrayExpr* arrayExprNode) override {
+			array = arrayExprNode;
+		}
+		void visitRelOp(RelOp* relOpNode) override {
+			relOp = relOpNode;
+		}
+		void visitBoolConst(BoolConst*) override {}
+		void visitBoolOp(BoolOp*) override {}
+	};
+
+	template<typename Node>
+	Probe probe(Node* node) {
+		Probe p;
+		node->accept(&p);
+		return p;
+	}
+
+	// Slot of the expression if it is a variable, -1 otherwise.
+	int variableSlot(NumExpr* e) {
+		Probe p = probe(e);
+		return p.variable ? p.variable->getSlot() : -1;
+	}
+
+	// Compiles an expression into postfix code, collecting the slots it reads.
+	// Returns false if a variable has no slot or an array is read; a number that is not a long int clears "compiled".
+	bool compile(NumExpr* e, std::vector<ReductionPlan::Op>& code, std::vector<int>& reads, bool& compiled, size_t depth, size_t& maxDepth) {
+		typedef ReductionPlan::Op Op;
+		maxDepth = std::max(maxDepth, depth + 1);
+		Probe p = probe(e);
+		if (p.array) {
+			return false;
+		}
+		if (p.number) {
+			compiled = compiled && p.number->getValue().isSmall();
+			code.push_back(Op{ Op::CONSTANT, compiled ? p.number->getValue().getSmall() : 0, -1 });
+			return true;
+		}
+		if (p.variable) {
+			if (p.variable->getSlot() < 0) {
+				return false;
+			}
+			reads.push_back(p.variable->getSlot());
+			// The kind of the read is set once the roles of the variables are known
+			code.push_back(Op{ Op::INVARIANT, 0, p.variable->getSlot() });
+			return true;
+		}
+		if (!compile(p.op->getLeft(), code, reads, compiled, depth, maxDepth) || !compile(p.op->getRight(), code, reads, compiled, depth + 1, maxDepth)) {
+			return false;
+		}
+		static const Op::Code codes[] = { Op::ADD, Op::SUB, Op::MUL, Op::DIV };
+		code.push_back(Op{ codes[p.op->getOpCode()], 0, -1 });
+		return true;
+	}
+
+	typedef std::array<long, ReductionVisitor::BLOCK> Lanes;
+
+	// Runs compiled code over the n iterations of a block, leaving the result in stack[0].
+	// Returns false if an operation overflows, divides by zero, or reads a value that is not a long int.
+	bool runBlock(const std::vector<ReductionPlan::Op>& code, size_t n, const Lanes& counter, const std::vector<long>& invariants,
+		const std::vector<Lanes>& privates, std::vector<Lanes>& stack) {
+		typedef ReductionPlan::Op Op;
+		typedef unsigned long U;
+		size_t top = 0;
+		long bad = 0;
+		for (const Op& op : code) {
+			if (op.code <= Op::PRIVATE_VALUE) {
+				long* r = stack[top++].data();
+				switch (op.code) {
+				case Op::COUNTER:
+					std::copy(counter.begin(), counter.begin() + n, r);
+					break;
+				case Op::CONSTANT:
+					std::fill(r, r + n, op.constant);
+					break;
+				case Op::INVARIANT:
+					std::fill(r, r + n, invariants[op.index]);
+					break;
+				default:
+					std::copy(privates[op.index].begin(), privates[op.index].begin() + n, r);
+					break;
+				}
+				continue;
+			}
+			long* a = stack[top - 2].data();
+			const long* b = stack[top - 1].data();
+			--top;
+			// Overflows are detected as in the LaneEvaluator: the arithmetic wraps and the checks are or'ed together
+			switch (op.code) {
+			case Op::ADD:
+				for (size_t k = 0; k < n; ++k) {
+					long r = static_cast<long>(static_cast<U>(a[k]) + static_cast<U>(b[k]));
+					bad |= (a[k] ^ r) & (b[k] ^ r);
+					a[k] = r;
+				}
+				break;
+			case Op::SUB:
+				for (size_t k = 0; k < n; ++k) {
+					long r = static_cast<long>(static_cast<U>(a[k]) - static_cast<U>(b[k]));
+					bad |= (a[k] ^ b[k]) & (a[k] ^ r);
+					a[k] = r;
+				}
+				break;
+			case Op::MUL:
+				for (size_t k = 0; k < n; ++k) {
+					long r;
+					bad |= -static_cast<long>(__builtin_mul_overflow(a[k], b[k], &r));
+					a[k] = r;
+				}
+				break;
+			default:
+				for (size_t k = 0; k < n; ++k) {
+					bool fails = b[k] == 0 || (a[k] == LONG_MIN && b[k] == -1);
+					bad |= -static_cast<long>(fails);
+					a[k] = fails ? 0 : a[k] / b[k];
+				}
+				break;
+			}
+			if (bad < 0) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	// Evaluator of the iterations of a chunk that are evaluated exactly.
+	class ChunkEvaluator : public EvaluatorVisitor {
+	public:
+		using EvaluatorVisitor::EvaluatorVisitor;
+
+		// The RangeAnalysis proves its ranges for the iterations a sequential run reaches, and a chunk may start
+		// after an iteration that fails: every operation is checked, whatever its evaluation.
+		void visitOperator(Operator* opNode) override {
+			Value lval = evaluate(opNode->getLeft());
+			Value rval = evaluate(opNode->getRight());
+			switch (opNode->getOpCode()) {
+			case Operator::ADD:
+				Value::addTo(lval, rval); break;
+			case Operator::SUB:
+				Value::subTo(lval, rval); break;
+			case Operator::MUL:
+				Value::mulTo(lval, rval); break;
+			default:
+				if (rval.isZero()) {
+					throw SemanticError("ZERO DIVISION");
+				}
+				Value::divTo(lval, rval); break;
+			}
+			pushNumber(lval);
+		}
+
+		Value evaluate(NumExpr* e) {
+			e->accept(this);
+			Value v = topNumber();
+			popNumber();
+			return v;
+		}
+	};
+
+	void combine(ReductionPlan::Kind kind, Value& into, const Value& v) {
+		if (kind == ReductionPlan::PRODUCT) {
+			Value::mulTo(into, v);
+		}
+		else {
+			Value::addTo(into, v);
+		}
+	}
+
+	// Iterations [begin, end) of a loop, and their results.
+	struct Chunk {
+		unsigned long long begin, end;
+		std::vector<Value> partials;	// By item: the combined operands of the reductions, the last value of the privates
+		bool failed = false;
+	};
+
+	// Runs the iterations of a chunk; "invariants" holds the values of the invariant slots, assigned or not.
+	void runChunk(const ReductionPlan& plan, const ReductionPlan::Loop& loop, long start, const std::vector<Value>& invariants,
+		const std::vector<char>& assigned, Chunk& chunk) {
+		size_t count = loop.items.size();
+		chunk.partials.assign(count, Value());
+		for (size_t j = 0; j < count; ++j) {
+			chunk.partials[j] = Value(loop.items[j].kind == ReductionPlan::PRODUCT ? 1L : 0L);
+		}
+		try {
+			SymbolTable local;
+			local.reserveSlots(plan.getSlotNames());
+			// The compiled form reads the invariants as long ints: it is used only if they all are
+			bool compiled = loop.compiled;
+			std::vector<long> smallInvariants(plan.getSlotNames().size());
+			for (int s : loop.invariants) {
+				if (assigned[s]) {
+					local.setSlot(s, invariants[s]);
+				}
+				compiled = compiled && assigned[s] && invariants[s].isSmall();
+				smallInvariants[s] = compiled ? invariants[s].getSmall() : 0;
+			}
+			StringOutputSink noOutput;
+			StringInputSource noInput{ "" };
+			ChunkEvaluator evaluator{ local, noOutput, noInput };
+			Lanes counter;
+			std::vector<Lanes> privates(count);
+			std::vector<Lanes> stack(loop.depth);
+			std::vector<Value> blockResults(count);
+			for (unsigned long long first = chunk.begin; first < chunk.end; first += ReductionVisitor::BLOCK) {
+				size_t n = static_cast<size_t>(std::min<unsigned long long>(ReductionVisitor::BLOCK, chunk.end - first));
+				// The counter of every iteration fits in a long int (it is below the bound), the distance from the start may not
+				for (size_t k = 0; k < n; ++k) {
+					counter[k] = static_cast<long>(static_cast<unsigned long>(start) + (first + k) * static_cast<unsigned long>(loop.step));
+				}
+				bool done = compiled;
+				for (size_t j = 0; j < count && done; ++j) {
+					const ReductionPlan::Item& item = loop.items[j];
+					done = runBlock(item.code, n, counter, smallInvariants, privates, stack);
+					if (!done) {
+						break;
+					}
+					const long* v = stack[0].data();
+					if (item.kind == ReductionPlan::PRIVATE) {
+						std::copy(v, v + n, privates[j].begin());
+						blockResults[j] = Value(v[n - 1]);
+					}
+					else if (item.kind == ReductionPlan::PRODUCT) {
+						long product = 1;
+						for (size_t k = 0; k < n && done; ++k) {
+							done = !__builtin_mul_overflow(product, v[k], &product);
+						}
+						blockResults[j] = Value(product);
+					}
+					else {
+						// At most BLOCK long ints: the sum cannot overflow 128 bits
+						__int128 sum = 0;
+						for (size_t k = 0; k < n; ++k) {
+							sum += v[k];
+						}
+						done = sum >= LONG_MIN && sum <= LONG_MAX;
+						blockResults[j] = Value(static_cast<long>(sum));
+					}
+				}
+				if (done) {
+					for (size_t j = 0; j < count; ++j) {
+						if (loop.items[j].kind == ReductionPlan::PRIVATE) {
+							chunk.partials[j] = blockResults[j];
+						}
+						else {
+							combine(loop.items[j].kind, chunk.partials[j], blockResults[j]);
+						}
+					}
+					continue;
+				}
+				// Exact evaluation of the block, which raises the errors
+				for (size_t k = 0; k < n; ++k) {
+					local.setSlot(loop.counter, Value(counter[k]));
+					for (size_t j = 0; j < count; ++j) {
+						const ReductionPlan::Item& item = loop.items[j];
+						Value v = evaluator.evaluate(item.operand);
+						if (item.kind == ReductionPlan::PRIVATE) {
+							local.setSlot(item.slot, v);
+							chunk.partials[j] = v;
+						}
+						else {
+							combine(item.kind, chunk.partials[j], v);
+						}
+					}
+				}
+				// The compiled form of the next block reads the privates of this one only after assigning them
+			}
+		}
+		catch (...) {
+			chunk.failed = true;
+		}
+	}
+}
+
+ReductionPlan::ReductionPlan(Program* progNode) : names{ progNode->getSlotNames() } {
+	progNode->accept(this);
+}
+
+void ReductionPlan::visitProgram(Program* progNode) {
+	progNode->getBlock()->accept(this);
+}
+
+void ReductionPlan::visitBlock(Block* blockNode) {
+	for (Statement* s : blockNode->getVector()) {
+		s->accept(this);
+	}
+}
+
+void ReductionPlan::visitPrintStmt(PrintStmt*) {}
+
+void ReductionPlan::visitSetStmt(SetStmt*) {}
+
+void ReductionPlan::visitInputStmt(InputStmt*) {}
+
+void ReductionPlan::visitWhileStmt(WhileStmt* whileStmtNode) {
+	Loop loop;
+	if (analyse(whileStmtNode, loop)) {
+		index.emplace(whileStmtNode, static_cast<int>(loops.size()));
+		loops.push_back(std::move(loop));
+	}
+	else {
+		whileStmtNode->getReppeter()->accept(this);
+	}
+}
+
+void ReductionPlan::visitIfStmt(IfStmt* ifStmtNode) {
+	ifStmtNode->getIfBlock()->accept(this);
+	ifStmtNode->getElseBlock()->accept(this);
+}
+
+void ReductionPlan::visitParallelStmt(ParallelStmt* parallelStmtNode) {
+	for (Block* b : parallelStmtNode->getChildren()) {
+		b->accept(this);
+	}
+}
+
+void ReductionPlan::visitArrayStmt(ArrayStmt*) {}
+
+bool ReductionPlan::analyse(WhileStmt* whileStmtNode, Loop& loop) {
+	// The condition: (LT counter bound) or (GT bound counter)
+	RelOp* cond = probe(whileStmtNode->getCondition()).relOp;
+	if (!cond || cond->getRelOpCode() == RelOp::EQ) {
+		return false;
+	}
+	bool lt = cond->getRelOpCode() == RelOp::LT;
+	loop.counter = variableSlot(lt ? cond->getLeft() : cond->getRight());
+	loop.bound = lt ? cond->getRight() : cond->getLeft();
+	if (loop.counter < 0) {
+		return false;
+	}
+	// The body: SET statements ending with the increment
+	const std::vector<Statement*>& body = whileStmtNode->getReppeter()->getVector();
+	std::vector<SetStmt*> sets;
+	for (Statement* s : body) {
+		SetStmt* set = probe(s).set;
+		if (!set || set->getVar()->getSlot() < 0) {
+			return false;
+		}
+		sets.push_back(set);
+	}
+	if (sets.size() < 2 || sets.back()->getVar()->getSlot() != loop.counter) {
+		return false;
+	}
+	Operator* increment = probe(sets.back()->getSetter()).op;
+	if (!increment || increment->getOpCode() != Operator::ADD) {
+		return false;
+	}
+	NumExpr* stepExpr = variableSlot(increment->getLeft()) == loop.counter ? increment->getRight()
+		: variableSlot(increment->getRight()) == loop.counter ? increment->getLeft() : nullptr;
+	Number* step = stepExpr ? probe(stepExpr).number : nullptr;
+	if (!step || !step->getValue().isSmall() || step->getValue().getSmall() <= 0) {
+		return false;
+	}
+	loop.step = step->getValue().getSmall();
+	// Every variable is assigned once by the body
+	std::vector<int> position(names.size(), -1);
+	for (size_t t = 0; t < sets.size(); ++t) {
+		int slot = sets[t]->getVar()->getSlot();
+		if (position[slot] >= 0) {
+			return false;
+		}
+		position[slot] = static_cast<int>(t);
+	}
+	// The roles: a SET updating its own variable with ADD, SUB (on the left) or MUL is a reduction
+	sets.pop_back();
+	for (SetStmt* set : sets) {
+		Item item{ PRIVATE, set->getVar()->getSlot(), set->getSetter(), {} };
+		Operator* op = probe(set->getSetter()).op;
+		if (op && op->getOpCode() != Operator::DIV) {
+			bool left = variableSlot(op->getLeft()) == item.slot;
+			bool right = op->getOpCode() != Operator::SUB && variableSlot(op->getRight()) == item.slot;
+			if (left || right) {
+				item.kind = op->getOpCode() == Operator::ADD ? SUM : op->getOpCode() == Operator::SUB ? DIFFERENCE : PRODUCT;
+				item.operand = left ? op->getRight() : op->getLeft();
+			}
+		}
+		loop.items.push_back(std::move(item));
+	}
+	if (std::none_of(loop.items.begin(), loop.items.end(), [](const Item& i) { return i.kind != PRIVATE; })) {
+		return false;
+	}
+	// The reads: the counter, the privates assigned before in the iteration, and the invariants
+	loop.compiled = true;
+	loop.depth = 0;
+	std::vector<int> item(names.size(), -1);
+	for (size_t t = 0; t < loop.items.size(); ++t) {
+		item[loop.items[t].slot] = static_cast<int>(t);
+	}
+	std::vector<char> invariant(names.size(), false);
+	for (size_t t = 0; t < loop.items.size(); ++t) {
+		std::vector<int> reads;
+		if (!compile(loop.items[t].operand, loop.items[t].code, reads, loop.compiled, 0, loop.depth)) {
+			return false;
+		}
+		for (Op& op : loop.items[t].code) {
+			if (op.code != Op::INVARIANT) {
+				continue;
+			}
+			int slot = op.index;
+			if (slot == loop.counter) {
+				op.code = Op::COUNTER;
+			}
+			else if (position[slot] < 0) {
+				invariant[slot] = true;
+			}
+			else if (item[slot] >= 0 && item[slot] < static_cast<int>(t) && loop.items[item[slot]].kind == PRIVATE) {
+				op.code = Op::PRIVATE_VALUE;
+				op.index = item[slot];
+			}
+			else {
+				// A reduction read elsewhere, or a value carried from the previous iteration
+				return false;
+			}
+		}
+	}
+	std::vector<Op> boundCode;
+	std::vector<int> boundReads;
+	bool boundCompiled = true;
+	size_t boundDepth = 0;
+	if (!compile(loop.bound, boundCode, boundReads, boundCompiled, 0, boundDepth)) {
+		return false;
+	}
+	for (int slot : boundReads) {
+		if (position[slot] >= 0) {
+			return false;
+		}
+	}
+	for (size_t s = 0; s < invariant.size(); ++s) {
+		if (invariant[s]) {
+			loop.invariants.push_back(static_cast<int>(s));
+		}
+	}
+	loop.line = whileStmtNode->getLine();
+	loop.column = whileStmtNode->getColumn();
+	return true;
+}
+
+void ReductionVisitor::visitWhileStmt(WhileStmt* whileStmtNode) {
+	const ReductionPlan::Loop* loop = Plan.loop(whileStmtNode);
+	if (!loop || metered() || !runReduction(*loop)) {
+		EvaluatorVisitor::visitWhileStmt(whileStmtNode);
+	}
+}
+
+bool ReductionVisitor::runReduction(const ReductionPlan::Loop& loop) {
+	// The first evaluation of the condition: a read of an unassigned counter is left to the sequential loop,
+	// the bound is evaluated as the condition would (it cannot change, and evaluating it again changes nothing)
+	if (!ST.isSlotAssigned(loop.counter) || !ST.getSlotUnchecked(loop.counter).isSmall()) {
+		return false;
+	}
+	loop.bound->accept(this);
+	Value bound = topNumber();
+	popNumber();
+	if (!bound.isSmall()) {
+		return false;
+	}
+	long start = ST.getSlotUnchecked(loop.counter).getSmall();
+	__int128 distance = static_cast<__int128>(bound.getSmall()) - start;
+	if (distance < static_cast<__int128>(MIN_ITERATIONS)) {
+		return false;
+	}
+	unsigned long long iterations = static_cast<unsigned long long>((distance + loop.step - 1) / loop.step);
+	// A reduction read before it is assigned fails in the first iteration
+	std::vector<Value> invariants(ST.size());
+	std::vector<char> assigned(ST.size(), false);
+	for (const ReductionPlan::Item& item : loop.items) {
+		if (item.kind != ReductionPlan::PRIVATE && !ST.isSlotAssigned(item.slot)) {
+			return false;
+		}
+	}
+	for (int s : loop.invariants) {
+		assigned[s] = ST.isSlotAssigned(s);
+		if (assigned[s]) {
+			invariants[s] = ST.getSlotUnchecked(s);
+		}
+	}
+	// A few chunks per thread balance the load; a single thread runs one chunk itself
+	unsigned long long chunks = Pool.size() > 1 ? std::clamp<unsigned long long>(iterations / BLOCK, 1, Pool.size() * 4ULL) : 1;
+	std::vector<Chunk> results(chunks);
+	for (unsigned long long c = 0; c < chunks; ++c) {
+		results[c].begin = iterations * c / chunks;
+		results[c].end = iterations * (c + 1) / chunks;
+	}
+	if (chunks == 1) {
+		runChunk(Plan, loop, start, invariants, assigned, results[0]);
+	}
+	else {
+		for (Chunk& chunk : results) {
+			Chunk* target = &chunk;
+			Pool.submit([&, target] { runChunk(Plan, loop, start, invariants, assigned, *target); });
+		}
+		Pool.wait();
+	}
+	for (const Chunk& chunk : results) {
+		if (chunk.failed) {
+			return false;
+		}
+	}
+	// The partial results are combined in order; the privates keep their value of the last iteration
+	for (size_t j = 0; j < loop.items.size(); ++j) {
+		const ReductionPlan::Item& item = loop.items[j];
+		if (item.kind == ReductionPlan::PRIVATE) {
+			ST.setSlot(item.slot, results.back().partials[j]);
+			continue;
+		}
+		Value total = results[0].partials[j];
+		for (size_t c = 1; c < results.size(); ++c) {
+			combine(item.kind, total, results[c].partials[j]);
+		}
+		Value v = ST.getSlotUnchecked(item.slot);
+		if (item.kind == ReductionPlan::DIFFERENCE) {
+			Value::subTo(v, total);
+		}
+		else {
+			combine(item.kind, v, total);
+		}
+		ST.setSlot(item.slot, v);
+	}
+	// The counter after the last increment may not fit in a long int
+	Value counter{ static_cast<long>(static_cast<unsigned long>(start) + (iterations - 1) * static_cast<unsigned long>(loop.step)) };
+	Value::addTo(counter, Value(loop.step));
+	ST.setSlot(loop.counter, counter);
+	++parallelLoops;
+	return true;
+}
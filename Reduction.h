@@ -0,0 +1,130 @@
+#ifndef REDUCTION_H
+#define REDUCTION_H
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "Visitor.h"
+#include "ThreadPool.h"
+
+// The ReductionPlan finds the WHILE loops that are reductions over a counted loop, such as
+//   (WHILE (LT i n) (BLOCK (SET t (MUL i i)) (SET s (ADD s t)) (SET i (ADD i 1))))
+// The condition compares the counter with a bound that the body does not change, (LT i bound) or (GT bound i).
+// The body is made of SET statements only (no array is read) and ends with the increment of the counter by a positive constant.
+// Every other SET is either a reduction, a variable updated only by (ADD s e), (ADD e s), (SUB s e),
+// (MUL s e) or (MUL e s) and read nowhere else in the loop, or a private variable, assigned once per iteration
+// before it is read. The values of the variables are exact (big integers instead of overflows), so sums and
+// products are associative: the iterations can be split into chunks and the partial results combined.
+// The loops of the WhileStmts are kept in the plan, which leaves the program untouched.
+// The plan needs the slots of the AssignmentAnalysis.
+class ReductionPlan : public Visitor {
+public:
+	enum Kind { PRIVATE, SUM, DIFFERENCE, PRODUCT };
+
+	// Operation of the compiled form of an expression: a postfix program over blocks of iterations.
+	struct Op {
+		enum Code { COUNTER, CONSTANT, INVARIANT, PRIVATE_VALUE, ADD, SUB, MUL, DIV };
+		Code code;
+		long constant;	// CONSTANT
+		int index;	// Slot of an INVARIANT, index of the item of a PRIVATE_VALUE
+	};
+
+	// A SET of the body: the value of a private variable or the operand combined into a reduction.
+	struct Item {
+		Kind kind;
+		int slot;
+		NumExpr* operand;
+		std::vector<Op> code;
+	};
+
+	struct Loop {
+		int counter;
+		long step;
+		NumExpr* bound;
+		std::vector<Item> items;	// In the order of the body, without the increment
+		std::vector<int> invariants;	// Slots read in the loop and not assigned by it
+		bool compiled;	// False if an operand contains a number too large for the compiled form
+		size_t depth;	// Values stacked by the compiled operands
+		int line, column;
+	};
+
+	explicit ReductionPlan(Program* progNode);
+
+	// The loop of the WHILE, nullptr if it is not a reduction.
+	const Loop* loop(const WhileStmt* whileStmtNode) const {
+		auto i = index.find(whileStmtNode);
+		return i == index.end() ? nullptr : &loops[i->second];
+	}
+
+	size_t size() const {
+		return loops.size();
+	}
+
+	const std::vector<std::string>& getSlotNames() const {
+		return names;
+	}
+
+	void visitProgram(Program* progNode) override;
+	void visitBlock(Block* blockNode) override;
+
+	void visitPrintStmt(PrintStmt* printStmtNode) override;
+	void visitSetStmt(SetStmt* setStmtNode) override;
+	void visitInputStmt(InputStmt* inputStmtNode) override;
+	void visitWhileStmt(WhileStmt* whileStmtNode) override;
+	void visitIfStmt(IfStmt* ifStmtNode) override;
+	void visitParallelStmt(ParallelStmt* parallelStmtNode) override;
+	void visitArrayStmt(ArrayStmt* arrayStmtNode) override;
+
+	// Expressions contain no loop: they are not visited.
+	void visitOperator(Operator*) override {}
+	void visitNumber(Number*) override {}
+	void visitVariable(Variable*) override {}
+	void visitArrayExpr(ArrayExpr*) override {}
+
+	void visitRelOp(RelOp*) override {}
+	void visitBoolConst(BoolConst*) override {}
+	void visitBoolOp(BoolOp*) override {}
+
+private:
+	// Fills the loop if the WHILE is a reduction.
+	bool analyse(WhileStmt* whileStmtNode, Loop& loop);
+
+	std::vector<Loop> loops;
+	std::unordered_map<const WhileStmt*, int> index;	// WHILE to loop
+	std::vector<std::string> names;
+};
+
+// Evaluator running the loops of a ReductionPlan in chunks of iterations on a ThreadPool.
+// Every chunk evaluates its iterations in blocks of BLOCK with the compiled form of the body, on long ints with
+// loops the compiler vectorizes; a block that overflows or fails a check is evaluated again exactly with Values.
+// The partial results are combined in order, so the variables end as in a sequential run: the reductions,
+// the private variables (their values in the last iteration) and the counter.
+// A loop of less than MIN_ITERATIONS iterations, a metered run, and a loop in which an iteration fails, are run
+// sequentially, so an error is raised exactly where the EvaluatorVisitor raises it.
+class ReductionVisitor : public EvaluatorVisitor {
+public:
+	static constexpr unsigned long long MIN_ITERATIONS = 1 << 14;
+	static constexpr size_t BLOCK = 256;
+
+	ReductionVisitor(SymbolTable& S, OutputSink& O, InputSource& I, const ReductionPlan& P, ThreadPool& T)
+		: EvaluatorVisitor{ S, O, I }, ST{ S }, Plan{ P }, Pool{ T } {}
+
+	void visitWhileStmt(WhileStmt* whileStmtNode) override;
+
+	// Loops run in chunks so far.
+	size_t getParallelLoops() const {
+		return parallelLoops;
+	}
+
+private:
+	// Runs the loop in chunks; returns false, leaving the variables untouched, if it has to run sequentially.
+	bool runReduction(const ReductionPlan::Loop& loop);
+
+	SymbolTable& ST;
+	const ReductionPlan& Plan;
+	ThreadPool& Pool;
+	size_t parallelLoops = 0;
+};
+
+#endif
@@ -0,0 +1,371 @@
+#include "Rewriter.h"
+
+namespace {
+	// Tells the type of a node, without visiting its children.
+	class Probe : public Visitor {
+	public:
+		Number* number = nullptr;
+		BoolConst* boolConst = nullptr;
+		BoolOp* boolOp = nullptr;
+
+		void visitProgram(Program*) override {}
+		void visitBlock(Block*) override {}
+		void visitPrintStmt(PrintStmt*) override {}
+		void visitSetStmt(SetStmt*) override {}
+		void visitInputStmt(InputStmt*) override {}
+		void visitWhileStmt(WhileStmt*) override {}
+		void visitIfStmt(IfStmt*) override {}
+		void visitParallelStmt(ParallelStmt*) override {}
+		void visitArrayStmt(ArrayStmt*) override {}
+		void visitOperator(Operator*) override {}
+		void visitNumber(Number* numNode) override {
+			number = numNode;
+		}
+		void visitVariable(Variable*) override {}
+		void visitArrayExpr(ArrayExpr*) override {}
+		void visitRelOp(RelOp*) override {}
+		void visitBoolConst(BoolConst* boolConstNode) override {
+			boolConst = boolConstNode;
+		}
+		void visitBoolOp(BoolOp* boolOpNode) override {
+			boolOp = boolOpNode;
+		}
+	};
+
+	template<typename Node>
+	Probe probe(Node* node) {
+		Probe p;
+		node->accept(&p);
+		return p;
+	}
+
+	// True if the number is the given small value.
+	bool isSmall(const Number* n, long v) {
+		return n != nullptr && n->getValue().isSmall() && n->getValue().getSmall() == v;
+	}
+}
+
+Number* Rewriter::asNumber(NumExpr* e) {
+	return probe(e).number;
+}
+
+BoolConst* Rewriter::asBoolConst(BoolExpr* e) {
+	return probe(e).boolConst;
+}
+
+Program* Rewriter::operator()(Program* progNode) {
+	program = progNode;
+	progNode->accept(this);
+	return program;
+}
+
+void Rewriter::visitProgram(Program* progNode) {
+	Block* main = rewritten(progNode->getBlock());
+	if (main != progNode->getBlock()) {
+		program = PM.makeProgram(main);
+	}
+}
+
+void Rewriter::visitBlock(Block* blockNode) {
+	std::vector<Statement*> outer;
+	outer.swap(statements);
+	for (auto i : blockNode->getVector()) {
+		i->accept(this);
+	}
+	if (statements.empty()) {
+		statements.push_back(blockNode->getVector().front());
+	}
+	if (statements == blockNode->getVector()) {
+		block = blockNode;
+	}
+	else {
+		block = BM.makeBlock();
+		for (auto i : statements) {
+			block->pushback(i);
+		}
+	}
+	statements.swap(outer);
+}
+
+void Rewriter::emit(Statement* stmt, const Statement* at) {
+	stmt->setLocation(at->getLine(), at->getColumn());
+	statements.push_back(stmt);
+}
+
+void Rewriter::splice(Block* blockNode) {
+	for (auto i : blockNode->getVector()) {
+		statements.push_back(i);
+	}
+}
+
+void Rewriter::visitPrintStmt(PrintStmt* printStmtNode) {
+	rewritePrint(printStmtNode, rewritten(printStmtNode->getPrinter()));
+}
+
+void Rewriter::visitSetStmt(SetStmt* setStmtNode) {
+	rewriteSet(setStmtNode, rewritten(setStmtNode->getSetter()));
+}
+
+void Rewriter::visitInputStmt(InputStmt* inputStmtNode) {
+	statements.push_back(inputStmtNode);
+}
+
+void Rewriter::visitWhileStmt(WhileStmt* whileStmtNode) {
+	BoolExpr* c = rewritten(whileStmtNode->getCondition());
+	rewriteWhile(whileStmtNode, c, rewritten(whileStmtNode->getReppeter()));
+}
+
+void Rewriter::visitIfStmt(IfStmt* ifStmtNode) {
+	BoolExpr* c = rewritten(ifStmtNode->getCondition());
+	Block* i = rewritten(ifStmtNode->getIfBlock());
+	rewriteIf(ifStmtNode, c, i, rewritten(ifStmtNode->getElseBlock()));
+}
+
+void Rewriter::visitParallelStmt(ParallelStmt* parallelStmtNode) {
+	std::vector<Block*> children;
+	for (auto i : parallelStmtNode->getChildren()) {
+		children.push_back(rewritten(i));
+	}
+	if (children == parallelStmtNode->getChildren()) {
+		statements.push_back(parallelStmtNode);
+		return;
+	}
+	emit(SM.makeParallelStmt(children), parallelStmtNode);
+}
+
+void Rewriter::visitArrayStmt(ArrayStmt* arrayStmtNode) {
+	NumExpr* o = arrayStmtNode->getOperand() ? rewritten(arrayStmtNode->getOperand()) : nullptr;
+	NumExpr* e = arrayStmtNode->getElement() ? rewritten(arrayStmtNode->getElement()) : nullptr;
+	rewriteArrayStmt(arrayStmtNode, o, e);
+}
+
+void Rewriter::visitOperator(Operator* opNode) {
+	NumExpr* l = rewritten(opNode->getLeft());
+	number = rewriteOperator(opNode, l, rewritten(opNode->getRight()));
+}
+
+void Rewriter::visitNumber(Number* numNode) {
+	number = numNode;
+}
+
+void Rewriter::visitVariable(Variable* varNode) {
+	number = varNode;
+}
+
+void Rewriter::visitArrayExpr(ArrayExpr* arrayExprNode) {
+	number = rewriteArrayExpr(arrayExprNode, arrayExprNode->getIndex() ? rewritten(arrayExprNode->getIndex()) : nullptr);
+}
+
+void Rewriter::visitRelOp(RelOp* relOpNode) {
+	NumExpr* l = rewritten(relOpNode->getLeft());
+	condition = rewriteRelOp(relOpNode, l, rewritten(relOpNode->getRight()));
+}
+
+void Rewriter::visitBoolConst(BoolConst* boolConstNode) {
+	condition = boolConstNode;
+}
+
+void Rewriter::visitBoolOp(BoolOp* boolOpNode) {
+	BoolExpr* l = rewritten(boolOpNode->getLeft());
+	condition = rewriteBoolOp(boolOpNode, l, boolOpNode->getRight() ? rewritten(boolOpNode->getRight()) : nullptr);
+}
+
+NumExpr* Rewriter::rewriteOperator(Operator* opNode, NumExpr* left, NumExpr* right) {
+	if (left == opNode->getLeft() && right == opNode->getRight()) {
+		return opNode;
+	}
+	return NEM.makeOperator(opNode->getOpCode(), left, right);
+}
+
+NumExpr* Rewriter::rewriteArrayExpr(ArrayExpr* arrayExprNode, NumExpr* index) {
+	if (index == arrayExprNode->getIndex()) {
+		return arrayExprNode;
+	}
+	return NEM.makeArrayExpr(arrayExprNode->getKind(), arrayExprNode->getArray(), index);
+}
+
+BoolExpr* Rewriter::rewriteRelOp(RelOp* relOpNode, NumExpr* left, NumExpr* right) {
+	if (left == relOpNode->getLeft() && right == relOpNode->getRight()) {
+		return relOpNode;
+	}
+	return BEM.makeRelOp(relOpNode->getRelOpCode(), left, right);
+}
+
+BoolExpr* Rewriter::rewriteBoolOp(BoolOp* boolOpNode, BoolExpr* left, BoolExpr* right) {
+	if (left == boolOpNode->getLeft() && right == boolOpNode->getRight()) {
+		return boolOpNode;
+	}
+	if (right == nullptr) {
+		return BEM.makeBoolOp(boolOpNode->getBoolOpCode(), left);
+	}
+	return BEM.makeBoolOp(boolOpNode->getBoolOpCode(), left, right);
+}
+
+void Rewriter::rewritePrint(PrintStmt* printStmtNode, NumExpr* printed) {
+	if (printed == printStmtNode->getPrinter()) {
+		statements.push_back(printStmtNode);
+		return;
+	}
+	emit(SM.makePrintStmt(printed), printStmtNode);
+}
+
+void Rewriter::rewriteSet(SetStmt* setStmtNode, NumExpr* setter) {
+	if (setter == setStmtNode->getSetter()) {
+		statements.push_back(setStmtNode);
+		return;
+	}
+	emit(SM.makeSetStmt(setStmtNode->getVar(), setter), setStmtNode);
+}
+
+void Rewriter::rewriteWhile(WhileStmt* whileStmtNode, BoolExpr* condition, Block* body) {
+	if (condition == whileStmtNode->getCondition() && body == whileStmtNode->getReppeter()) {
+		statements.push_back(whileStmtNode);
+		return;
+	}
+	emit(SM.makeWhileStmt(condition, body), whileStmtNode);
+}
+
+void Rewriter::rewriteIf(IfStmt* ifStmtNode, BoolExpr* condition, Block* ifBlock, Block* elseBlock) {
+	if (condition == ifStmtNode->getCondition() && ifBlock == ifStmtNode->getIfBlock() && elseBlock == ifStmtNode->getElseBlock()) {
+		statements.push_back(ifStmtNode);
+		return;
+	}
+	emit(SM.makeIfStmt(condition, ifBlock, elseBlock), ifStmtNode);
+}
+
+void Rewriter::rewriteArrayStmt(ArrayStmt* arrayStmtNode, NumExpr* operand, NumExpr* element) {
+	if (operand == arrayStmtNode->getOperand() && element == arrayStmtNode->getElement()) {
+		statements.push_back(arrayStmtNode);
+		return;
+	}
+	emit(SM.makeArrayStmt(arrayStmtNode->getKind(), arrayStmtNode->getArray(), operand, element), arrayStmtNode);
+}
+
+NumExpr* ConstantFolding::rewriteOperator(Operator* opNode, NumExpr* left, NumExpr* right) {
+	Number* l = asNumber(left);
+	Number* r = asNumber(right);
+	if (l == nullptr || r == nullptr) {
+		return Rewriter::rewriteOperator(opNode, left, right);
+	}
+	switch (opNode->getOpCode())
+	{
+	case Operator::ADD:
+		return NEM.makeNumber(Value::add(l->getValue(), r->getValue()));
+	case Operator::SUB:
+		return NEM.makeNumber(Value::sub(l->getValue(), r->getValue()));
+	case Operator::MUL:
+		return NEM.makeNumber(Value::mul(l->getValue(), r->getValue()));
+	default:
+		// The division by zero fails when it is evaluated, if it ever is
+		if (r->getValue().isZero()) {
+			return Rewriter::rewriteOperator(opNode, left, right);
+		}
+		return NEM.makeNumber(Value::div(l->getValue(), r->getValue()));
+	}
+}
+
+BoolExpr* ConstantFolding::rewriteRelOp(RelOp* relOpNode, NumExpr* left, NumExpr* right) {
+	Number* l = asNumber(left);
+	Number* r = asNumber(right);
+	if (l == nullptr || r == nullptr) {
+		return Rewriter::rewriteRelOp(relOpNode, left, right);
+	}
+	int cmp = Value::compare(l->getValue(), r->getValue());
+	switch (relOpNode->getRelOpCode())
+	{
+	case RelOp::LT:
+		return BEM.makeBoolConst(cmp < 0);
+	case RelOp::GT:
+		return BEM.makeBoolConst(cmp > 0);
+	default:
+		return BEM.makeBoolConst(cmp == 0);
+	}
+}
+
+BoolExpr* ConstantFolding::rewriteBoolOp(BoolOp* boolOpNode, BoolExpr* left, BoolExpr* right) {
+	BoolConst* l = asBoolConst(left);
+	switch (boolOpNode->getBoolOpCode())
+	{
+	case BoolOp::NOT:
+		return l ? BEM.makeBoolConst(!l->getValue()) : Rewriter::rewriteBoolOp(boolOpNode, left, right);
+	case BoolOp::AND:
+	case BoolOp::OR: {
+		// The value that decides the operation: FALSE for AND, TRUE for OR
+		bool decisive = boolOpNode->getBoolOpCode() == BoolOp::OR;
+		if (l) {
+			// The right operand is not evaluated after a decisive left one
+			return l->getValue() == decisive ? left : right;
+		}
+		BoolConst* r = asBoolConst(right);
+		if (r && r->getValue() != decisive) {
+			// (AND c TRUE) and (OR c FALSE) are c; with a decisive constant c must still be evaluated
+			return left;
+		}
+		return Rewriter::rewriteBoolOp(boolOpNode, left, right);
+	}
+	default:
+		return Rewriter::rewriteBoolOp(boolOpNode, left, right);
+	}
+}
+
+void ConstantFolding::rewriteWhile(WhileStmt* whileStmtNode, BoolExpr* condition, Block* body) {
+	BoolConst* c = asBoolConst(condition);
+	if (c && !c->getValue()) {
+		return;
+	}
+	Rewriter::rewriteWhile(whileStmtNode, condition, body);
+}
+
+void ConstantFolding::rewriteIf(IfStmt* ifStmtNode, BoolExpr* condition, Block* ifBlock, Block* elseBlock) {
+	BoolConst* c = asBoolConst(condition);
+	if (c) {
+		splice(c->getValue() ? ifBlock : elseBlock);
+		return;
+	}
+	Rewriter::rewriteIf(ifStmtNode, condition, ifBlock, elseBlock);
+}
+
+NumExpr* AlgebraicSimplification::rewriteOperator(Operator* opNode, NumExpr* left, NumExpr* right) {
+	Number* l = asNumber(left);
+	Number* r = asNumber(right);
+	switch (opNode->getOpCode())
+	{
+	case Operator::ADD:
+		if (isSmall(r, 0)) {
+			return left;
+		}
+		if (isSmall(l, 0)) {
+			return right;
+		}
+		break;
+	case Operator::SUB:
+		if (isSmall(r, 0)) {
+			return left;
+		}
+		break;
+	case Operator::MUL:
+		if (isSmall(r, 1)) {
+			return left;
+		}
+		if (isSmall(l, 1)) {
+			return right;
+		}
+		break;
+	default:
+		if (isSmall(r, 1)) {
+			return left;
+		}
+		break;
+	}
+	return Rewriter::rewriteOperator(opNode, left, right);
+}
+
+BoolExpr* AlgebraicSimplification::rewriteBoolOp(BoolOp* boolOpNode, BoolExpr* left, BoolExpr* right) {
+	if (boolOpNode->getBoolOpCode() == BoolOp::NOT) {
+		BoolOp* inner = probe(left).boolOp;
+		if (inner && inner->getBoolOpCode() == BoolOp::NOT) {
+			return inner->getLeft();
+		}
+	}
+	return Rewriter::rewriteBoolOp(boolOpNode, left, right);
+}
@@ -0,0 +1,127 @@
+#ifndef REWRITER_H
+#define REWRITER_H
+
+#include <vector>
+
+#include "Visitor.h"
+#include "Manager.h"
+
+// The Rewriter rebuilds the syntax tree bottom-up, for the transformations of the PassManager.
+// The nodes are immutable: a node whose children are unchanged is kept, any other node is made again by the Managers,
+// so a rewrite returns a new Program sharing the unchanged subtrees with the old one, which stays valid.
+// The subclasses replace nodes by overriding the rewrite functions, which get the node and its rewritten children
+// and by default keep or remake the node. A statement is rewritten into the current statement list: it may be
+// replaced by any number of statements, or by none only when it has no effect at all. As the grammar has no empty
+// block, a block whose statements all disappear keeps its first one.
+// The new nodes copy the position of the statements they replace; the analyses must run again on the result.
+class Rewriter : public Visitor {
+public:
+	Rewriter(NumExprManager& N, BoolExprManager& B, StatementManager& S, BlockManager& K, ProgramManager& P)
+		: NEM{ N }, BEM{ B }, SM{ S }, BM{ K }, PM{ P } {}
+
+	// Rewrites the program: the same program if nothing changed, otherwise a new one.
+	Program* operator()(Program* progNode);
+
+	void visitProgram(Program* progNode) override;
+	void visitBlock(Block* blockNode) override;
+
+	void visitPrintStmt(PrintStmt* printStmtNode) override;
+	void visitSetStmt(SetStmt* setStmtNode) override;
+	void visitInputStmt(InputStmt* inputStmtNode) override;
+	void visitWhileStmt(WhileStmt* whileStmtNode) override;
+	void visitIfStmt(IfStmt* ifStmtNode) override;
+	void visitParallelStmt(ParallelStmt* parallelStmtNode) override;
+	void visitArrayStmt(ArrayStmt* arrayStmtNode) override;
+
+	void visitOperator(Operator* opNode) override;
+	void visitNumber(Number* numNode) override;
+	void visitVariable(Variable* varNode) override;
+	void visitArrayExpr(ArrayExpr* arrayExprNode) override;
+
+	void visitRelOp(RelOp* relOpNode) override;
+	void visitBoolConst(BoolConst* boolConstNode) override;
+	void visitBoolOp(BoolOp* boolOpNode) override;
+
+protected:
+	virtual NumExpr* rewriteOperator(Operator* opNode, NumExpr* left, NumExpr* right);
+	virtual NumExpr* rewriteArrayExpr(ArrayExpr* arrayExprNode, NumExpr* index);
+	virtual BoolExpr* rewriteRelOp(RelOp* relOpNode, NumExpr* left, NumExpr* right);
+	// The right operand is null for NOT.
+	virtual BoolExpr* rewriteBoolOp(BoolOp* boolOpNode, BoolExpr* left, BoolExpr* right);
+
+	virtual void rewritePrint(PrintStmt* printStmtNode, NumExpr* printed);
+	virtual void rewriteSet(SetStmt* setStmtNode, NumExpr* setter);
+	virtual void rewriteWhile(WhileStmt* whileStmtNode, BoolExpr* condition, Block* body);
+	virtual void rewriteIf(IfStmt* ifStmtNode, BoolExpr* condition, Block* ifBlock, Block* elseBlock);
+	// The operand and the element are null when the statement has none.
+	virtual void rewriteArrayStmt(ArrayStmt* arrayStmtNode, NumExpr* operand, NumExpr* element);
+
+	// Appends a statement to the current list, at the position of the statement it replaces.
+	void emit(Statement* stmt, const Statement* at);
+	// Appends the statements of a block to the current list, in place of a statement.
+	void splice(Block* blockNode);
+
+	// The node as a constant, or null if it is not one.
+	static Number* asNumber(NumExpr* e);
+	static BoolConst* asBoolConst(BoolExpr* e);
+
+	NumExprManager& NEM;
+	BoolExprManager& BEM;
+	StatementManager& SM;
+	BlockManager& BM;
+	ProgramManager& PM;
+
+private:
+	NumExpr* rewritten(NumExpr* node) {
+		node->accept(this);
+		return number;
+	}
+
+	BoolExpr* rewritten(BoolExpr* node) {
+		node->accept(this);
+		return condition;
+	}
+
+	Block* rewritten(Block* node) {
+		node->accept(this);
+		return block;
+	}
+
+	// Results of the last visit
+	NumExpr* number = nullptr;
+	BoolExpr* condition = nullptr;
+	Block* block = nullptr;
+	Program* program = nullptr;
+	// Statements of the block being rewritten
+	std::vector<Statement*> statements;
+};
+
+// Constant folding: operations on numbers become numbers (except a division by zero, left to fail at run time),
+// comparisons of numbers become TRUE or FALSE, AND and OR with a constant operand are reduced where the
+// short-circuit evaluation allows it, an IF with a constant condition becomes the statements of its branch and
+// a WHILE whose condition is FALSE disappears.
+class ConstantFolding : public Rewriter {
+public:
+	using Rewriter::Rewriter;
+
+protected:
+	NumExpr* rewriteOperator(Operator* opNode, NumExpr* left, NumExpr* right) override;
+	BoolExpr* rewriteRelOp(RelOp* relOpNode, NumExpr* left, NumExpr* right) override;
+	BoolExpr* rewriteBoolOp(BoolOp* boolOpNode, BoolExpr* left, BoolExpr* right) override;
+	void rewriteWhile(WhileStmt* whileStmtNode, BoolExpr* condition, Block* body) override;
+	void rewriteIf(IfStmt* ifStmtNode, BoolExpr* condition, Block* ifBlock, Block* elseBlock) override;
+};
+
+// Algebraic simplification of the identities that keep their other operand, which is still evaluated (so its
+// errors are kept): (ADD e 0), (ADD 0 e), (SUB e 0), (MUL e 1), (MUL 1 e) and (DIV e 1) become e,
+// and (NOT (NOT c)) becomes c.
+class AlgebraicSimplification : public Rewriter {
+public:
+	using Rewriter::Rewriter;
+
+protected:
+	NumExpr* rewriteOperator(Operator* opNode, NumExpr* left, NumExpr* right) override;
+	BoolExpr* rewriteBoolOp(BoolOp* boolOpNode, BoolExpr* left, BoolExpr* right) override;
+};
+
+#endif
@@ -0,0 +1,1181 @@
+#include <algorithm>
+#include <sstream>
+#include <stdexcept>
+
+#include "SSA.h"
+#include "IntArray.h"
+
+namespace {
+	enum Lattice : char { TOP, CONSTANT, BOTTOM };
+
+	const char* opName(SsaFunction::Op op) {
+		static const char* names[]{ "const", "undef", "phi", "add", "sub", "mul", "div", "lt", "gt", "eq", "input",
+			"array", "check", "print", "array", "step" };
+		return names[op];
+	}
+
+	int slotOf(const Variable* varNode) {
+		if (varNode->getSlot() < 0 || varNode->getAssignment() == Variable::NOT_ANALYSED) {
+			throw std::logic_error("SSA form of a program that was not analysed");
+		}
+		return varNode->getSlot();
+	}
+}
+
+SsaFunction::SsaFunction(Program* progNode) {
+	slots = progNode->getSlotNames().size();
+	undefs.assign(slots, -1);
+	progNode->accept(this);
+	for (const Instr& i : instrs) {
+		report.lowered += !i.dead;
+	}
+}
+
+// Construction
+
+int SsaFunction::newBlock() {
+	blocks.emplace_back();
+	definitions.emplace_back();
+	incompletePhis.emplace_back();
+	return static_cast<int>(blocks.size() - 1);
+}
+
+int SsaFunction::emit(Op op, std::vector<int> args) {
+	int id = static_cast<int>(instrs.size());
+	instrs.push_back(Instr{ op, current, std::move(args) });
+	forward.push_back(id);
+	if (op == PHI) {
+		blocks[current].phis.push_back(id);
+	}
+	else if (op == CONST || op == UNDEF) {
+		// In the entry block, which dominates every use
+		instrs[id].block = 0;
+		blocks[0].instrs.insert(blocks[0].instrs.begin(), id);
+	}
+	else {
+		blocks[current].instrs.push_back(id);
+	}
+	return id;
+}
+
+int SsaFunction::constant(const Value& v) {
+	int id = emit(CONST);
+	instrs[id].constant = v;
+	return id;
+}
+
+int SsaFunction::lowerValue(NumExpr* e) {
+	e->accept(this);
+	return result;
+}
+
+void SsaFunction::lowerCondition(BoolExpr* c, int t, int f) {
+	int savedTrue = onTrue, savedFalse = onFalse;
+	onTrue = t;
+	onFalse = f;
+	c->accept(this);
+	onTrue = savedTrue;
+	onFalse = savedFalse;
+}
+
+void SsaFunction::jump(int from, int to) {
+	blocks[from].exit = JUMP;
+	blocks[from].succs = { to };
+	blocks[to].preds.push_back(from);
+}
+
+void SsaFunction::branch(int from, int condition, int t, int f) {
+	blocks[from].exit = BRANCH;
+	blocks[from].condition = condition;
+	blocks[from].succs = { t, f };
+	blocks[t].preds.push_back(from);
+	blocks[f].preds.push_back(from);
+}
+
+void SsaFunction::seal(int b) {
+	// addPhiOperands may add incomplete PHIs to other blocks, not to this one (its predecessors are all known)
+	std::unordered_map<int, int> incomplete;
+	incomplete.swap(incompletePhis[b]);
+	for (auto& entry : incomplete) {
+		addPhiOperands(entry.first, entry.second);
+	}
+	blocks[b].sealed = true;
+}
+
+void SsaFunction::writeVariable(int slot, int b, int value) {
+	definitions[b][slot] = value;
+}
+
+int SsaFunction::readVariable(int slot, int b) {
+	auto found = definitions[b].find(slot);
+	if (found != definitions[b].end()) {
+		return find(found->second);
+	}
+	return readVariableRecursive(slot, b);
+}
+
+int SsaFunction::readVariableRecursive(int slot, int b) {
+	int value;
+	if (!blocks[b].sealed) {
+		// The operands are added when the block is sealed
+		int saved = current;
+		current = b;
+		value = emit(PHI);
+		current = saved;
+		incompletePhis[b][slot] = value;
+	}
+	else if (blocks[b].preds.size() == 1) {
+		value = readVariable(slot, blocks[b].preds[0]);
+	}
+	else if (blocks[b].preds.empty()) {
+		// The entry, or a block no execution reaches: the variable is not assigned
+		if (undefs[slot] < 0) {
+			undefs[slot] = emit(UNDEF);
+		}
+		value = undefs[slot];
+	}
+	else {
+		// The PHI is the definition before its operands are read, which breaks the cycles of the loops
+		int saved = current;
+		current = b;
+		value = emit(PHI);
+		current = saved;
+		writeVariable(slot, b, value);
+		value = addPhiOperands(slot, value);
+	}
+	writeVariable(slot, b, value);
+	return value;
+}
+
+int SsaFunction::addPhiOperands(int slot, int phi) {
+	int b = instrs[phi].block;
+	for (size_t p = 0; p < blocks[b].preds.size(); ++p) {
+		int v = readVariable(slot, blocks[b].preds[p]);
+		instrs[phi].args.push_back(v);
+	}
+	return tryRemoveTrivialPhi(phi);
+}
+
+int SsaFunction::tryRemoveTrivialPhi(int phi) {
+	int same = -1;
+	for (int arg : instrs[phi].args) {
+		arg = find(arg);
+		if (arg == same || arg == phi) {
+			continue;
+		}
+		if (same >= 0) {
+			return phi;
+		}
+		same = arg;
+	}
+	if (same < 0) {
+		// Only the PHI itself: a loop that nothing enters, left to removeTrivialPhis
+		return phi;
+	}
+	replace(phi, same);
+	return same;
+}
+
+void SsaFunction::replace(int v, int by) {
+	forward[v] = find(by);
+	instrs[v].dead = true;
+}
+
+int SsaFunction::find(int v) const {
+	int root = v;
+	while (forward[root] != root) {
+		root = forward[root];
+	}
+	while (forward[v] != root) {
+		int next = forward[v];
+		forward[v] = root;
+		v = next;
+	}
+	return root;
+}
+
+void SsaFunction::visitProgram(Program* progNode) {
+	current = newBlock();
+	seal(current);
+	progNode->getBlock()->accept(this);
+	blocks[current].exit = RETURN;
+}
+
+void SsaFunction::visitBlock(Block* blockNode) {
+	// The evaluators count a step when they enter a block
+	emit(STEP);
+	for (auto i : blockNode->getVector()) {
+		i->accept(this);
+	}
+}
+
+void SsaFunction::visitPrintStmt(PrintStmt* printStmtNode) {
+	emit(PRINT, { lowerValue(printStmtNode->getPrinter()) });
+}
+
+void SsaFunction::visitSetStmt(SetStmt* setStmtNode) {
+	int value = lowerValue(setStmtNode->getSetter());
+	writeVariable(slotOf(setStmtNode->getVar()), current, value);
+}
+
+void SsaFunction::visitInputStmt(InputStmt* inputStmtNode) {
+	writeVariable(slotOf(inputStmtNode->getVar()), current, emit(INPUT));
+}
+
+void SsaFunction::visitWhileStmt(WhileStmt* whileStmtNode) {
+	int header = newBlock();
+	jump(current, header);
+	current = header;
+	int body = newBlock(), exit = newBlock();
+	lowerCondition(whileStmtNode->getCondition(), body, exit);
+	seal(body);
+	seal(exit);
+	current = body;
+	whileStmtNode->getReppeter()->accept(this);
+	jump(current, header);
+	// The back edge is known: the PHIs of the header get their operands
+	seal(header);
+	current = exit;
+}
+
+void SsaFunction::visitIfStmt(IfStmt* ifStmtNode) {
+	int t = newBlock(), f = newBlock(), join = newBlock();
+	lowerCondition(ifStmtNode->getCondition(), t, f);
+	seal(t);
+	seal(f);
+	current = t;
+	ifStmtNode->getIfBlock()->accept(this);
+	jump(current, join);
+	current = f;
+	ifStmtNode->getElseBlock()->accept(this);
+	jump(current, join);
+	seal(join);
+	current = join;
+}
+
+void SsaFunction::visitParallelStmt(ParallelStmt* parallelStmtNode) {
+	for (auto i : parallelStmtNode->getChildren()) {
+		i->accept(this);
+	}
+}
+
+void SsaFunction::visitArrayStmt(ArrayStmt* arrayStmtNode) {
+	std::vector<int> args;
+	if (!arrayStmtNode->isElementWise()) {
+		args.push_back(lowerValue(arrayStmtNode->getOperand()));
+		if (arrayStmtNode->getElement()) {
+			args.push_back(lowerValue(arrayStmtNode->getElement()));
+		}
+	}
+	int id = emit(ARRAY_STMT, std::move(args));
+	instrs[id].arrayStmt = arrayStmtNode;
+}
+
+void SsaFunction::visitOperator(Operator* opNode) {
+	int l = lowerValue(opNode->getLeft());
+	int r = lowerValue(opNode->getRight());
+	result = emit(static_cast<Op>(ADD + static_cast<int>(opNode->getOpCode())), { l, r });
+}
+
+void SsaFunction::visitNumber(Number* numNode) {
+	result = constant(numNode->getValue());
+}
+
+void SsaFunction::visitVariable(Variable* varNode) {
+	result = readVariable(slotOf(varNode), current);
+	if (varNode->getAssignment() != Variable::ASSIGNED) {
+		emit(CHECK, { result });
+	}
+}
+
+void SsaFunction::visitArrayExpr(ArrayExpr* arrayExprNode) {
+	std::vector<int> args;
+	if (arrayExprNode->getIndex()) {
+		args.push_back(lowerValue(arrayExprNode->getIndex()));
+	}
+	result = emit(ARRAY_EXPR, std::move(args));
+	instrs[result].arrayExpr = arrayExprNode;
+}
+
+void SsaFunction::visitRelOp(RelOp* relOpNode) {
+	int l = lowerValue(relOpNode->getLeft());
+	int r = lowerValue(relOpNode->getRight());
+	static constexpr Op ops[]{ LT, GT, EQ };
+	branch(current, emit(ops[relOpNode->getRelOpCode()], { l, r }), onTrue, onFalse);
+}
+
+void SsaFunction::visitBoolConst(BoolConst* boolConstNode) {
+	jump(current, boolConstNode->getValue() ? onTrue : onFalse);
+}
+
+void SsaFunction::visitBoolOp(BoolOp* boolOpNode) {
+	if (boolOpNode->getBoolOpCode() == BoolOp::NOT) {
+		lowerCondition(boolOpNode->getLeft(), onFalse, onTrue);
+		return;
+	}
+	// The right operand is evaluated only when the left one does not decide
+	int right = newBlock();
+	if (boolOpNode->getBoolOpCode() == BoolOp::AND) {
+		lowerCondition(boolOpNode->getLeft(), right, onFalse);
+	}
+	else {
+		lowerCondition(boolOpNode->getLeft(), onTrue, right);
+	}
+	seal(right);
+	current = right;
+	lowerCondition(boolOpNode->getRight(), onTrue, onFalse);
+}
+
+// Optimizations
+
+void SsaFunction::optimize() {
+	propagateConstants();
+	removeTrivialPhis();
+	numberValues();
+	removeTrivialPhis();
+	removeChecks();
+	removeUnused();
+	report.remaining = 0;
+	for (const BasicBlock& b : blocks) {
+		if (!b.dead) {
+			for (int i : b.phis) {
+				report.remaining += !instrs[i].dead;
+			}
+			for (int i : b.instrs) {
+				report.remaining += !instrs[i].dead;
+			}
+		}
+	}
+}
+
+std::vector<int> SsaFunction::reversePostorder() const {
+	std::vector<int> order;
+	std::vector<char> seen(blocks.size(), 0);
+	// Explicit stack of (block, next successor)
+	std::vector<std::pair<int, size_t>> stack{ { 0, 0 } };
+	seen[0] = 1;
+	while (!stack.empty()) {
+		int b = stack.back().first;
+		size_t s = stack.back().second++;
+		if (s < blocks[b].succs.size()) {
+			int next = blocks[b].succs[s];
+			if (!seen[next] && !blocks[next].dead) {
+				seen[next] = 1;
+				stack.push_back({ next, 0 });
+			}
+		}
+		else {
+			order.push_back(b);
+			stack.pop_back();
+		}
+	}
+	std::reverse(order.begin(), order.end());
+	return order;
+}
+
+void SsaFunction::removePredecessor(int b, size_t index) {
+	blocks[b].preds.erase(blocks[b].preds.begin() + index);
+	for (int phi : blocks[b].phis) {
+		if (!instrs[phi].dead) {
+			instrs[phi].args.erase(instrs[phi].args.begin() + index);
+		}
+	}
+}
+
+void SsaFunction::propagateConstants() {
+	size_t n = instrs.size();
+	std::vector<char> lattice(n, TOP);
+	std::vector<Value> values(n);
+	std::vector<char> reached(blocks.size(), 0);
+	std::vector<std::vector<char>> executable(blocks.size());
+	std::vector<std::vector<int>> users(n);
+	std::vector<std::vector<int>> deciding(n);	// Blocks branching on the value
+	for (size_t b = 0; b < blocks.size(); ++b) {
+		executable[b].assign(blocks[b].preds.size(), 0);
+		if (blocks[b].exit == BRANCH) {
+			blocks[b].condition = find(blocks[b].condition);
+			deciding[blocks[b].condition].push_back(static_cast<int>(b));
+		}
+	}
+	for (size_t i = 0; i < n; ++i) {
+		if (!instrs[i].dead) {
+			for (int& arg : instrs[i].args) {
+				arg = find(arg);
+				users[arg].push_back(static_cast<int>(i));
+			}
+		}
+	}
+
+	std::vector<std::pair<int, int>> edgeWork;
+	std::vector<int> valueWork;
+	auto markEdge = [&](int from, int to) {
+		for (size_t p = 0; p < blocks[to].preds.size(); ++p) {
+			if (blocks[to].preds[p] == from && !executable[to][p]) {
+				executable[to][p] = 1;
+				edgeWork.push_back({ from, to });
+			}
+		}
+	};
+	auto lower = [&](int v, char l, const Value& c) {
+		if (l > lattice[v] || (l == CONSTANT && lattice[v] == CONSTANT && Value::compare(c, values[v]) != 0)) {
+			// A constant that changes only happens if the operands were not monotone: the value is not constant
+			lattice[v] = lattice[v] == CONSTANT && l == CONSTANT ? static_cast<char>(BOTTOM) : l;
+			values[v] = c;
+			valueWork.push_back(v);
+		}
+	};
+	auto evaluate = [&](int v) {
+		const Instr& i = instrs[v];
+		if (i.dead || !reached[i.block] || !hasValue(i)) {
+			return;
+		}
+		switch (i.op)
+		{
+		case CONST:
+			lower(v, CONSTANT, i.constant);
+			return;
+		case PHI: {
+			char l = TOP;
+			Value c;
+			for (size_t p = 0; p < i.args.size(); ++p) {
+				if (!executable[i.block][p] || lattice[i.args[p]] == TOP) {
+					continue;
+				}
+				if (lattice[i.args[p]] == BOTTOM || (l == CONSTANT && Value::compare(c, values[i.args[p]]) != 0)) {
+					l = BOTTOM;
+					break;
+				}
+				l = CONSTANT;
+				c = values[i.args[p]];
+			}
+			if (l != TOP) {
+				lower(v, l, c);
+			}
+			return;
+		}
+		case ADD: case SUB: case MUL: case DIV: case LT: case GT: case EQ: {
+			char a = lattice[i.args[0]], b = lattice[i.args[1]];
+			if (a == BOTTOM || b == BOTTOM) {
+				lower(v, BOTTOM, Value());
+				return;
+			}
+			if (a == TOP || b == TOP) {
+				return;
+			}
+			const Value& x = values[i.args[0]];
+			const Value& y = values[i.args[1]];
+			switch (i.op)
+			{
+			case ADD:
+				lower(v, CONSTANT, Value::add(x, y)); return;
+			case SUB:
+				lower(v, CONSTANT, Value::sub(x, y)); return;
+			case MUL:
+				lower(v, CONSTANT, Value::mul(x, y)); return;
+			case DIV:
+				// A division by zero fails at run time: its value is never used
+				if (y.isZero()) {
+					lower(v, BOTTOM, Value());
+					return;
+				}
+				lower(v, CONSTANT, Value::div(x, y)); return;
+			case LT:
+				lower(v, CONSTANT, Value(Value::compare(x, y) < 0 ? 1L : 0L)); return;
+			case GT:
+				lower(v, CONSTANT, Value(Value::compare(x, y) > 0 ? 1L : 0L)); return;
+			default:
+				lower(v, CONSTANT, Value(Value::compare(x, y) == 0 ? 1L : 0L)); return;
+			}
+		}
+		default:
+			// UNDEF, INPUT and the array reads
+			lower(v, BOTTOM, Value());
+			return;
+		}
+	};
+	auto evaluateExit = [&](int b) {
+		const BasicBlock& block = blocks[b];
+		if (block.exit == JUMP) {
+			markEdge(b, block.succs[0]);
+		}
+		else if (block.exit == BRANCH) {
+			char l = lattice[block.condition];
+			if (l == CONSTANT) {
+				markEdge(b, values[block.condition].isZero() ? block.succs[1] : block.succs[0]);
+			}
+			else if (l == BOTTOM) {
+				markEdge(b, block.succs[0]);
+				markEdge(b, block.succs[1]);
+			}
+		}
+	};
+	auto reach = [&](int b) {
+		reached[b] = 1;
+		for (int i : blocks[b].phis) {
+			evaluate(i);
+		}
+		for (int i : blocks[b].instrs) {
+			evaluate(i);
+		}
+		evaluateExit(b);
+	};
+
+	reach(0);
+	while (!edgeWork.empty() || !valueWork.empty()) {
+		if (!edgeWork.empty()) {
+			int to = edgeWork.back().second;
+			edgeWork.pop_back();
+			if (!reached[to]) {
+				reach(to);
+			}
+			else {
+				for (int i : blocks[to].phis) {
+					evaluate(i);
+				}
+			}
+			continue;
+		}
+		int v = valueWork.back();
+		valueWork.pop_back();
+		for (int u : users[v]) {
+			evaluate(u);
+		}
+		for (int b : deciding[v]) {
+			if (reached[b]) {
+				evaluateExit(b);
+			}
+		}
+	}
+
+	// The blocks no execution reaches disappear, with their edges
+	for (size_t b = 0; b < blocks.size(); ++b) {
+		if (reached[b] || blocks[b].dead) {
+			continue;
+		}
+		blocks[b].dead = true;
+		report.blocks++;
+		for (int i : blocks[b].phis) {
+			instrs[i].dead = true;
+		}
+		for (int i : blocks[b].instrs) {
+			if (instrs[i].op != CONST && instrs[i].op != UNDEF) {
+				instrs[i].dead = true;
+			}
+		}
+		for (int s : blocks[b].succs) {
+			for (size_t p = blocks[s].preds.size(); p-- > 0;) {
+				if (blocks[s].preds[p] == static_cast<int>(b)) {
+					removePredecessor(s, p);
+				}
+			}
+		}
+	}
+	// The branches on constants become jumps
+	for (size_t b = 0; b < blocks.size(); ++b) {
+		BasicBlock& block = blocks[b];
+		if (block.dead || block.exit != BRANCH || lattice[block.condition] != CONSTANT) {
+			continue;
+		}
+		int taken = values[block.condition].isZero() ? block.succs[1] : block.succs[0];
+		int other = taken == block.succs[0] ? block.succs[1] : block.succs[0];
+		for (size_t p = 0; p < blocks[other].preds.size(); ++p) {
+			if (blocks[other].preds[p] == static_cast<int>(b)) {
+				removePredecessor(other, p);
+				break;
+			}
+		}
+		block.exit = JUMP;
+		block.condition = -1;
+		block.succs = { taken };
+		report.branches++;
+	}
+	// The constant values become constants
+	for (size_t v = 0; v < n; ++v) {
+		Instr& i = instrs[v];
+		if (i.dead || i.op == CONST || lattice[v] != CONSTANT) {
+			continue;
+		}
+		int c = constant(values[v]);
+		replace(static_cast<int>(v), c);
+		report.constants++;
+	}
+}
+
+void SsaFunction::removeTrivialPhis() {
+	bool changed = true;
+	while (changed) {
+		changed = false;
+		for (const BasicBlock& b : blocks) {
+			if (b.dead) {
+				continue;
+			}
+			for (int phi : b.phis) {
+				if (!instrs[phi].dead && tryRemoveTrivialPhi(phi) != phi) {
+					changed = true;
+				}
+			}
+		}
+	}
+}
+
+std::vector<int> SsaFunction::dominators(const std::vector<int>& order) const {
+	// Cooper, Harvey and Kennedy, "A Simple, Fast Dominance Algorithm"
+	std::vector<int> position(blocks.size(), -1);
+	for (size_t p = 0; p < order.size(); ++p) {
+		position[order[p]] = static_cast<int>(p);
+	}
+	std::vector<int> idom(blocks.size(), -1);
+	idom[order[0]] = order[0];
+	bool changed = true;
+	while (changed) {
+		changed = false;
+		for (size_t p = 1; p < order.size(); ++p) {
+			int b = order[p];
+			int dom = -1;
+			for (int pred : blocks[b].preds) {
+				if (position[pred] < 0 || idom[pred] < 0) {
+					continue;
+				}
+				if (dom < 0) {
+					dom = pred;
+					continue;
+				}
+				int x = pred, y = dom;
+				while (x != y) {
+					while (position[x] > position[y]) {
+						x = idom[x];
+					}
+					while (position[y] > position[x]) {
+						y = idom[y];
+					}
+				}
+				dom = x;
+			}
+			if (dom != idom[b]) {
+				idom[b] = dom;
+				changed = true;
+			}
+		}
+	}
+	return idom;
+}
+
+void SsaFunction::numberValues() {
+	std::vector<int> order = reversePostorder();
+	std::vector<int> idom = dominators(order);
+	std::vector<std::vector<int>> children(blocks.size());
+	for (size_t p = 1; p < order.size(); ++p) {
+		children[idom[order[p]]].push_back(order[p]);
+	}
+
+	// The operations available in the dominators of the block being numbered, by key
+	std::unordered_map<std::string, int> available;
+	std::vector<std::string> added;
+	// Depth-first walk of the dominator tree: a marker (-1) removes the keys added by the block it closes
+	std::vector<std::pair<int, size_t>> stack{ { order[0], 0 } };
+	std::vector<size_t> marks;
+	auto number = [&](int v) {
+		Instr& i = instrs[v];
+		for (int& arg : i.args) {
+			arg = find(arg);
+		}
+		std::ostringstream key;
+		switch (i.op)
+		{
+		case CONST:
+			key << "c" << i.constant;
+			break;
+		case UNDEF:
+			key << "u";
+			break;
+		case PHI:
+			key << "p" << i.block;
+			for (int arg : i.args) {
+				key << " " << arg;
+			}
+			break;
+		case ADD: case MUL: case EQ:
+			// Commutative
+			key << opName(i.op) << " " << std::min(i.args[0], i.args[1]) << " " << std::max(i.args[0], i.args[1]);
+			break;
+		case SUB: case DIV: case LT: case GT:
+			key << opName(i.op) << " " << i.args[0] << " " << i.args[1];
+			break;
+		case CHECK:
+			key << "k" << i.args[0];
+			break;
+		default:
+			return;
+		}
+		auto found = available.find(key.str());
+		if (found == available.end()) {
+			available.emplace(key.str(), v);
+			added.push_back(key.str());
+			return;
+		}
+		report.numbered++;
+		if (hasValue(i)) {
+			replace(v, found->second);
+		}
+		else {
+			i.dead = true;
+		}
+	};
+	while (!stack.empty()) {
+		int b = stack.back().first;
+		size_t next = stack.back().second++;
+		if (next == 0) {
+			marks.push_back(added.size());
+			for (int i : blocks[b].phis) {
+				if (!instrs[i].dead) {
+					number(i);
+				}
+			}
+			for (int i : blocks[b].instrs) {
+				if (!instrs[i].dead) {
+					number(i);
+				}
+			}
+			if (blocks[b].exit == BRANCH) {
+				blocks[b].condition = find(blocks[b].condition);
+			}
+		}
+		if (next < children[b].size()) {
+			stack.push_back({ children[b][next], 0 });
+			continue;
+		}
+		for (size_t k = marks.back(); k < added.size(); ++k) {
+			available.erase(added[k]);
+		}
+		added.resize(marks.back());
+		marks.pop_back();
+		stack.pop_back();
+	}
+}
+
+void SsaFunction::removeChecks() {
+	// A value may be unassigned if it is an UNDEF or a PHI of one
+	std::vector<char> unassigned(instrs.size(), 0);
+	for (size_t v = 0; v < instrs.size(); ++v) {
+		unassigned[v] = !instrs[v].dead && instrs[v].op == UNDEF;
+	}
+	bool changed = true;
+	while (changed) {
+		changed = false;
+		for (const BasicBlock& b : blocks) {
+			if (b.dead) {
+				continue;
+			}
+			for (int phi : b.phis) {
+				if (instrs[phi].dead || unassigned[phi]) {
+					continue;
+				}
+				for (int arg : instrs[phi].args) {
+					if (unassigned[find(arg)]) {
+						unassigned[phi] = 1;
+						changed = true;
+						break;
+					}
+				}
+			}
+		}
+	}
+	for (const BasicBlock& b : blocks) {
+		if (b.dead) {
+			continue;
+		}
+		for (int v : b.instrs) {
+			Instr& i = instrs[v];
+			if (!i.dead && i.op == CHECK && !unassigned[find(i.args[0])]) {
+				i.dead = true;
+				report.checks++;
+			}
+		}
+	}
+}
+
+void SsaFunction::removeUnused() {
+	std::vector<char> used(instrs.size(), 0);
+	std::vector<int> work;
+	auto use = [&](int v) {
+		v = find(v);
+		if (!used[v]) {
+			used[v] = 1;
+			work.push_back(v);
+		}
+	};
+	for (const BasicBlock& b : blocks) {
+		if (b.dead) {
+			continue;
+		}
+		for (int v : b.instrs) {
+			const Instr& i = instrs[v];
+			if (i.dead) {
+				continue;
+			}
+			// What has an effect or can fail stays
+			bool divisorSafe = i.op == DIV && instrs[find(i.args[1])].op == CONST && !instrs[find(i.args[1])].constant.isZero();
+			if (i.op >= INPUT || (i.op == DIV && !divisorSafe)) {
+				use(v);
+			}
+		}
+		if (b.exit == BRANCH) {
+			use(b.condition);
+		}
+	}
+	while (!work.empty()) {
+		int v = work.back();
+		work.pop_back();
+		for (int arg : instrs[v].args) {
+			use(arg);
+		}
+	}
+	for (const BasicBlock& b : blocks) {
+		if (b.dead) {
+			continue;
+		}
+		for (int v : b.phis) {
+			if (!instrs[v].dead && !used[v]) {
+				instrs[v].dead = true;
+				report.unused++;
+			}
+		}
+		for (int v : b.instrs) {
+			if (!instrs[v].dead && !used[v]) {
+				instrs[v].dead = true;
+				report.unused++;
+			}
+		}
+	}
+}
+
+void SsaFunction::write(std::ostream& os) const {
+	auto value = [&](int v) {
+		return "v" + std::to_string(find(v));
+	};
+	for (int b : reversePostorder()) {
+		const BasicBlock& block = blocks[b];
+		os << "b" << b << ":";
+		if (!block.preds.empty()) {
+			os << " ; preds";
+			for (int p : block.preds) {
+				os << " b" << p;
+			}
+		}
+		os << "\n";
+		for (int v : block.phis) {
+			if (instrs[v].dead) {
+				continue;
+			}
+			os << "  v" << v << " = phi";
+			for (int arg : instrs[v].args) {
+				os << " " << value(arg);
+			}
+			os << "\n";
+		}
+		for (int v : block.instrs) {
+			const Instr& i = instrs[v];
+			if (i.dead) {
+				continue;
+			}
+			os << "  ";
+			if (hasValue(i)) {
+				os << "v" << v << " = ";
+			}
+			if (i.op == CONST) {
+				os << i.constant;
+			}
+			else if (i.op == ARRAY_STMT) {
+				os << token::id2word[token::ARRAY + i.arrayStmt->getKind()] << " " << i.arrayStmt->getArray()->getVarId();
+				if (i.arrayStmt->isElementWise()) {
+					os << " " << i.arrayStmt->getLeft()->getVarId() << " " << i.arrayStmt->getRight()->getVarId();
+				}
+			}
+			else if (i.op == ARRAY_EXPR) {
+				os << token::id2word[token::GET + i.arrayExpr->getKind()] << " " << i.arrayExpr->getArray()->getVarId();
+			}
+			else {
+				os << opName(i.op);
+			}
+			if (i.op != CONST) {
+				for (int arg : i.args) {
+					os << " " << value(arg);
+				}
+			}
+			os << "\n";
+		}
+		switch (block.exit)
+		{
+		case JUMP:
+			os << "  jump b" << block.succs[0] << "\n";
+			break;
+		case BRANCH:
+			os << "  branch " << value(block.condition) << " b" << block.succs[0] << " b" << block.succs[1] << "\n";
+			break;
+		default:
+			os << "  return\n";
+			break;
+		}
+	}
+}
+
+void SsaFunction::writeReport(std::ostream& os) const {
+	os << "SSA form: " << report.lowered << " instructions lowered, " << report.constants << " constant values, "
+		<< report.branches << " constant branches, " << report.blocks << " unreachable blocks, " << report.numbered
+		<< " redundant operations, " << report.checks << " checks, " << report.unused << " unused operations removed, "
+		<< report.remaining << " instructions left" << std::endl;
+}
+
+// Out of SSA form
+
+SsaCode::SsaCode(const SsaFunction& f) {
+	const std::vector<SsaFunction::Instr>& instrs = f.getInstrs();
+	const std::vector<SsaFunction::BasicBlock>& blocks = f.getBlocks();
+	std::vector<int> order = f.reversePostorder();
+
+	std::vector<int> reg(instrs.size(), -1);
+	for (int b : order) {
+		for (int v : blocks[b].phis) {
+			if (!instrs[v].dead) {
+				reg[v] = static_cast<int>(registers++);
+				undefined.push_back(reg[v]);
+			}
+		}
+		for (int v : blocks[b].instrs) {
+			const SsaFunction::Instr& i = instrs[v];
+			if (i.dead || i.op >= SsaFunction::CHECK) {
+				continue;
+			}
+			reg[v] = static_cast<int>(registers++);
+			if (i.op == SsaFunction::CONST) {
+				constants.push_back({ reg[v], i.constant });
+			}
+			else if (i.op == SsaFunction::UNDEF) {
+				undefined.push_back(reg[v]);
+			}
+		}
+	}
+	auto in = [&](const SsaFunction::Instr& i, size_t a) {
+		return a < i.args.size() ? reg[f.find(i.args[a])] : -1;
+	};
+
+	// Scratch registers of the parallel moves, shared by the edges
+	std::vector<int> scratch;
+	auto moves = [&](int from, int to) {
+		const SsaFunction::BasicBlock& target = blocks[to];
+		size_t p = std::find(target.preds.begin(), target.preds.end(), from) - target.preds.begin();
+		std::vector<std::pair<int, int>> pending;
+		for (int v : target.phis) {
+			if (!instrs[v].dead && reg[f.find(instrs[v].args[p])] != reg[v]) {
+				pending.push_back({ reg[v], reg[f.find(instrs[v].args[p])] });
+			}
+		}
+		bool overlap = false;
+		for (auto& m : pending) {
+			for (auto& other : pending) {
+				overlap = overlap || m.first == other.second;
+			}
+		}
+		if (!overlap) {
+			for (auto& m : pending) {
+				code.push_back(Instruction{ MOVE, m.first, m.second, -1 });
+			}
+			return;
+		}
+		// A PHI read by another on the same edge: all the sources are copied before any is overwritten
+		while (scratch.size() < pending.size()) {
+			scratch.push_back(static_cast<int>(registers++));
+		}
+		for (size_t m = 0; m < pending.size(); ++m) {
+			code.push_back(Instruction{ MOVE, scratch[m], pending[m].second, -1 });
+		}
+		for (size_t m = 0; m < pending.size(); ++m) {
+			code.push_back(Instruction{ MOVE, pending[m].first, scratch[m], -1 });
+		}
+	};
+	auto needsMoves = [&](int to) {
+		for (int v : blocks[to].phis) {
+			if (!instrs[v].dead) {
+				return true;
+			}
+		}
+		return false;
+	};
+
+	std::vector<int> label(blocks.size(), -1);
+	// Targets to patch once every block has its label: (instruction, block), in the dst or in b
+	std::vector<std::pair<size_t, int>> toDst, toB;
+	for (int b : order) {
+		label[b] = static_cast<int>(code.size());
+		for (int v : blocks[b].instrs) {
+			const SsaFunction::Instr& i = instrs[v];
+			if (i.dead) {
+				continue;
+			}
+			switch (i.op)
+			{
+			case SsaFunction::CONST:
+			case SsaFunction::UNDEF:
+			case SsaFunction::PHI:
+				break;
+			case SsaFunction::ADD: case SsaFunction::SUB: case SsaFunction::MUL: case SsaFunction::DIV:
+			case SsaFunction::LT: case SsaFunction::GT: case SsaFunction::EQ:
+				code.push_back(Instruction{ static_cast<Op>(ADD + (i.op - SsaFunction::ADD)), reg[v], in(i, 0), in(i, 1) });
+				break;
+			case SsaFunction::INPUT:
+				code.push_back(Instruction{ INPUT, reg[v], -1, -1 });
+				break;
+			case SsaFunction::ARRAY_EXPR:
+				code.push_back(Instruction{ ARRAY_EXPR, reg[v], in(i, 0), -1, nullptr, i.arrayExpr });
+				break;
+			case SsaFunction::CHECK:
+				code.push_back(Instruction{ CHECK, -1, in(i, 0), -1 });
+				break;
+			case SsaFunction::PRINT:
+				code.push_back(Instruction{ PRINT, -1, in(i, 0), -1 });
+				break;
+			case SsaFunction::ARRAY_STMT:
+				code.push_back(Instruction{ ARRAY_STMT, -1, in(i, 0), in(i, 1), i.arrayStmt });
+				break;
+			case SsaFunction::STEP:
+				code.push_back(Instruction{ STEP, -1, -1, -1 });
+				break;
+			}
+		}
+		const SsaFunction::BasicBlock& block = blocks[b];
+		if (block.exit == SsaFunction::RETURN) {
+			code.push_back(Instruction{ RETURN, -1, -1, -1 });
+		}
+		else if (block.exit == SsaFunction::JUMP) {
+			moves(b, block.succs[0]);
+			toDst.push_back({ code.size(), block.succs[0] });
+			code.push_back(Instruction{ JUMP, -1, -1, -1 });
+		}
+		else {
+			size_t at = code.size();
+			code.push_back(Instruction{ BRANCH, -1, reg[f.find(block.condition)], -1 });
+			// An edge with moves goes through a stub doing them, after the block
+			int stubs[2]{ -1, -1 };
+			for (int s = 0; s < 2; ++s) {
+				if (!needsMoves(block.succs[s])) {
+					(s == 0 ? toDst : toB).push_back({ at, block.succs[s] });
+					continue;
+				}
+				stubs[s] = static_cast<int>(code.size());
+				moves(b, block.succs[s]);
+				toDst.push_back({ code.size(), block.succs[s] });
+				code.push_back(Instruction{ JUMP, -1, -1, -1 });
+			}
+			if (stubs[0] >= 0) {
+				code[at].dst = stubs[0];
+			}
+			if (stubs[1] >= 0) {
+				code[at].b = stubs[1];
+			}
+		}
+	}
+	for (auto& t : toDst) {
+		code[t.first].dst = label[t.second];
+	}
+	for (auto& t : toB) {
+		code[t.first].b = label[t.second];
+	}
+}
+
+void SsaEvaluator::run(const SsaCode& program, Program* progNode) {
+	// The arrays are in the slots of their variables
+	ST.reserveSlots(progNode->getSlotNames());
+	std::vector<Value> R(program.registers);
+	std::vector<char> assigned(program.registers, 1);
+	for (auto& c : program.constants) {
+		R[c.first] = c.second;
+	}
+	for (int r : program.undefined) {
+		assigned[r] = 0;
+	}
+	const SsaCode::Instruction* code = program.code.data();
+	size_t pc = 0;
+	for (;;) {
+		const SsaCode::Instruction& i = code[pc++];
+		switch (i.op)
+		{
+		case SsaCode::ADD:
+			R[i.dst] = Value::add(R[i.a], R[i.b]);
+			if (__builtin_expect(!R[i.dst].isSmall(), 0)) {
+				chargeBig(R[i.dst]);
+			}
+			break;
+		case SsaCode::SUB:
+			R[i.dst] = Value::sub(R[i.a], R[i.b]);
+			if (__builtin_expect(!R[i.dst].isSmall(), 0)) {
+				chargeBig(R[i.dst]);
+			}
+			break;
+		case SsaCode::MUL:
+			R[i.dst] = Value::mul(R[i.a], R[i.b]);
+			if (__builtin_expect(!R[i.dst].isSmall(), 0)) {
+				chargeBig(R[i.dst]);
+			}
+			break;
+		case SsaCode::DIV:
+			if (R[i.b].isZero()) {
+				throw SemanticError("ZERO DIVISION");
+			}
+			R[i.dst] = Value::div(R[i.a], R[i.b]);
+			if (__builtin_expect(!R[i.dst].isSmall(), 0)) {
+				chargeBig(R[i.dst]);
+			}
+			break;
+		case SsaCode::LT:
+			R[i.dst] = Value(Value::compare(R[i.a], R[i.b]) < 0 ? 1L : 0L);
+			break;
+		case SsaCode::GT:
+			R[i.dst] = Value(Value::compare(R[i.a], R[i.b]) > 0 ? 1L : 0L);
+			break;
+		case SsaCode::EQ:
+			R[i.dst] = Value(Value::compare(R[i.a], R[i.b]) == 0 ? 1L : 0L);
+			break;
+		case SsaCode::MOVE:
+			R[i.dst] = R[i.a];
+			assigned[i.dst] = assigned[i.a];
+			break;
+		case SsaCode::INPUT:
+			Out.beforeInput();
+			R[i.dst] = In.next();
+			break;
+		case SsaCode::ARRAY_EXPR:
+			R[i.dst] = IntArray::evaluate(ST, i.arrayExpr, i.a >= 0 ? R[i.a] : Value());
+			if (i.arrayExpr->getKind() == ArrayExpr::SUM) {
+				chargeArray(i.arrayExpr->getArray());
+			}
+			break;
+		case SsaCode::CHECK:
+			if (!assigned[i.a]) {
+				throw SemanticError("Variable does not exist");
+			}
+			break;
+		case SsaCode::PRINT:
+			Out.writeValue(R[i.a]);
+			break;
+		case SsaCode::ARRAY_STMT:
+			IntArray::execute(ST, i.arrayStmt, i.a >= 0 ? R[i.a] : Value(), i.b >= 0 ? R[i.b] : Value());
+			if (i.arrayStmt->getKind() != ArrayStmt::PUT) {
+				chargeArray(i.arrayStmt->getArray());
+			}
+			break;
+		case SsaCode::STEP:
+			if (__builtin_expect(--fuel == 0, 0)) {
+				refuel();
+			}
+			break;
+		case SsaCode::JUMP:
+			pc = i.dst;
+			break;
+		case SsaCode::BRANCH:
+			pc = R[i.a].isZero() ? i.b : i.dst;
+			break;
+		case SsaCode::RETURN:
+			return;
+		}
+	}
+}
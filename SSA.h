@@ -0,0 +1,231 @@
+#ifndef SSA_H
+#define SSA_H
+
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "Visitor.h"
+
+// Intermediate representation of a program as a control-flow graph in SSA form, built from a program analysed by
+// the AssignmentAnalysis (the variables are identified by their slots).
+// Every instruction defines at most one value, named by the index of the instruction, and every value is defined
+// once: a SET or an INPUT gives its variable a new value, and where paths join (after an IF, at the header of a
+// WHILE, after the operands of AND and OR) the values of a variable are merged by a PHI. The construction renames
+// the variables on the fly (Braun et al., "Simple and Efficient Construction of Static Single Assignment Form"):
+// a SET copying a variable or a constant makes no instruction, so chains of copies are propagated as they are
+// built, and the PHIs whose operands are all the same value are removed.
+// AND, OR and NOT become branches, so conditions are only comparisons. Integer arrays stay in the SymbolTable:
+// their statements and reads are instructions with side effects, ordered like the other ones.
+// The evaluation steps of the budget are STEP instructions where the evaluators enter a block, and a read that the
+// AssignmentAnalysis could not prove assigned is a CHECK of its value, which fails on the value of a variable
+// never assigned (UNDEF). The children of a PARALLEL statement run one after the other.
+// optimize runs, on the whole graph:
+// - sparse conditional constant propagation (Wegman and Zadeck): values proven constant become constants, and
+//   branches on constants and the blocks no execution reaches are removed;
+// - global value numbering over the dominator tree: an operation computing the same value as one dominating it
+//   (the same operation on the same values) is replaced by it, as is a CHECK or a division already done;
+// - the removal of the PHIs made trivial, of the CHECKs of values that are always assigned and of the operations
+//   whose value is unused and which cannot fail.
+// SsaCode translates the graph out of SSA form into the register code, the register code run by the SsaEvaluator.
+class SsaFunction : public Visitor {
+public:
+	enum Op {
+		CONST, UNDEF, PHI, ADD, SUB, MUL, DIV, LT, GT, EQ, INPUT, ARRAY_EXPR,
+		// No value
+		CHECK, PRINT, ARRAY_STMT, STEP
+	};
+
+	struct Instr {
+		Op op;
+		int block;
+		std::vector<int> args;	// For a PHI, one per predecessor of the block, in order
+		Value constant{};	// CONST
+		ArrayStmt* arrayStmt = nullptr;	// ARRAY_STMT: its operands are the args (operand, then element)
+		ArrayExpr* arrayExpr = nullptr;	// ARRAY_EXPR: the index is the arg, if any
+		bool dead = false;
+	};
+
+	enum Exit { JUMP, BRANCH, RETURN };
+
+	struct BasicBlock {
+		std::vector<int> phis;
+		std::vector<int> instrs;
+		std::vector<int> preds;
+		Exit exit = RETURN;
+		int condition = -1;	// BRANCH: to succs[0] if the value is not zero, otherwise to succs[1]
+		std::vector<int> succs;
+		bool sealed = false;	// All the predecessors are known (during the construction)
+		bool dead = false;
+	};
+
+	// What the optimizations did, for the report of --dump-ssa.
+	struct Report {
+		size_t lowered = 0;	// Instructions and PHIs after the construction
+		size_t constants = 0;	// Values replaced by constants
+		size_t branches = 0;	// Branches on constants removed
+		size_t blocks = 0;	// Unreachable blocks removed
+		size_t numbered = 0;	// Redundant operations removed by the value numbering
+		size_t checks = 0;	// CHECKs of values always assigned removed
+		size_t unused = 0;	// Unused operations removed
+		size_t remaining = 0;	// Instructions and PHIs left
+	};
+
+	// Builds the graph of the program; throws std::logic_error if the program was not analysed.
+	explicit SsaFunction(Program* progNode);
+
+	void optimize();
+
+	const Report& getReport() const {
+		return report;
+	}
+
+	// Writes the graph, one instruction per line.
+	void write(std::ostream& os) const;
+	void writeReport(std::ostream& os) const;
+
+	const std::vector<Instr>& getInstrs() const {
+		return instrs;
+	}
+
+	const std::vector<BasicBlock>& getBlocks() const {
+		return blocks;
+	}
+
+	// The value standing for v after the replacements.
+	int find(int v) const;
+
+	// Blocks reachable from the entry, in reverse postorder.
+	std::vector<int> reversePostorder() const;
+
+	void visitProgram(Program* progNode) override;
+	void visitBlock(Block* blockNode) override;
+
+	void visitPrintStmt(PrintStmt* printStmtNode) override;
+	void visitSetStmt(SetStmt* setStmtNode) override;
+	void visitInputStmt(InputStmt* inputStmtNode) override;
+	void visitWhileStmt(WhileStmt* whileStmtNode) override;
+	void visitIfStmt(IfStmt* ifStmtNode) override;
+	void visitParallelStmt(ParallelStmt* parallelStmtNode) override;
+	void visitArrayStmt(ArrayStmt* arrayStmtNode) override;
+
+	// The numeric expressions leave their value in "result".
+	void visitOperator(Operator* opNode) override;
+	void visitNumber(Number* numNode) override;
+	void visitVariable(Variable* varNode) override;
+	void visitArrayExpr(ArrayExpr* arrayExprNode) override;
+
+	// The boolean expressions branch from the current block to "onTrue" or "onFalse".
+	void visitRelOp(RelOp* relOpNode) override;
+	void visitBoolConst(BoolConst* boolConstNode) override;
+	void visitBoolOp(BoolOp* boolOpNode) override;
+
+private:
+	// Construction
+	int newBlock();
+	int emit(Op op, std::vector<int> args = {});
+	int constant(const Value& v);
+	int lowerValue(NumExpr* e);
+	void lowerCondition(BoolExpr* c, int t, int f);
+	void jump(int from, int to);
+	void branch(int from, int condition, int t, int f);
+	void seal(int b);
+	void writeVariable(int slot, int b, int value);
+	int readVariable(int slot, int b);
+	int readVariableRecursive(int slot, int b);
+	int addPhiOperands(int slot, int phi);
+	int tryRemoveTrivialPhi(int phi);
+	void replace(int v, int by);
+
+	// Optimizations
+	void propagateConstants();
+	void numberValues();
+	void removeTrivialPhis();
+	void removeChecks();
+	void removeUnused();
+	void removePredecessor(int b, size_t index);
+	std::vector<int> dominators(const std::vector<int>& order) const;
+	bool hasValue(const Instr& i) const {
+		return i.op < CHECK;
+	}
+
+	std::vector<Instr> instrs;
+	std::vector<BasicBlock> blocks;
+	mutable std::vector<int> forward;	// Replacements, followed by find
+	std::vector<std::unordered_map<int, int>> definitions;	// By block: the value of every slot defined in it
+	std::vector<std::unordered_map<int, int>> incompletePhis;	// By block, for the blocks not sealed yet
+	std::vector<int> undefs;	// The UNDEF of every slot, -1 until needed
+	size_t slots = 0;
+	int current = 0;	// Block being built
+	int result = -1;
+	int onTrue = -1, onFalse = -1;
+	Report report;
+};
+
+// The register code of an SsaFunction out of SSA form: every value has a register, the PHIs are moves on the edges
+// that reach their block, and the blocks are laid out in reverse postorder with explicit jumps.
+// The registers of the constants are set before the code starts.
+struct SsaCode {
+	enum Op { ADD, SUB, MUL, DIV, LT, GT, EQ, MOVE, INPUT, ARRAY_EXPR, CHECK, PRINT, ARRAY_STMT, STEP, JUMP, BRANCH, RETURN };
+
+	struct Instruction {
+		Op op;
+		int dst;	// Register written, or the target of a JUMP or of a true BRANCH
+		int a, b;	// Registers read (-1 if none), or the target of a false BRANCH (b)
+		ArrayStmt* arrayStmt = nullptr;
+		ArrayExpr* arrayExpr = nullptr;
+	};
+
+	std::vector<Instruction> code;
+	size_t registers = 0;
+	std::vector<std::pair<int, Value>> constants;	// Registers set before the code starts
+	std::vector<int> undefined;	// Registers of UNDEF values, and of PHIs until a move sets them
+
+	explicit SsaCode(const SsaFunction& f);
+};
+
+// Evaluator running the SsaCode of a program, with the semantics and the errors of the EvaluatorVisitor.
+// The numeric variables live in registers, the arrays in the SymbolTable; every register has a flag telling if it
+// holds an assigned value, checked by CHECK and copied by MOVE.
+class SsaEvaluator {
+public:
+	SsaEvaluator(SymbolTable& S, OutputSink& O, InputSource& I) : ST{ S }, Out{ O }, In{ I } {}
+
+	// The steps and the time of the evaluation are limited by the meter (see BudgetMeter), which starts now.
+	void setBudget(BudgetMeter& M) {
+		Meter = &M;
+		fuel = M.start();
+	}
+
+	// Runs the code of the program, whose arrays have the slots of its AssignmentAnalysis.
+	void run(const SsaCode& code, Program* progNode);
+
+private:
+	static constexpr unsigned long long UNMETERED = ~0ULL;
+
+	__attribute__((noinline, cold)) void refuel() {
+		fuel = Meter ? Meter->refill() : UNMETERED;
+	}
+
+	// The work of an operation that computed a big integer, or went through a whole array (see BudgetMeter::charge).
+	__attribute__((noinline, cold)) void chargeBig(const Value& v) {
+		if (Meter) {
+			Meter->chargeValue(v.bytesHeld());
+		}
+	}
+
+	void chargeArray(const Variable* array) {
+		if (Meter) {
+			Meter->charge(ST.getArray(array->getSlot()).size());
+		}
+	}
+
+	BudgetMeter* Meter = nullptr;
+	unsigned long long fuel = UNMETERED;
+	SymbolTable& ST;
+	OutputSink& Out;
+	InputSource& In;
+};
+
+#endif
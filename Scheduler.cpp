@@ -0,0 +1,213 @@
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <stdexcept>
+#include <sys/epoll.h>
+#include <unistd.h>
+
+#include "Scheduler.h"
+#include "Exceptions.h"
+
+Script& Scheduler::spawn(const ProgramHandle& program, OutputSink& out) {
+	std::unique_ptr<Script> owned{ new Script(nextId++, program, out, limits) };
+	Script& script = *owned;
+	scripts.emplace(&script, std::move(owned));
+	script.task = execute(script);
+	ready.push_back(script.task.getHandle());
+	++running;
+	return script;
+}
+
+ScriptTask Scheduler::execute(Script& script) {
+	Session::Status status = Session::OK;
+	std::string message;
+	try {
+		if (script.metered) {
+			script.evaluator.setBudget(script.meter);
+		}
+		script.evaluator.start(script.program->getProgram());
+		while (!script.evaluator.resume(SLICE)) {
+			if (script.evaluator.waitingForInput()) {
+				co_await InputAwaiter{ script };
+			}
+			else {
+				co_await YieldAwaiter{ *this };
+			}
+		}
+	}
+	catch (SemanticError& se) {
+		status = Session::SEMANTIC_ERROR;
+		message = se.what();
+	}
+	catch (BudgetExceeded& be) {
+		status = Session::BUDGET_EXCEEDED;
+		message = be.what();
+	}
+	catch (std::exception& exc) {
+		status = Session::OTHER_ERROR;
+		message = exc.what();
+	}
+	try {
+		script.sink.flush();
+	}
+	catch (std::exception& exc) {
+		// As in Session::run, a failure of the output is reported only if the run itself succeeded
+		if (status == Session::OK) {
+			status = Session::OTHER_ERROR;
+			message = exc.what();
+		}
+	}
+	script.result.status = status;
+	script.result.message = message;
+	script.done = true;
+	--running;
+	for (std::function<void(Script&)>& f : finishCallbacks) {
+		f(script);
+	}
+}
+
+void Scheduler::wake(Script& script) {
+	if (script.waiting && script.in.ready()) {
+		ready.push_back(script.waiting);
+		script.waiting = nullptr;
+	}
+}
+
+void Scheduler::feed(Script& script, const char* data, size_t n) {
+	script.in.feed(data, n);
+	wake(script);
+}
+
+void Scheduler::close(Script& script) {
+	script.in.close();
+	wake(script);
+}
+
+void Scheduler::runReady() {
+	while (!ready.empty()) {
+		std::coroutine_handle<> h = ready.front();
+		ready.pop_front();
+		h.resume();
+	}
+}
+
+bool Scheduler::runTurn() {
+	// The scripts made ready during the turn wait for the next one
+	for (size_t n = ready.size(); n > 0; --n) {
+		std::coroutine_handle<> h = ready.front();
+		ready.pop_front();
+		h.resume();
+	}
+	return !ready.empty();
+}
+
+void Scheduler::remove(Script& script) {
+	if (!script.done) {
+		throw std::logic_error("Cannot remove a script that is still running");
+	}
+	scripts.erase(&script);
+}
+
+EpollDriver::EpollDriver(Scheduler& s) : scheduler{ s }, epollFd{ ::epoll_create1(EPOLL_CLOEXEC) }, buffer(READ_SIZE) {
+	if (epollFd < 0) {
+		throw std::runtime_error(std::string("Cannot create the epoll instance: ") + std::strerror(errno));
+	}
+	scheduler.onFinish([this](Script& script) {
+		auto d = descriptors.find(&script);
+		if (d != descriptors.end()) {
+			release(d->second);
+		}
+	});
+}
+
+EpollDriver::~EpollDriver() {
+	while (!watched.empty()) {
+		release(watched.begin()->first);
+	}
+	::close(epollFd);
+}
+
+void EpollDriver::watch(int fd, Script& script) {
+	int flags = ::fcntl(fd, F_GETFL);
+	epoll_event event{};
+	event.events = EPOLLIN;
+	event.data.fd = fd;
+	if (flags < 0 || ::fcntl(fd, F_SETFL, flags | O_NONBLOCK) < 0 || ::epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &event) < 0) {
+		throw std::runtime_error(std::string("Cannot watch the input: ") + std::strerror(errno));
+	}
+	watched[fd] = &script;
+	descriptors[&script] = fd;
+}
+
+void EpollDriver::watch(int fd, std::function<void()> onReady) {
+	epoll_event event{};
+	event.events = EPOLLIN;
+	event.data.fd = fd;
+	if (::epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &event) < 0) {
+		throw std::runtime_error(std::string("Cannot watch the descriptor: ") + std::strerror(errno));
+	}
+	handlers[fd] = std::move(onReady);
+}
+
+void EpollDriver::unwatch(int fd) {
+	if (handlers.erase(fd)) {
+		::epoll_ctl(epollFd, EPOLL_CTL_DEL, fd, nullptr);
+	}
+}
+
+void EpollDriver::release(int fd) {
+	auto w = watched.find(fd);
+	descriptors.erase(w->second);
+	watched.erase(w);
+	::epoll_ctl(epollFd, EPOLL_CTL_DEL, fd, nullptr);
+	::close(fd);
+}
+
+void EpollDriver::run() {
+	while (scheduler.live() != 0 && poll(-1)) {
+	}
+}
+
+bool EpollDriver::poll(int timeoutMs) {
+	bool busy = scheduler.runTurn();
+	if (watched.empty() && handlers.empty()) {
+		return busy;
+	}
+	epoll_event events[64];
+	int n;
+	do {
+		n = ::epoll_wait(epollFd, events, 64, busy ? 0 : timeoutMs);
+	} while (n < 0 && errno == EINTR);
+	if (n < 0) {
+		throw std::runtime_error(std::string("Cannot wait for the input: ") + std::strerror(errno));
+	}
+	for (int i = 0; i < n; ++i) {
+		int fd = events[i].data.fd;
+		auto h = handlers.find(fd);
+		if (h != handlers.end()) {
+			// A copy: the function may unwatch the descriptor
+			std::function<void()> onReady = h->second;
+			onReady();
+			continue;
+		}
+		auto w = watched.find(fd);
+		if (w == watched.end()) {
+			continue;
+		}
+		Script& script = *w->second;
+		// Everything available is read at once, the descriptor being non-blocking
+		ssize_t r;
+		do {
+			r = ::read(fd, buffer.data(), buffer.size());
+			if (r > 0) {
+				scheduler.feed(script, buffer.data(), r);
+			}
+		} while (r > 0 || (r < 0 && errno == EINTR));
+		if (r == 0 || errno != EAGAIN) {
+			// End of file, or an error that ends the input as well
+			release(fd);
+			scheduler.close(script);
+		}
+	}
+	return true;
+}
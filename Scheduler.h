@@ -0,0 +1,258 @@
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include <coroutine>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include "Session.h"
+#include "SymbolTable.h"
+#include "StackEvaluator.h"
+
+class Scheduler;
+
+// Coroutine running a Script: it suspends when the program waits for input and at the end of every time slice.
+// The handle is owned by the Script, which destroys it.
+class ScriptTask
+{
+public:
+	struct promise_type {
+		ScriptTask get_return_object() {
+			return ScriptTask{ std::coroutine_handle<promise_type>::from_promise(*this) };
+		}
+
+		// Started by the Scheduler, and kept after the end until the Script is destroyed.
+		std::suspend_always initial_suspend() noexcept {
+			return {};
+		}
+
+		std::suspend_always final_suspend() noexcept {
+			return {};
+		}
+
+		void return_void() {}
+
+		// The body reports every error in the result of the Script.
+		void unhandled_exception() {
+			std::terminate();
+		}
+	};
+
+	ScriptTask() = default;
+	explicit ScriptTask(std::coroutine_handle<promise_type> h) : handle{ h } {}
+
+	ScriptTask(ScriptTask&& other) noexcept : handle{ other.handle } {
+		other.handle = nullptr;
+	}
+
+	ScriptTask& operator=(ScriptTask&& other) noexcept {
+		std::swap(handle, other.handle);
+		return *this;
+	}
+
+	~ScriptTask() {
+		if (handle) {
+			handle.destroy();
+		}
+	}
+
+	std::coroutine_handle<> getHandle() const {
+		return handle;
+	}
+
+private:
+	std::coroutine_handle<promise_type> handle;
+};
+
+// A program run by a Scheduler, with its own SymbolTable, evaluator and input.
+// Its INPUT statements read what the host feeds to the Scheduler: a program waiting for a value is suspended,
+// without a thread, until the value arrives.
+class Script
+{
+public:
+	Script(const Script&) = delete;
+	Script& operator=(const Script&) = delete;
+
+	size_t getId() const {
+		return id;
+	}
+
+	bool finished() const {
+		return done;
+	}
+
+	bool waitingForInput() const {
+		return waiting != nullptr;
+	}
+
+	// The result of the run, meaningful once the script is finished.
+	const Session::Result& getResult() const {
+		return result;
+	}
+
+private:
+	friend class Scheduler;
+	Script(size_t i, const ProgramHandle& p, OutputSink& out, const ExecutionLimits& limits)
+		: id{ i }, program{ p }, limited{ out, limits.maxOutputBytes }, sink{ limits.maxOutputBytes ? static_cast<OutputSink&>(limited) : out },
+		meter{ limits }, evaluator{ ST, sink, in }, metered{ limits.metered() } {}
+
+	size_t id;
+	ProgramHandle program;
+	SymbolTable ST;
+	FeedInputSource in;
+	LimitedOutputSink limited;
+	OutputSink& sink;
+	BudgetMeter meter;
+	StackEvaluator evaluator;
+	bool metered;
+	bool done = false;
+	Session::Result result;
+	std::coroutine_handle<> waiting;	// Set while the script waits for input
+	ScriptTask task;
+};
+
+// Single-threaded event loop running many programs at once: every program is a Script whose coroutine runs
+// until its program waits for input, ends, or has run a slice of SLICE statements (then the other ready scripts
+// get their turn, so a long computation does not starve them).
+// The host supplies the input with feed and close, which make a waiting script ready again, and calls runReady
+// or runTurn; the EpollDriver does both for scripts reading file descriptors.
+// The scheduler and its scripts must be used by a single thread.
+class Scheduler
+{
+public:
+	static constexpr unsigned long long SLICE = 1 << 12;
+
+	// Every script is subject to the limits (the time limit counts the time spent waiting for input too).
+	explicit Scheduler(const ExecutionLimits& l = ExecutionLimits()) : limits{ l } {}
+
+	Scheduler(const Scheduler&) = delete;
+	Scheduler& operator=(const Scheduler&) = delete;
+
+	// Starts a program compiled by a Session: the script is ready and runs at the next runReady.
+	// It prints to "out", which must outlive the script. The script lives until it is removed.
+	Script& spawn(const ProgramHandle& program, OutputSink& out);
+
+	// Appends data to the input of a script, or ends it; a script waiting for input becomes ready if it can go on.
+	void feed(Script& script, const char* data, size_t n);
+	void close(Script& script);
+
+	// Runs the ready scripts, and those they make ready, until every script is finished or waiting for input.
+	void runReady();
+
+	// Gives a turn to the scripts ready now: each runs until it waits for input, ends or has run a slice.
+	// Returns true if scripts are still ready.
+	bool runTurn();
+
+	// Adds a function called with every script that finishes, right after its output is flushed.
+	// The functions are called in the order they were added, and must not remove the script.
+	void onFinish(std::function<void(Script&)> f) {
+		finishCallbacks.push_back(std::move(f));
+	}
+
+	// Destroys a finished script.
+	void remove(Script& script);
+
+	// Scripts not finished yet.
+	size_t live() const {
+		return running;
+	}
+
+	size_t size() const {
+		return scripts.size();
+	}
+
+private:
+	// Suspends the script until its input is ready.
+	struct InputAwaiter {
+		Script& script;
+
+		bool await_ready() {
+			return script.in.ready();
+		}
+
+		void await_suspend(std::coroutine_handle<> h) {
+			script.waiting = h;
+		}
+
+		void await_resume() {}
+	};
+
+	// Suspends the script at the back of the ready queue.
+	struct YieldAwaiter {
+		Scheduler& scheduler;
+
+		bool await_ready() {
+			return false;
+		}
+
+		void await_suspend(std::coroutine_handle<> h) {
+			scheduler.ready.push_back(h);
+		}
+
+		void await_resume() {}
+	};
+
+	// Body of the coroutine of a script.
+	ScriptTask execute(Script& script);
+	// Makes the script ready if it waits for input that is now ready.
+	void wake(Script& script);
+
+	ExecutionLimits limits;
+	std::unordered_map<const Script*, std::unique_ptr<Script>> scripts;
+	std::deque<std::coroutine_handle<>> ready;
+	std::vector<std::function<void(Script&)>> finishCallbacks;
+	size_t nextId = 1;
+	size_t running = 0;
+};
+
+// Feeds the scripts of a Scheduler from file descriptors, waiting for data with epoll, so that a single thread
+// serves any number of programs reading pipes or sockets. The host can wait for its own descriptors in the same
+// loop (see Server).
+class EpollDriver
+{
+public:
+	static constexpr size_t READ_SIZE = 1 << 16;
+
+	// The driver must live as long as the scheduler, which calls it when a script finishes.
+	// Throws std::runtime_error if the epoll instance cannot be created.
+	explicit EpollDriver(Scheduler& s);
+	~EpollDriver();
+
+	EpollDriver(const EpollDriver&) = delete;
+	EpollDriver& operator=(const EpollDriver&) = delete;
+
+	// The input of the script is read from the descriptor, which is made non-blocking and is closed by the driver
+	// at its end of file or when the script finishes. Throws std::runtime_error if it cannot be watched.
+	void watch(int fd, Script& script);
+
+	// Calls the function, on the thread polling, whenever the descriptor is readable or closed, until unwatch.
+	// The descriptor is left as it is and stays the caller's. Throws std::runtime_error if it cannot be watched.
+	void watch(int fd, std::function<void()> onReady);
+	void unwatch(int fd);
+
+	// Runs the scripts until all of them are finished, waiting for data whenever no script is ready.
+	// Returns early if the scripts left wait for input that no watched descriptor can bring.
+	void run();
+
+	// Gives a turn to the ready scripts, then waits up to timeoutMs milliseconds (-1: no limit) for data, or only
+	// looks for it if scripts are still ready, and feeds it; a long computation thus lets the descriptors be served
+	// between its slices. Returns false if there was nothing to wait for and no script is ready.
+	bool poll(int timeoutMs);
+
+private:
+	// Stops watching a descriptor and closes it.
+	void release(int fd);
+
+	Scheduler& scheduler;
+	int epollFd;
+	std::unordered_map<int, Script*> watched;
+	std::unordered_map<const Script*, int> descriptors;
+	std::unordered_map<int, std::function<void()>> handlers;	// Descriptors watched for the host
+	std::vector<char> buffer;
+};
+
+#endif
@@ -0,0 +1,280 @@
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <fcntl.h>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "Server.h"
+
+volatile std::sig_atomic_t Server::stopRequested = 0;
+int Server::wakeFd = -1;
+
+namespace {
+	std::string response(int code, const std::string& hash, const std::string& output, const std::string& message) {
+		std::ostringstream header;
+		header << code << " " << (hash.empty() ? "-" : hash) << " " << output.size() << " " << message.size() << "\n";
+		return header.str() + output + message;
+	}
+}
+
+Server::Server(const std::string& socketPath, size_t cacheBudget, unsigned jobs, const ExecutionLimits& limits)
+	: path{ socketPath }, listenFd{ -1 }, cache{ cacheBudget }, session{ limits }, scheduler{ limits }, driver{ scheduler }, pool{ jobs } {
+	sockaddr_un address{};
+	if (path.size() >= sizeof(address.sun_path)) {
+		throw std::runtime_error("Socket path too long: " + path);
+	}
+	address.sun_family = AF_UNIX;
+	std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+	// Non-blocking: run accepts until no connection is left
+	listenFd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+	if (listenFd < 0) {
+		throw std::runtime_error(std::string("Cannot create the socket: ") + std::strerror(errno));
+	}
+	::unlink(path.c_str());
+	if (::bind(listenFd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0 || ::listen(listenFd, SOMAXCONN) < 0) {
+		std::string error = std::strerror(errno);
+		::close(listenFd);
+		throw std::runtime_error("Cannot listen on " + path + ": " + error);
+	}
+	wakeFd = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	if (wakeFd < 0) {
+		std::string error = std::strerror(errno);
+		::close(listenFd);
+		throw std::runtime_error("Cannot create the eventfd: " + error);
+	}
+	// After the EpollDriver, which stops reading the input of the script
+	scheduler.onFinish([this](Script& script) { finished(script); });
+}
+
+Server::~Server() {
+	// The tasks of the pool post to the eventfd
+	pool.wait();
+	int fd = wakeFd;
+	wakeFd = -1;
+	::close(fd);
+	::close(listenFd);
+	::unlink(path.c_str());
+}
+
+void Server::requestStop() {
+	stopRequested = 1;
+	wake();
+}
+
+void Server::wake() {
+	// write is async-signal-safe; it fails only if the counter is full, which wakes run as well
+	std::uint64_t one = 1;
+	if (wakeFd >= 0) {
+		ssize_t n = ::write(wakeFd, &one, sizeof(one));
+		(void)n;
+	}
+}
+
+void Server::run() {
+	driver.watch(listenFd, [this] { accept(); });
+	driver.watch(wakeFd, [this] { runPosted(); });
+	while (!stopRequested) {
+		driver.poll(-1);
+	}
+	driver.unwatch(listenFd);
+	driver.unwatch(wakeFd);
+	for (auto& c : connections) {
+		::shutdown(c.first, SHUT_RDWR);
+	}
+}
+
+void Server::accept() {
+	for (;;) {
+		int fd = ::accept4(listenFd, nullptr, nullptr, SOCK_CLOEXEC);
+		if (fd < 0) {
+			// EAGAIN: no connection left
+			if (errno == EINTR || errno == ECONNABORTED) {
+				continue;
+			}
+			if (errno != EAGAIN && errno != EWOULDBLOCK) {
+				std::cerr << "Cannot accept a connection: " << std::strerror(errno) << std::endl;
+			}
+			return;
+		}
+		connections[fd].reset(new Connection(fd));
+		driver.watch(fd, [this, fd] { dispatch(fd); });
+	}
+}
+
+void Server::dispatch(int fd) {
+	// The connection belongs to the pool until its request is answered
+	driver.unwatch(fd);
+	Connection* connection = connections[fd].get();
+	pool.submit([this, fd, connection] {
+		bool open = false;
+		try {
+			std::string header;
+			if (connection->readLine(header)) {
+				std::string reply = handle(fd, *connection, header);
+				if (reply.empty()) {
+					return;	// The connection belongs to the script of a STREAM request
+				}
+				connection->writeAll(reply);
+				// The response to a STREAM request ends the connection, even if its program did not compile
+				open = header.compare(0, 6, "STREAM") != 0;
+			}
+		}
+		catch (std::exception& exc) {
+			// A broken connection or request ends only that connection
+			if (!stopRequested) {
+				std::cerr << exc.what() << std::endl;
+			}
+		}
+		post([this, fd, open] { resume(fd, open); });
+	});
+}
+
+void Server::resume(int fd, bool open) {
+	if (!open) {
+		connections.erase(fd);
+	}
+	else if (connections[fd]->buffered()) {
+		// The client sent the next request along with the previous one
+		dispatch(fd);
+	}
+	else {
+		driver.watch(fd, [this, fd] { dispatch(fd); });
+	}
+}
+
+void Server::post(std::function<void()> f) {
+	{
+		std::lock_guard<std::mutex> lock{ postedMutex };
+		posted.push_back(std::move(f));
+	}
+	wake();
+}
+
+void Server::runPosted() {
+	std::uint64_t count;
+	if (::read(wakeFd, &count, sizeof(count)) < 0) {
+		return;	// EAGAIN: already read along with a previous wake
+	}
+	std::vector<std::function<void()>> ready;
+	{
+		std::lock_guard<std::mutex> lock{ postedMutex };
+		ready.swap(posted);
+	}
+	for (std::function<void()>& f : ready) {
+		f();
+	}
+}
+
+std::string Server::handle(int fd, Connection& connection, const std::string& header) {
+	std::istringstream fields{ header };
+	std::string kind, hash;
+	size_t sourceLength = 0, inputLength = 0;
+	fields >> kind;
+	if (kind == "RUN") {
+		fields >> sourceLength >> inputLength;
+	}
+	else if (kind == "HASH") {
+		fields >> hash >> inputLength;
+	}
+	else if (kind == "STREAM") {
+		fields >> sourceLength;
+	}
+	if (!fields || (kind != "RUN" && kind != "HASH" && kind != "STREAM") || sourceLength > MAX_MESSAGE || inputLength > MAX_MESSAGE) {
+		throw std::runtime_error("Malformed request: " + header);
+	}
+	std::string source, input;
+	connection.readExact(sourceLength, source);
+	connection.readExact(inputLength, input);
+
+	ProgramHandle program;
+	if (kind != "HASH") {
+		hash = ProgramCache::hashOf(source);
+		program = cache.find(hash, &source);
+		if (!program) {
+			Session::Result r = session.compile(source, program);
+			if (!r.ok()) {
+				return response(FAILED, hash, "", std::string(Session::statusName(r.status)) + "\n" + r.message);
+			}
+			cache.insert(hash, source, program);
+		}
+	}
+	else {
+		program = cache.find(hash);
+		if (!program) {
+			return response(UNKNOWN_PROGRAM, hash, "", "Unknown program");
+		}
+	}
+	if (kind == "STREAM") {
+		post([this, fd, program, hash] { stream(fd, program, hash); });
+		return std::string();
+	}
+	Session::Result r = session.run(program, input);
+	if (!r.ok()) {
+		return response(FAILED, hash, r.output, std::string(Session::statusName(r.status)) + "\n" + r.message);
+	}
+	return response(OK, hash, r.output, "");
+}
+
+void Server::stream(int fd, const ProgramHandle& program, const std::string& hash) {
+	std::unique_ptr<Stream> owned{ new Stream{ fd, hash, {} } };
+	Script& script = scheduler.spawn(program, owned->output);
+	streams.emplace(&script, std::move(owned));
+	// The beginning of the input may have come along with the source
+	std::string received;
+	connections[fd]->readBuffered(received);
+	scheduler.feed(script, received.data(), received.size());
+	// The driver reads the rest from a descriptor of its own, which it closes
+	int input = ::fcntl(fd, F_DUPFD_CLOEXEC, 0);
+	try {
+		if (input < 0) {
+			throw std::runtime_error(std::string("Cannot read the input: ") + std::strerror(errno));
+		}
+		driver.watch(input, script);
+	}
+	catch (std::exception& exc) {
+		if (input >= 0) {
+			::close(input);
+		}
+		std::cerr << exc.what() << std::endl;
+		scheduler.close(script);
+	}
+}
+
+void Server::finished(Script& script) {
+	auto s = streams.find(&script);
+	if (s == streams.end()) {
+		return;
+	}
+	int fd = s->second->fd;
+	const Session::Result& r = script.getResult();
+	std::string reply = r.ok() ? response(OK, s->second->hash, s->second->output.str(), "")
+		: response(FAILED, s->second->hash, s->second->output.str(), std::string(Session::statusName(r.status)) + "\n" + r.message);
+	// Not removed by its own callback
+	post([this, &script] {
+		scheduler.remove(script);
+		streams.erase(&script);
+	});
+	Connection* connection = connections[fd].get();
+	pool.submit([this, fd, connection, reply] {
+		try {
+			// The driver made the socket non-blocking
+			int flags = ::fcntl(fd, F_GETFL);
+			if (flags >= 0) {
+				::fcntl(fd, F_SETFL, flags & ~O_NONBLOCK);
+			}
+			connection->writeAll(reply);
+		}
+		catch (std::exception& exc) {
+			if (!stopRequested) {
+				std::cerr << exc.what() << std::endl;
+			}
+		}
+		post([this, fd] { resume(fd, false); });
+	});
+}
@@ -0,0 +1,111 @@
+#ifndef SERVER_H
+#define SERVER_H
+
+#include <csignal>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "Connection.h"
+#include "OutputSink.h"
+#include "ProgramCache.h"
+#include "Scheduler.h"
+#include "Session.h"
+#include "ThreadPool.h"
+
+// Resident interpreter (--serve mode): runs the programs sent on a Unix domain socket,
+// keeping the compiled programs in a ProgramCache so that a program sent again is neither tokenized nor parsed.
+// The thread calling run waits for the connections and their requests with an EpollDriver, and hands every request
+// to a thread of the pool: an idle connection holds no thread. The cached programs are shared read-only by all of them.
+//
+// Protocol, any number of requests per connection:
+//   RUN <source length> <input length>\n<source><input>
+//   HASH <hash> <input length>\n<input>
+// or, ending the connection:
+//   STREAM <source length>\n<source><input>
+// where the input goes on until the client shuts down its side of the connection. The program of a STREAM request
+// runs as a Script of the Scheduler of run, reading the input as it arrives: while it waits for more, it holds
+// no thread.
+// Every request gets the response:
+//   <code> <hash> <output length> <message length>\n<output><message>
+// where code is 0 on success, 1 on error (the message holds the heading and the description of the error
+// on two lines, as printed by the interpreter) and 2 if a HASH request names a program that is not cached:
+// the client has to send the source again.
+class Server
+{
+public:
+	static constexpr int OK = 0;
+	static constexpr int FAILED = 1;
+	static constexpr int UNKNOWN_PROGRAM = 2;
+
+	// Largest source or input accepted in a request.
+	static constexpr size_t MAX_MESSAGE = 64 << 20;
+
+	// Listens on the socket path (an old socket file there is replaced).
+	// Every run is subject to the limits. Throws std::runtime_error if the socket cannot be created.
+	Server(const std::string& socketPath, size_t cacheBudget, unsigned jobs, const ExecutionLimits& limits = ExecutionLimits());
+
+	// Waits for the requests being handled, then closes the connections and removes the socket.
+	~Server();
+
+	Server(const Server&) = delete;
+	Server& operator=(const Server&) = delete;
+
+	// Accepts connections and serves their requests until requestStop is called, then shuts the open connections
+	// down: a request being received or answered fails, a run in progress goes on until its end (see ~Server).
+	void run();
+
+	// Can be called from a signal handler, on any thread.
+	static void requestStop();
+
+	const ProgramCache& getCache() const {
+		return cache;
+	}
+
+private:
+	// A STREAM request being run: its connection and the output of its script.
+	struct Stream {
+		int fd;
+		std::string hash;
+		StringOutputSink output;
+	};
+
+	// Accepts the pending connections.
+	void accept();
+	// Hands the connection to the pool, which handles its next request.
+	void dispatch(int fd);
+	// Back from the pool: waits for the next request of the connection, or closes it.
+	void resume(int fd, bool open);
+	// Handles one request of the connection, whose header line is given; returns the response, or an empty string
+	// for a STREAM request whose program compiled: its script is started on the thread of run.
+	std::string handle(int fd, Connection& connection, const std::string& header);
+	// Starts the script of a STREAM request, which reads its input from the connection.
+	void stream(int fd, const ProgramHandle& program, const std::string& hash);
+	// Sends the response of a finished STREAM request and closes its connection.
+	void finished(Script& script);
+	// Runs the function on the thread of run; can be called from any thread.
+	void post(std::function<void()> f);
+	void runPosted();
+	// Wakes the thread of run.
+	static void wake();
+
+	static volatile std::sig_atomic_t stopRequested;
+	static int wakeFd;	// eventfd watched by run
+
+	std::string path;
+	int listenFd;
+	ProgramCache cache;
+	Session session;
+	std::unordered_map<const Script*, std::unique_ptr<Stream>> streams;	// Before the scheduler, whose scripts use them
+	Scheduler scheduler;
+	EpollDriver driver;
+	std::unordered_map<int, std::unique_ptr<Connection>> connections;
+	std::mutex postedMutex;
+	std::vector<std::function<void()>> posted;
+	ThreadPool pool;	// Destroyed first: its tasks use the members above
+};
+
+#endif
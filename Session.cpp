@@ -0,0 +1,125 @@
+#include <sstream>
+#include <vector>
+
+#include "Session.h"
+#include "Exceptions.h"
+#include "token.h"
+#include "tokenizer.h"
+#include "Parser.h"
+#include "Visitor.h"
+#include "SymbolTable.h"
+#include "PassManager.h"
+
+namespace {
+	Session::Result failure(Session::Status status, const char* message) {
+		Session::Result r;
+		r.status = status;
+		r.message = message;
+		return r;
+	}
+}
+
+const char* Session::statusName(Status status) {
+	switch (status) {
+	case OK:
+		return "OK";
+	case LEXICAL_ERROR:
+		return "Lexical Error";
+	case PARSE_ERROR:
+		return "Error in parsing";
+	case SEMANTIC_ERROR:
+		return "Error in semantic analysis";
+	case BUDGET_EXCEEDED:
+		return "Execution budget exceeded";
+	default:
+		return "Error";
+	}
+}
+
+Session::Result Session::compile(std::istream& source, ProgramHandle& program) const {
+	std::shared_ptr<CompiledProgram> compiled{ new CompiledProgram() };
+	try {
+		tokenizer tokenize;
+		std::vector<token> tokens = tokenize(source);
+		Parser parse{ compiled->NEM, compiled->BEM, compiled->SM, compiled->BM, compiled->PM };
+		// Optimized, resolved and bounded once, before the program is shared; the warnings are left to the
+		// interpreter's command line
+		PassContext context{ compiled->NEM, compiled->BEM, compiled->SM, compiled->BM, compiled->PM, parse(tokens) };
+		PassManager passes{ level };
+		passes.run(context);
+		compiled->program = context.program;
+		compiled->tokenCount = tokens.size();
+	}
+	catch (LexicalError& le) {
+		return failure(LEXICAL_ERROR, le.what());
+	}
+	catch (ParseError& pe) {
+		return failure(PARSE_ERROR, pe.what());
+	}
+	catch (SemanticError& se) {
+		// A PARALLEL statement whose blocks are not independent
+		return failure(SEMANTIC_ERROR, se.what());
+	}
+	catch (std::exception& exc) {
+		return failure(OTHER_ERROR, exc.what());
+	}
+	program = std::move(compiled);
+	return Result();
+}
+
+Session::Result Session::compile(const std::string& source, ProgramHandle& program) const {
+	std::istringstream stream{ source };
+	return compile(stream, program);
+}
+
+Session::Result Session::run(const ProgramHandle& program, OutputSink& out, InputSource& in) const {
+	Status status = OK;
+	std::string message;
+	try {
+		SymbolTable ST;
+		LimitedOutputSink limited{ out, limits.maxOutputBytes };
+		EvaluatorVisitor evaluator{ ST, limits.maxOutputBytes ? limited : out, in };
+		BudgetMeter meter{ limits };
+		if (limits.metered()) {
+			evaluator.setBudget(meter);
+		}
+		program->getProgram()->accept(&evaluator);
+	}
+	catch (SemanticError& se) {
+		status = SEMANTIC_ERROR;
+		message = se.what();
+	}
+	catch (BudgetExceeded& be) {
+		status = BUDGET_EXCEEDED;
+		message = be.what();
+	}
+	catch (std::exception& exc) {
+		status = OTHER_ERROR;
+		message = exc.what();
+	}
+	try {
+		out.flush();
+	}
+	catch (std::exception& exc) {
+		// A failure of the output is reported only if the run itself succeeded
+		if (status == OK) {
+			status = OTHER_ERROR;
+			message = exc.what();
+		}
+	}
+	return status == OK ? Result() : failure(status, message.c_str());
+}
+
+Session::Result Session::run(const ProgramHandle& program, std::function<void(const Value&)> output, std::function<bool(Value&)> input) const {
+	CallbackOutputSink out{ std::move(output) };
+	CallbackInputSource in{ std::move(input) };
+	return run(program, out, in);
+}
+
+Session::Result Session::run(const ProgramHandle& program, const std::string& input) const {
+	StringOutputSink out;
+	StringInputSource in{ input };
+	Result r = run(program, out, in);
+	r.output = out.str();
+	return r;
+}
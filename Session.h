@@ -0,0 +1,102 @@
+#ifndef SESSION_H
+#define SESSION_H
+
+#include <functional>
+#include <istream>
+#include <memory>
+#include <string>
+
+#include "Manager.h"
+#include "Program.h"
+#include "Value.h"
+#include "OutputSink.h"
+#include "InputSource.h"
+#include "Budget.h"
+#include "PassManager.h"
+
+// A program compiled by a Session: the syntax tree and the Managers owning its nodes.
+// It is immutable once compiled (the evaluators never modify the tree), so a single compiled program
+// can be shared and run any number of times, also by several threads at the same time.
+class CompiledProgram
+{
+public:
+	CompiledProgram(const CompiledProgram&) = delete;
+	CompiledProgram& operator=(const CompiledProgram&) = delete;
+
+	// The root of the syntax tree, to be visited by an evaluator.
+	Program* getProgram() const {
+		return program;
+	}
+
+	size_t getTokenCount() const {
+		return tokenCount;
+	}
+
+	// Bytes held by the syntax tree.
+	size_t bytesHeld() const {
+		return NEM.bytesHeld() + BEM.bytesHeld() + SM.bytesHeld() + BM.bytesHeld() + PM.bytesHeld();
+	}
+
+private:
+	friend class Session;
+	CompiledProgram() = default;
+
+	// The managers are declared before the program, whose nodes they own.
+	BlockManager BM;
+	BoolExprManager BEM;
+	NumExprManager NEM;
+	StatementManager SM;
+	ProgramManager PM;
+	Program* program = nullptr;
+	size_t tokenCount = 0;
+};
+
+// Shared handle of a compiled program.
+typedef std::shared_ptr<const CompiledProgram> ProgramHandle;
+
+// Entry point of the interpreter as a library.
+// A Session compiles source text into a ProgramHandle and runs it with a fresh SymbolTable every time,
+// with the output and the input given by the caller. Errors are returned as results instead of being printed.
+// Every run is subject to the limits given to the Session, if any.
+class Session
+{
+public:
+	// OK, or the phase that failed; the names are the headings printed by the interpreter.
+	enum Status { OK, LEXICAL_ERROR, PARSE_ERROR, SEMANTIC_ERROR, BUDGET_EXCEEDED, OTHER_ERROR };
+
+	// The programs are compiled with the passes of the optimization level (see PassManager).
+	explicit Session(const ExecutionLimits& l = ExecutionLimits(), int o = PassManager::DEFAULT_LEVEL) : limits{ l }, level{ o } {}
+
+	struct Result {
+		Status status = OK;
+		std::string message;	// Description of the error
+		std::string output;	// Output of the run, for the run functions working on strings
+
+		bool ok() const {
+			return status == OK;
+		}
+	};
+
+	static const char* statusName(Status status);
+
+	// Compiles a program; on success "program" refers to the new compiled program.
+	Result compile(std::istream& source, ProgramHandle& program) const;
+	Result compile(const std::string& source, ProgramHandle& program) const;
+
+	// Runs a compiled program with its own SymbolTable.
+	// What was printed before an error is flushed to the sink before the error is returned.
+	Result run(const ProgramHandle& program, OutputSink& out, InputSource& in) const;
+
+	// Runs a compiled program calling "output" for every printed value and "input" for every value read
+	// ("input" returns false when there are no more values).
+	Result run(const ProgramHandle& program, std::function<void(const Value&)> output, std::function<bool(Value&)> input) const;
+
+	// Runs a compiled program reading the whitespace separated values of "input"; the output is returned in the result.
+	Result run(const ProgramHandle& program, const std::string& input) const;
+
+private:
+	ExecutionLimits limits;
+	int level;
+};
+
+#endif
@@ -0,0 +1,338 @@
+#include "Specializer.h"
+
+namespace {
+	// Collects the variables (and arrays) a statement assigns, and whether it reads the input.
+	class Assigned : public Visitor {
+	public:
+		std::set<std::string> names;
+		bool input = false;
+
+		void visitProgram(Program*) override {}
+		void visitBlock(Block* blockNode) override {
+			for (auto i : blockNode->getVector()) {
+				i->accept(this);
+			}
+		}
+		void visitPrintStmt(PrintStmt*) override {}
+		void visitSetStmt(SetStmt* setStmtNode) override {
+			names.insert(setStmtNode->getVar()->getVarId());
+		}
+		void visitInputStmt(InputStmt* inputStmtNode) override {
+			names.insert(inputStmtNode->getVar()->getVarId());
+			input = true;
+		}
+		void visitWhileStmt(WhileStmt* whileStmtNode) override {
+			whileStmtNode->getReppeter()->accept(this);
+		}
+		void visitIfStmt(IfStmt* ifStmtNode) override {
+			ifStmtNode->getIfBlock()->accept(this);
+			ifStmtNode->getElseBlock()->accept(this);
+		}
+		void visitParallelStmt(ParallelStmt* parallelStmtNode) override {
+			for (auto i : parallelStmtNode->getChildren()) {
+				i->accept(this);
+			}
+		}
+		void visitArrayStmt(ArrayStmt* arrayStmtNode) override {
+			names.insert(arrayStmtNode->getArray()->getVarId());
+		}
+		void visitOperator(Operator*) override {}
+		void visitNumber(Number*) override {}
+		void visitVariable(Variable*) override {}
+		void visitArrayExpr(ArrayExpr*) override {}
+		void visitRelOp(RelOp*) override {}
+		void visitBoolConst(BoolConst*) override {}
+		void visitBoolOp(BoolOp*) override {}
+	};
+}
+
+// The residual nodes are all new, even where they are copies: the analyses annotate the variables and the
+// operators, which must not be shared by two places of the program (unrolled iterations are copies of one body).
+
+Program* Specializer::operator()(Program* progNode, const std::vector<Value>& known) {
+	environment.clear();
+	inputs = known;
+	consumed = 0;
+	inputsOpen = true;
+	unrolled = 0;
+	size = 0;
+	stopped = false;
+	depth = 0;
+	progNode->accept(this);
+	return program;
+}
+
+void Specializer::visitProgram(Program* progNode) {
+	program = PM.makeProgram(residualBlock(progNode->getBlock()));
+}
+
+void Specializer::visitBlock(Block* blockNode) {
+	// The statements are specialized into the current list
+	for (auto i : blockNode->getVector()) {
+		if (stopped) {
+			return;
+		}
+		i->accept(this);
+	}
+}
+
+Block* Specializer::residualBlock(Block* blockNode) {
+	std::vector<Statement*> outer;
+	outer.swap(statements);
+	blockNode->accept(this);
+	if (statements.empty()) {
+		// As the grammar has no empty block, a statement without effect: (WHILE FALSE (BLOCK (PRINT 0)))
+		Block* never = BM.makeBlock();
+		never->pushback(counted(SM.makePrintStmt(counted(NEM.makeNumber(Value())))));
+		emit(SM.makeWhileStmt(counted(BEM.makeBoolConst(false)), counted(never)), blockNode->getVector().front());
+	}
+	Block* block = counted(BM.makeBlock());
+	for (auto i : statements) {
+		block->pushback(i);
+	}
+	statements.swap(outer);
+	return block;
+}
+
+void Specializer::emit(Statement* stmt, const Statement* at, bool fails) {
+	stmt->setLocation(at->getLine(), at->getColumn());
+	statements.push_back(counted(stmt));
+	// Nothing after it runs
+	stopped = stopped || (fails && depth == 0);
+}
+
+void Specializer::materialize(const std::set<std::string>& names, const Statement* at) {
+	for (const std::string& name : names) {
+		auto found = environment.find(name);
+		if (found == environment.end()) {
+			// Never assigned: it stays so at run time until the statement assigns it
+			environment.emplace(name, Binding{ false, Value() });
+		}
+		else if (found->second.known) {
+			emit(SM.makeSetStmt(fresh(name), constant(found->second.value)), at);
+			found->second = Binding{ false, Value() };
+		}
+	}
+}
+
+void Specializer::enterResidual(Statement* stmt) {
+	Assigned assigned;
+	stmt->accept(&assigned);
+	if (assigned.input) {
+		inputsOpen = false;
+	}
+	materialize(assigned.names, stmt);
+}
+
+NumExpr* Specializer::constant(const Value& v) {
+	return counted(NEM.makeNumber(v), 1 + v.bytesHeld() / sizeof(long));
+}
+
+Variable* Specializer::fresh(const std::string& name) {
+	return counted(static_cast<Variable*>(NEM.makeVariable(name)));
+}
+
+NumExpr* Specializer::residual(const Num& n) {
+	return n.known ? constant(n.value) : n.residual;
+}
+
+BoolExpr* Specializer::residual(const Cond& c) {
+	return c.known ? counted(BEM.makeBoolConst(c.value)) : c.residual;
+}
+
+void Specializer::visitPrintStmt(PrintStmt* printStmtNode) {
+	Num n = specialized(printStmtNode->getPrinter());
+	emit(SM.makePrintStmt(residual(n)), printStmtNode, n.fails);
+}
+
+void Specializer::visitSetStmt(SetStmt* setStmtNode) {
+	Num n = specialized(setStmtNode->getSetter());
+	const std::string& name = setStmtNode->getVar()->getVarId();
+	if (depth == 0 && n.known) {
+		environment[name] = Binding{ true, n.value };
+		return;
+	}
+	environment[name] = Binding{ false, Value() };
+	emit(SM.makeSetStmt(fresh(name), residual(n)), setStmtNode, n.fails);
+}
+
+void Specializer::visitInputStmt(InputStmt* inputStmtNode) {
+	const std::string& name = inputStmtNode->getVar()->getVarId();
+	if (depth == 0 && inputsOpen && consumed < inputs.size()) {
+		environment[name] = Binding{ true, inputs[consumed++] };
+		return;
+	}
+	// The rest of the input is read at run time
+	inputsOpen = false;
+	environment[name] = Binding{ false, Value() };
+	emit(SM.makeInputStmt(fresh(name)), inputStmtNode);
+}
+
+void Specializer::visitWhileStmt(WhileStmt* whileStmtNode) {
+	if (depth == 0) {
+		// Every iteration whose condition is known is unrolled, up to the limit
+		for (;;) {
+			Cond c = specialized(whileStmtNode->getCondition());
+			if (c.known && !c.value) {
+				return;
+			}
+			if (!c.known || unrolled >= limit || size >= limit) {
+				break;
+			}
+			unrolled++;
+			whileStmtNode->getReppeter()->accept(this);
+			if (stopped) {
+				return;
+			}
+		}
+	}
+	enterResidual(whileStmtNode);
+	depth++;
+	// Specialized again: the variables the loop assigns are unknown now
+	Cond c = specialized(whileStmtNode->getCondition());
+	if (!c.known || c.value) {
+		Block* body = residualBlock(whileStmtNode->getReppeter());
+		depth--;
+		emit(SM.makeWhileStmt(residual(c), body), whileStmtNode, c.fails);
+		return;
+	}
+	depth--;
+}
+
+void Specializer::visitIfStmt(IfStmt* ifStmtNode) {
+	Cond c = specialized(ifStmtNode->getCondition());
+	if (c.known) {
+		(c.value ? ifStmtNode->getIfBlock() : ifStmtNode->getElseBlock())->accept(this);
+		return;
+	}
+	// The condition is evaluated before the SETs of the known values, which do not change it
+	enterResidual(ifStmtNode);
+	depth++;
+	Block* ifBlock = residualBlock(ifStmtNode->getIfBlock());
+	Block* elseBlock = residualBlock(ifStmtNode->getElseBlock());
+	depth--;
+	emit(SM.makeIfStmt(c.residual, ifBlock, elseBlock), ifStmtNode, c.fails);
+}
+
+void Specializer::visitParallelStmt(ParallelStmt* parallelStmtNode) {
+	enterResidual(parallelStmtNode);
+	depth++;
+	std::vector<Block*> children;
+	for (auto i : parallelStmtNode->getChildren()) {
+		children.push_back(residualBlock(i));
+	}
+	depth--;
+	emit(SM.makeParallelStmt(children), parallelStmtNode);
+}
+
+void Specializer::visitArrayStmt(ArrayStmt* arrayStmtNode) {
+	// The arrays are never known
+	environment[arrayStmtNode->getArray()->getVarId()] = Binding{ false, Value() };
+	if (arrayStmtNode->isElementWise()) {
+		emit(SM.makeArrayStmt(arrayStmtNode->getKind(), fresh(arrayStmtNode->getArray()->getVarId()),
+			fresh(arrayStmtNode->getLeft()->getVarId()), fresh(arrayStmtNode->getRight()->getVarId())), arrayStmtNode);
+		return;
+	}
+	Num operand = specialized(arrayStmtNode->getOperand());
+	Num element = arrayStmtNode->getElement() ? specialized(arrayStmtNode->getElement()) : Num{ false, Value(), nullptr };
+	emit(SM.makeArrayStmt(arrayStmtNode->getKind(), fresh(arrayStmtNode->getArray()->getVarId()), residual(operand),
+		element.residual || element.known ? residual(element) : nullptr), arrayStmtNode, operand.fails || element.fails);
+}
+
+void Specializer::visitOperator(Operator* opNode) {
+	Num l = specialized(opNode->getLeft());
+	Num r = specialized(opNode->getRight());
+	Operator::OpCode op = opNode->getOpCode();
+	// A division by zero is left to fail at run time
+	bool fails = l.fails || r.fails || (op == Operator::DIV && r.known && r.value.isZero());
+	if (l.known && r.known && !fails) {
+		Value v;
+		switch (op)
+		{
+		case Operator::ADD:
+			v = Value::add(l.value, r.value);
+			break;
+		case Operator::SUB:
+			v = Value::sub(l.value, r.value);
+			break;
+		case Operator::MUL:
+			v = Value::mul(l.value, r.value);
+			break;
+		default:
+			v = Value::div(l.value, r.value);
+			break;
+		}
+		if (v.bytesHeld() <= MAX_CONSTANT_BYTES) {
+			number = Num{ true, v, nullptr };
+			return;
+		}
+	}
+	number = Num{ false, Value(), counted(NEM.makeOperator(op, residual(l), residual(r))), fails };
+}
+
+void Specializer::visitNumber(Number* numNode) {
+	number = Num{ true, numNode->getValue(), nullptr };
+}
+
+void Specializer::visitVariable(Variable* varNode) {
+	auto found = environment.find(varNode->getVarId());
+	if (found != environment.end() && found->second.known) {
+		number = Num{ true, found->second.value, nullptr };
+		return;
+	}
+	// Unknown, or never assigned: then the read fails at run time
+	number = Num{ false, Value(), fresh(varNode->getVarId()), found == environment.end() };
+}
+
+void Specializer::visitArrayExpr(ArrayExpr* arrayExprNode) {
+	Num index = arrayExprNode->getIndex() ? specialized(arrayExprNode->getIndex()) : Num{ false, Value(), nullptr };
+	NumExpr* read = NEM.makeArrayExpr(arrayExprNode->getKind(), fresh(arrayExprNode->getArray()->getVarId()),
+		arrayExprNode->getIndex() ? residual(index) : nullptr);
+	number = Num{ false, Value(), counted(read), index.fails };
+}
+
+void Specializer::visitRelOp(RelOp* relOpNode) {
+	Num l = specialized(relOpNode->getLeft());
+	Num r = specialized(relOpNode->getRight());
+	if (l.known && r.known) {
+		int cmp = Value::compare(l.value, r.value);
+		switch (relOpNode->getRelOpCode())
+		{
+		case RelOp::LT:
+			condition = Cond{ true, cmp < 0, nullptr };
+			return;
+		case RelOp::GT:
+			condition = Cond{ true, cmp > 0, nullptr };
+			return;
+		default:
+			condition = Cond{ true, cmp == 0, nullptr };
+			return;
+		}
+	}
+	condition = Cond{ false, false, counted(BEM.makeRelOp(relOpNode->getRelOpCode(), residual(l), residual(r))), l.fails || r.fails };
+}
+
+void Specializer::visitBoolConst(BoolConst* boolConstNode) {
+	condition = Cond{ true, boolConstNode->getValue(), nullptr };
+}
+
+void Specializer::visitBoolOp(BoolOp* boolOpNode) {
+	Cond l = specialized(boolOpNode->getLeft());
+	BoolOp::BoolOpCode op = boolOpNode->getBoolOpCode();
+	if (op == BoolOp::NOT) {
+		condition = l.known ? Cond{ true, !l.value, nullptr } : Cond{ false, false, counted(BEM.makeBoolOp(op, l.residual)), l.fails };
+		return;
+	}
+	// A known left operand decides, or leaves the right one as the result, as the short-circuit evaluation does
+	if (l.known) {
+		if (l.value == (op == BoolOp::OR)) {
+			condition = l;
+			return;
+		}
+		condition = specialized(boolOpNode->getRight());
+		return;
+	}
+	// The right operand may not be evaluated: only the left one always is
+	Cond r = specialized(boolOpNode->getRight());
+	condition = Cond{ false, false, counted(BEM.makeBoolOp(op, l.residual, residual(r))), l.fails };
+}
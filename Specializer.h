@@ -0,0 +1,149 @@
+#ifndef SPECIALIZER_H
+#define SPECIALIZER_H
+
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "Visitor.h"
+#include "Manager.h"
+
+// Partial evaluation of a program with respect to the values of its first INPUT statements.
+// The Specializer runs the program symbolically: the variables whose values it knows are propagated into the
+// expressions, the INPUTs reading the known values and the SETs of known values disappear, the IFs whose conditions
+// are known become the statements of their branches and the WHILEs whose conditions stay known are unrolled.
+// What it cannot decide is residual: a statement depending on an unknown value is kept with the known values
+// replaced by numbers, and the IF or WHILE whose condition is unknown is kept whole (as is a PARALLEL statement),
+// after SETs giving the known values to the variables it assigns. Inside such a statement nothing assigned is known,
+// so its SETs and INPUTs stay, and the known inputs left are not used once an INPUT is residual.
+// An operation that fails (a division by zero, the read of a variable never assigned) is left to fail at run time,
+// at the same point: the residual program prints the same values and fails with the same error as the program
+// run on the known values followed by the rest of the input. It takes other evaluation steps (see BudgetMeter).
+// Outside the residual statements, a statement that always fails ends the residual program.
+// The unrolling stops when the residual program reaches the size limit, in nodes and words of the constants, or
+// after as many iterations in all; a known value larger than MAX_CONSTANT_BYTES is not known, its operation is
+// residual.
+// The residual program is made of new nodes and of nodes of the program, which stays valid; the analyses must
+// run on it (see PassManager).
+class Specializer : public Visitor {
+public:
+	static constexpr size_t DEFAULT_LIMIT = 100000;
+	static constexpr size_t MAX_CONSTANT_BYTES = 4096;
+
+	// The limit bounds both the loop iterations unrolled in all and the size of the residual program.
+	Specializer(NumExprManager& N, BoolExprManager& B, StatementManager& S, BlockManager& K, ProgramManager& P,
+		size_t l = DEFAULT_LIMIT) : NEM{ N }, BEM{ B }, SM{ S }, BM{ K }, PM{ P }, limit{ l } {}
+
+	// The residual program of the program when its first INPUTs read the known values.
+	// It reads the input that follows the known values it used (see getConsumed).
+	Program* operator()(Program* progNode, const std::vector<Value>& known);
+
+	// Known values read by INPUTs of the program, of the last run.
+	size_t getConsumed() const {
+		return consumed;
+	}
+
+	// Loop iterations unrolled, of the last run.
+	size_t getUnrolled() const {
+		return unrolled;
+	}
+
+	void visitProgram(Program* progNode) override;
+	void visitBlock(Block* blockNode) override;
+
+	void visitPrintStmt(PrintStmt* printStmtNode) override;
+	void visitSetStmt(SetStmt* setStmtNode) override;
+	void visitInputStmt(InputStmt* inputStmtNode) override;
+	void visitWhileStmt(WhileStmt* whileStmtNode) override;
+	void visitIfStmt(IfStmt* ifStmtNode) override;
+	void visitParallelStmt(ParallelStmt* parallelStmtNode) override;
+	void visitArrayStmt(ArrayStmt* arrayStmtNode) override;
+
+	void visitOperator(Operator* opNode) override;
+	void visitNumber(Number* numNode) override;
+	void visitVariable(Variable* varNode) override;
+	void visitArrayExpr(ArrayExpr* arrayExprNode) override;
+
+	void visitRelOp(RelOp* relOpNode) override;
+	void visitBoolConst(BoolConst* boolConstNode) override;
+	void visitBoolOp(BoolOp* boolOpNode) override;
+
+private:
+	// A variable not in the environment was never assigned.
+	struct Binding {
+		bool known;
+		Value value;
+	};
+
+	// The result of an expression: its value if known, otherwise the residual expression, which may always fail
+	// when it is evaluated.
+	struct Num {
+		bool known;
+		Value value;
+		NumExpr* residual;
+		bool fails = false;
+	};
+
+	struct Cond {
+		bool known;
+		bool value;
+		BoolExpr* residual;
+		bool fails = false;
+	};
+
+	Num specialized(NumExpr* e) {
+		e->accept(this);
+		return number;
+	}
+
+	Cond specialized(BoolExpr* c) {
+		c->accept(this);
+		return condition;
+	}
+
+	NumExpr* constant(const Value& v);
+	Variable* fresh(const std::string& name);
+	NumExpr* residual(const Num& n);
+	BoolExpr* residual(const Cond& c);
+	// The statements of the block specialized into a new block.
+	Block* residualBlock(Block* blockNode);
+	// Appends a residual statement, at the position of the statement it comes from; a statement that always fails
+	// ends the program if it is not in a residual statement.
+	void emit(Statement* stmt, const Statement* at, bool fails = false);
+	// Counts a residual node in the size of the residual program.
+	template<typename Node>
+	Node* counted(Node* node, size_t words = 1) {
+		size += words;
+		return node;
+	}
+	// Gives their known values to the variables, which are unknown from now on.
+	void materialize(const std::set<std::string>& names, const Statement* at);
+	// Before a statement kept whole (IF, WHILE or PARALLEL): nothing it assigns is known from then on.
+	void enterResidual(Statement* stmt);
+
+	NumExprManager& NEM;
+	BoolExprManager& BEM;
+	StatementManager& SM;
+	BlockManager& BM;
+	ProgramManager& PM;
+	size_t limit;
+
+	std::unordered_map<std::string, Binding> environment;
+	std::vector<Value> inputs;
+	size_t consumed = 0;
+	bool inputsOpen = true;	// False once an INPUT is residual
+	size_t unrolled = 0;
+	size_t size = 0;	// Of the residual program
+	bool stopped = false;	// After a statement that always fails
+	int depth = 0;	// Residual statements being specialized: their bodies may run any number of times
+
+	// Results of the last visit
+	Num number{};
+	Cond condition{};
+	Program* program = nullptr;
+	// Statements of the block being specialized
+	std::vector<Statement*> statements;
+};
+
+#endif
@@ -0,0 +1,363 @@
+#include "StackEvaluator.h"
+
+void StackEvaluator::start(Program* progNode) {
+	top = 0;
+	NumExprAccumulator.clear();
+	BoolExprAccumulator.clear();
+	progNode->accept(this);
+}
+
+bool StackEvaluator::resume(unsigned long long statements) {
+	try {
+		while (top != 0) {
+			// Every case changes the frame before visiting a child, as the visit may push a frame and move the others.
+			// A child evaluated on the spot pushes no frame, so the case goes on with the next phase.
+			Frame& f = frames[top - 1];
+			switch (f.kind)
+			{
+			case BLOCK: {
+				const std::vector<Statement*>& stmts = f.block->getVector();
+				if (f.phase == stmts.size()) {
+					pop();
+					break;
+				}
+				// Suspension point: between two statements
+				if (statements == 0) {
+					return false;
+				}
+				--statements;
+				Statement* next = stmts[f.phase++];
+				if (f.phase == stmts.size()) {
+					// The last statement replaces the block
+					pop();
+				}
+				next->accept(this);
+				break;
+			}
+			case PRINT:
+				if (f.phase++ == 0 && !onTheSpot(f.print->getPrinter())) {
+					break;
+				}
+				pop();
+				Out.writeValue(NumExprAccumulator.peek()); NumExprAccumulator.pop();
+				break;
+			case SET:
+				if (f.phase++ == 0 && !onTheSpot(f.set->getSetter())) {
+					break;
+				}
+				assign(f.set->getVar(), NumExprAccumulator.peek()); NumExprAccumulator.pop();
+				pop();
+				break;
+			case INPUT:
+				// Suspension point: the value has not arrived yet
+				if (!In.ready()) {
+					return false;
+				}
+				assign(f.input->getVar(), In.next());
+				pop();
+				break;
+			case WHILE:
+				if (f.phase == 0) {
+					f.phase = 1;
+					f.whileStmt->getCondition()->accept(this);
+				}
+				else if (popCondition()) {
+					// After the body the condition is evaluated again
+					f.phase = 0;
+					f.whileStmt->getReppeter()->accept(this);
+				}
+				else {
+					pop();
+				}
+				break;
+			case IF:
+				if (f.phase++ == 0) {
+					f.ifStmt->getCondition()->accept(this);
+				}
+				else {
+					// The chosen block replaces the IF
+					IfStmt* ifStmt = f.ifStmt;
+					pop();
+					(popCondition() ? ifStmt->getIfBlock() : ifStmt->getElseBlock())->accept(this);
+				}
+				break;
+			case PARALLEL: {
+				// The children run one after the other, the last one replacing the statement
+				const std::vector<Block*>& children = f.parallel->getChildren();
+				Block* next = children[f.phase++];
+				if (f.phase == children.size()) {
+					pop();
+				}
+				next->accept(this);
+				break;
+			}
+			case ARRAY_STMT:
+				// ARRAY and PUT: the size, or the index and then the element
+				if (f.phase == 0) {
+					f.phase = 1;
+					if (!onTheSpot(f.arrayStmt->getOperand())) {
+						break;
+					}
+				}
+				if (f.phase == 1) {
+					f.phase = 2;
+					if (f.arrayStmt->getElement() && !onTheSpot(f.arrayStmt->getElement())) {
+						break;
+					}
+				}
+				{
+					ArrayStmt* arrayStmt = f.arrayStmt;
+					pop();
+					if (arrayStmt->getElement()) {
+						IntArray::execute(ST, arrayStmt, NumExprAccumulator.peek(1), NumExprAccumulator.peek());
+						NumExprAccumulator.pop();
+					}
+					else {
+						IntArray::execute(ST, arrayStmt, NumExprAccumulator.peek(), Value());
+						chargeArray(arrayStmt->getArray());
+					}
+					NumExprAccumulator.pop();
+				}
+				break;
+			case ARRAY_EXPR:
+				// GET: the index is replaced by the element
+				if (f.phase++ == 0 && !onTheSpot(f.arrayExpr->getIndex())) {
+					break;
+				}
+				{
+					ArrayExpr* arrayExpr = f.arrayExpr;
+					pop();
+					Value& index = NumExprAccumulator.peek();
+					index = IntArray::evaluate(ST, arrayExpr, index);
+				}
+				break;
+			case OPERATOR:
+				if (f.phase == 0) {
+					f.phase = 1;
+					if (!onTheSpot(f.op->getLeft())) {
+						break;
+					}
+				}
+				if (f.phase == 1) {
+					f.phase = 2;
+					if (!onTheSpot(f.op->getRight())) {
+						break;
+					}
+				}
+				{
+					int evaluation = f.op->getEvaluation();
+					pop();
+					Value& lval = NumExprAccumulator.peek(1);
+					const Value& rval = NumExprAccumulator.peek();
+					switch (evaluation)
+					{
+					case Operator::ADD_UNCHECKED:
+						Value::addToUnchecked(lval, rval); break;
+					case Operator::SUB_UNCHECKED:
+						Value::subToUnchecked(lval, rval); break;
+					case Operator::MUL_UNCHECKED:
+						Value::mulToUnchecked(lval, rval); break;
+					case Operator::DIV_UNCHECKED:
+						Value::divToUnchecked(lval, rval); break;
+					case Operator::ADD:
+						Value::addTo(lval, rval); break;
+					case Operator::SUB:
+						Value::subTo(lval, rval); break;
+					case Operator::MUL:
+						Value::mulTo(lval, rval); break;
+					case Operator::DIV:
+						if (rval.isZero()) {
+							throw SemanticError("ZERO DIVISION");
+						}
+						Value::divTo(lval, rval); break;
+					default:
+						throw SemanticError("INVALID operation");
+					}
+					if (__builtin_expect(!lval.isSmall(), 0)) {
+						chargeBig(lval);
+					}
+					NumExprAccumulator.pop();
+				}
+				break;
+			case RELOP:
+				if (f.phase == 0) {
+					f.phase = 1;
+					if (!onTheSpot(f.relOp->getLeft())) {
+						break;
+					}
+				}
+				if (f.phase == 1) {
+					f.phase = 2;
+					if (!onTheSpot(f.relOp->getRight())) {
+						break;
+					}
+				}
+				{
+					RelOp::RelOpCode code = f.relOp->getRelOpCode();
+					pop();
+					int cmp = Value::compare(NumExprAccumulator.peek(1), NumExprAccumulator.peek());
+					NumExprAccumulator.pop(); NumExprAccumulator.pop();
+					switch (code)
+					{
+					case RelOp::EQ:
+						BoolExprAccumulator.push_back(cmp == 0); break;
+					case RelOp::LT:
+						BoolExprAccumulator.push_back(cmp < 0); break;
+					case RelOp::GT:
+						BoolExprAccumulator.push_back(cmp > 0); break;
+					default:
+						throw SemanticError("INVALID realtional operator");
+					}
+				}
+				break;
+			case BOOLOP:
+				if (f.phase == 0) {
+					f.phase = 1;
+					f.boolOp->getLeft()->accept(this);
+				}
+				else {
+					BoolOp* boolOp = f.boolOp;
+					pop();
+					bool lval = popCondition();
+					switch (boolOp->getBoolOpCode())
+					{
+					case BoolOp::NOT:
+						BoolExprAccumulator.push_back(!lval); break;
+					case BoolOp::AND:
+					case BoolOp::OR:
+						if (lval == (boolOp->getBoolOpCode() == BoolOp::OR)) {
+							// Short circuit: the left operand decides
+							BoolExprAccumulator.push_back(lval);
+						}
+						else {
+							// Otherwise the result is the right operand, which replaces the operation
+							boolOp->getRight()->accept(this);
+						}
+						break;
+					default:
+						throw SemanticError("INVALID boolean operator");
+					}
+				}
+				break;
+			}
+		}
+	}
+	catch (...) {
+		top = 0;
+		NumExprAccumulator.clear();
+		BoolExprAccumulator.clear();
+		throw;
+	}
+	return true;
+}
+
+void StackEvaluator::refuel() {
+	fuel = Meter ? Meter->refill() : UNLIMITED;
+}
+
+void StackEvaluator::chargeBig(const Value& v) {
+	if (Meter) {
+		Meter->chargeValue(v.bytesHeld());
+	}
+}
+
+void StackEvaluator::chargeArray(const Variable* array) {
+	if (Meter) {
+		Meter->charge(ST.getArray(array->getSlot()).size());
+	}
+}
+
+void StackEvaluator::visitProgram(Program* progNode) {
+	ST.reserveSlots(progNode->getSlotNames());
+	progNode->getBlock()->accept(this);
+}
+
+void StackEvaluator::visitBlock(Block* blockNode) {
+	// Entering a block is a step of the execution budget, as in the EvaluatorVisitor
+	step();
+	push(BLOCK).block = blockNode;
+}
+
+void StackEvaluator::visitPrintStmt(PrintStmt* printStmtNode) {
+	push(PRINT).print = printStmtNode;
+}
+
+void StackEvaluator::visitSetStmt(SetStmt* setStmtNode) {
+	push(SET).set = setStmtNode;
+}
+
+void StackEvaluator::visitInputStmt(InputStmt* inputStmtNode) {
+	// Nothing to evaluate first: the value is read on the spot, unless it has to be waited for
+	Out.beforeInput();
+	if (!In.ready()) {
+		push(INPUT).input = inputStmtNode;
+		return;
+	}
+	assign(inputStmtNode->getVar(), In.next());
+}
+
+void StackEvaluator::visitWhileStmt(WhileStmt* whileStmtNode) {
+	push(WHILE).whileStmt = whileStmtNode;
+}
+
+void StackEvaluator::visitIfStmt(IfStmt* ifStmtNode) {
+	push(IF).ifStmt = ifStmtNode;
+}
+
+void StackEvaluator::visitParallelStmt(ParallelStmt* parallelStmtNode) {
+	push(PARALLEL).parallel = parallelStmtNode;
+}
+
+void StackEvaluator::visitArrayStmt(ArrayStmt* arrayStmtNode) {
+	// The element-wise operations have no expression to evaluate first: they run on the spot
+	if (arrayStmtNode->isElementWise()) {
+		IntArray::execute(ST, arrayStmtNode, Value(), Value());
+		chargeArray(arrayStmtNode->getArray());
+		return;
+	}
+	push(ARRAY_STMT).arrayStmt = arrayStmtNode;
+}
+
+void StackEvaluator::visitOperator(Operator* opNode) {
+	push(OPERATOR).op = opNode;
+}
+
+void StackEvaluator::visitNumber(Number* numNode) {
+	NumExprAccumulator.push(numNode->getValue());
+}
+
+void StackEvaluator::visitVariable(Variable* varNode) {
+	switch (varNode->getAssignment())
+	{
+	case Variable::ASSIGNED:
+		NumExprAccumulator.push(ST.getSlotUnchecked(varNode->getSlot())); return;
+	case Variable::NOT_ANALYSED:
+		NumExprAccumulator.push(ST.getValueFromVariable(varNode->getVarId())); return;
+	default:
+		NumExprAccumulator.push(ST.getSlot(varNode->getSlot())); return;
+	}
+}
+
+void StackEvaluator::visitArrayExpr(ArrayExpr* arrayExprNode) {
+	// SUM and LEN have no index: they are evaluated on the spot
+	if (arrayExprNode->getIndex() == nullptr) {
+		NumExprAccumulator.push(IntArray::evaluate(ST, arrayExprNode, Value()));
+		if (arrayExprNode->getKind() == ArrayExpr::SUM) {
+			chargeArray(arrayExprNode->getArray());
+		}
+		return;
+	}
+	push(ARRAY_EXPR).arrayExpr = arrayExprNode;
+}
+
+void StackEvaluator::visitRelOp(RelOp* relOpNode) {
+	push(RELOP).relOp = relOpNode;
+}
+
+void StackEvaluator::visitBoolConst(BoolConst* boolConstNode) {
+	BoolExprAccumulator.push_back(boolConstNode->getValue());
+}
+
+void StackEvaluator::visitBoolOp(BoolOp* boolOpNode) {
+	push(BOOLOP).boolOp = boolOpNode;
+}
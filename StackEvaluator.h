@@ -0,0 +1,164 @@
+#ifndef STACKEVALUATOR_H
+#define STACKEVALUATOR_H
+
+#include <vector>
+
+#include "Visitor.h"
+
+// The StackEvaluator evaluates a program like the EvaluatorVisitor, with the same semantics and errors,
+// without recursion: the nodes being evaluated are kept on an explicit stack of frames (node and phase),
+// so the nesting of blocks and expressions is limited only by memory.
+// accept is used only to dispatch on the type of a node: the visit of a node pushes its frame (leaves are
+// evaluated on the spot), and the loop of resume advances the frame on top of the stack one phase at a time.
+// As the whole state of the evaluation is in the object, the evaluation can be suspended between two statements
+// and resumed later. It is also suspended by an INPUT whose value has not arrived yet (see InputSource::ready),
+// and the INPUT is done when the evaluation is resumed with the value ready.
+class StackEvaluator : public Visitor {
+public:
+	static constexpr unsigned long long UNLIMITED = ~0ULL;
+
+	StackEvaluator(SymbolTable& S, OutputSink& O, InputSource& I) : ST{ S }, Out{ O }, In{ I } {}
+
+	// Prepares the evaluation of a program, which starts with the first call to resume.
+	void start(Program* progNode);
+
+	// Evaluates the program until it ends, returning true, or until "statements" statements have been started:
+	// the evaluation is then suspended right before the next statement and false is returned.
+	// False is also returned when an INPUT waits for its value.
+	// An error ends the evaluation: the exception is propagated and the program cannot be resumed.
+	bool resume(unsigned long long statements = UNLIMITED);
+
+	bool finished() const {
+		return top == 0;
+	}
+
+	// True if the evaluation is suspended on an INPUT whose value is not ready.
+	bool waitingForInput() const {
+		return top != 0 && frames[top - 1].kind == INPUT;
+	}
+
+	// Current nesting of the evaluation (frames on the stack).
+	size_t depth() const {
+		return top;
+	}
+
+	// Starts and evaluates a whole program.
+	void run(Program* progNode) {
+		start(progNode);
+		resume();
+	}
+
+	// The steps and the time of the evaluation are limited by the meter (see BudgetMeter), which starts now.
+	void setBudget(BudgetMeter& M) {
+		Meter = &M;
+		fuel = M.start();
+	}
+
+	// The visits push the frame of the node, evaluating numbers, variables and boolean constants directly.
+	void visitProgram(Program* progNode) override;
+	void visitBlock(Block* blockNode) override;
+
+	void visitPrintStmt(PrintStmt* printStmtNode) override;
+	void visitSetStmt(SetStmt* setStmtNode) override;
+	void visitInputStmt(InputStmt* inputStmtNode) override;
+	void visitWhileStmt(WhileStmt* whileStmtNode) override;
+	void visitIfStmt(IfStmt* ifStmtNode) override;
+	void visitParallelStmt(ParallelStmt* parallelStmtNode) override;
+	void visitArrayStmt(ArrayStmt* arrayStmtNode) override;
+
+	void visitOperator(Operator* opNode) override;
+	void visitNumber(Number* numNode) override;
+	void visitVariable(Variable* varNode) override;
+	void visitArrayExpr(ArrayExpr* arrayExprNode) override;
+
+	void visitRelOp(RelOp* relOpNode) override;
+	void visitBoolConst(BoolConst* boolConstNode) override;
+	void visitBoolOp(BoolOp* boolOpNode) override;
+
+private:
+	enum Kind { BLOCK, PRINT, SET, INPUT, WHILE, IF, PARALLEL, ARRAY_STMT, OPERATOR, ARRAY_EXPR, RELOP, BOOLOP };
+
+	// A node being evaluated; phase counts the children already evaluated (the statements, for a block).
+	struct Frame {
+		Kind kind;
+		size_t phase;
+		union {
+			Block* block;
+			PrintStmt* print;
+			SetStmt* set;
+			InputStmt* input;
+			WhileStmt* whileStmt;
+			IfStmt* ifStmt;
+			ParallelStmt* parallel;
+			ArrayStmt* arrayStmt;
+			Operator* op;
+			ArrayExpr* arrayExpr;
+			RelOp* relOp;
+			BoolOp* boolOp;
+		};
+	};
+
+	// Pushes a new frame, whose node is set by the caller.
+	// The reference is valid only until the next push: the frames are in a vector, which only grows
+	// (the slots above the top are reused, so pushing and popping never construct or destroy anything).
+	Frame& push(Kind kind) {
+		if (top == frames.size()) {
+			frames.resize(frames.empty() ? 64 : frames.size() * 2);
+		}
+		Frame& f = frames[top++];
+		f.kind = kind;
+		f.phase = 0;
+		return f;
+	}
+
+	void pop() {
+		--top;
+	}
+
+	void assign(const Variable* var, const Value& value) {
+		if (var->getSlot() >= 0) {
+			ST.setSlot(var->getSlot(), value);
+		}
+		else {
+			ST.CCvar(var->getVarId(), value);
+		}
+	}
+
+	// Visits a child; returns true if it was evaluated on the spot (a leaf), false if it pushed its frame.
+	template<typename Node>
+	bool onTheSpot(Node* child) {
+		size_t depth = top;
+		child->accept(this);
+		return top == depth;
+	}
+
+	bool popCondition() {
+		bool cond = BoolExprAccumulator.back();
+		BoolExprAccumulator.pop_back();
+		return cond;
+	}
+
+	void step() {
+		if (__builtin_expect(--fuel == 0, 0)) {
+			refuel();
+		}
+	}
+
+	void refuel();
+	// The work of an operation that computed a big integer, or went through a whole array (see BudgetMeter::charge).
+	void chargeBig(const Value& v);
+	void chargeArray(const Variable* array);
+
+	std::vector<Frame> frames;
+	size_t top = 0;
+	ValueStack NumExprAccumulator;
+	std::vector<char> BoolExprAccumulator;
+	BudgetMeter* Meter = nullptr;
+	unsigned long long fuel = UNLIMITED;
+
+	SymbolTable& ST;
+	OutputSink& Out;
+	InputSource& In;
+};
+
+#endif
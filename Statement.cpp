@@ -22,6 +22,16 @@ void WhileStmt::accept(Visitor* v)
 	v->visitWhileStmt(this);
 }
 
+void ParallelStmt::accept(Visitor* v)
+{
+	v->visitParallelStmt(this);
+}
+
+void ArrayStmt::accept(Visitor* v)
+{
+	v->visitArrayStmt(this);
+}
+
 void IfStmt::accept(Visitor* v)
 {
 	v->visitIfStmt(this);
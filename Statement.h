@@ -19,6 +19,24 @@ public:
 	virtual ~Statement() {};	
 	
 	virtual void accept(Visitor* v) = 0;
+
+	// Position of the statement's "(" in the source, set by the Parser (used by the profiler reports).
+	void setLocation(int l, int c) {
+		line = l;
+		column = c;
+	}
+
+	int getLine() const {
+		return line;
+	}
+
+	int getColumn() const {
+		return column;
+	}
+
+private:
+	int line = 0;
+	int column = 0;
 };
  
 // The private attributes (immutable objects) are due to the derivations defined in the language grammar
@@ -105,6 +123,92 @@ private:
 	Block* Reppeter; // The block to be repeated.
 };
 
+class ParallelStmt : public Statement {
+public:
+
+	ParallelStmt(const std::vector<Block*>& c) : Children{ c } {}
+
+	~ParallelStmt() = default;
+
+	void accept(Visitor* v) override;
+
+	// Access method
+	const std::vector<Block*>& getChildren() const {
+		return Children;
+	}
+
+	// Set by the AssignmentAnalysis once it has checked that no child assigns a variable another child uses:
+	// only then may the children run concurrently.
+	void setChecked(bool c) {
+		checked = c;
+	}
+
+	bool isChecked() const {
+		return checked;
+	}
+
+private:
+	std::vector<Block*> Children; // The blocks that can run at the same time.
+	bool checked = false;
+};
+
+// Statements on integer arrays (see IntArray):
+// (ARRAY a n) creates or replaces the array a with n elements set to zero, (PUT a i e) sets the element at index i,
+// and (VADD d a b), (VSUB d a b), (VMUL d a b), (VLT d a b), (VGT d a b), (VEQ d a b) create or replace the array d
+// with the element-wise sums, differences, products or comparisons (1 if true, 0 if false) of a and b.
+class ArrayStmt : public Statement {
+public:
+	// In the order of the tokens ARRAY, PUT, VADD, VSUB, VMUL, VLT, VGT and VEQ.
+	enum Kind { ALLOCATE, PUT, ADD, SUB, MUL, LT, GT, EQ };
+
+	// ARRAY: the size is the operand; PUT: the index is the operand, followed by the element.
+	ArrayStmt(Kind k, Variable* a, NumExpr* o, NumExpr* e = nullptr) : kind{ k }, Array{ a }, Operand{ o }, Element{ e } {}
+
+	// The element-wise operations: the array is the destination.
+	ArrayStmt(Kind k, Variable* d, Variable* l, Variable* r) : kind{ k }, Array{ d }, Left{ l }, Right{ r } {}
+
+	~ArrayStmt() = default;
+
+	void accept(Visitor* v) override;
+
+	// Access methods
+	Kind getKind() const {
+		return kind;
+	}
+
+	bool isElementWise() const {
+		return kind >= ADD;
+	}
+
+	Variable* getArray() const {
+		return Array;
+	}
+
+	NumExpr* getOperand() const {
+		return Operand;
+	}
+
+	NumExpr* getElement() const {
+		return Element;
+	}
+
+	Variable* getLeft() const {
+		return Left;
+	}
+
+	Variable* getRight() const {
+		return Right;
+	}
+
+private:
+	Kind kind;
+	Variable* Array; // The array created, changed or replaced.
+	NumExpr* Operand = nullptr; // The size (ARRAY) or the index (PUT).
+	NumExpr* Element = nullptr; // The element stored (PUT).
+	Variable* Left = nullptr; // The operands of the element-wise operations.
+	Variable* Right = nullptr;
+};
+
 class IfStmt : public Statement {
 public:
 
@@ -0,0 +1,808 @@
+#ifndef STATICSCRIPT_H
+#define STATICSCRIPT_H
+
+#include <array>
+#include <climits>
+#include <cstddef>
+#include <ostream>
+#include <span>
+#include <string_view>
+
+#include "token.h"
+
+// Compile-time version of the interpreter, for scripts embedded in C++ programs as string constants (C++20).
+// StaticProgram tokenizes and parses a script into nodes stored in a std::array, and runs it into a StaticRun holding
+// the printed values in another std::array: there is no heap, so everything can be done in a constant expression
+// and the syntax tree, or the whole output of a script without INPUT, baked into the binary:
+//
+//   constexpr auto program = StaticProgram<>::compile("(BLOCK (SET x 6) (PRINT (MUL x 7)))");
+//   static_assert(program.ok());
+//   constexpr auto output = program.run();
+//   static_assert(output.ok() && output[0] == 42);
+//
+// The same functions run at run time too, for instance a baked program with the INPUT values of the service.
+// Errors are never thrown: compile and run return objects whose status tells what failed, with the message the
+// interpreter would print, so that a static_assert on ok() rejects a wrong script.
+// Tokens and grammar are those of the tokenizer and the Parser, without PARALLEL and the arrays: their reserved words
+// are recognized and rejected with a parse error. Values are long ints only: where the interpreter would
+// promote a value to a big integer the run stops with "INTEGER OVERFLOW", like the C backend.
+// The program refers to the names of its variables in the source, which must outlive it (a string literal does).
+struct StaticStatus {
+	enum Status { OK, LEXICAL_ERROR, PARSE_ERROR, SEMANTIC_ERROR, BUDGET_EXCEEDED, OTHER_ERROR };
+
+	// The headings printed by the interpreter, as Session::statusName.
+	static constexpr const char* name(Status status) {
+		switch (status) {
+		case OK:
+			return "OK";
+		case LEXICAL_ERROR:
+			return "Lexical Error";
+		case PARSE_ERROR:
+			return "Error in parsing";
+		case SEMANTIC_ERROR:
+			return "Error in semantic analysis";
+		case BUDGET_EXCEEDED:
+			return "Execution budget exceeded";
+		default:
+			return "Error";
+		}
+	}
+};
+
+// Output of a run: the printed values, at most Outputs of them.
+template<size_t Outputs>
+struct StaticRun {
+	StaticStatus::Status status = StaticStatus::OK;
+	const char* message = "";
+	std::array<long, Outputs> values{};
+	size_t count = 0;
+	unsigned long long steps = 0;
+
+	constexpr bool ok() const {
+		return status == StaticStatus::OK;
+	}
+
+	constexpr size_t size() const {
+		return count;
+	}
+
+	constexpr long operator[](size_t i) const {
+		return values[i];
+	}
+
+	// Writes the printed values as the interpreter does, one per line.
+	void write(std::ostream& os) const {
+		for (size_t i = 0; i < count; ++i) {
+			os << values[i] << '\n';
+		}
+	}
+};
+
+template<size_t Nodes = 256, size_t Variables = 32>
+class StaticProgram {
+public:
+	static constexpr unsigned long long DEFAULT_MAX_STEPS = 1000000;
+
+	// A node of the tree. Its kind is the tag of the token naming it (token::SET, token::ADD, token::NUMBER...)
+	// and its operands are indices of other nodes:
+	// BLOCK: first statement; statements: the next one in their block;
+	// SET: slot, value; INPUT: slot; PRINT: value; WHILE: condition, body; IF: condition, if block, else block;
+	// operators: left and right operand (NOT: only the left one); VARIABLE_ID: slot; NUMBER: value.
+	struct Node {
+		int kind = -1;
+		int first = -1;
+		int second = -1;
+		int third = -1;
+		int next = -1;
+		long value = 0;
+		bool big = false;	// A NUMBER that does not fit in a long int
+		int line = 0;
+		int column = 0;
+	};
+
+	static constexpr StaticProgram compile(std::string_view source) {
+		StaticProgram p;
+		p.source = source;
+		p.build();
+		return p;
+	}
+
+	constexpr bool ok() const {
+		return status == StaticStatus::OK;
+	}
+
+	constexpr StaticStatus::Status getStatus() const {
+		return status;
+	}
+
+	constexpr const char* getMessage() const {
+		return message;
+	}
+
+	// Position of the error in the source (starting from 1).
+	constexpr int getLine() const {
+		return errorLine;
+	}
+
+	constexpr int getColumn() const {
+		return errorColumn;
+	}
+
+	constexpr size_t getNodeCount() const {
+		return nodeCount;
+	}
+
+	constexpr const Node& getNode(size_t i) const {
+		return nodes[i];
+	}
+
+	constexpr int getRoot() const {
+		return root;
+	}
+
+	constexpr size_t getVariableCount() const {
+		return variableCount;
+	}
+
+	constexpr std::string_view getVariableName(size_t slot) const {
+		return names[slot];
+	}
+
+	// Runs the program reading its INPUT values from "inputs"; it stops after maxSteps steps (block entries and
+	// iterations), as the interpreter with --max-steps, and when it prints more than Outputs values.
+	template<size_t Outputs = 64>
+	constexpr StaticRun<Outputs> run(std::span<const long> inputs = {}, unsigned long long maxSteps = DEFAULT_MAX_STEPS) const {
+		StaticRun<Outputs> r;
+		if (!ok()) {
+			r.status = status;
+			r.message = message;
+			return r;
+		}
+		Machine<Outputs> m{ *this, r, inputs, maxSteps };
+		m.block(root);
+		return r;
+	}
+
+private:
+	struct Token {
+		int tag = -1;
+		std::string_view word;
+		int line = 0;
+		int column = 0;
+	};
+
+	// Reads the tokens of the source one at a time.
+	struct Lexer {
+		std::string_view text;
+		size_t pos = 0;
+		int line = 1;
+		int column = 1;
+
+		static constexpr bool space(char c) {
+			return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\v' || c == '\f';
+		}
+
+		static constexpr bool letter(char c) {
+			return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z');
+		}
+
+		static constexpr bool digit(char c) {
+			return c >= '0' && c <= '9';
+		}
+
+		constexpr void skipSpaces() {
+			while (pos < text.size() && space(text[pos])) {
+				if (text[pos] == '\n') {
+					++line;
+					column = 1;
+				}
+				else {
+					++column;
+				}
+				++pos;
+			}
+		}
+
+		constexpr bool atEnd() {
+			skipSpaces();
+			return pos == text.size();
+		}
+
+		// The next token; a word that is not a token gives tag -1 and the message of the tokenizer.
+		constexpr Token next(const char*& error) {
+			skipSpaces();
+			Token t;
+			t.line = line;
+			t.column = column;
+			if (text[pos] == '(' || text[pos] == ')') {
+				t.tag = text[pos] == '(' ? token::LP : token::RP;
+				t.word = text.substr(pos, 1);
+				++pos;
+				++column;
+				return t;
+			}
+			size_t start = pos;
+			while (pos < text.size() && !space(text[pos]) && text[pos] != '(' && text[pos] != ')') {
+				++pos;
+				++column;
+			}
+			t.word = text.substr(start, pos - start);
+			std::string_view w = t.word;
+			if (w[0] == '-' || digit(w[0])) {
+				for (size_t i = 1; i < w.size(); ++i) {
+					if (!digit(w[i])) {
+						error = "Lexical error on word";
+						return t;
+					}
+				}
+				if (w[0] == '0' && w.size() > 1) {
+					error = "Invalid number";
+					return t;
+				}
+				t.tag = token::NUMBER;
+				return t;
+			}
+			// The tokenizer reads a keyword as a whole word: followed by a letter it is a variable (SETX), by anything
+			// else it is an error on that character (SET1)
+			for (int k = token::BLOCK; k <= token::LEN; ++k) {
+				if (k >= token::LP && k <= token::VARIABLE_ID) {
+					continue;
+				}
+				std::string_view keyword = token::id2word[k];
+				if (w.substr(0, keyword.size()) == keyword && (w.size() == keyword.size() || !letter(w[keyword.size()]))) {
+					if (w.size() == keyword.size()) {
+						t.tag = k;
+					}
+					else {
+						error = "Lexical error on character";
+					}
+					return t;
+				}
+			}
+			for (char c : w) {
+				if (!letter(c)) {
+					error = "Lexical error on word";
+					return t;
+				}
+			}
+			t.tag = token::VARIABLE_ID;
+			return t;
+		}
+	};
+
+	// Evaluates the nodes; the first error stops it.
+	template<size_t Outputs>
+	struct Machine {
+		const StaticProgram& p;
+		StaticRun<Outputs>& r;
+		std::span<const long> inputs;
+		unsigned long long maxSteps;
+		size_t nextInput = 0;
+		std::array<long, Variables> values{};
+		std::array<bool, Variables> assigned{};
+
+		constexpr bool fail(StaticStatus::Status s, const char* m) {
+			if (r.status == StaticStatus::OK) {
+				r.status = s;
+				r.message = m;
+			}
+			return false;
+		}
+
+		constexpr bool block(int b) {
+			if (++r.steps > maxSteps) {
+				return fail(StaticStatus::BUDGET_EXCEEDED, "STEP LIMIT EXCEEDED");
+			}
+			for (int s = p.nodes[b].first; s >= 0; s = p.nodes[s].next) {
+				if (!statement(s)) {
+					return false;
+				}
+			}
+			return true;
+		}
+
+		constexpr bool statement(int s) {
+			const Node& n = p.nodes[s];
+			long v = 0;
+			switch (n.kind) {
+			case token::PRINT:
+				if (!number(n.first, v)) {
+					return false;
+				}
+				if (r.count == Outputs) {
+					return fail(StaticStatus::BUDGET_EXCEEDED, "OUTPUT LIMIT EXCEEDED");
+				}
+				r.values[r.count++] = v;
+				return true;
+			case token::SET:
+				if (!number(n.second, v)) {
+					return false;
+				}
+				values[n.first] = v;
+				assigned[n.first] = true;
+				return true;
+			case token::INPUT:
+				if (nextInput == inputs.size()) {
+					return fail(StaticStatus::SEMANTIC_ERROR, "END OF INPUT");
+				}
+				values[n.first] = inputs[nextInput++];
+				assigned[n.first] = true;
+				return true;
+			case token::WHILE:
+				while (true) {
+					bool c = false;
+					if (!condition(n.first, c)) {
+						return false;
+					}
+					if (!c) {
+						return true;
+					}
+					if (!block(n.second)) {
+						return false;
+					}
+				}
+			case token::IF: {
+				bool c = false;
+				if (!condition(n.first, c)) {
+					return false;
+				}
+				return block(c ? n.second : n.third);
+			}
+			default:
+				return fail(StaticStatus::OTHER_ERROR, "INVALID statement");
+			}
+		}
+
+		constexpr bool number(int e, long& v) {
+			const Node& n = p.nodes[e];
+			switch (n.kind) {
+			case token::NUMBER:
+				if (n.big) {
+					return fail(StaticStatus::SEMANTIC_ERROR, "INTEGER OVERFLOW");
+				}
+				v = n.value;
+				return true;
+			case token::VARIABLE_ID:
+				if (!assigned[n.first]) {
+					return fail(StaticStatus::SEMANTIC_ERROR, "Variable does not exist");
+				}
+				v = values[n.first];
+				return true;
+			default:
+				break;
+			}
+			long a = 0, b = 0;
+			if (!number(n.first, a) || !number(n.second, b)) {
+				return false;
+			}
+			// Computed exactly on 128 bits (the overflow builtins are not constant expressions when they overflow)
+			__int128 exact = 0;
+			switch (n.kind) {
+			case token::ADD:
+				exact = static_cast<__int128>(a) + b;
+				break;
+			case token::SUB:
+				exact = static_cast<__int128>(a) - b;
+				break;
+			case token::MUL:
+				exact = static_cast<__int128>(a) * b;
+				break;
+			case token::DIV:
+				if (b == 0) {
+					return fail(StaticStatus::SEMANTIC_ERROR, "ZERO DIVISION");
+				}
+				exact = static_cast<__int128>(a) / b;
+				break;
+			default:
+				return fail(StaticStatus::SEMANTIC_ERROR, "INVALID operation");
+			}
+			if (exact < LONG_MIN || exact > LONG_MAX) {
+				return fail(StaticStatus::SEMANTIC_ERROR, "INTEGER OVERFLOW");
+			}
+			v = static_cast<long>(exact);
+			return true;
+		}
+
+		constexpr bool condition(int e, bool& c) {
+			const Node& n = p.nodes[e];
+			switch (n.kind) {
+			case token::TRUE:
+			case token::FALSE:
+				c = n.kind == token::TRUE;
+				return true;
+			case token::LT:
+			case token::GT:
+			case token::EQ: {
+				long a = 0, b = 0;
+				if (!number(n.first, a) || !number(n.second, b)) {
+					return false;
+				}
+				c = n.kind == token::LT ? a < b : n.kind == token::GT ? a > b : a == b;
+				return true;
+			}
+			case token::NOT:
+				if (!condition(n.first, c)) {
+					return false;
+				}
+				c = !c;
+				return true;
+			default:
+				// AND and OR: the right operand only if the left one does not decide
+				if (!condition(n.first, c)) {
+					return false;
+				}
+				if (c == (n.kind == token::OR)) {
+					return true;
+				}
+				return condition(n.second, c);
+			}
+		}
+	};
+
+	// Compiling: the whole source is tokenized first, as the tokenizer does before the Parser starts,
+	// so a lexical error is reported even if a parse error comes before it.
+	constexpr void build() {
+		Lexer check{ source };
+		if (check.atEnd()) {
+			lexicalError("Empty program", check.line, check.column);
+			return;
+		}
+		while (!check.atEnd()) {
+			const char* error = nullptr;
+			Token t = check.next(error);
+			if (error) {
+				lexicalError(error, t.line, t.column);
+				return;
+			}
+		}
+		lexer = Lexer{ source };
+		const char* error = nullptr;
+		current = lexer.next(error);
+		root = supported() ? blockParse() : -1;
+		if (root >= 0 && !lexer.atEnd()) {
+			parseError("Unexpected premature ending");
+		}
+	}
+
+	constexpr void lexicalError(const char* m, int l, int c) {
+		status = StaticStatus::LEXICAL_ERROR;
+		message = m;
+		errorLine = l;
+		errorColumn = c;
+	}
+
+	constexpr int parseError(const char* m) {
+		if (status == StaticStatus::OK) {
+			status = StaticStatus::PARSE_ERROR;
+			message = m;
+			errorLine = current.line;
+			errorColumn = current.column;
+		}
+		return -1;
+	}
+
+	// Moves to the next token, which must exist.
+	constexpr bool advance() {
+		if (lexer.atEnd()) {
+			parseError("Unexpected end of input");
+			return false;
+		}
+		const char* error = nullptr;
+		current = lexer.next(error);
+		return supported();
+	}
+
+	// PARALLEL and the arrays are reserved words of the tokenizer, but not part of the static grammar.
+	constexpr bool supported() {
+		if (current.tag >= token::PARALLEL) {
+			parseError("ERROR: PARALLEL and arrays are not supported by StaticProgram");
+			return false;
+		}
+		return true;
+	}
+
+	constexpr int makeNode(int kind, int line, int column) {
+		if (nodeCount == Nodes) {
+			if (status == StaticStatus::OK) {
+				status = StaticStatus::OTHER_ERROR;
+				message = "Too many nodes for the StaticProgram";
+				errorLine = line;
+				errorColumn = column;
+			}
+			return -1;
+		}
+		Node& n = nodes[nodeCount];
+		n.kind = kind;
+		n.line = line;
+		n.column = column;
+		return static_cast<int>(nodeCount++);
+	}
+
+	constexpr int slotOf(std::string_view name) {
+		for (size_t slot = 0; slot < variableCount; ++slot) {
+			if (names[slot] == name) {
+				return static_cast<int>(slot);
+			}
+		}
+		if (variableCount == Variables) {
+			if (status == StaticStatus::OK) {
+				status = StaticStatus::OTHER_ERROR;
+				message = "Too many variables for the StaticProgram";
+				errorLine = current.line;
+				errorColumn = current.column;
+			}
+			return -1;
+		}
+		names[variableCount] = name;
+		return static_cast<int>(variableCount++);
+	}
+
+	// A block is "(BLOCK statement...)" or a single statement; it ends on its closing parenthesis.
+	constexpr int blockParse() {
+		if (current.tag != token::LP) {
+			return parseError("ERROR: Unexpected initial token for a block");
+		}
+		int b = makeNode(token::BLOCK, current.line, current.column);
+		if (b < 0) {
+			return -1;
+		}
+		Lexer saved = lexer;
+		Token open = current;
+		if (!advance()) {
+			return -1;
+		}
+		if (current.tag == token::BLOCK) {
+			if (!advance()) {
+				return -1;
+			}
+			int last = -1;
+			do {
+				int s = statementParse();
+				if (s < 0 || !advance()) {
+					return -1;
+				}
+				if (last < 0) {
+					nodes[b].first = s;
+				}
+				else {
+					nodes[last].next = s;
+				}
+				last = s;
+			} while (current.tag != token::RP);
+			return b;
+		}
+		if (current.tag == token::IF || current.tag == token::WHILE || current.tag == token::PRINT || current.tag == token::SET || current.tag == token::INPUT) {
+			// The statement starts at the parenthesis just read
+			lexer = saved;
+			current = open;
+			int s = statementParse();
+			if (s < 0) {
+				return -1;
+			}
+			nodes[b].first = s;
+			return b;
+		}
+		return parseError("ERROR in block definition");
+	}
+
+	// A statement ends on its closing parenthesis.
+	constexpr int statementParse() {
+		if (current.tag != token::LP) {
+			return parseError("ERROR: Unexpected initial token for a Statement");
+		}
+		int line = current.line, column = current.column;
+		if (!advance()) {
+			return -1;
+		}
+		int kind = current.tag;
+		int s = -1;
+		if (kind == token::IF) {
+			s = makeNode(kind, line, column);
+			if (s < 0 || !advance()) {
+				return -1;
+			}
+			int c = boolexprParse();
+			if (c < 0) {
+				return -1;
+			}
+			int yes = blockParse();
+			if (yes < 0 || !advance()) {
+				return -1;
+			}
+			int no = blockParse();
+			if (no < 0 || !advance()) {
+				return -1;
+			}
+			nodes[s].first = c;
+			nodes[s].second = yes;
+			nodes[s].third = no;
+		}
+		else if (kind == token::INPUT || kind == token::PRINT || kind == token::SET) {
+			s = makeNode(kind, line, column);
+			if (s < 0 || !advance()) {
+				return -1;
+			}
+			int e = numexprParse();
+			if (e < 0) {
+				return -1;
+			}
+			if (kind != token::PRINT && nodes[e].kind != token::VARIABLE_ID) {
+				return parseError("ERROR: Unrecognized variable");
+			}
+			if (kind == token::SET) {
+				int v = numexprParse();
+				if (v < 0) {
+					return -1;
+				}
+				nodes[s].second = v;
+			}
+			nodes[s].first = kind == token::PRINT ? e : nodes[e].first;
+		}
+		else if (kind == token::WHILE) {
+			s = makeNode(kind, line, column);
+			if (s < 0 || !advance()) {
+				return -1;
+			}
+			int c = boolexprParse();
+			if (c < 0) {
+				return -1;
+			}
+			int body = blockParse();
+			if (body < 0 || !advance()) {
+				return -1;
+			}
+			nodes[s].first = c;
+			nodes[s].second = body;
+		}
+		else {
+			return parseError("ERROR: Unrecognized variable");
+		}
+		if (current.tag != token::RP) {
+			return parseError("ERROR: Mismatched parenthesis");
+		}
+		return s;
+	}
+
+	// An expression ends after its last token.
+	constexpr int numexprParse() {
+		int line = current.line, column = current.column;
+		if (current.tag == token::LP) {
+			if (!advance()) {
+				return -1;
+			}
+			int kind = current.tag;
+			if (kind != token::ADD && kind != token::SUB && kind != token::MUL && kind != token::DIV) {
+				return parseError("ERROR: Unrecognized operator");
+			}
+			int e = makeNode(kind, line, column);
+			if (e < 0 || !advance()) {
+				return -1;
+			}
+			int left = numexprParse();
+			if (left < 0) {
+				return -1;
+			}
+			int right = numexprParse();
+			if (right < 0) {
+				return -1;
+			}
+			if (current.tag != token::RP) {
+				return parseError("ERROR: Mismatched parenthesis");
+			}
+			if (!advance()) {
+				return -1;
+			}
+			nodes[e].first = left;
+			nodes[e].second = right;
+			return e;
+		}
+		if (current.tag == token::NUMBER) {
+			std::string_view w = current.word;
+			bool negative = w[0] == '-';
+			if (w.size() == (negative ? 1u : 0u)) {
+				return parseError("ERROR: Invalid number");
+			}
+			int e = makeNode(token::NUMBER, line, column);
+			if (e < 0) {
+				return -1;
+			}
+			__int128 v = 0;
+			for (size_t i = negative ? 1 : 0; i < w.size() && v <= LONG_MAX; ++i) {
+				v = v * 10 + (w[i] - '0');
+			}
+			v = negative ? -v : v;
+			bool big = v < LONG_MIN || v > LONG_MAX;
+			nodes[e].value = big ? 0 : static_cast<long>(v);
+			nodes[e].big = big;
+			return advance() ? e : -1;
+		}
+		if (current.tag == token::VARIABLE_ID) {
+			int e = makeNode(token::VARIABLE_ID, line, column);
+			if (e < 0) {
+				return -1;
+			}
+			nodes[e].first = slotOf(current.word);
+			if (nodes[e].first < 0) {
+				return -1;
+			}
+			return advance() ? e : -1;
+		}
+		return parseError("ERROR: Unexpected initial token for a Numeric Expression");
+	}
+
+	constexpr int boolexprParse() {
+		int line = current.line, column = current.column;
+		if (current.tag == token::LP) {
+			if (!advance()) {
+				return -1;
+			}
+			int kind = current.tag;
+			int e = -1;
+			if (kind == token::LT || kind == token::GT || kind == token::EQ) {
+				e = makeNode(kind, line, column);
+				if (e < 0 || !advance()) {
+					return -1;
+				}
+				int left = numexprParse();
+				if (left < 0) {
+					return -1;
+				}
+				int right = numexprParse();
+				if (right < 0) {
+					return -1;
+				}
+				nodes[e].first = left;
+				nodes[e].second = right;
+			}
+			else if (kind == token::AND || kind == token::OR || kind == token::NOT) {
+				e = makeNode(kind, line, column);
+				if (e < 0 || !advance()) {
+					return -1;
+				}
+				int left = boolexprParse();
+				if (left < 0) {
+					return -1;
+				}
+				nodes[e].first = left;
+				if (kind != token::NOT) {
+					int right = boolexprParse();
+					if (right < 0) {
+						return -1;
+					}
+					nodes[e].second = right;
+				}
+			}
+			else {
+				return parseError("ERROR: Unrecognized operator in boolean expression");
+			}
+			if (current.tag != token::RP) {
+				return parseError("ERROR: Mismatched parenthesis");
+			}
+			return advance() ? e : -1;
+		}
+		if (current.tag == token::TRUE || current.tag == token::FALSE) {
+			int e = makeNode(current.tag, line, column);
+			if (e < 0) {
+				return -1;
+			}
+			return advance() ? e : -1;
+		}
+		return parseError("ERROR: Unexpected initial token for a Boolean Expression");
+	}
+
+	std::string_view source;
+	std::array<Node, Nodes> nodes{};
+	size_t nodeCount = 0;
+	std::array<std::string_view, Variables> names{};
+	size_t variableCount = 0;
+	int root = -1;
+	StaticStatus::Status status = StaticStatus::OK;
+	const char* message = "";
+	int errorLine = 0;
+	int errorColumn = 0;
+	// State of the parser
+	Lexer lexer{};
+	Token current{};
+};
+
+#endif
@@ -0,0 +1,74 @@
+#include <cstdio>
+#include <ctime>
+#include <sys/resource.h>
+
+#include "Stats.h"
+
+void Stats::beginPhase(const char* name) {
+	endPhase();
+	current = name;
+	wallStart = std::chrono::steady_clock::now();
+	cpuStart = cpuMs();
+}
+
+void Stats::endPhase() {
+	if (current == nullptr) {
+		return;
+	}
+	double wall = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - wallStart).count();
+	phases.push_back(Phase{ current, wall, cpuMs() - cpuStart });
+	current = nullptr;
+}
+
+double Stats::cpuMs() {
+	timespec t;
+	clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &t);
+	return t.tv_sec * 1e3 + t.tv_nsec / 1e6;
+}
+
+long Stats::peakRssKb() {
+	rusage usage;
+	getrusage(RUSAGE_SELF, &usage);
+	// ru_maxrss is in kB on Linux
+	return usage.ru_maxrss;
+}
+
+void Stats::writeText(std::ostream& os) const {
+	char line[128];
+	os << "Interpreter statistics\n";
+	std::snprintf(line, sizeof(line), "  %-18s %12s %12s\n", "phase", "wall ms", "cpu ms");
+	os << line;
+	for (const Phase& p : phases) {
+		std::snprintf(line, sizeof(line), "  %-18s %12.3f %12.3f\n", p.name, p.wallMs, p.cpuMs);
+		os << line;
+	}
+	std::snprintf(line, sizeof(line), "  %-18s %12zu\n", "tokens", tokens);
+	os << line;
+	std::snprintf(line, sizeof(line), "  %-18s %12s %12s\n", "memory", "count", "bytes");
+	os << line;
+	for (const Holder& m : managers) {
+		std::snprintf(line, sizeof(line), "  %-18s %12zu %12zu\n", m.name, m.count, m.bytes);
+		os << line;
+	}
+	std::snprintf(line, sizeof(line), "  %-18s %12zu %12zu\n", symbols.name, symbols.count, symbols.bytes);
+	os << line;
+	std::snprintf(line, sizeof(line), "  %-18s %12ld kB\n", "peak RSS", peakRssKb());
+	os << line;
+}
+
+void Stats::writeJson(std::ostream& os) const {
+	os << "{\n  \"phases\": [";
+	const char* separator = "\n";
+	for (const Phase& p : phases) {
+		os << separator << "    {\"name\": \"" << p.name << "\", \"wall_ms\": " << p.wallMs << ", \"cpu_ms\": " << p.cpuMs << "}";
+		separator = ",\n";
+	}
+	os << "\n  ],\n  \"tokens\": " << tokens << ",\n  \"managers\": [";
+	separator = "\n";
+	for (const Holder& m : managers) {
+		os << separator << "    {\"name\": \"" << m.name << "\", \"nodes\": " << m.count << ", \"bytes\": " << m.bytes << "}";
+		separator = ",\n";
+	}
+	os << "\n  ],\n  \"symbol_table\": {\"variables\": " << symbols.count << ", \"bytes\": " << symbols.bytes << "},\n";
+	os << "  \"peak_rss_kb\": " << peakRssKb() << "\n}\n";
+}
@@ -0,0 +1,66 @@
+#ifndef STATS_H
+#define STATS_H
+
+#include <chrono>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "Manager.h"
+#include "SymbolTable.h"
+
+// Statistics about the interpreter itself, reported by --stats:
+// wall and CPU time of every phase, number of tokens, nodes and bytes held by every Manager and by the SymbolTable,
+// and the peak resident set size of the process.
+class Stats
+{
+public:
+	// A phase lasts from its beginPhase to the next beginPhase or endPhase.
+	void beginPhase(const char* name);
+	void endPhase();
+
+	void setTokens(size_t count) {
+		tokens = count;
+	}
+
+	// Records the nodes and bytes held by a manager at the time of the call.
+	void addManager(const char* name, const Manager& m) {
+		managers.push_back(Holder{ name, m.nodeCount(), m.bytesHeld() });
+	}
+
+	void setSymbolTable(const SymbolTable& st) {
+		symbols = Holder{ "SymbolTable", st.size(), st.bytesHeld() };
+	}
+
+	// Peak resident set size of the process in kB.
+	static long peakRssKb();
+
+	void writeText(std::ostream& os) const;
+	void writeJson(std::ostream& os) const;
+
+private:
+	struct Phase {
+		const char* name;
+		double wallMs;
+		double cpuMs;
+	};
+
+	// Something holding memory: a manager (count of nodes) or the symbol table (count of variables).
+	struct Holder {
+		const char* name;
+		size_t count;
+		size_t bytes;
+	};
+
+	static double cpuMs();
+
+	std::vector<Phase> phases;
+	const char* current = nullptr;
+	std::chrono::steady_clock::time_point wallStart;
+	double cpuStart = 0;
+	size_t tokens = 0;
+	std::vector<Holder> managers;
+	Holder symbols{ "SymbolTable", 0, 0 };
+};
+
+#endif
@@ -1,17 +1,24 @@
 #ifndef SYMBOLTABLE_H
 #define SYMBOLTABLE_H
 
+#include<memory>
 #include<string>
 #include<vector>
+#include<stdexcept>
 #include "Exceptions.h"
+#include "Value.h"
+#include "IntArray.h"
 
 // Represents a symbol in the symbol table.
 struct Symbol
 {
-	Symbol(std::string vi, long int vu) :var_id{ vi }, value{ vu } {}
+	Symbol(const std::string& vi, const Value& vu, bool a = true) :var_id{ vi }, value{ vu }, assigned{ a }, version{ a ? 1ULL : 0ULL } {}
 
 	std::string var_id; // Variable identifier
-	long int value;			// Value associated with the variable
+	Value value;			// Value associated with the variable
+	bool assigned;		// False for the slot of a variable that was not assigned yet
+	unsigned long long version;	// Number of assignments, used to tell whether a cached result is still valid
+	std::unique_ptr<IntArray> array;	// The array, for the slot of an array that was created
 };
 
 class SymbolTable
@@ -34,10 +41,13 @@ public:
 	}
 	
 	// Create or update a variable in the symbol table
-	void CCvar(std::string vi, long int vu) {
+	// The name is taken by reference so that updating an existing variable never allocates.
+	void CCvar(const std::string& vi, const Value& vu) {
 		for (auto i : variables) {
 			if (i->var_id == vi) {
 				i->value = vu; // Update the value if variable exists
+				i->assigned = true;
+				++i->version;
 				return;
 			}
 		}
@@ -47,15 +57,95 @@ public:
 	}
 
 	// Retrieve the value of a variable from the symbol table
-	long int getValueFromVariable(std::string vi) const {
+	const Value& getValueFromVariable(const std::string& vi) const {
 		for (auto i : variables) {
-			if (i->var_id == vi) {
+			if (i->var_id == vi && i->assigned) {
 				return i->value; // Return the value if variable exists
 			}
 		}
 		throw SemanticError("Variable does not exist"); // Variable not found
 	}
 
+	// Slots: a program resolved by the AssignmentAnalysis accesses its variables by position.
+	// reserveSlots creates the (unassigned) variables of the program in slot order, so that slot s is variables[s].
+	void reserveSlots(const std::vector<std::string>& names) {
+		for (size_t s = 0; s < names.size(); ++s) {
+			if (s < variables.size()) {
+				if (variables[s]->var_id != names[s]) {
+					throw std::logic_error("The symbol table does not match the slots of the program");
+				}
+			}
+			else {
+				variables.push_back(new Symbol(names[s], Value(), false));
+			}
+		}
+	}
+
+	void setSlot(size_t s, const Value& vu) {
+		Symbol* symbol = variables[s];
+		symbol->value = vu;
+		symbol->assigned = true;
+		++symbol->version;
+	}
+
+	// Write version of a slot: it changes with every assignment of the variable
+	unsigned long long getVersion(size_t s) const {
+		return variables[s]->version;
+	}
+
+	// Read of a variable that may not be assigned yet
+	const Value& getSlot(size_t s) const {
+		const Symbol* symbol = variables[s];
+		if (!symbol->assigned) {
+			throw SemanticError("Variable does not exist");
+		}
+		return symbol->value;
+	}
+
+	// Read of a variable proven to be assigned
+	const Value& getSlotUnchecked(size_t s) const {
+		return variables[s]->value;
+	}
+
+	bool isSlotAssigned(size_t s) const {
+		return variables[s]->assigned;
+	}
+
+	// Arrays are held by the symbols of their slots (a slot is used either for a number or for an array,
+	// as checked by the AssignmentAnalysis). Setting an array replaces the previous one.
+	void setArray(size_t s, std::unique_ptr<IntArray> a) {
+		variables[s]->array = std::move(a);
+	}
+
+	IntArray& getArray(size_t s) const {
+		IntArray* a = variables[s]->array.get();
+		if (a == nullptr) {
+			throw SemanticError("Array does not exist");
+		}
+		return *a;
+	}
+
+	// Number of variables
+	size_t size() const {
+		return variables.size();
+	}
+
+	// Bytes held by the symbols (names and big values included), for memory accounting.
+	size_t bytesHeld() const {
+		size_t bytes = variables.capacity() * sizeof(Symbol*);
+		for (auto i : variables) {
+			bytes += sizeof(Symbol) + i->value.bytesHeld();
+			if (i->array) {
+				bytes += i->array->bytesHeld();
+			}
+			// Names longer than the string's inline buffer are on the heap
+			if (i->var_id.capacity() > std::string().capacity()) {
+				bytes += i->var_id.capacity() + 1;
+			}
+		}
+		return bytes;
+	}
+
 private: 
 	std::vector<Symbol*> variables;
 	
@@ -0,0 +1,108 @@
+#include <csignal>
+
+#include "ThreadPool.h"
+
+ThreadPool::ThreadPool(unsigned n) {
+	if (n == 0) {
+		n = std::thread::hardware_concurrency();
+	}
+	if (n == 0) {
+		n = 1;
+	}
+	for (unsigned i = 0; i < n; ++i) {
+		queues.emplace_back(new Queue());
+	}
+	for (unsigned i = 0; i < n; ++i) {
+		threads.emplace_back(&ThreadPool::work, this, i);
+	}
+}
+
+ThreadPool::~ThreadPool() {
+	wait();
+	{
+		std::lock_guard<std::mutex> lock{ stateMutex };
+		stopping = true;
+	}
+	wakeUp.notify_all();
+	for (auto& t : threads) {
+		t.join();
+	}
+}
+
+void ThreadPool::submit(std::function<void()> task) {
+	size_t q;
+	{
+		std::lock_guard<std::mutex> lock{ stateMutex };
+		q = nextQueue;
+		nextQueue = (nextQueue + 1) % queues.size();
+		++unfinished;
+	}
+	{
+		std::lock_guard<std::mutex> lock{ queues[q]->m };
+		queues[q]->tasks.push_back(std::move(task));
+	}
+	// The task is counted as queued only once it is in its queue, so a woken thread always finds it
+	{
+		std::lock_guard<std::mutex> lock{ stateMutex };
+		++queued;
+	}
+	wakeUp.notify_one();
+}
+
+void ThreadPool::wait() {
+	std::unique_lock<std::mutex> lock{ stateMutex };
+	allDone.wait(lock, [this] { return unfinished == 0; });
+}
+
+bool ThreadPool::take(size_t self, std::function<void()>& task) {
+	{
+		Queue& own = *queues[self];
+		std::lock_guard<std::mutex> lock{ own.m };
+		if (!own.tasks.empty()) {
+			task = std::move(own.tasks.back());
+			own.tasks.pop_back();
+			return true;
+		}
+	}
+	for (size_t i = 1; i < queues.size(); ++i) {
+		Queue& victim = *queues[(self + i) % queues.size()];
+		std::lock_guard<std::mutex> lock{ victim.m };
+		if (!victim.tasks.empty()) {
+			task = std::move(victim.tasks.front());
+			victim.tasks.pop_front();
+			return true;
+		}
+	}
+	return false;
+}
+
+void ThreadPool::work(size_t self) {
+	// SIGINT and SIGTERM go to the other threads, which may be waiting for them (see Server::run)
+	sigset_t signals;
+	sigemptyset(&signals);
+	sigaddset(&signals, SIGINT);
+	sigaddset(&signals, SIGTERM);
+	pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+	for (;;) {
+		{
+			std::unique_lock<std::mutex> lock{ stateMutex };
+			wakeUp.wait(lock, [this] { return stopping || queued > 0; });
+			if (queued == 0) {
+				return;	// Stopping with nothing left to run
+			}
+			--queued;	// This thread is entitled to one of the queued tasks
+		}
+		std::function<void()> task;
+		// The reserved task may be taken by another thread that stole it first: look until one is found
+		while (!take(self, task)) {
+			std::this_thread::yield();
+		}
+		task();
+		{
+			std::lock_guard<std::mutex> lock{ stateMutex };
+			if (--unfinished == 0) {
+				allDone.notify_all();
+			}
+		}
+	}
+}
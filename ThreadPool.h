@@ -0,0 +1,62 @@
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Pool of threads running tasks, with one queue per thread and work stealing.
+// Submitted tasks are spread over the queues; a thread runs the tasks of its own queue (newest first)
+// and, when it is empty, steals the oldest task of another queue. This way long tasks do not hold back
+// the short ones queued behind them: the other threads take them.
+// The threads block SIGINT and SIGTERM, which are left to the thread owning the pool.
+class ThreadPool
+{
+public:
+	// Zero threads means one per core.
+	explicit ThreadPool(unsigned threads = 0);
+
+	// Waits for the submitted tasks and stops the threads.
+	~ThreadPool();
+
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+
+	// Tasks must not throw: an exception escaping a task terminates the program.
+	void submit(std::function<void()> task);
+
+	// Waits until every submitted task has been run.
+	void wait();
+
+	unsigned size() const {
+		return static_cast<unsigned>(threads.size());
+	}
+
+private:
+	struct Queue {
+		std::mutex m;
+		std::deque<std::function<void()>> tasks;
+	};
+
+	// Takes a task from the queue of thread "self", or steals one. Returns false if every queue is empty.
+	bool take(size_t self, std::function<void()>& task);
+	void work(size_t self);
+
+	std::vector<std::unique_ptr<Queue>> queues;
+	std::vector<std::thread> threads;
+
+	std::mutex stateMutex;
+	std::condition_variable wakeUp;	// Signaled when a task is queued or the pool stops
+	std::condition_variable allDone;	// Signaled when the last unfinished task ends
+	size_t queued = 0;	// Tasks waiting in the queues
+	size_t unfinished = 0;	// Tasks submitted and not yet finished
+	size_t nextQueue = 0;
+	bool stopping = false;
+};
+
+#endif
@@ -0,0 +1,107 @@
+#include <charconv>
+
+#include "Value.h"
+
+Value Value::fromBig(const BigInt& b) {
+	if (b.fitsLong()) {
+		return Value(b.toLong());
+	}
+	Value v;
+	v.big = new BigBox(b);
+	return v;
+}
+
+bool Value::fromChars(const char* begin, const char* end, Value& out) {
+	const char* digits = begin != end && *begin == '-' ? begin + 1 : begin;
+	if (digits == end) {
+		return false;
+	}
+	for (const char* c = digits; c != end; ++c) {
+		if (*c < '0' || *c > '9') {
+			return false;
+		}
+	}
+	long int v;
+	if (std::from_chars(begin, end, v).ec == std::errc{}) {
+		out = Value(v);
+	}
+	else {
+		// Only digits, but too many of them for a long int
+		out = fromBig(BigInt::fromString(begin, end));
+	}
+	return true;
+}
+
+BigInt Value::toBig() const {
+	return big ? big->value : BigInt(small);
+}
+
+std::string Value::toString() const {
+	return big ? big->value.toString() : std::to_string(small);
+}
+
+size_t Value::bytesHeld() const {
+	return big ? sizeof(BigBox) + big->value.bytesHeld() : 0;
+}
+
+void Value::releaseBig(BigBox* box) {
+	if (box->refs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+		delete box;
+	}
+}
+
+const BigInt& Value::bigOf(const Value& v, BigInt& tmp) {
+	if (v.big) {
+		return v.big->value;
+	}
+	tmp = BigInt(v.small);
+	return tmp;
+}
+
+Value Value::addSlow(const Value& a, const Value& b) {
+	BigInt ta, tb;
+	return fromBig(BigInt::add(bigOf(a, ta), bigOf(b, tb)));
+}
+
+Value Value::subSlow(const Value& a, const Value& b) {
+	BigInt ta, tb;
+	return fromBig(BigInt::sub(bigOf(a, ta), bigOf(b, tb)));
+}
+
+Value Value::mulSlow(const Value& a, const Value& b) {
+	BigInt ta, tb;
+	return fromBig(BigInt::mul(bigOf(a, ta), bigOf(b, tb)));
+}
+
+Value Value::divSlow(const Value& a, const Value& b) {
+	BigInt ta, tb;
+	return fromBig(BigInt::div(bigOf(a, ta), bigOf(b, tb)));
+}
+
+void Value::addToSlow(Value& a, const Value& b) {
+	a = addSlow(a, b);
+}
+
+void Value::subToSlow(Value& a, const Value& b) {
+	a = subSlow(a, b);
+}
+
+void Value::mulToSlow(Value& a, const Value& b) {
+	a = mulSlow(a, b);
+}
+
+void Value::divToSlow(Value& a, const Value& b) {
+	a = divSlow(a, b);
+}
+
+int Value::compareSlow(const Value& a, const Value& b) {
+	BigInt ta, tb;
+	return BigInt::compare(bigOf(a, ta), bigOf(b, tb));
+}
+
+std::ostream& operator<<(std::ostream& os, const Value& v) {
+	if (v.isSmall()) {
+		return os << v.getSmall();
+	}
+	return os << v.toString();
+}
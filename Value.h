@@ -0,0 +1,277 @@
+#ifndef VALUE_H
+#define VALUE_H
+
+#include <atomic>
+#include <climits>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "BigInt.h"
+
+// Integer value of the language.
+// Values are stored inline as a long int; an operation whose result does not fit (detected with the
+// overflow builtins) promotes the result to a BigInt allocated on the heap and shared by reference counting.
+// A value is stored as a BigInt only if it does not fit in a long int, so two equal values always have the same
+// representation and the fast paths only need to check that both operands are inline: a single test of their tags,
+// predicted taken, with the slow paths (and the Values they build) out of line.
+class Value
+{
+public:
+	Value(long int v = 0) : small{ v }, big{ nullptr } {}
+
+	Value(const Value& other) : small{ other.small }, big{ other.big } {
+		if (big) {
+			big->refs.fetch_add(1, std::memory_order_relaxed);
+		}
+	}
+
+	Value(Value&& other) noexcept : small{ other.small }, big{ other.big } {
+		other.big = nullptr;
+	}
+
+	Value& operator=(const Value& other) {
+		// Fast path: both values inline, nothing to share or release
+		if (big == nullptr && other.big == nullptr) {
+			small = other.small;
+			return *this;
+		}
+		if (other.big) {
+			other.big->refs.fetch_add(1, std::memory_order_relaxed);
+		}
+		release();
+		small = other.small;
+		big = other.big;
+		return *this;
+	}
+
+	Value& operator=(Value&& other) noexcept {
+		if (this != &other) {
+			release();
+			small = other.small;
+			big = other.big;
+			other.big = nullptr;
+		}
+		return *this;
+	}
+
+	~Value() {
+		release();
+	}
+
+	// Builds a value from a BigInt, stored inline when it fits in a long int.
+	static Value fromBig(const BigInt& b);
+
+	// Converts a decimal number made of an optional '-' followed by at least one digit.
+	// Returns false (leaving out unchanged) if the text is not such a number.
+	static bool fromChars(const char* begin, const char* end, Value& out);
+
+	bool isSmall() const {
+		return big == nullptr;
+	}
+
+	// The inline value, meaningful only if isSmall() is true.
+	long int getSmall() const {
+		return small;
+	}
+
+	// A BigInt is never zero, so only the inline value has to be checked.
+	bool isZero() const {
+		return big == nullptr && small == 0;
+	}
+
+	BigInt toBig() const;
+	std::string toString() const;
+
+	// Heap bytes owned by the value (zero for inline values), for memory accounting.
+	size_t bytesHeld() const;
+
+	// Arithmetic with the semantics of the C++ operators, without overflow.
+	// The divisor of div must not be zero.
+	static Value add(const Value& a, const Value& b) {
+		long int r;
+		if (__builtin_expect(bothSmall(a, b) && !__builtin_add_overflow(a.small, b.small, &r), 1)) {
+			return Value(r);
+		}
+		return addSlow(a, b);
+	}
+
+	static Value sub(const Value& a, const Value& b) {
+		long int r;
+		if (__builtin_expect(bothSmall(a, b) && !__builtin_sub_overflow(a.small, b.small, &r), 1)) {
+			return Value(r);
+		}
+		return subSlow(a, b);
+	}
+
+	static Value mul(const Value& a, const Value& b) {
+		long int r;
+		if (__builtin_expect(bothSmall(a, b) && !__builtin_mul_overflow(a.small, b.small, &r), 1)) {
+			return Value(r);
+		}
+		return mulSlow(a, b);
+	}
+
+	static Value div(const Value& a, const Value& b) {
+		// LONG_MIN / -1 is the only division of two long ints that overflows
+		if (__builtin_expect(bothSmall(a, b) && !(a.small == LONG_MIN && b.small == -1), 1)) {
+			return Value(a.small / b.small);
+		}
+		return divSlow(a, b);
+	}
+
+	// In place versions (a = a op b), used by the evaluator on its accumulator:
+	// on the fast path they only overwrite the inline value.
+	static void addTo(Value& a, const Value& b) {
+		long int r;
+		if (__builtin_expect(bothSmall(a, b) && !__builtin_add_overflow(a.small, b.small, &r), 1)) {
+			a.small = r;
+			return;
+		}
+		addToSlow(a, b);
+	}
+
+	static void subTo(Value& a, const Value& b) {
+		long int r;
+		if (__builtin_expect(bothSmall(a, b) && !__builtin_sub_overflow(a.small, b.small, &r), 1)) {
+			a.small = r;
+			return;
+		}
+		subToSlow(a, b);
+	}
+
+	static void mulTo(Value& a, const Value& b) {
+		long int r;
+		if (__builtin_expect(bothSmall(a, b) && !__builtin_mul_overflow(a.small, b.small, &r), 1)) {
+			a.small = r;
+			return;
+		}
+		mulToSlow(a, b);
+	}
+
+	static void divTo(Value& a, const Value& b) {
+		if (__builtin_expect(bothSmall(a, b) && !(a.small == LONG_MIN && b.small == -1), 1)) {
+			a.small /= b.small;
+			return;
+		}
+		divToSlow(a, b);
+	}
+
+	// Arithmetic on inline values whose result is known to fit in a long int (an operation proven by the RangeAnalysis):
+	// there is nothing to check. The divisor is known not to be zero.
+	static void addToUnchecked(Value& a, const Value& b) {
+		a.small += b.small;
+	}
+
+	static void subToUnchecked(Value& a, const Value& b) {
+		a.small -= b.small;
+	}
+
+	static void mulToUnchecked(Value& a, const Value& b) {
+		a.small *= b.small;
+	}
+
+	static void divToUnchecked(Value& a, const Value& b) {
+		a.small /= b.small;
+	}
+
+	// Returns a negative number, zero or a positive number if a is less, equal or greater than b.
+	static int compare(const Value& a, const Value& b) {
+		if (__builtin_expect(bothSmall(a, b), 1)) {
+			return (a.small > b.small) - (a.small < b.small);
+		}
+		return compareSlow(a, b);
+	}
+
+private:
+	// Shared heap storage of a BigInt. The counter is atomic because values may be copied by different threads.
+	struct BigBox {
+		BigBox(const BigInt& v) : refs{ 1 }, value{ v } {}
+		std::atomic<long> refs;
+		BigInt value;
+	};
+
+	// Both tags in one test: the pointers are null only if both values are inline.
+	static bool bothSmall(const Value& a, const Value& b) {
+		return (reinterpret_cast<uintptr_t>(a.big) | reinterpret_cast<uintptr_t>(b.big)) == 0;
+	}
+
+	// Only the check is inline: dropping a reference to a BigInt is kept out of the hot paths.
+	void release() {
+		if (__builtin_expect(big != nullptr, 0)) {
+			releaseBig(big);
+			big = nullptr;
+		}
+	}
+
+	static void releaseBig(BigBox* box);
+
+	// Returns the BigInt of a value: the shared one if the value is big, otherwise the conversion stored in tmp.
+	static const BigInt& bigOf(const Value& v, BigInt& tmp);
+
+	friend class ValueStack;
+
+	static Value addSlow(const Value& a, const Value& b);
+	static Value subSlow(const Value& a, const Value& b);
+	static Value mulSlow(const Value& a, const Value& b);
+	static Value divSlow(const Value& a, const Value& b);
+	// a = a op b, out of line so that the evaluators do not inline the assignment of a big result.
+	static void addToSlow(Value& a, const Value& b);
+	static void subToSlow(Value& a, const Value& b);
+	static void mulToSlow(Value& a, const Value& b);
+	static void divToSlow(Value& a, const Value& b);
+	static int compareSlow(const Value& a, const Value& b);
+
+	long int small;
+	BigBox* big;
+};
+
+std::ostream& operator<<(std::ostream& os, const Value& v);
+
+// Stack of values, used by the evaluators as their numeric accumulator.
+// The slots are constructed once and reused: a slot above the top never holds a BigInt, so pushing an inline
+// value is a plain store and popping only has to release the slot if it holds a BigInt.
+class ValueStack
+{
+public:
+	ValueStack(size_t capacity = 64) : slots(capacity), top{ 0 } {}
+
+	void push(const Value& v) {
+		if (top == slots.size()) {
+			slots.resize(top * 2);
+		}
+		Value& s = slots[top++];
+		if (v.big == nullptr) {
+			s.small = v.small;
+		}
+		else {
+			s = v;
+		}
+	}
+
+	// Returns the value at the given distance from the top.
+	Value& peek(size_t fromTop = 0) {
+		return slots[top - 1 - fromTop];
+	}
+
+	void pop() {
+		slots[--top].release();
+	}
+
+	size_t size() const {
+		return top;
+	}
+
+	void clear() {
+		while (top) {
+			pop();
+		}
+	}
+
+private:
+	std::vector<Value> slots;
+	size_t top;
+};
+
+#endif
@@ -1,7 +1,11 @@
 #ifndef VISITOR_H
 #define VISITOR_H
 
+#include <atomic>
+#include <exception>
 #include <iostream>
+#include <memory>
+#include <stdexcept>
 #include <string>
 #include <vector>
 
@@ -13,6 +17,11 @@
 #include "NumExpr.h"
 #include "Statement.h"
 #include "SymbolTable.h"
+#include "AllocCounter.h"
+#include "OutputSink.h"
+#include "InputSource.h"
+#include "Budget.h"
+#include "ThreadPool.h"
 
 // The Visitor class defines a visitor pattern for traversing the syntax tree.
 // tutti i tipi di visite devo creare metodi che sono capaci de fare la visita ad ogniuno dai tipi di nodi presenti nel albero del programma 
@@ -32,11 +41,14 @@ public:
 	virtual void visitInputStmt(InputStmt* inputStmtNode) = 0;
 	virtual void visitWhileStmt(WhileStmt* whileStmtNode) = 0;
 	virtual void visitIfStmt(IfStmt* ifStmtNode) = 0;
+	virtual void visitParallelStmt(ParallelStmt* parallelStmtNode) = 0;
+	virtual void visitArrayStmt(ArrayStmt* arrayStmtNode) = 0;
 
 	// Visits various expression nodes.
 	virtual void visitOperator(Operator* opNode) = 0;
 	virtual void visitNumber(Number* numNode) = 0;
 	virtual void visitVariable(Variable* varNode) = 0;
+	virtual void visitArrayExpr(ArrayExpr* arrayExprNode) = 0;
 
 	// Visits relational operator and boolean nodes.
 	virtual void visitRelOp(RelOp* relOpNode) = 0;
@@ -45,157 +57,251 @@ public:
 };
 
 // The PrintVisitor class is an implementation of the Visitor interface that prints the syntax tree.
-// Questa visita non  utile para il programma finale,  stato essenciale per il teste della creazione del albero sintatico
+// The tree is written as source text that the Parser reads back (used by the dumps of the PassManager).
 class PrintVisitor: public Visitor {
+public:
+	PrintVisitor(std::ostream& O = std::cout) : Out{ O } {}
+
 	void visitProgram(Program* progNode) {
-		std::cout << "Inizio del programa: ";
 		progNode->getBlock()->accept(this);
+		Out << std::endl;
 	}
 
 	void visitBlock(Block* blockNode) {
-		std::cout << "(BLOCK ";
+		Out << "(BLOCK";
 		for (auto i : blockNode->getVector()) {
+			Out << " ";
 			i->accept(this);
 		}
+		Out << ")";
 	}
 
 	void visitPrintStmt(PrintStmt* printStmtNode) {
-		std::cout << "(PRINT ";
+		Out << "(PRINT ";
 		printStmtNode->getPrinter()->accept(this);
-		std::cout << " ) ";
+		Out << ")";
 	}
 	void visitSetStmt(SetStmt* setStmtNode) {
-		std::cout << "(SET ";
+		Out << "(SET ";
 		setStmtNode->getVar()->accept(this);
-		std::cout << " ";
+		Out << " ";
 		setStmtNode->getSetter()->accept(this);
-		std::cout << " ) ";
+		Out << ")";
 	}
 	void visitInputStmt(InputStmt* inputStmtNode) {
-		std::cout << "(INPUT ";
+		Out << "(INPUT ";
 		inputStmtNode->getVar()->accept(this);
-		std::cout << " ) ";
+		Out << ")";
 	}
 	void visitWhileStmt(WhileStmt* whileStmtNode) {
-		std::cout << "(WHILE ";
+		Out << "(WHILE ";
 		whileStmtNode->getCondition()->accept(this);
-		std::cout << " ";
+		Out << " ";
 		whileStmtNode->getReppeter()->accept(this);
-		std::cout << " ) ";
+		Out << ")";
 	}
 	void visitIfStmt(IfStmt* ifStmtNode) {
-		std::cout << "(IF ";
+		Out << "(IF ";
 		ifStmtNode->getCondition()->accept(this);
-		std::cout << " ";
+		Out << " ";
 		ifStmtNode->getIfBlock()->accept(this);
-		std::cout << " ";
+		Out << " ";
 		ifStmtNode->getElseBlock()->accept(this);
-		std::cout << " ) ";
+		Out << ")";
+	}
+	void visitParallelStmt(ParallelStmt* parallelStmtNode) {
+		Out << "(PARALLEL";
+		for (auto i : parallelStmtNode->getChildren()) {
+			Out << " ";
+			i->accept(this);
+		}
+		Out << ")";
+	}
+	void visitArrayStmt(ArrayStmt* arrayStmtNode) {
+		Out << "(" << token::id2word[token::ARRAY + arrayStmtNode->getKind()] << " ";
+		arrayStmtNode->getArray()->accept(this);
+		if (arrayStmtNode->isElementWise()) {
+			Out << " ";
+			arrayStmtNode->getLeft()->accept(this);
+			Out << " ";
+			arrayStmtNode->getRight()->accept(this);
+		}
+		else {
+			Out << " ";
+			arrayStmtNode->getOperand()->accept(this);
+			if (arrayStmtNode->getElement()) {
+				Out << " ";
+				arrayStmtNode->getElement()->accept(this);
+			}
+		}
+		Out << ")";
 	}
 
 	void visitOperator(Operator* opNode) {
-		std::cout << " ( " << opNode->getOpCode() << " ";
+		Out << "(" << token::id2word[token::ADD + opNode->getOpCode()] << " ";
 		opNode->getLeft()->accept(this);
-		std::cout << " ";
+		Out << " ";
 		opNode->getRight()->accept(this);
-		std::cout << " ) ";
+		Out << ")";
 	}
 	void visitNumber(Number* numNode) {
-		std::cout << numNode->getValue();
+		Out << numNode->getValue();
 	}
 	void visitVariable(Variable* varNode) {
-		std::cout << varNode->getVarId();
+		Out << varNode->getVarId();
+	}
+	void visitArrayExpr(ArrayExpr* arrayExprNode) {
+		Out << "(" << token::id2word[token::GET + arrayExprNode->getKind()] << " ";
+		arrayExprNode->getArray()->accept(this);
+		if (arrayExprNode->getIndex()) {
+			Out << " ";
+			arrayExprNode->getIndex()->accept(this);
+		}
+		Out << ")";
 	}
 
 	void visitRelOp(RelOp* relOpNode) {
-		std::cout << " ( " << relOpNode->getRelOpCode() << " ";
+		// The RelOpCodes are not in the order of the tokens
+		static constexpr int words[]{ token::LT, token::GT, token::EQ };
+		Out << "(" << token::id2word[words[relOpNode->getRelOpCode()]] << " ";
 		relOpNode->getLeft()->accept(this);
-		std::cout << " ";
+		Out << " ";
 		relOpNode->getRight()->accept(this);
-		std::cout << " ) ";
+		Out << ")";
 	}
 	void visitBoolConst(BoolConst* boolConstNode) {
-		std::cout << boolConstNode->getValue();
+		Out << token::id2word[boolConstNode->getValue() ? token::TRUE : token::FALSE];
 	}
 	void visitBoolOp(BoolOp* boolOpNode) {
-		std::cout << " ( " << boolOpNode->getBoolOpCode() << " ";
+		Out << "(" << token::id2word[token::AND + boolOpNode->getBoolOpCode()] << " ";
 		boolOpNode->getLeft()->accept(this);
-		std::cout << " ";
-		boolOpNode->getRight()->accept(this);
-		std::cout << " ) ";
+		// NOT has a single operand
+		if (boolOpNode->getRight()) {
+			Out << " ";
+			boolOpNode->getRight()->accept(this);
+		}
+		Out << ")";
 	}
+
+private:
+	std::ostream& Out;
 };
 
 // The EvaluatorVisitor class is an implementation of the Visitor interface that evaluates the program with expressions and statements.
 class EvaluatorVisitor :public Visitor {
 public:
-	EvaluatorVisitor(SymbolTable& S): ST{S} {}
+	// The accumulators only grow as deep as the most nested expression, so after a first pass over a loop
+	// their capacity is enough and pushing/popping values never allocates again.
+	// The values printed by the program are written to the OutputSink O, the values read come from the InputSource I.
+	EvaluatorVisitor(SymbolTable& S, OutputSink& O, InputSource& I): ST{S}, Out{O}, In{I} {
+		BoolExprAccumulator.reserve(ACCUMULATOR_RESERVE);
+	}
 	
 	void visitProgram(Program* progNode) {
+		// The variables of a program resolved by the AssignmentAnalysis are created in their slots
+		ST.reserveSlots(progNode->getSlotNames());
 		// Start the evaluation by visiting the Program's Block.
 		progNode->getBlock()->accept(this);
 	}
 
 	void visitBlock(Block* blockNode) {
+		// Entering a block is a step of the execution budget.
+		// The body of a WHILE is a block, so this also counts every iteration (every back edge) of the loops.
+		step();
 		// Iterate through the statements within the Block and visit each one.
 		for (auto i : blockNode->getVector()) {
 			i->accept(this);
 		}
 	}
 
+	// The steps and the time of the evaluation are limited by the meter (see BudgetMeter), which starts now.
+	void setBudget(BudgetMeter& M) {
+		Meter = &M;
+		fuel = M.start();
+	}
+
+	// The children of the PARALLEL statements run on the threads of the pool.
+	void setPool(ThreadPool& P) {
+		Pool = &P;
+	}
+
 	void visitPrintStmt(PrintStmt* printStmtNode) {
 		// Visit the expression to be printed and evaluate it
 		printStmtNode->getPrinter()->accept(this);
 		// Retrieve the result of the expression evaluation from the accumulator and print it
-		int numPrintable = NumExprAccumulator.back(); NumExprAccumulator.pop_back();
-		std::cout << numPrintable << std::endl;
+		Out.writeValue(NumExprAccumulator.peek()); NumExprAccumulator.pop();
 	}
 	void visitSetStmt(SetStmt* setStmtNode) {
-		// Get the variable name to set
-		std::string vi = setStmtNode->getVar()->getVarId();
+		// Get the variable to set
+		const Variable* var = setStmtNode->getVar();
 		// Visit and evaluate the expression that provides the new value for the variable
 		setStmtNode->getSetter()->accept(this);
-		// Retrieve the result of the expression evaluation and update the variable's value in the symbol table
-		int numSetter = NumExprAccumulator.back(); NumExprAccumulator.pop_back();
-		ST.CCvar(vi, numSetter);
+		// Retrieve the result of the expression evaluation and update the variable's value in the symbol table,
+		// in its slot if it has one
+		if (var->getSlot() >= 0) {
+			ST.setSlot(var->getSlot(), NumExprAccumulator.peek());
+		}
+		else {
+			ST.CCvar(var->getVarId(), NumExprAccumulator.peek());
+		}
+		NumExprAccumulator.pop();
 		return;
 	}
 	void visitInputStmt(InputStmt* inputStmtNode) {
-		// Get the variable name to input a value into
-		std::string vi = inputStmtNode->getVar()->getVarId();
-		std::string stringInput;
-		// Read a string input from the user
-		std::cin >> stringInput;
-		// Check if the input string is a valid numeric value
-		for (size_t i = 0; i < stringInput.length(); ++i) {
-			if (!isdigit(stringInput[i]) && !(i == 0 && stringInput[i] == '-')) {
-				throw SemanticError("NOT A ACCETABLE NUMBER ");
-				return;
-			}
+		// Get the variable to input a value into
+		const Variable* var = inputStmtNode->getVar();
+		// Read the next number from the input source, which validates it and throws if it is not a number
+		Out.beforeInput();
+		// Update the variable's value in the symbol table
+		if (var->getSlot() >= 0) {
+			ST.setSlot(var->getSlot(), In.next());
+		}
+		else {
+			ST.CCvar(var->getVarId(), In.next());
 		}
-		// Convert the input string to a long int and update the variable's value in the symbol table
-		long int numInput = std::stoi(stringInput);
-		ST.CCvar(vi, numInput);
 		return;
 	}
 	void visitWhileStmt(WhileStmt* whileStmtNode) {
 		// Evaluate the condition expression
 		whileStmtNode->getCondition()->accept(this);
 		// Retrieve the boolean result of the condition evaluation
-		bool cond = BoolExprAccumulator.back(); BoolExprAccumulator.pop_back();
+		bool cond = popCondition();
 		// Execute the loop as long as the condition is true
+#ifdef LISP_ALLOC_COUNTER
+		// The first iteration may legitimately allocate (new variables, accumulator growth);
+		// whatever the following iterations allocate is reported as a steady-state allocation.
+		// Only the outermost loop in its steady state records, so nested loops are not counted twice.
+		bool first = true, owner = false;
+		unsigned long long allocs = 0, allocBytes = 0;
+#endif
 		while (cond)
 		{
 			whileStmtNode->getReppeter()->accept(this);
 			whileStmtNode->getCondition()->accept(this);
-			cond = BoolExprAccumulator.back(); BoolExprAccumulator.pop_back();
+			cond = popCondition();
+#ifdef LISP_ALLOC_COUNTER
+			if (first) {
+				first = false;
+				if (!inSteadyLoop) {
+					owner = inSteadyLoop = true;
+					allocs = AllocCounter::allocations();
+					allocBytes = AllocCounter::bytes();
+				}
+			}
+#endif
+		}
+#ifdef LISP_ALLOC_COUNTER
+		if (owner) {
+			AllocCounter::addSteadyStateLoop(AllocCounter::allocations() - allocs, AllocCounter::bytes() - allocBytes);
+			inSteadyLoop = false;
 		}
+#endif
 	}
 	void visitIfStmt(IfStmt* ifStmtNode) {
 		// Evaluate the condition expression
 		ifStmtNode->getCondition()->accept(this);
 		// Retrieve the boolean result of the condition evaluation
-		bool cond = BoolExprAccumulator.back(); BoolExprAccumulator.pop_back();
+		bool cond = popCondition();
 		// Execute the if or else block based on the condition result
 		if (cond) {
 			ifStmtNode->getIfBlock()->accept(this);
@@ -204,6 +310,37 @@ public:
 			ifStmtNode->getElseBlock()->accept(this);
 		}
 	}
+	void visitParallelStmt(ParallelStmt* parallelStmtNode) {
+		const std::vector<Block*>& children = parallelStmtNode->getChildren();
+		// Without a pool, in a metered run (the meter belongs to this evaluator) or if the AssignmentAnalysis did not
+		// check that the children are independent, they run one after the other
+		if (Pool == nullptr || Meter != nullptr || !parallelStmtNode->isChecked() || children.size() < 2) {
+			for (auto i : children) {
+				i->accept(this);
+			}
+			return;
+		}
+		runParallel(children);
+	}
+	void visitArrayStmt(ArrayStmt* arrayStmtNode) {
+		// The size of ARRAY, or the index and then the element of PUT, are evaluated before the array is used
+		// (see IntArray::execute); the element-wise operations only have arrays as operands
+		if (arrayStmtNode->isElementWise()) {
+			IntArray::execute(ST, arrayStmtNode, Value(), Value());
+			chargeArray(arrayStmtNode->getArray());
+			return;
+		}
+		arrayStmtNode->getOperand()->accept(this);
+		if (arrayStmtNode->getElement() == nullptr) {
+			IntArray::execute(ST, arrayStmtNode, NumExprAccumulator.peek(), Value());
+			NumExprAccumulator.pop();
+			chargeArray(arrayStmtNode->getArray());
+			return;
+		}
+		arrayStmtNode->getElement()->accept(this);
+		IntArray::execute(ST, arrayStmtNode, NumExprAccumulator.peek(1), NumExprAccumulator.peek());
+		NumExprAccumulator.pop(); NumExprAccumulator.pop();
+	}
 
 
 	// Evaluation of numeric expressions or boolean expressions:
@@ -215,46 +352,79 @@ public:
 
 
 	void visitOperator(Operator* opNode) {
-		// Propagate the visit to the operands and retrieve the values
+		// Propagate the visit to the operands: their values are the two values on top of the accumulator.
+		// The result replaces the left operand and the right one is removed, so no value is moved around.
+		// The arithmetic of Value is checked: results that overflow a long int are promoted to big values.
+		// The operations proven in range by the RangeAnalysis skip the checks.
 		opNode->getLeft()->accept(this);
-		int lval = NumExprAccumulator.back(); NumExprAccumulator.pop_back();
 		opNode->getRight()->accept(this);
-		int rval = NumExprAccumulator.back(); NumExprAccumulator.pop_back();
-		switch (opNode->getOpCode())
+		Value& lval = NumExprAccumulator.peek(1);
+		const Value& rval = NumExprAccumulator.peek();
+		switch (opNode->getEvaluation())
 		{
 		// Perform the arithmetic operation and store the result in the accumulator
+		case Operator::ADD_UNCHECKED:
+			Value::addToUnchecked(lval, rval); break;
+		case Operator::SUB_UNCHECKED:
+			Value::subToUnchecked(lval, rval); break;
+		case Operator::MUL_UNCHECKED:
+			Value::mulToUnchecked(lval, rval); break;
+		case Operator::DIV_UNCHECKED:
+			Value::divToUnchecked(lval, rval); break;
 		case Operator::ADD:
-			NumExprAccumulator.push_back(lval + rval); return;
+			Value::addTo(lval, rval); break;
 		case Operator::SUB:
-			NumExprAccumulator.push_back(lval - rval); return;
+			Value::subTo(lval, rval); break;
 		case Operator::MUL:
-			NumExprAccumulator.push_back(lval * rval); return;
+			Value::mulTo(lval, rval); break;
 		case Operator::DIV:
-			if (rval == 0) {
+			if (rval.isZero()) {
 				// Handle division by zero error
 				throw SemanticError("ZERO DIVISION");
 			}
-			NumExprAccumulator.push_back(lval / rval); return;
+			Value::divTo(lval, rval); break;
 		default:
 			// This error should not occur because it should have already been handled in previous stages
 			throw SemanticError("INVALID operation");
 			return;
 		}
+		if (__builtin_expect(!lval.isSmall(), 0)) {
+			chargeBig(lval);
+		}
+		NumExprAccumulator.pop();
 	}
 	void visitNumber(Number* numNode) {
 		// Store the value of the number in the accumulator
-		NumExprAccumulator.push_back(numNode->getValue());
+		NumExprAccumulator.push(numNode->getValue());
 		return;
 	}
 	void visitVariable(Variable* varNode) {
 		// Visiting a variable retrieves its value and puts it in the accumulator.
 		// The creation and modification of variable values can only be done through a set or input statement,
-		// which do not call the visit to the variable, but rather use the symbol table with CCvar.
-		NumExprAccumulator.push_back(
-			ST.getValueFromVariable(
-				varNode->getVarId()
-			));
-		return;
+		// which do not call the visit to the variable, but rather use the symbol table with CCvar or setSlot.
+		// Only the reads that the AssignmentAnalysis could not prove check that the variable was assigned.
+		switch (varNode->getAssignment())
+		{
+		case Variable::ASSIGNED:
+			NumExprAccumulator.push(ST.getSlotUnchecked(varNode->getSlot())); return;
+		case Variable::NOT_ANALYSED:
+			NumExprAccumulator.push(ST.getValueFromVariable(varNode->getVarId())); return;
+		default:
+			NumExprAccumulator.push(ST.getSlot(varNode->getSlot())); return;
+		}
+	}
+	void visitArrayExpr(ArrayExpr* arrayExprNode) {
+		// The index of GET is replaced by the element
+		if (arrayExprNode->getIndex()) {
+			arrayExprNode->getIndex()->accept(this);
+			Value& index = NumExprAccumulator.peek();
+			index = IntArray::evaluate(ST, arrayExprNode, index);
+			return;
+		}
+		NumExprAccumulator.push(IntArray::evaluate(ST, arrayExprNode, Value()));
+		if (arrayExprNode->getKind() == ArrayExpr::SUM) {
+			chargeArray(arrayExprNode->getArray());
+		}
 	}
 
 
@@ -262,18 +432,18 @@ public:
 	void visitRelOp(RelOp* relOpNode) {
 		// Propagate the visit to the operands and retrieve the values
 		relOpNode->getLeft()->accept(this);
-		int lval = NumExprAccumulator.back(); NumExprAccumulator.pop_back();
 		relOpNode->getRight()->accept(this);
-		int rval = NumExprAccumulator.back(); NumExprAccumulator.pop_back();
+		int cmp = Value::compare(NumExprAccumulator.peek(1), NumExprAccumulator.peek());
+		NumExprAccumulator.pop(); NumExprAccumulator.pop();
 		switch (relOpNode->getRelOpCode())
 		{
 		// Perform the relational operation and store the result in the accumulator.
 		case RelOp::EQ:
-			BoolExprAccumulator.push_back(lval == rval); return;
+			BoolExprAccumulator.push_back(cmp == 0); return;
 		case RelOp::LT:
-			BoolExprAccumulator.push_back(lval < rval); return;
+			BoolExprAccumulator.push_back(cmp < 0); return;
 		case RelOp::GT:
-			BoolExprAccumulator.push_back(lval > rval); return;
+			BoolExprAccumulator.push_back(cmp > 0); return;
 		default:
 			// This error should not occur because it should have already been handled in previous stages
 			throw SemanticError("INVALID realtional operator");
@@ -317,10 +487,132 @@ public:
 		}
 	}
 
+protected:
+	// Counts a step: without a meter, or until the granted steps are used up, only a counter is decremented.
+	void step() {
+		if (__builtin_expect(--fuel == 0, 0)) {
+			refuel();
+		}
+	}
+
+	// Access to the results on top of the accumulators, for the evaluators extending this one.
+	const Value& topNumber() {
+		return NumExprAccumulator.peek();
+	}
+
+	void pushNumber(const Value& v) {
+		NumExprAccumulator.push(v);
+	}
+
+	void popNumber() {
+		NumExprAccumulator.pop();
+	}
+
+	bool topCondition() const {
+		return BoolExprAccumulator.back();
+	}
+
+	void pushCondition(bool c) {
+		BoolExprAccumulator.push_back(c);
+	}
+
+	// True if the steps and the time of the evaluation are limited.
+	bool metered() const {
+		return Meter != nullptr;
+	}
+
+	// Removes the result of a condition from the boolean accumulator and returns it.
+	bool popCondition() {
+		bool cond = BoolExprAccumulator.back();
+		BoolExprAccumulator.pop_back();
+		return cond;
+	}
+
 private:
-	std::vector<long int> NumExprAccumulator;
-	std::vector<bool> BoolExprAccumulator;
+	static constexpr size_t ACCUMULATOR_RESERVE = 64;
+	static constexpr unsigned long long UNMETERED = ~0ULL;
+	// Steps between two checks of the cancellation of a child of a PARALLEL statement
+	static constexpr unsigned long long CANCEL_INTERVAL = 4096;
+
+	// Slow path of step, kept out of the evaluation loops.
+	__attribute__((noinline, cold)) void refuel() {
+		if (Cancelled) {
+			if (Cancelled->load(std::memory_order_relaxed)) {
+				throw std::runtime_error("Cancelled");
+			}
+			fuel = CANCEL_INTERVAL;
+			return;
+		}
+		fuel = Meter ? Meter->refill() : UNMETERED;
+	}
+
+	// The work of an operation that computed a big integer, or went through a whole array, is charged to the meter.
+	__attribute__((noinline, cold)) void chargeBig(const Value& v) {
+		if (Meter) {
+			Meter->chargeValue(v.bytesHeld());
+		}
+	}
+
+	void chargeArray(const Variable* array) {
+		if (Meter) {
+			Meter->charge(ST.getArray(array->getSlot()).size());
+		}
+	}
+
+	// Runs every child with its own evaluator on the pool. The children share the SymbolTable: none of them assigns
+	// a variable another one uses, and every variable is a separate Symbol, so they never write the same memory.
+	// Their outputs are recorded, then written in the order of the children up to the first child that failed,
+	// whose error is raised: the output and the error are those of a run of the children one after the other.
+	// The children after a failed one are cancelled, as they would not have run.
+	void runParallel(const std::vector<Block*>& children) {
+		size_t n = children.size();
+		std::vector<RecordingOutputSink> outputs(n);
+		std::vector<std::exception_ptr> errors(n);
+		std::unique_ptr<std::atomic<bool>[]> cancel{ new std::atomic<bool>[n] };
+		for (size_t c = 0; c < n; ++c) {
+			cancel[c].store(false);
+		}
+		for (size_t c = 0; c < n; ++c) {
+			Pool->submit([&, c] {
+				try {
+					// A nested PARALLEL runs in order inside its child
+					EvaluatorVisitor child{ ST, outputs[c], In };
+					child.Cancelled = &cancel[c];
+					child.fuel = CANCEL_INTERVAL;
+					children[c]->accept(&child);
+				}
+				catch (...) {
+					errors[c] = std::current_exception();
+					for (size_t later = c + 1; later < n; ++later) {
+						cancel[later].store(true, std::memory_order_relaxed);
+					}
+				}
+			});
+		}
+		Pool->wait();
+		for (size_t c = 0; c < n; ++c) {
+			outputs[c].replay(Out);
+			if (errors[c]) {
+				std::rethrow_exception(errors[c]);
+			}
+		}
+	}
+
+	// The numeric accumulator is a ValueStack: pushing an inline value is a plain store into a reused slot.
+	ValueStack NumExprAccumulator{ ACCUMULATOR_RESERVE };
+	// One byte per value: std::vector<bool> would pack the bits and mask them on every push and pop.
+	std::vector<char> BoolExprAccumulator;
+#ifdef LISP_ALLOC_COUNTER
+	bool inSteadyLoop = false;
+#endif
+
+	BudgetMeter* Meter = nullptr;
+	unsigned long long fuel = UNMETERED;	// Steps left before the meter is called
+	ThreadPool* Pool = nullptr;
+	const std::atomic<bool>* Cancelled = nullptr;	// Set for the evaluator of a child of a PARALLEL statement
 
 	SymbolTable& ST;
+	OutputSink& Out;
+	InputSource& In;
 };
 #endif
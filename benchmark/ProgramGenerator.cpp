@@ -0,0 +1,108 @@
+#include "ProgramGenerator.h"
+
+namespace {
+	const char* const shapeNames[ProgramGenerator::SHAPES] = { "nesting", "loop", "variables", "flat", "print" };
+	const char* const operators[] = { "ADD", "SUB", "MUL" };
+}
+
+const char* ProgramGenerator::shapeName(Shape shape) {
+	return shapeNames[shape];
+}
+
+bool ProgramGenerator::shapeFromName(const std::string& name, Shape& shape) {
+	for (int s = 0; s < SHAPES; ++s) {
+		if (name == shapeNames[s]) {
+			shape = static_cast<Shape>(s);
+			return true;
+		}
+	}
+	return false;
+}
+
+std::string ProgramGenerator::generate(Shape shape, size_t size) {
+	switch (shape) {
+	case NESTING:
+		return nesting(size);
+	case LOOP:
+		return loop(size);
+	case VARIABLES:
+		return variables(size);
+	case FLAT:
+		return flat(size);
+	case PRINT:
+		return print(size);
+	}
+	return std::string();
+}
+
+std::string ProgramGenerator::variableName(size_t n) {
+	std::string name;
+	do {
+		name.push_back('a' + n % 26);
+		n /= 26;
+	} while (n);
+	return name;
+}
+
+long int ProgramGenerator::constant() {
+	state = state * 1664525u + 1013904223u;
+	return 1 + (state >> 16) % 9;
+}
+
+std::string ProgramGenerator::nesting(size_t size) {
+	// (PRINT (ADD 3 (SUB 5 (MUL 2 ... 1)))) with values kept small: MUL only by 1
+	std::string text = "(BLOCK (PRINT ";
+	for (size_t i = 0; i < size; ++i) {
+		const char* op = operators[i % 3];
+		long int c = op[0] == 'M' ? 1 : constant();
+		text += "(";
+		text += op;
+		text += " " + std::to_string(c) + " ";
+	}
+	text += "1";
+	text.append(size, ')');
+	text += "))";
+	return text;
+}
+
+std::string ProgramGenerator::loop(size_t size) {
+	return "(BLOCK (SET i 0) (SET a 0) (SET b 1)\n"
+		" (WHILE (LT i " + std::to_string(size) + ") (BLOCK\n"
+		"   (SET a (ADD a (MUL i " + std::to_string(constant()) + ")))\n"
+		"   (IF (GT a 1000000) (SET a (SUB a 999999)) (SET b (ADD b 1)))\n"
+		"   (SET i (ADD i 1))))\n"
+		" (PRINT a) (PRINT b))";
+}
+
+std::string ProgramGenerator::variables(size_t size) {
+	std::string text = "(BLOCK (SET s 0)\n";
+	for (size_t i = 0; i < size; ++i) {
+		text += " (SET x" + variableName(i) + " " + std::to_string(constant()) + ")\n";
+	}
+	for (size_t i = 0; i < size; ++i) {
+		text += " (SET s (ADD s x" + variableName(i) + "))\n";
+	}
+	text += " (PRINT s))";
+	return text;
+}
+
+std::string ProgramGenerator::flat(size_t size) {
+	std::string text = "(BLOCK (SET a 0)\n";
+	for (size_t i = 0; i < size; ++i) {
+		if (i % 2) {
+			text += " (PRINT a)\n";
+		}
+		else {
+			text += " (SET a (ADD a " + std::to_string(constant()) + "))\n";
+		}
+	}
+	text += ")";
+	return text;
+}
+
+std::string ProgramGenerator::print(size_t size) {
+	return "(BLOCK (SET i 0)\n"
+		" (WHILE (LT i " + std::to_string(size) + ") (BLOCK\n"
+		"   (PRINT (MUL i " + std::to_string(constant()) + "))\n"
+		"   (SET i (ADD i 1)))))";
+}
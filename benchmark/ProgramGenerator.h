@@ -0,0 +1,45 @@
+#ifndef PROGRAMGENERATOR_H
+#define PROGRAMGENERATOR_H
+
+#include <cstdint>
+#include <string>
+
+// Generates synthetic programs of a given shape and size for the benchmarks.
+// The generation is deterministic: the same shape, size and seed always produce the same program text.
+class ProgramGenerator
+{
+public:
+	// NESTING: a PRINT of an expression nested "size" levels deep.
+	// LOOP: a WHILE loop of "size" iterations updating a few variables.
+	// VARIABLES: "size" distinct variables, set and then summed (each access scans the SymbolTable).
+	// FLAT: a single BLOCK of "size" SET and PRINT statements.
+	// PRINT: a WHILE loop printing "size" values.
+	enum Shape { NESTING, LOOP, VARIABLES, FLAT, PRINT };
+
+	static constexpr int SHAPES = 5;
+
+	explicit ProgramGenerator(uint32_t seed = 1) : state{ seed } {}
+
+	std::string generate(Shape shape, size_t size);
+
+	static const char* shapeName(Shape shape);
+	// Returns false if the name is not a shape.
+	static bool shapeFromName(const std::string& name, Shape& shape);
+
+private:
+	// Variable names are made of letters only: the n-th name is n written in base 26 with the letters a-z.
+	static std::string variableName(size_t n);
+
+	// Small positive constants from a linear congruential generator.
+	long int constant();
+
+	std::string nesting(size_t size);
+	std::string loop(size_t size);
+	std::string variables(size_t size);
+	std::string flat(size_t size);
+	std::string print(size_t size);
+
+	uint32_t state;
+};
+
+#endif
@@ -0,0 +1,202 @@
+// Benchmark of the interpreter phases on generated programs (the parse phase includes the AssignmentAnalysis and the RangeAnalysis).
+// For every shape and size, the program is generated once and then tokenized, parsed and evaluated
+// "repeat" times; the fastest time of every phase is reported as JSON on the standard output.
+// Besides the times, every shape reports the growth exponent of every phase between its smallest and largest size
+// (1 for linear behavior, 2 for quadratic...).
+//
+// Built from the interpreter sources, without lispInterpreter.cpp, for example from the repository root:
+//   g++ -std=c++20 -O2 -I. benchmark/*.cpp $(ls *.cpp | grep -v lispInterpreter.cpp) -o lispBenchmark
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "ProgramGenerator.h"
+#include "Exceptions.h"
+#include "token.h"
+#include "tokenizer.h"
+#include "Manager.h"
+#include "Parser.h"
+#include "Visitor.h"
+#include "SymbolTable.h"
+#include "OutputSink.h"
+#include "InputSource.h"
+#include "AssignmentAnalysis.h"
+#include "RangeAnalysis.h"
+
+namespace {
+	struct Result {
+		size_t size;
+		size_t tokens;
+		double tokenizeMs;
+		double parseMs;
+		double evaluateMs;
+	};
+
+	double elapsedMs(std::chrono::steady_clock::time_point start) {
+		return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	}
+
+	// One run of the three phases on the program text; keeps the fastest time of every phase in r.
+	void measure(const std::string& text, Result& r) {
+		auto start = std::chrono::steady_clock::now();
+		std::istringstream source{ text };
+		tokenizer tokenize;
+		std::vector<token> tokens = tokenize(source);
+		double tokenizeMs = elapsedMs(start);
+
+		BlockManager BM;
+		BoolExprManager BEM;
+		NumExprManager NEM;
+		StatementManager SM;
+		ProgramManager PM;
+		Parser parse{ NEM, BEM, SM, BM, PM };
+		start = std::chrono::steady_clock::now();
+		Program* p = parse(tokens);
+		// The analyses resolving and bounding the variables are part of the compilation, so they are timed with the parser
+		AssignmentAnalysis analyse;
+		analyse(p);
+		RangeAnalysis ranges;
+		ranges(p);
+		double parseMs = elapsedMs(start);
+
+		SymbolTable ST;
+		StringOutputSink out;
+		StringInputSource in{ "" };
+		EvaluatorVisitor evaluator{ ST, out, in };
+		start = std::chrono::steady_clock::now();
+		p->accept(&evaluator);
+		double evaluateMs = elapsedMs(start);
+
+		r.tokens = tokens.size();
+		r.tokenizeMs = std::min(r.tokenizeMs, tokenizeMs);
+		r.parseMs = std::min(r.parseMs, parseMs);
+		r.evaluateMs = std::min(r.evaluateMs, evaluateMs);
+	}
+
+	// Growth exponent of a time between two sizes: t ~ size^k.
+	double exponent(double t0, double t1, size_t s0, size_t s1) {
+		if (t0 <= 0 || t1 <= 0 || s0 == s1) {
+			return 0;
+		}
+		return std::log(t1 / t0) / std::log(static_cast<double>(s1) / s0);
+	}
+
+	// Default sizes: loops are cheap per iteration, so their sizes are larger.
+	// The parser and the evaluator are recursive, so the nesting stays well below the depth that exhausts the stack
+	// (around 10000 levels with a 8 MB stack).
+	std::vector<size_t> defaultSizes(ProgramGenerator::Shape shape) {
+		size_t base = shape == ProgramGenerator::LOOP || shape == ProgramGenerator::PRINT ? 100000
+			: shape == ProgramGenerator::NESTING ? 250 : 1000;
+		std::vector<size_t> sizes;
+		for (size_t s = base; s <= base * 16; s *= 2) {
+			sizes.push_back(s);
+		}
+		return sizes;
+	}
+
+	void usage(const char* name) {
+		std::cerr << "Use: " << name << " [options]" << std::endl;
+		std::cerr << "  --shape=<name>          run only one shape (nesting, loop, variables, flat, print)" << std::endl;
+		std::cerr << "  --sizes=<n>,<n>...      sizes to run instead of the default ones" << std::endl;
+		std::cerr << "  --repeat=<n>            runs of every size, the fastest is reported (default 3)" << std::endl;
+		std::cerr << "  --seed=<n>              seed of the generator (default 1)" << std::endl;
+		std::cerr << "  --generate              write the program of the first shape and size instead of running it" << std::endl;
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	std::vector<ProgramGenerator::Shape> shapes;
+	std::vector<size_t> sizes;
+	int repeat = 3;
+	uint32_t seed = 1;
+	bool generateOnly = false;
+	for (int a = 1; a < argc; ++a) {
+		std::string arg = argv[a];
+		ProgramGenerator::Shape shape;
+		if (arg.rfind("--shape=", 0) == 0 && ProgramGenerator::shapeFromName(arg.substr(8), shape)) {
+			shapes.push_back(shape);
+		}
+		else if (arg.rfind("--sizes=", 0) == 0) {
+			std::stringstream list{ arg.substr(8) };
+			std::string size;
+			while (std::getline(list, size, ',')) {
+				sizes.push_back(std::strtoul(size.c_str(), nullptr, 10));
+			}
+		}
+		else if (arg.rfind("--repeat=", 0) == 0) {
+			repeat = std::atoi(arg.c_str() + 9);
+		}
+		else if (arg.rfind("--seed=", 0) == 0) {
+			seed = std::strtoul(arg.c_str() + 7, nullptr, 10);
+		}
+		else if (arg == "--generate") {
+			generateOnly = true;
+		}
+		else {
+			std::cerr << "Unknown argument: " << arg << std::endl;
+			usage(argv[0]);
+			return EXIT_FAILURE;
+		}
+	}
+	if (shapes.empty()) {
+		for (int s = 0; s < ProgramGenerator::SHAPES; ++s) {
+			shapes.push_back(static_cast<ProgramGenerator::Shape>(s));
+		}
+	}
+	if (repeat < 1) {
+		repeat = 1;
+	}
+
+	if (generateOnly) {
+		size_t size = sizes.empty() ? defaultSizes(shapes[0]).front() : sizes.front();
+		ProgramGenerator generator{ seed };
+		std::cout << generator.generate(shapes[0], size) << std::endl;
+		return 0;
+	}
+
+	std::cout << "{\n  \"repeat\": " << repeat << ",\n  \"shapes\": [";
+	const char* shapeSeparator = "\n";
+	for (ProgramGenerator::Shape shape : shapes) {
+		std::vector<Result> results;
+		for (size_t size : sizes.empty() ? defaultSizes(shape) : sizes) {
+			ProgramGenerator generator{ seed };
+			std::string text = generator.generate(shape, size);
+			Result r{ size, 0, HUGE_VAL, HUGE_VAL, HUGE_VAL };
+			try {
+				for (int i = 0; i < repeat; ++i) {
+					measure(text, r);
+				}
+			}
+			catch (std::exception& exc) {
+				std::cerr << ProgramGenerator::shapeName(shape) << " " << size << ": " << exc.what() << std::endl;
+				return EXIT_FAILURE;
+			}
+			results.push_back(r);
+		}
+
+		std::cout << shapeSeparator << "    {\"shape\": \"" << ProgramGenerator::shapeName(shape) << "\", \"results\": [";
+		const char* separator = "\n";
+		for (const Result& r : results) {
+			std::cout << separator << "      {\"size\": " << r.size << ", \"tokens\": " << r.tokens
+				<< ", \"tokenize_ms\": " << r.tokenizeMs << ", \"parse_ms\": " << r.parseMs
+				<< ", \"evaluate_ms\": " << r.evaluateMs << "}";
+			separator = ",\n";
+		}
+		const Result& first = results.front();
+		const Result& last = results.back();
+		std::cout << "\n    ], \"exponents\": {"
+			<< "\"tokenize\": " << exponent(first.tokenizeMs, last.tokenizeMs, first.size, last.size)
+			<< ", \"parse\": " << exponent(first.parseMs, last.parseMs, first.size, last.size)
+			<< ", \"evaluate\": " << exponent(first.evaluateMs, last.evaluateMs, first.size, last.size) << "}}";
+		shapeSeparator = ",\n";
+	}
+	std::cout << "\n  ]\n}" << std::endl;
+	return 0;
+}
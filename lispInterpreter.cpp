@@ -2,8 +2,18 @@
 #include <iostream>
 #include <vector>
 #include <fstream>
+#include <sstream>
 #include <stdlib.h>
 #include <string>
+#include <memory>
+#include <chrono>
+#include <algorithm>
+#include <limits>
+#include <csignal>
+#include <unistd.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <functional>
 
 #include "Exceptions.h"
 #include "token.h"
@@ -12,23 +22,552 @@
 #include "Parser.h"
 #include "Visitor.h"
 #include "SymbolTable.h"
+#include "AllocCounter.h"
+#include "OutputSink.h"
+#include "InputSource.h"
+#include "Profiler.h"
+#include "Stats.h"
+#include "BatchRunner.h"
+#include "Server.h"
+#include "Client.h"
+#include "CEmitter.h"
+#include "AssignmentAnalysis.h"
+#include "RangeAnalysis.h"
+#include "PassManager.h"
+#include "StackEvaluator.h"
+#include "Memo.h"
+#include "Reduction.h"
+#include "Lanes.h"
+#include "SSA.h"
+#include "Specializer.h"
 
-int main(int argc, char* argv[])
+namespace {
+    void stopServer(int) {
+        Server::requestStop();
+    }
+
+    std::string readAll(std::istream& in) {
+        std::ostringstream text;
+        text << in.rdbuf();
+        return text.str();
+    }
+
+    // Client mode: sends the program to the server "repeat" times (the first time the source, then only its hash),
+    // prints the output of the last run and, when repeating, the latencies on the standard error.
+    // With stream, the program is sent once and its input as it is read, while the program runs.
+    int runClient(const std::string& socketPath, const char* fileName, const std::string& inputFileName, int repeat, bool stream) {
+        try {
+            std::ifstream programFile{ fileName };
+            if (!programFile) {
+                std::cerr << "Cannot open " << fileName << std::endl;
+                return EXIT_FAILURE;
+            }
+            std::string source = readAll(programFile);
+            if (stream) {
+                int inputFd = STDIN_FILENO;
+                if (!inputFileName.empty() && (inputFd = ::open(inputFileName.c_str(), O_RDONLY | O_CLOEXEC)) < 0) {
+                    std::cerr << "Cannot open " << inputFileName << std::endl;
+                    return EXIT_FAILURE;
+                }
+                Client client{ socketPath };
+                Client::Response r = client.stream(source, inputFd);
+                std::cout << r.output << std::flush;
+                if (r.code != Server::OK) {
+                    std::cerr << r.message << std::endl;
+                    return EXIT_FAILURE;
+                }
+                return 0;
+            }
+            std::string input;
+            if (inputFileName.empty()) {
+                input = readAll(std::cin);
+            }
+            else {
+                std::ifstream inputFile{ inputFileName };
+                input = readAll(inputFile);
+            }
+            Client client{ socketPath };
+            Client::Response r;
+            std::vector<double> latencies;
+            for (int i = 0; i < repeat; ++i) {
+                auto start = std::chrono::steady_clock::now();
+                r = i == 0 ? client.run(source, input) : client.runHash(r.hash, input);
+                if (r.code == Server::UNKNOWN_PROGRAM) {
+                    // Dropped from the cache meanwhile
+                    r = client.run(source, input);
+                }
+                latencies.push_back(std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count());
+            }
+            std::cout << r.output << std::flush;
+            if (repeat > 1) {
+                std::sort(latencies.begin(), latencies.end());
+                std::cerr << repeat << " requests, latency us: min " << latencies.front() << " median " << latencies[latencies.size() / 2]
+                    << " max " << latencies.back() << std::endl;
+            }
+            if (r.code != Server::OK) {
+                std::cerr << r.message << std::endl;
+                return EXIT_FAILURE;
+            }
+            return 0;
+        }
+        catch (std::exception& exc) {
+            std::cerr << exc.what() << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+
+    // True if the run was stopped by its step or time limit, which the optimizations change (folding an IF removes
+    // block entries): the output up to that point is all that can be compared.
+    bool stoppedByBudget(const Session::Result& r) {
+        return r.status == Session::BUDGET_EXCEEDED && r.message != "OUTPUT LIMIT EXCEEDED";
+    }
+
+    constexpr unsigned REFERENCE_STEPS = 4;
+
+    // Verification mode: runs the program compiled without optimizations and at the given level on the same input
+    // and compares their status, error and output. The optimized output is written; a difference is reported on
+    // the standard error and makes the run fail.
+    // The reference run may take more steps than the optimized one (folding removes block entries): it gets
+    // REFERENCE_STEPS times the step limit. When a run is stopped by its step or time limit, only the output it
+    // wrote is compared with the other one. The input is read only if the program has INPUT statements.
+    int runVerified(const char* fileName, const std::string& inputFileName, int level, const ExecutionLimits& limits) {
+        try {
+            std::ifstream programFile{ fileName };
+            if (!programFile) {
+                std::cerr << "Cannot open " << fileName << std::endl;
+                return EXIT_FAILURE;
+            }
+            std::string source = readAll(programFile);
+            Session::Result results[2];
+            ProgramHandle programs[2];
+            ExecutionLimits referenceLimits = limits;
+            if (limits.maxSteps <= std::numeric_limits<unsigned long long>::max() / REFERENCE_STEPS) {
+                referenceLimits.maxSteps = limits.maxSteps * REFERENCE_STEPS;
+            }
+            for (int o = 0; o < 2; ++o) {
+                Session session{ o == 0 ? referenceLimits : limits, o == 0 ? 0 : level };
+                results[o] = session.compile(source, programs[o]);
+            }
+            std::string input;
+            bool readsInput = results[0].ok() && programs[0]->getProgram()->getReadsInput();
+            if (readsInput && inputFileName.empty()) {
+                input = readAll(std::cin);
+            }
+            else if (readsInput) {
+                std::ifstream inputFile{ inputFileName };
+                if (!inputFile) {
+                    std::cerr << "Cannot open " << inputFileName << std::endl;
+                    return EXIT_FAILURE;
+                }
+                input = readAll(inputFile);
+            }
+            for (int o = 0; o < 2; ++o) {
+                Session session{ o == 0 ? referenceLimits : limits, o == 0 ? 0 : level };
+                if (results[o].ok()) {
+                    results[o] = session.run(programs[o], input);
+                }
+            }
+            const Session::Result& reference = results[0];
+            const Session::Result& optimized = results[1];
+            std::cout << optimized.output << std::flush;
+            bool same;
+            if (stoppedByBudget(reference) || stoppedByBudget(optimized)) {
+                size_t common = std::min(reference.output.size(), optimized.output.size());
+                same = reference.output.compare(0, common, optimized.output, 0, common) == 0
+                    && (stoppedByBudget(reference) || optimized.output.size() <= reference.output.size())
+                    && (stoppedByBudget(optimized) || reference.output.size() <= optimized.output.size());
+            }
+            else {
+                same = reference.status == optimized.status && reference.message == optimized.message && reference.output == optimized.output;
+            }
+            if (!same) {
+                std::cerr << "Optimization mismatch at -O" << level << std::endl;
+                std::cerr << "  -O0: " << Session::statusName(reference.status) << " " << reference.message
+                    << ", " << reference.output.size() << " bytes of output" << std::endl;
+                std::cerr << "  -O" << level << ": " << Session::statusName(optimized.status) << " " << optimized.message
+                    << ", " << optimized.output.size() << " bytes of output" << std::endl;
+                auto diff = std::mismatch(reference.output.begin(), reference.output.end(), optimized.output.begin(), optimized.output.end());
+                if (diff.first != reference.output.end() || diff.second != optimized.output.end()) {
+                    std::cerr << "  outputs differ at byte " << (diff.first - reference.output.begin()) << std::endl;
+                }
+                return EXIT_FAILURE;
+            }
+            if (!optimized.ok()) {
+                std::cerr << Session::statusName(optimized.status) << std::endl;
+                std::cerr << optimized.message << std::endl;
+                return EXIT_FAILURE;
+            }
+            return 0;
+        }
+        catch (std::exception& exc) {
+            std::cerr << exc.what() << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+
+    // Splits a comma separated list.
+    std::vector<std::string> splitList(const std::string& list) {
+        std::vector<std::string> items;
+        std::istringstream stream{ list };
+        std::string item;
+        while (std::getline(stream, item, ',')) {
+            items.push_back(item);
+        }
+        return items;
+    }
+
+    // Stack of the thread running the interpreter with --stack-evaluator: it holds the recursion of the parser and
+    // of the passes before the run on a program nested Parser::STACK_EVALUATOR_MAX_DEPTH levels deep.
+    constexpr size_t LARGE_STACK_BYTES = size_t(1) << 30;
+
+    // Runs the function on a new thread with a stack of the given size and waits for it; false if the thread
+    // cannot be created.
+    bool runOnStack(size_t bytes, std::function<void()> function) {
+        pthread_attr_t attributes;
+        pthread_attr_init(&attributes);
+        pthread_t thread;
+        bool started = pthread_attr_setstacksize(&attributes, bytes) == 0
+            && pthread_create(&thread, &attributes, [](void* f) -> void* {
+                (*static_cast<std::function<void()>*>(f))();
+                return nullptr;
+            }, &function) == 0;
+        pthread_attr_destroy(&attributes);
+        if (started) {
+            pthread_join(thread, nullptr);
+        }
+        return started;
+    }
+}
+
+// The interpreter, parsing programs nested at most maxDepth levels deep.
+static int interpret(int argc, char* argv[], int maxDepth)
 {
-    // Retrieve the filename from the program's arguments
+    // Retrieve the filename and the options from the program's arguments
+    // Options start with "--", the first other argument is the program file
+    const char* fileName = nullptr;
+    std::string inputFileName;
+    bool allocStats = false;
+    bool profile = false;
+    std::string profileFileName;
+    bool stats = false;
+    std::string statsFileName;
+    bool emitC = false;
+    std::string emitCFileName;
+    std::string batchFileName;
+    std::string lanesFileName;
+    size_t laneWidth = LaneRunner::DEFAULT_WIDTH;
+    unsigned jobs = 0;
+    std::string serveSocket;
+    size_t cacheSize = ProgramCache::DEFAULT_BUDGET;
+    std::string connectSocket;
+    int repeat = 1;
+    bool stream = false;
+    ExecutionLimits limits;
+    bool stackEvaluator = false;
+    bool memo = false;
+    bool dumpRanges = false;
+    bool ssa = false;
+    bool dumpSsa = false;
+    bool specialize = false;
+    std::vector<Value> knownInputs;
+    size_t memoThreshold = ExpressionMemo::DEFAULT_THRESHOLD;
+    bool parallelReductions = false;
+    unsigned reductionThreads = 0;
+    int optimization = PassManager::DEFAULT_LEVEL;
+    std::vector<std::string> dumpAfter;
+    bool passTimes = false;
+    bool verifyOptimization = false;
+    bool badArgument = false;
+    int flushPolicy = BufferedOutputSink::FLUSH_ON_SIZE | BufferedOutputSink::FLUSH_ON_INPUT;
+    size_t outputBuffer = BufferedOutputSink::DEFAULT_CAPACITY;
+    BufferedOutputSink::Format outputFormat = BufferedOutputSink::TEXT;
+    for (int a = 1; a < argc; ++a) {
+        std::string arg = argv[a];
+        if (arg == "--alloc-stats") {
+            allocStats = true;
+        }
+        else if (PassManager::parseLevel(arg, optimization)) {
+        }
+        else if (arg.rfind("--dump-after=", 0) == 0) {
+            dumpAfter = splitList(arg.substr(13));
+        }
+        else if (arg == "--pass-times") {
+            passTimes = true;
+        }
+        else if (arg == "--verify-opt") {
+            verifyOptimization = true;
+        }
+        else if (arg.rfind("--flush=", 0) == 0) {
+            try {
+                flushPolicy = BufferedOutputSink::parsePolicy(arg.substr(8));
+            }
+            catch (std::exception& exc) {
+                std::cerr << exc.what() << std::endl;
+                return EXIT_FAILURE;
+            }
+        }
+        else if (arg.rfind("--output-buffer=", 0) == 0) {
+            outputBuffer = std::strtoul(arg.c_str() + 16, nullptr, 10);
+        }
+        else if (arg == "--binary-output") {
+            outputFormat = BufferedOutputSink::BINARY_INT64;
+        }
+        else if (arg.rfind("--input=", 0) == 0) {
+            inputFileName = arg.substr(8);
+        }
+        else if (arg == "--profile") {
+            profile = true;
+        }
+        else if (arg.rfind("--profile=", 0) == 0) {
+            profile = true;
+            profileFileName = arg.substr(10);
+        }
+        else if (arg == "--stats") {
+            stats = true;
+        }
+        else if (arg.rfind("--stats=", 0) == 0) {
+            stats = true;
+            statsFileName = arg.substr(8);
+        }
+        else if (arg == "--stack-evaluator") {
+            stackEvaluator = true;
+        }
+        else if (arg == "--memo") {
+            memo = true;
+        }
+        else if (arg.rfind("--memo=", 0) == 0) {
+            memo = true;
+            memoThreshold = std::strtoul(arg.c_str() + 7, nullptr, 10);
+        }
+        else if (arg == "--parallel-reductions") {
+            parallelReductions = true;
+        }
+        else if (arg.rfind("--parallel-reductions=", 0) == 0) {
+            parallelReductions = true;
+            reductionThreads = std::strtoul(arg.c_str() + 22, nullptr, 10);
+        }
+        else if (arg == "--dump-ranges") {
+            dumpRanges = true;
+        }
+        else if (arg == "--ssa") {
+            ssa = true;
+        }
+        else if (arg == "--dump-ssa") {
+            dumpSsa = true;
+        }
+        else if (arg.rfind("--specialize=", 0) == 0) {
+            specialize = true;
+            for (const std::string& item : splitList(arg.substr(13))) {
+                Value v;
+                if (!Value::fromChars(item.data(), item.data() + item.size(), v)) {
+                    std::cerr << "Not a number in --specialize: " << item << std::endl;
+                    return EXIT_FAILURE;
+                }
+                knownInputs.push_back(v);
+            }
+        }
+        else if (arg == "--emit-c") {
+            emitC = true;
+        }
+        else if (arg.rfind("--emit-c=", 0) == 0) {
+            emitC = true;
+            emitCFileName = arg.substr(9);
+        }
+        else if (arg.rfind("--batch=", 0) == 0) {
+            batchFileName = arg.substr(8);
+        }
+        else if (arg.rfind("--lanes=", 0) == 0) {
+            lanesFileName = arg.substr(8);
+        }
+        else if (arg.rfind("--lane-width=", 0) == 0) {
+            laneWidth = std::strtoul(arg.c_str() + 13, nullptr, 10);
+        }
+        else if (arg.rfind("--jobs=", 0) == 0) {
+            jobs = std::strtoul(arg.c_str() + 7, nullptr, 10);
+        }
+        else if (arg.rfind("--serve=", 0) == 0) {
+            serveSocket = arg.substr(8);
+        }
+        else if (arg.rfind("--cache-size=", 0) == 0) {
+            cacheSize = std::strtoul(arg.c_str() + 13, nullptr, 10);
+        }
+        else if (arg.rfind("--connect=", 0) == 0) {
+            connectSocket = arg.substr(10);
+        }
+        else if (arg.rfind("--max-steps=", 0) == 0) {
+            limits.maxSteps = std::strtoull(arg.c_str() + 12, nullptr, 10);
+        }
+        else if (arg.rfind("--time-limit=", 0) == 0) {
+            limits.timeLimit = std::chrono::milliseconds(std::strtoull(arg.c_str() + 13, nullptr, 10));
+        }
+        else if (arg.rfind("--max-output=", 0) == 0) {
+            limits.maxOutputBytes = std::strtoull(arg.c_str() + 13, nullptr, 10);
+        }
+        else if (arg.rfind("--max-value=", 0) == 0) {
+            limits.maxValueBytes = std::strtoull(arg.c_str() + 12, nullptr, 10);
+        }
+        else if (arg == "--stream") {
+            stream = true;
+        }
+        else if (arg.rfind("--repeat=", 0) == 0) {
+            repeat = std::max(1, std::atoi(arg.c_str() + 9));
+        }
+        else if (arg.rfind("-", 0) != 0 && fileName == nullptr) {
+            fileName = argv[a];
+        }
+        else {
+            std::cerr << "Unknown argument: " << arg << std::endl;
+            fileName = nullptr;
+            badArgument = true;
+            break;
+        }
+    }
+    if (!batchFileName.empty() && !badArgument) {
+        // Batch mode: the programs of the manifest are run concurrently and their results written in manifest order
+        try {
+            BatchRunner runner{ jobs, limits };
+            size_t failed = runner.run(BatchRunner::readManifest(batchFileName), std::cout);
+            return failed ? EXIT_FAILURE : 0;
+        }
+        catch (std::exception& exc) {
+            std::cerr << exc.what() << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+    if (!lanesFileName.empty() && fileName != nullptr) {
+        // Lanes mode: the program is run over every input set of the file at once, the results are written in order
+        try {
+            std::ifstream source{ fileName };
+            if (!source) {
+                std::cerr << "Cannot open " << fileName << std::endl;
+                return EXIT_FAILURE;
+            }
+            Session session{ limits, optimization };
+            ProgramHandle program;
+            Session::Result r = session.compile(source, program);
+            if (!r.ok()) {
+                std::cerr << Session::statusName(r.status) << std::endl;
+                std::cerr << r.message << std::endl;
+                return EXIT_FAILURE;
+            }
+            LaneRunner runner{ laneWidth, limits };
+            size_t failed = runner.run(program, LaneRunner::readInputSets(lanesFileName), std::cout);
+            return failed ? EXIT_FAILURE : 0;
+        }
+        catch (std::exception& exc) {
+            std::cerr << exc.what() << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+    if (!serveSocket.empty() && !badArgument) {
+        // Server mode: runs until SIGINT or SIGTERM, whose handler wakes the thread running the server
+        try {
+            Server server{ serveSocket, cacheSize, jobs, limits };
+            struct sigaction action {};
+            action.sa_handler = stopServer;
+            sigaction(SIGINT, &action, nullptr);
+            sigaction(SIGTERM, &action, nullptr);
+            server.run();
+            return 0;
+        }
+        catch (std::exception& exc) {
+            std::cerr << exc.what() << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+    if (!connectSocket.empty() && fileName != nullptr) {
+        return runClient(connectSocket, fileName, inputFileName, repeat, stream);
+    }
+    if (verifyOptimization && fileName != nullptr) {
+        // Both runs are compiled and evaluated by Sessions: the options reporting on the passes or the run, or
+        // choosing another evaluator, would be ignored
+        const char* ignored = passTimes ? "--pass-times" : !dumpAfter.empty() ? "--dump-after" : dumpRanges ? "--dump-ranges"
+            : profile ? "--profile" : stats ? "--stats" : allocStats ? "--alloc-stats" : stackEvaluator ? "--stack-evaluator"
+            : memo ? "--memo" : parallelReductions ? "--parallel-reductions" : ssa ? "--ssa" : dumpSsa ? "--dump-ssa"
+            : emitC ? "--emit-c" : specialize ? "--specialize"
+            : outputFormat == BufferedOutputSink::BINARY_INT64 ? "--binary-output" : nullptr;
+        if (ignored) {
+            std::cerr << "--verify-opt cannot be used with " << ignored << std::endl;
+            return EXIT_FAILURE;
+        }
+        return runVerified(fileName, inputFileName, optimization, limits);
+    }
     // In case of missing arguments, the program exits with an error
-    if (argc < 2) {
+    if (fileName == nullptr) {
         std::cerr << "Not specified file!" << std::endl;
-        std::cerr << "Use: " << argv[0] << " <nome_file>" << std::endl;
+        std::cerr << "Use: " << argv[0] << " [options] <nome_file>" << std::endl;
+        std::cerr << "  or: " << argv[0] << " --batch=<manifest> [--jobs=<n>]" << std::endl;
+        std::cerr << "  or: " << argv[0] << " --lanes=<inputs> [--lane-width=<n>] <nome_file>" << std::endl;
+        std::cerr << "  or: " << argv[0] << " --serve=<socket> [--jobs=<n>] [--cache-size=<bytes>]" << std::endl;
+        std::cerr << "  -O0, -O1, -O2              optimization level: no pass, the range analysis (default), or also" << std::endl;
+        std::cerr << "                             constant folding and algebraic simplification" << std::endl;
+        std::cerr << "  --dump-after=<passes>      write the program after the passes (comma separated, or all)" << std::endl;
+        std::cerr << "                             on the standard error" << std::endl;
+        std::cerr << "  --pass-times               report the time of every pass on the standard error" << std::endl;
+        std::cerr << "  --verify-opt               run the program also without optimizations and fail if the results differ" << std::endl;
+        std::cerr << "                             (with -O<n>, the limits and the input options only)" << std::endl;
+        std::cerr << "  --flush=exit|size|input    when the output buffer is written (comma separated)" << std::endl;
+        std::cerr << "  --output-buffer=<bytes>    size of the output buffer" << std::endl;
+        std::cerr << "  --binary-output            print values as 8 bytes binary integers" << std::endl;
+        std::cerr << "  --input=<file>             read the INPUT values from a file instead of the standard input" << std::endl;
+        std::cerr << "  --alloc-stats              report the allocations of every phase" << std::endl;
+        std::cerr << "  --profile[=<file>]         report the time spent in every statement on the standard error" << std::endl;
+        std::cerr << "                             and as JSON in <file> (default: <nome_file>.profile.json)" << std::endl;
+        std::cerr << "  --stats[=<file>]           report the time and memory used by the interpreter on the standard error" << std::endl;
+        std::cerr << "                             and as JSON in <file> (default: <nome_file>.stats.json)" << std::endl;
+        std::cerr << "  --stack-evaluator          evaluate without recursion, for programs nested up to 1000000 levels (not with --profile)" << std::endl;
+        std::cerr << "  --memo[=<nodes>]           cache the results of expressions of at least <nodes> nodes (default "
+            << ExpressionMemo::DEFAULT_THRESHOLD << ")" << std::endl;
+        std::cerr << "                             and report the hits on the standard error (not with --profile or --stack-evaluator)" << std::endl;
+        std::cerr << "  --parallel-reductions[=<n>]" << std::endl;
+        std::cerr << "                             run the loops that are sums or products over a counter in chunks" << std::endl;
+        std::cerr << "                             on n threads (default: one per core; not with --profile, --memo" << std::endl;
+        std::cerr << "                             or --stack-evaluator)" << std::endl;
+        std::cerr << "  --dump-ranges              report the range of every variable found by the range analysis" << std::endl;
+        std::cerr << "                             on the standard error before running the program (from -O1)" << std::endl;
+        std::cerr << "  --ssa                      run the program translated to SSA form and optimized (constant propagation," << std::endl;
+        std::cerr << "                             value numbering), with the children of PARALLEL in sequence" << std::endl;
+        std::cerr << "                             (not with --profile, --stack-evaluator, --memo or --parallel-reductions)" << std::endl;
+        std::cerr << "  --dump-ssa                 write the optimized SSA form and what the optimizations removed" << std::endl;
+        std::cerr << "                             on the standard error before running the program" << std::endl;
+        std::cerr << "  --specialize=<n>[,<n>...]  write on the standard output the program specialized for the values" << std::endl;
+        std::cerr << "                             read by its first INPUTs, instead of running it; the residual" << std::endl;
+        std::cerr << "                             program reads the input after the values it used" << std::endl;
+        std::cerr << "  --emit-c[=<file>]          write the program translated to C on the standard output or in <file>" << std::endl;
+        std::cerr << "                             instead of running it" << std::endl;
+        std::cerr << "  --max-steps=<n>            stop the program after n block entries and loop iterations" << std::endl;
+        std::cerr << "  --time-limit=<ms>          stop the program after ms milliseconds" << std::endl;
+        std::cerr << "  --max-output=<bytes>       stop the program before it prints more than bytes bytes" << std::endl;
+        std::cerr << "  --max-value=<bytes>        stop the program when it computes an integer of more than bytes bytes" << std::endl;
+        std::cerr << "  --batch=<manifest>         run concurrently the programs listed in the manifest, one per line," << std::endl;
+        std::cerr << "                             each followed by its optional input file" << std::endl;
+        std::cerr << "  --lanes=<inputs>           run the program over every line of <inputs>, a set of INPUT values," << std::endl;
+        std::cerr << "                             all at once, writing for each one its status and output" << std::endl;
+        std::cerr << "  --lane-width=<n>           input sets run together by --lanes (default " << LaneRunner::DEFAULT_WIDTH << ")" << std::endl;
+        std::cerr << "  --jobs=<n>                 threads used by --batch, --serve and the PARALLEL statements" << std::endl;
+        std::cerr << "                             (default: one per core)" << std::endl;
+        std::cerr << "  --serve=<socket>           run as a server on a Unix domain socket, caching the compiled programs" << std::endl;
+        std::cerr << "  --cache-size=<bytes>       memory budget of the server's program cache" << std::endl;
+        std::cerr << "  --connect=<socket>         run the program on the server (input from --input or the standard input)" << std::endl;
+        std::cerr << "  --repeat=<n>               with --connect, send the program n times and report the latencies" << std::endl;
+        std::cerr << "  --stream                   with --connect, send the input as it is read, while the program runs" << std::endl;
         return EXIT_FAILURE;
     }
+    if (profile && profileFileName.empty()) {
+        profileFileName = std::string(fileName) + ".profile.json";
+    }
+    if (stats && statsFileName.empty()) {
+        statsFileName = std::string(fileName) + ".stats.json";
+    }
+    // The phases are always timed, the report is written only with --stats
+    Stats statistics;
     // Try to open the file specified in the passed argument and handle exceptions in case of opening error 
     std::ifstream inputFile;
     try {
-        inputFile.open(argv[1]);
+        inputFile.open(fileName);
     }
     catch (std::exception& exc) {
-        std::cerr << "Cannot open " << argv[1] << std::endl;
+        std::cerr << "Cannot open " << fileName << std::endl;
         std::cerr << exc.what() << std::endl;
         return EXIT_FAILURE;
     }
@@ -38,6 +577,8 @@ int main(int argc, char* argv[])
 
     try {
         // Call the () function on inputFile and use std::move to transfer the returned vector from the function 
+        AllocCounter::beginPhase("tokenize");
+        statistics.beginPhase("tokenize");
         inputTokens = std::move(tokenize(inputFile));
         inputFile.close(); // Close the file since the information is now in the inputTokens vector
     }
@@ -49,7 +590,7 @@ int main(int argc, char* argv[])
     }
     catch (std::exception& exc) {
         // Catch exceptions propagated from any other sources that might throw an exception
-        std::cerr << "Cannot read from  " << argv[1] << std::endl;
+        std::cerr << "Cannot read from  " << fileName << std::endl;
         std::cerr << exc.what() << std::endl;
         return EXIT_FAILURE;
     }
@@ -64,44 +605,259 @@ int main(int argc, char* argv[])
     // Instantiate a SymbolTable to manage variable allocation and values during program interpretation
     SymbolTable ST;
 
+    // The printed values go through a buffered sink on the standard output
+    BufferedOutputSink out{ STDOUT_FILENO, outputBuffer, flushPolicy, outputFormat };
+
+    // The values of the INPUT statements come from the standard input or from the file given with --input
+    std::unique_ptr<InputSource> in;
+    try {
+        if (inputFileName.empty()) {
+            in.reset(new BufferedInputSource(STDIN_FILENO));
+        }
+        else {
+            in = BufferedInputSource::openFile(inputFileName);
+        }
+    }
+    catch (std::exception& exc) {
+        std::cerr << exc.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+
     // Lastly, instantiate the Function Class responsible for parsing
-    Parser parse{ NEM,BEM,SM,BM,PM };
+    Parser parse{ NEM,BEM,SM,BM,PM, maxDepth };
+
+    // With --profile the program is evaluated by a visitor timing every statement
+    Profiler profiler;
+    bool profiled = false;	// Once the profiled run started
 
+    // The limits of the run: the output is limited in front of the buffered sink, the steps and the time by the meter
+    LimitedOutputSink limitedOut{ out, limits.maxOutputBytes, outputFormat == BufferedOutputSink::BINARY_INT64 };
+    OutputSink& programOut = limits.maxOutputBytes ? static_cast<OutputSink&>(limitedOut) : out;
+    BudgetMeter meter{ limits };
+
+    // With --memo the evaluator caches the results of the large expressions
+    std::unique_ptr<ExpressionMemo> expressionMemo;
+    // With --parallel-reductions the reduction loops are run in chunks by the threads of the pool
+    std::unique_ptr<ReductionPlan> reductionPlan;
+    std::unique_ptr<ThreadPool> reductionPool;
+    // The children of the PARALLEL statements run on the threads of this pool (only with the default evaluator)
+    std::unique_ptr<ThreadPool> parallelPool;
+    // With --ssa the program runs as register code translated from its SSA form
+    std::unique_ptr<SsaCode> ssaCode;
+
+    // The reports below are written also when the program fails or is stopped by a limit, on what ran until then
+    int status = 0;
     try {
         // Call the () function on inputTokens, returning a pointer to the Program node, which is the initial node of the syntax tree
+        AllocCounter::beginPhase("parse");
+        statistics.beginPhase("parse");
         Program* p = parse(inputTokens);
 
-        // Uncomment the following lines to enable printing the syntax tree
-        // PrintVisitor* vipi = new PrintVisitor();
-        // p->accept(vipi);
+        // The passes of the optimization level transform the program, then resolve the variables to slots and find
+        // the reads that need no check, and from -O1 bound the values of the variables and operations, so that the
+        // operations that cannot overflow nor divide by zero are evaluated without checks.
+        // The reads of variables that are never assigned before are reported before the program runs
+        AllocCounter::beginPhase("analyse");
+        statistics.beginPhase("analyse");
+        PassManager passes{ optimization };
+        if (!dumpAfter.empty()) {
+            passes.dumpAfter(dumpAfter, std::cerr);
+        }
+        PassContext context{ NEM, BEM, SM, BM, PM, p };
+        passes.run(context);
+        p = context.program;
+        if (passTimes) {
+            passes.writeTimes(std::cerr);
+        }
+        const AssignmentPass* analyse = static_cast<const AssignmentPass*>(passes.find("assignments"));
+        for (const AssignmentAnalysis::Warning& w : analyse->getWarnings()) {
+            std::cerr << "Warning: variable " << w.variable << " is read before being assigned (line " << w.line
+                << ", column " << w.column << ")" << std::endl;
+        }
+        if (dumpRanges) {
+            if (optimization >= 1) {
+                static_cast<const RangePass*>(passes.find("ranges"))->getRanges().writeRanges(std::cerr);
+            }
+            else {
+                std::cerr << "No range analysis at -O0" << std::endl;
+            }
+        }
+        // With --specialize the residual program is written instead of evaluated
+        if (specialize) {
+            Specializer specializer{ NEM, BEM, SM, BM, PM };
+            Program* residual = specializer(p, knownInputs);
+            PrintVisitor print{ std::cout };
+            residual->accept(&print);
+            std::cout.flush();
+            std::cerr << "Specialized: " << specializer.getConsumed() << " of " << knownInputs.size()
+                << " known inputs read, " << specializer.getUnrolled() << " loop iterations unrolled" << std::endl;
+            return 0;
+        }
+        // The SSA form is evaluated only without the options choosing another evaluator
+        bool runSsa = ssa && !profile && !stackEvaluator && !memo && !parallelReductions;
+        if (runSsa || dumpSsa) {
+            SsaFunction function{ p };
+            function.optimize();
+            if (dumpSsa) {
+                function.write(std::cerr);
+                function.writeReport(std::cerr);
+            }
+            ssaCode.reset(new SsaCode(function));
+        }
+
+        // With --emit-c the program is translated instead of evaluated
+        if (emitC) {
+            CEmitterVisitor emitter;
+            if (emitCFileName.empty()) {
+                emitter.emit(p, std::cout);
+                std::cout.flush();
+            }
+            else {
+                std::ofstream cFile{ emitCFileName };
+                emitter.emit(p, cFile);
+                if (!cFile) {
+                    std::cerr << "Cannot write the C program to " << emitCFileName << std::endl;
+                    return EXIT_FAILURE;
+                }
+            }
+            return 0;
+        }
 
-        // Instantiate a visitor responsible for evaluating the syntax tree
-        EvaluatorVisitor* viev = new EvaluatorVisitor(ST);
-        // When p accepts the program, the visitor starts traversing the tree and interpreting the program
-        p->accept(viev);
+        AllocCounter::beginPhase("evaluate");
+        statistics.beginPhase("evaluate");
+        if (runSsa) {
+            SsaEvaluator evaluator{ ST, programOut, *in };
+            if (limits.metered()) {
+                evaluator.setBudget(meter);
+            }
+            evaluator.run(*ssaCode, p);
+        }
+        else if (stackEvaluator && !profile) {
+            // The evaluation keeps its frames on the heap instead of the call stack
+            StackEvaluator evaluator{ ST, programOut, *in };
+            if (limits.metered()) {
+                evaluator.setBudget(meter);
+            }
+            evaluator.run(p);
+        }
+        else {
+            // Instantiate a visitor responsible for evaluating the syntax tree
+            EvaluatorVisitor* viev;
+            if (profile) {
+                viev = new ProfilerVisitor(ST, programOut, *in, profiler);
+            }
+            else if (memo) {
+                expressionMemo.reset(new ExpressionMemo(p, memoThreshold));
+                viev = new MemoVisitor(ST, programOut, *in, *expressionMemo);
+            }
+            else if (parallelReductions) {
+                reductionPlan.reset(new ReductionPlan(p));
+                reductionPool.reset(new ThreadPool(reductionThreads));
+                viev = new ReductionVisitor(ST, programOut, *in, *reductionPlan, *reductionPool);
+            }
+            else {
+                viev = new EvaluatorVisitor(ST, programOut, *in);
+                if (p->getParallelStatements() != 0) {
+                    parallelPool.reset(new ThreadPool(jobs));
+                    viev->setPool(*parallelPool);
+                }
+            }
+            if (limits.metered()) {
+                viev->setBudget(meter);
+            }
+            // When p accepts the program, the visitor starts traversing the tree and interpreting the program
+            profiler.start();
+            profiled = profile;
+            p->accept(viev);
+            profiler.stop();
+        }
+        AllocCounter::endPhase();
+        out.flush();
+        statistics.endPhase();
     }
     catch (ParseError& pe) {
         // Catch exceptions propagated from parsing errors
         std::cerr << "Error in parsing" << std::endl;
         std::cerr << pe.what() << std::endl;
-        return EXIT_FAILURE;
+        status = EXIT_FAILURE;
     }
     catch (SemanticError& se) {
         // Catch exceptions propagated from interpretation and semantic errors in the program
+        // What was printed before the error is written first, so the two outputs keep their order
+        out.flush();
         std::cerr << "Error in semantic analysis" << std::endl;
         std::cerr << se.what() << std::endl;
-        return EXIT_FAILURE;
+        status = EXIT_FAILURE;
+    }
+    catch (BudgetExceeded& be) {
+        // The program was stopped by one of its limits
+        out.flush();
+        std::cerr << "Execution budget exceeded" << std::endl;
+        std::cerr << be.what() << std::endl;
+        status = EXIT_FAILURE;
     }
     catch (std::exception& exc) {
         // Catch exceptions propagated from any other sources that might throw an exception
+        out.flush();
         std::cerr << "Error" << std::endl;
         std::cerr << exc.what() << std::endl;
-        return EXIT_FAILURE;
+        status = EXIT_FAILURE;
+    }
+    if (status != 0) {
+        // The phases and the profiled run end at the error
+        AllocCounter::endPhase();
+        statistics.endPhase();
+        if (profiled) {
+            profiler.stop();
+        }
+    }
+    if (allocStats) {
+        AllocCounter::report(std::cerr);
     }
-    return 0;
+    if (expressionMemo) {
+        expressionMemo->writeText(std::cerr);
+    }
+    if (stats) {
+        statistics.setTokens(inputTokens.size());
+        statistics.addManager("NumExprManager", NEM);
+        statistics.addManager("BoolExprManager", BEM);
+        statistics.addManager("StatementManager", SM);
+        statistics.addManager("BlockManager", BM);
+        statistics.addManager("ProgramManager", PM);
+        statistics.setSymbolTable(ST);
+        statistics.writeText(std::cerr);
+        std::ofstream statsFile{ statsFileName };
+        statistics.writeJson(statsFile);
+        if (!statsFile) {
+            std::cerr << "Cannot write the statistics to " << statsFileName << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+    if (profiled) {
+        profiler.writeText(std::cerr);
+        std::ofstream profileFile{ profileFileName };
+        profiler.writeJson(profileFile);
+        if (!profileFile) {
+            std::cerr << "Cannot write the profile to " << profileFileName << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+    return status;
 
 
     // cosa devo ancora fare : 
     // dynamic cast in parsing Set 
     // fare uml 
-}
\ No newline at end of file
+}
+int main(int argc, char* argv[])
+{
+    // The StackEvaluator does not recurse, but the parser and the passes before the run do: with it the interpreter
+    // runs on a thread with a large stack, and accepts programs nested up to STACK_EVALUATOR_MAX_DEPTH levels deep
+    if (std::find(argv + 1, argv + argc, std::string("--stack-evaluator")) != argv + argc) {
+        int result = EXIT_FAILURE;
+        if (runOnStack(LARGE_STACK_BYTES, [&] { result = interpret(argc, argv, Parser::STACK_EVALUATOR_MAX_DEPTH); })) {
+            return result;
+        }
+    }
+    return interpret(argc, argv, Parser::DEFAULT_MAX_DEPTH);
+}
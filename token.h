@@ -35,22 +35,39 @@ class token
 	static constexpr int RP = 19;
 	static constexpr int NUMBER = 20;
 	static constexpr int VARIABLE_ID = 21;
+	static constexpr int PARALLEL = 22;
+	// Array statements and expressions, in the order of the kinds of ArrayStmt and ArrayExpr
+	static constexpr int ARRAY = 23;
+	static constexpr int PUT = 24;
+	static constexpr int VADD = 25;
+	static constexpr int VSUB = 26;
+	static constexpr int VMUL = 27;
+	static constexpr int VLT = 28;
+	static constexpr int VGT = 29;
+	static constexpr int VEQ = 30;
+	static constexpr int GET = 31;
+	static constexpr int SUM = 32;
+	static constexpr int LEN = 33;
 
 
 	static constexpr const char* id2word[]{
-		"BLOCK", "INPUT", "PRINT", "SET", "WHILE", "IF", "GT", "LT", "EQ", "AND", "OR", "NOT", "ADD", "SUB", "MUL", "DIV", "TRUE", "FALSE", "(", ")", "NUMBER", "VARIABLE_ID"
+		"BLOCK", "INPUT", "PRINT", "SET", "WHILE", "IF", "GT", "LT", "EQ", "AND", "OR", "NOT", "ADD", "SUB", "MUL", "DIV", "TRUE", "FALSE", "(", ")", "NUMBER", "VARIABLE_ID", "PARALLEL",
+		"ARRAY", "PUT", "VADD", "VSUB", "VMUL", "VLT", "VGT", "VEQ", "GET", "SUM", "LEN"
 	};
 
 	// By creating constructors with parameters, the default constructor without parameters is automatically deleted.
 
-	token(int t, const char* w) : tag{ t }, word{ w } { }
+	token(int t, const char* w, int l = 0, int c = 0) : tag{ t }, word{ w }, line{ l }, column{ c } { }
 
-	token(int t, std::string w) : tag{ t }, word{ w } { }
+	token(int t, std::string w, int l = 0, int c = 0) : tag{ t }, word{ w }, line{ l }, column{ c } { }
 
 	
 
 	int tag;
 	std::string word;
+	// Position of the first character of the token in the source (starting from 1), used to report where statements are.
+	int line;
+	int column;
 
 };
 
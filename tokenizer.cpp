@@ -10,18 +10,19 @@
 // When the string consists only of uppercase or lowercase letters and there's no match with other tokens,
 // a variable is created with the name from the current string.
 
-void tokenizer::tokenizeInputFiles(std::ifstream& inputFile, std::vector<token>& inputTokens) {
+void tokenizer::tokenizeInputFiles(std::istream& inputFile, std::vector<token>& inputTokens) {
 	std::string parole;
 	if (inputFile.eof()) {
 		throw LexicalError("Empty program");
 		return;
 	}
-	char ch = inputFile.get();
+	char ch = nextChar(inputFile);
 	
 	while (std::isspace(ch)) {
-		ch = inputFile.get();
+		ch = nextChar(inputFile);
 	}
 	parole.push_back(ch);
+	wordLine = line; wordColumn = column;
 	// Continue the loop until the characters from the file are exhausted
 	while (!inputFile.eof()) {
 		if (ch == '(') {
@@ -39,15 +40,16 @@ void tokenizer::tokenizeInputFiles(std::ifstream& inputFile, std::vector<token>&
 						throw LexicalError(tmp.str());
 					}
 				}
-				inputTokens.push_back(token{ token::VARIABLE_ID, parole.c_str() });
+				inputTokens.push_back(token{ token::VARIABLE_ID, parole.c_str(), wordLine, wordColumn });
 			}
-			inputTokens.push_back(token{ token::LP, token::id2word[token::LP] });
+			inputTokens.push_back(token{ token::LP, token::id2word[token::LP], line, column });
 			parole.clear();
-			ch = inputFile.get();
+			ch = nextChar(inputFile);
 			while (std::isspace(ch)) {
-				ch = inputFile.get();
+				ch = nextChar(inputFile);
 			}
 			parole.push_back(ch);
+			wordLine = line; wordColumn = column;
 			continue;
 			
 		}
@@ -63,106 +65,174 @@ void tokenizer::tokenizeInputFiles(std::ifstream& inputFile, std::vector<token>&
 						throw LexicalError(tmp.str());
 					}
 				}
-				inputTokens.push_back(token{ token::VARIABLE_ID, parole.c_str() });
+				inputTokens.push_back(token{ token::VARIABLE_ID, parole.c_str(), wordLine, wordColumn });
 			}
-			inputTokens.push_back(token{ token::RP, token::id2word[token::RP] });
+			inputTokens.push_back(token{ token::RP, token::id2word[token::RP], line, column });
 			parole.clear();
-			ch = inputFile.get();
+			ch = nextChar(inputFile);
 			while (std::isspace(ch)) {
-				ch = inputFile.get();
+				ch = nextChar(inputFile);
 			}
 			parole.push_back(ch);
+			wordLine = line; wordColumn = column;
+			continue;
+		}
+		// A keyword is a whole word: while a letter follows, the word goes on (SUMMARY or SETX is a variable).
+		else if (std::isalpha(static_cast<unsigned char>(parole[0])) && std::isalpha(inputFile.peek()))
+		{
+			ch = nextChar(inputFile);
+			parole.push_back(ch);
 			continue;
 		}
 		// From here, check if the word in "parole" matches any of the tokens.
 		else if (!parole.compare("BLOCK"))
 		{
-			inputTokens.push_back(token{ token::BLOCK, token::id2word[token::BLOCK] });
+			inputTokens.push_back(token{ token::BLOCK, token::id2word[token::BLOCK], wordLine, wordColumn });
 			parole.clear();
 		}
 		else if (!parole.compare("INPUT"))
 		{
-			inputTokens.push_back(token{ token::INPUT, token::id2word[token::INPUT] });
+			inputTokens.push_back(token{ token::INPUT, token::id2word[token::INPUT], wordLine, wordColumn });
 			parole.clear();
 		}
 		else if (!parole.compare("PRINT"))
 		{
-			inputTokens.push_back(token{ token::PRINT, token::id2word[token::PRINT] });
+			inputTokens.push_back(token{ token::PRINT, token::id2word[token::PRINT], wordLine, wordColumn });
 			parole.clear();
 		}
 		else if (!parole.compare("SET"))
 		{
-			inputTokens.push_back(token{ token::SET, token::id2word[token::SET] });
+			inputTokens.push_back(token{ token::SET, token::id2word[token::SET], wordLine, wordColumn });
+			parole.clear();
+		}
+		else if (!parole.compare("PARALLEL"))
+		{
+			inputTokens.push_back(token{ token::PARALLEL, token::id2word[token::PARALLEL], wordLine, wordColumn });
+			parole.clear();
+		}
+		else if (!parole.compare("ARRAY"))
+		{
+			inputTokens.push_back(token{ token::ARRAY, token::id2word[token::ARRAY], wordLine, wordColumn });
+			parole.clear();
+		}
+		else if (!parole.compare("PUT"))
+		{
+			inputTokens.push_back(token{ token::PUT, token::id2word[token::PUT], wordLine, wordColumn });
+			parole.clear();
+		}
+		else if (!parole.compare("VADD"))
+		{
+			inputTokens.push_back(token{ token::VADD, token::id2word[token::VADD], wordLine, wordColumn });
+			parole.clear();
+		}
+		else if (!parole.compare("VSUB"))
+		{
+			inputTokens.push_back(token{ token::VSUB, token::id2word[token::VSUB], wordLine, wordColumn });
+			parole.clear();
+		}
+		else if (!parole.compare("VMUL"))
+		{
+			inputTokens.push_back(token{ token::VMUL, token::id2word[token::VMUL], wordLine, wordColumn });
+			parole.clear();
+		}
+		else if (!parole.compare("VLT"))
+		{
+			inputTokens.push_back(token{ token::VLT, token::id2word[token::VLT], wordLine, wordColumn });
+			parole.clear();
+		}
+		else if (!parole.compare("VGT"))
+		{
+			inputTokens.push_back(token{ token::VGT, token::id2word[token::VGT], wordLine, wordColumn });
+			parole.clear();
+		}
+		else if (!parole.compare("VEQ"))
+		{
+			inputTokens.push_back(token{ token::VEQ, token::id2word[token::VEQ], wordLine, wordColumn });
+			parole.clear();
+		}
+		else if (!parole.compare("GET"))
+		{
+			inputTokens.push_back(token{ token::GET, token::id2word[token::GET], wordLine, wordColumn });
+			parole.clear();
+		}
+		else if (!parole.compare("SUM"))
+		{
+			inputTokens.push_back(token{ token::SUM, token::id2word[token::SUM], wordLine, wordColumn });
+			parole.clear();
+		}
+		else if (!parole.compare("LEN"))
+		{
+			inputTokens.push_back(token{ token::LEN, token::id2word[token::LEN], wordLine, wordColumn });
 			parole.clear();
 		}
 		else if (!parole.compare("WHILE"))
 		{
-			inputTokens.push_back(token{ token::WHILE, token::id2word[token::WHILE] });
+			inputTokens.push_back(token{ token::WHILE, token::id2word[token::WHILE], wordLine, wordColumn });
 			parole.clear();
 		}
 		else if (!parole.compare("IF"))
 		{
-			inputTokens.push_back(token{ token::IF, token::id2word[token::IF] });
+			inputTokens.push_back(token{ token::IF, token::id2word[token::IF], wordLine, wordColumn });
 			parole.clear();
 		}
 		else if (!parole.compare("GT"))
 		{
-			inputTokens.push_back(token{ token::GT, token::id2word[token::GT] });
+			inputTokens.push_back(token{ token::GT, token::id2word[token::GT], wordLine, wordColumn });
 			parole.clear();
 		}
 		else if (!parole.compare("LT"))
 		{
-			inputTokens.push_back(token{ token::LT, token::id2word[token::LT] });
+			inputTokens.push_back(token{ token::LT, token::id2word[token::LT], wordLine, wordColumn });
 			parole.clear();
 		}
 		else if (!parole.compare("EQ"))
 		{
-			inputTokens.push_back(token{ token::EQ, token::id2word[token::EQ] });
+			inputTokens.push_back(token{ token::EQ, token::id2word[token::EQ], wordLine, wordColumn });
 			parole.clear();
 		}
 		else if (!parole.compare("AND"))
 		{
-			inputTokens.push_back(token{ token::AND, token::id2word[token::AND] });
+			inputTokens.push_back(token{ token::AND, token::id2word[token::AND], wordLine, wordColumn });
 			parole.clear();
 		}
 		else if (!parole.compare("OR"))
 		{
-			inputTokens.push_back(token{ token::OR, token::id2word[token::OR] });
+			inputTokens.push_back(token{ token::OR, token::id2word[token::OR], wordLine, wordColumn });
 			parole.clear();
 		}
 		else if (!parole.compare("NOT"))
 		{
-			inputTokens.push_back(token{ token::NOT, token::id2word[token::NOT] });
+			inputTokens.push_back(token{ token::NOT, token::id2word[token::NOT], wordLine, wordColumn });
 			parole.clear();
 		}
 		else if (!parole.compare("ADD"))
 		{
-			inputTokens.push_back(token{ token::ADD, token::id2word[token::ADD] });
+			inputTokens.push_back(token{ token::ADD, token::id2word[token::ADD], wordLine, wordColumn });
 			parole.clear();
 		}
 		else if (!parole.compare("SUB"))
 		{
-			inputTokens.push_back(token{ token::SUB, token::id2word[token::SUB] });
+			inputTokens.push_back(token{ token::SUB, token::id2word[token::SUB], wordLine, wordColumn });
 			parole.clear();
 		}
 		else if (!parole.compare("MUL"))
 		{
-			inputTokens.push_back(token{ token::MUL, token::id2word[token::MUL] });
+			inputTokens.push_back(token{ token::MUL, token::id2word[token::MUL], wordLine, wordColumn });
 			parole.clear();
 		}
 		else if (!parole.compare("DIV"))
 		{
-			inputTokens.push_back(token{ token::DIV, token::id2word[token::DIV] });
+			inputTokens.push_back(token{ token::DIV, token::id2word[token::DIV], wordLine, wordColumn });
 			parole.clear();
 		}
 		else if (!parole.compare("TRUE"))
 		{
-			inputTokens.push_back(token{ token::TRUE, token::id2word[token::TRUE] });
+			inputTokens.push_back(token{ token::TRUE, token::id2word[token::TRUE], wordLine, wordColumn });
 			parole.clear();
 		}
 		else if (!parole.compare("FALSE"))
 		{
-			inputTokens.push_back(token{ token::FALSE, token::id2word[token::FALSE] });
+			inputTokens.push_back(token{ token::FALSE, token::id2word[token::FALSE], wordLine, wordColumn });
 			parole.clear();
 		} 
 		// If the first character of "parole" is a digit or minus sign, it indicates a number.
@@ -176,7 +246,7 @@ void tokenizer::tokenizeInputFiles(std::ifstream& inputFile, std::vector<token>&
 
 			// Loop to collect all digits and add them to "tmp" 
 			do {
-				ch = inputFile.get();
+				ch = nextChar(inputFile);
 				if (std::isdigit(ch)) tmp.push_back(ch);
 			} while (std::isdigit(ch));
 
@@ -186,7 +256,7 @@ void tokenizer::tokenizeInputFiles(std::ifstream& inputFile, std::vector<token>&
 				tmp1 << "Invalid number: " << tmp;
 				throw LexicalError(tmp1.str());
 			}
-			inputTokens.push_back(token{ token::NUMBER, tmp });
+			inputTokens.push_back(token{ token::NUMBER, tmp, wordLine, wordColumn });
 			parole.clear();
 
 			// Check if there's a space or parenthesis after the number.
@@ -196,6 +266,7 @@ void tokenizer::tokenizeInputFiles(std::ifstream& inputFile, std::vector<token>&
 			}
 			else if (ch == '(' || ch == ')') {
 				parole.push_back(ch);
+				wordLine = line; wordColumn = column;
 			}
 			else if (inputFile.eof()) {
 
@@ -211,7 +282,7 @@ void tokenizer::tokenizeInputFiles(std::ifstream& inputFile, std::vector<token>&
 			// If the word doesn't match any token, process the next character.
 			// If it's a space, it indicates the previous word ended, and it is a VARIABLE_ID.
 			// If not, it means the previous word isn't finished yet, so add the character to "parole"
-			ch = inputFile.get();
+			ch = nextChar(inputFile);
 			if (std::isspace(ch)) {
 				for (char cr : parole) {
 					if (!isalpha(cr)) {
@@ -220,12 +291,13 @@ void tokenizer::tokenizeInputFiles(std::ifstream& inputFile, std::vector<token>&
 						throw LexicalError(tmp.str());
 					}
 				}
-				inputTokens.push_back(token{ token::VARIABLE_ID, parole });
+				inputTokens.push_back(token{ token::VARIABLE_ID, parole, wordLine, wordColumn });
 				parole.clear();
 				while (std::isspace(ch)) {
-					ch = inputFile.get();
+					ch = nextChar(inputFile);
 				}
 				parole.push_back(ch);
+				wordLine = line; wordColumn = column;
 
 			}
 			else
@@ -238,10 +310,10 @@ void tokenizer::tokenizeInputFiles(std::ifstream& inputFile, std::vector<token>&
 		// If execution reaches here, it means there was a match with a token that wasn't '(' or ')', NUMBER, or VARIABLE_ID and "word" is empty.
 		// Since a token was just processed, the next character should be a space or parenthesis.
 		// If it's a space, skip all spaces.
-		ch = inputFile.get();
+		ch = nextChar(inputFile);
 		if (std::isspace(ch)) {
 			while (std::isspace(ch)) {
-				ch = inputFile.get();
+				ch = nextChar(inputFile);
 			}
 		}
 		else if (ch == '(' || ch == ')') {
@@ -256,6 +328,7 @@ void tokenizer::tokenizeInputFiles(std::ifstream& inputFile, std::vector<token>&
 			throw LexicalError(tmp.str());
 		}
 		parole.push_back(ch);
+		wordLine = line; wordColumn = column;
 	}
 }
 
@@ -2,7 +2,7 @@
 #define TOKENIZER_H
 
 #include <vector>
-#include <fstream>
+#include <istream>
 
 // Including "token.h" because it's needed for using tokens, and there's no risk of infinite inclusion
 // since "tokenizer.h" is not included in "token.h".
@@ -13,15 +13,38 @@ class tokenizer
 public: 
 	// Overloading the () operator to perform tokenization of the input file.
 	// Returns a vector of tokens resulting from the tokenization process.
-	std::vector<token> operator()(std::ifstream& inputFile) {
+	// Any input stream can be tokenized (a file, or a string stream for programs built in memory).
+	std::vector<token> operator()(std::istream& inputFile) {
 		std::vector<token> inputTokens;
+		line = 0;
+		column = 0;
+		atLineStart = true;
 		tokenizeInputFiles(inputFile, inputTokens);
 		return inputTokens;
 	}
 
 private:
 	// The actual tokenization is done by this function, which takes the input file and a token vector as parameters.
-	void tokenizeInputFiles(std::ifstream& inputFile, std::vector<token>& inputTokens);
+	void tokenizeInputFiles(std::istream& inputFile, std::vector<token>& inputTokens);
+
+	// Reads the next character, keeping track of its line and column.
+	char nextChar(std::istream& inputFile) {
+		char ch = inputFile.get();
+		if (atLineStart) {
+			++line;
+			column = 0;
+		}
+		++column;
+		atLineStart = ch == '\n';
+		return ch;
+	}
+
+	// Position of the last character read and of the first character of the word being built.
+	int line = 0;
+	int column = 0;
+	bool atLineStart = true;
+	int wordLine = 0;
+	int wordColumn = 0;
 };
 
 